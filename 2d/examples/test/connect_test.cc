@@ -0,0 +1,93 @@
+// Connectivity test code
+// Example code for Voro++, a cell-based Voronoi library
+// By Chris H. Rycroft and the Rycroft Group
+
+#include "v_connect.hh"
+using namespace voro;
+
+// The number of failed checks
+int failures=0;
+
+// Records the outcome of a check, printing a message if it failed
+void check(bool ok,const char *msg) {
+    if(!ok) {
+        fprintf(stderr,"connect_test: %s\n",msg);
+        failures++;
+    }
+}
+
+// Returns true if a row of a connectivity table contains a given entry
+bool has(const csr_table::row &r,int b) {
+    for(int k=0;k<r.size();k++) if(r[k]==b) return true;
+    return false;
+}
+
+int main(int argc,char **argv) {
+    if(argc!=2&&argc!=3) {
+        fputs("Syntax: connect_test <input_file> [<output_file>]\n",stderr);
+        return 1;
+    }
+
+    // Import the generators and assemble all of the connectivity tables
+    v_connect vc;
+    vc.import(argv[1]);
+    vc.assemble_vertex();
+    vc.assemble_gen_ed();
+    vc.assemble_boundary();
+
+    // The cells tile a region without holes, so Euler's formula for a planar
+    // graph relates the numbers of vertices, edges, and cells
+    check(vc.nv-vc.ne+vc.ng==1,"Numbers of vertices, edges, and cells do not satisfy Euler's formula");
+
+    // Each edge joins two vertices and separates two generators, or lies on
+    // the outside of the tessellation and touches one generator. It must
+    // appear in the tables for each of them.
+    bool ok=true;
+    int eg_total=0,ge_total=0;
+    for(int i=0;i<vc.ne&&ok;i++) {
+        int v1=vc.ed_to_vert[2*i],v2=vc.ed_to_vert[2*i+1];
+        csr_table::row eg=vc.ed_to_gen[i];
+        ok=v1>=0&&v1<v2&&v2<vc.nv&&(eg.size()==1||eg.size()==2)
+         &&has(vc.vert_to_ed[v1],i)&&has(vc.vert_to_ed[v2],i);
+        for(int k=0;k<eg.size()&&ok;k++)
+            ok=has(vc.gen_to_ed[eg[k]],i)||has(vc.gen_to_ed[eg[k]],~i);
+        eg_total+=eg.size();
+    }
+    for(int i=0;i<vc.ng;i++) ge_total+=vc.gen_to_ed[i].size();
+    check(ok&&eg_total==ge_total,"Edge tables are inconsistent");
+
+    // Each cell has as many edges as vertices, and the vertex and generator
+    // tables must refer to each other
+    ok=true;
+    for(int i=0;i<vc.ng&&ok;i++) {
+        csr_table::row gv=vc.gen_to_vert[i];
+        ok=gv.size()>=3&&gv.size()==vc.gen_to_ed[i].size();
+        for(int k=0;k<gv.size()&&ok;k++) ok=has(vc.vert_to_gen[gv[k]],i);
+    }
+    for(int i=0;i<vc.nv&&ok;i++) {
+        csr_table::row vg=vc.vert_to_gen[i];
+        for(int k=0;k<vg.size()&&ok;k++) ok=has(vc.gen_to_vert[vg[k]],i);
+    }
+    check(ok,"Vertex and generator tables are inconsistent");
+
+    // Save the tables and the boundary information, so that they can be
+    // compared to the reference output
+    if(argc==3) {
+        FILE *fp=safe_fopen(argv[2],"w");
+        vc.print_gen_to_vert_table(fp);
+        vc.print_gen_to_ed_table(fp);
+        vc.print_vert_to_gen_table(fp);
+        vc.print_ed_to_gen_table(fp);
+        vc.print_vert_to_ed_table(fp);
+        vc.print_vert_boundary(fp);
+        vc.print_ed_boundary(fp);
+        vc.ascii_output(fp);
+        fclose(fp);
+    }
+
+    if(failures>0) {
+        fprintf(stderr,"connect_test: %d checks failed\n",failures);
+        return 1;
+    }
+    puts("connect_test: All checks passed");
+}
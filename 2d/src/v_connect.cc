@@ -4,8 +4,48 @@
 
 namespace voro {
 
+// Sets up n_ empty rows for the two-pass construction, in which the number of
+// entries in each row is accumulated in off[i+2]
+void csr_table::count_setup(int n_) {
+    if(n_>c_rows) {
+        while(c_rows<n_) c_rows<<=1;
+        delete [] off;
+        off=new int[c_rows+2];
+    }
+    n=n_;
+    for(int i=0;i<n+2;i++) off[i]=0;
+}
+
+// Converts the counts into offsets and allocates the entries. Afterwards
+// off[i+1] is used as the fill position of row i, so that once all rows have
+// been filled, it holds the end of row i as required.
+void csr_table::allocate() {
+    for(int i=2;i<n+2;i++) off[i]+=off[i-1];
+    if(off[n+1]>c_dat) {
+        while(c_dat<off[n+1]) c_dat<<=1;
+        delete [] dat;
+        dat=new int[c_dat];
+    }
+}
+
+void csr_table::add_memory_rows() {
+    c_rows<<=1;
+    int *noff=new int[c_rows+2];
+    for(int i=0;i<=n;i++) noff[i]=off[i];
+    delete [] off;
+    off=noff;
+}
+
+void csr_table::add_memory_dat() {
+    c_dat<<=1;
+    int *ndat=new int[c_dat];
+    for(int i=0;i<off[n];i++) ndat[i]=dat[i];
+    delete [] dat;
+    dat=ndat;
+}
+
 void v_connect::import(FILE *fp) {
-    bool neg_label=false,boundary_track=false,start=false;
+    bool boundary_track=false,start=false;
     char *buf(new char[512]);
     int i=0,id;
     double x, y,pad=.05;
@@ -38,7 +78,6 @@ void v_connect::import(FILE *fp) {
             i++;
 
             // Determine bounds
-            if(id<0) neg_label=true;
             if(id>mid) mid=id;
             if(x<minx) minx=x;
             if(x>maxx) maxx=x;
@@ -63,10 +102,6 @@ void v_connect::import(FILE *fp) {
     double lscale=sqrt(8.0*dx*dy/i);
     nx=(int)(dx/lscale)+1,ny=(int)(dy/lscale)+1;
     ng=i;
-    gen_to_vert= new vector<int>[i];
-    gen_to_ed= new vector<int>[i];
-    gen_to_gen_e= new vector<int>[i];
-    gen_to_gen_v=new vector<int>[i];
     generator_is_vertex=new int[i];
     for(int j=0;j<ng;j++) generator_is_vertex[j]=-1;
     mp=new int[mid+1];
@@ -74,25 +109,24 @@ void v_connect::import(FILE *fp) {
 }
 // Assemble vert_to_gen,gen_to_vert,vert_to_ed,ed_to_vert
 void v_connect::assemble_vertex(){
-    bool arrange=false;
-    int cv,lv,cvi,lvi,fvi,j,id,pcurrent_vertices=init_vertices,vert_size=0,g1,g2,g3,gl1,gl2,gl3,i,pne=0;
+    int cv,lv,cvi,lvi=0,fvi=0,j,id,pcurrent_vertices=init_vertices,vert_size=0,g1,g2,g3,gl1,gl2,gl3,i,pne=0;
     int *pmap;
     int *ped_to_vert=new int[2*current_edges];
-    bool seencv=false,seenlv=false;
     vector<int> gens;
-    vector<int> *pvert_to_gen= new vector<int>[pcurrent_vertices];
-    vector<int> *pgen_to_vert=new vector<int>[ng];
+    //potential vertices and their generators, and the potential vertices of
+    //each computed cell, stored as rows in the order they are found.
+    //pgen_row[i] is the row of pgen_to_vert for generator i.
+    csr_table pvert_to_gen,pgen_to_vert;
+    int *pgen_row=new int[ng];
+    for(i=0;i<ng;i++) pgen_row[i]=-1;
     vector<int> problem_verts;
     vector<int> problem_verts21;
     vector<int> problem_verts32;
     vector<int> problem_gen_to_vert;
     double gx1,gy1,gx2,gy2;
     double *pvertl=new double[2*pcurrent_vertices];
-    unsigned int *globvertc=new unsigned int[2*(ng+1)*ng*ng];
-
-    for(int i=0;i<2*((ng+1)*ng*ng);i++){
-        globvertc[i]=0;
-    }
+    //the number of cells in which each potential vertex has been found
+    map<vertex_key,vertex_count> globvert;
 
     cout << "2.1" << endl;
 
@@ -101,7 +135,7 @@ void v_connect::assemble_vertex(){
     container_boundary_2d con(minx,maxx,miny,maxy,nx,ny,false,false,16);
 
     // Import data
-    for(j=0;j<vid.size();j++) {
+    for(j=0;j<(int) vid.size();j++) {
         if(vbd[j]&1) con.start_boundary();
         con.put(vid[j],vpos[2*j],vpos[2*j+1]);
         if(vbd[j]&2) con.end_boundary();
@@ -109,7 +143,6 @@ void v_connect::assemble_vertex(){
 
     // Carry out all of the setup prior to computing any Voronoi cells
     con.setup();
-    con.full_connect_on();
     voronoicell_nonconvex_neighbor_2d c;
     c_loop_all_2d cl(con);
 
@@ -118,25 +151,25 @@ void v_connect::assemble_vertex(){
         cv=0;
         lv=c.ed[2*cv+1];
         id=cl.pid();
+        pgen_row[id]=pgen_to_vert.n;
+        pgen_to_vert.new_row();
         x=vpos[2*mp[id]];
         y=vpos[2*mp[id]+1];
-        groom_vertexg(c);
+        groom_vertexg(c,id);
         do{
-            gens=c.vertexg[cv];
+            gens=vertexg[cv];
             vx=.5*c.pts[2*cv]+x;
             vy=.5*c.pts[2*cv+1]+y;
             if(gens.size()==1){
-                seencv=false;
                 if(pcurrent_vertices==vert_size){
                     pcurrent_vertices<<=1;
-                    add_memory_vector(pvert_to_gen,pcurrent_vertices);
                     add_memory_array(pvertl,pcurrent_vertices);
 
                 }
-                pgen_to_vert[gens[0]].push_back(vert_size);
+                pgen_to_vert.push_back(vert_size);
                 pvertl[2*vert_size]=vx;
                 pvertl[2*vert_size+1]=vy;
-                pvert_to_gen[vert_size]=gens;
+                pvert_to_gen.add_row(gens);
                 cvi=vert_size;
                 if(cv==0) fvi=cvi;
                 vert_size++;
@@ -162,26 +195,24 @@ void v_connect::assemble_vertex(){
                 }else{
                     g1=gens[1]; g2=gens[0];
                 }
-                if(globvertc[2*((ng*ng*g1)+(ng*g2))]!=0){
-                    seencv=true;
-                    globvertc[2*((ng*ng*g1)+(ng*g2))]+=1;
-                    cvi=globvertc[2*((ng*ng*g1)+(ng*g2))+1];
-                    pgen_to_vert[id].push_back(cvi);
+                vertex_count &gv=globvert[vertex_key(g1,g2,0)];
+                if(gv.n!=0){
+                    gv.n+=1;
+                    cvi=gv.index;
+                    pgen_to_vert.push_back(cvi);
                     if(cv==0) fvi=cvi;
                 }else{
-                    seencv=false;
                     if(pcurrent_vertices==vert_size){
                         pcurrent_vertices<<=1;
-                        add_memory_vector(pvert_to_gen,pcurrent_vertices);
                         add_memory_array(pvertl,pcurrent_vertices);
 
                     }
-                                    pgen_to_vert[id].push_back(vert_size);
+                    pgen_to_vert.push_back(vert_size);
                     pvertl[2*vert_size]=vx;
                     pvertl[2*vert_size+1]=vy;
-                    pvert_to_gen[vert_size]=gens;
-                    globvertc[2*((ng*ng*g1)+(ng*g2))]=(unsigned int)1;
-                    globvertc[2*((ng*ng*g1)+(ng*g2))+1]=vert_size;
+                    pvert_to_gen.add_row(gens);
+                    gv.n=1;
+                    gv.index=vert_size;
                     cvi=vert_size;
                     if(cv==0) fvi=cvi;
                     vert_size++;
@@ -196,26 +227,24 @@ void v_connect::assemble_vertex(){
                 }else{
                     gl1=g3;gl2=g1;gl3=g2;
                 }
-                if(globvertc[2*((ng*ng*gl1)+(ng*gl2)+gl3)]!=0){
-                    seencv=true;
-                    globvertc[2*((ng*ng*gl1)+(ng*gl2)+gl3)]+=1;
-                    cvi=globvertc[2*((ng*ng*gl1)+(ng*gl2)+gl3)+1];
-                    pgen_to_vert[id].push_back(cvi);
+                vertex_count &gv=globvert[vertex_key(gl1,gl2,gl3)];
+                if(gv.n!=0){
+                    gv.n+=1;
+                    cvi=gv.index;
+                    pgen_to_vert.push_back(cvi);
                     if(cv==0)fvi=cvi;
                 }else{
-                    seencv=false;
                     if(pcurrent_vertices==vert_size){
                         pcurrent_vertices<<=1;
-                        add_memory_vector(pvert_to_gen,pcurrent_vertices);
                         add_memory_array(pvertl,pcurrent_vertices);
 
                     }
-                                    pgen_to_vert[id].push_back(vert_size);
+                    pgen_to_vert.push_back(vert_size);
                     pvertl[2*vert_size]=vx;
                     pvertl[2*vert_size+1]=vy;
-                    pvert_to_gen[vert_size]=gens;
-                    globvertc[2*((ng*ng*gl1)+(ng*gl2)+gl3)]=(unsigned int)1;
-                    globvertc[2*((ng*ng*gl1)+(ng*gl2)+gl3)+1]=vert_size;
+                    pvert_to_gen.add_row(gens);
+                    gv.n=1;
+                    gv.index=vert_size;
                     cvi=vert_size;
                     if(cv==0)fvi=cvi;
                     vert_size++;
@@ -240,7 +269,6 @@ void v_connect::assemble_vertex(){
 
                 lv=cv;
                 lvi=cvi;
-                seenlv=seencv;
                 cv=c.ed[2*lv];
 
         }while(cv!=0);
@@ -262,10 +290,11 @@ void v_connect::assemble_vertex(){
     cout << "2.2" << endl;
     //Add non-problem vertices(connectivity<=3) to class variables, add problem vertices to problem vertice data structures
     pmap=new int[pcurrent_vertices];
+    vert_to_gen.clear();
     j=0;
     int v1=0;
     for(int i=0;i<vert_size;i++){
-        gens=pvert_to_gen[i];
+        gens.assign(pvert_to_gen[i].begin(),pvert_to_gen[i].end());
         if(gens.size()==1){
             if(j==current_vertices){
                 add_memory_vertices();
@@ -274,7 +303,7 @@ void v_connect::assemble_vertex(){
             vertex_is_generator[j]=gens[0];
             vertl[2*j]=pvertl[2*i];
             vertl[2*j+1]=pvertl[2*i+1];
-            vert_to_gen[j]=pvert_to_gen[i];
+            vert_to_gen.add_row(pvert_to_gen[i]);
             pmap[i]=j;
             j++;
             v1++;
@@ -299,7 +328,7 @@ void v_connect::assemble_vertex(){
             }else{
                 g1=gens[1]; g2=gens[0];
             }
-            if(globvertc[2*((ng*ng*g1)+(ng*g2))]!=2){
+            if(globvert[vertex_key(g1,g2,0)].n!=2){
                 problem_verts21.push_back(i);
             }
             else{
@@ -308,7 +337,7 @@ void v_connect::assemble_vertex(){
                 }
                 vertl[2*j]=pvertl[2*i];
                 vertl[2*j+1]=pvertl[2*i+1];
-                vert_to_gen[j]=pvert_to_gen[i];
+                vert_to_gen.add_row(pvert_to_gen[i]);
                 pmap[i]=j;
                 j++;
             }
@@ -321,8 +350,9 @@ void v_connect::assemble_vertex(){
             }else{
                 gl1=g3;gl2=g1;gl3=g2;
             }
-            if(globvertc[2*((ng*ng*gl1)+(ng*gl2)+gl3)]!=3){
-                if(globvertc[2*((ng*ng*gl1)+(ng*gl2)+gl3)]==1) problem_verts.push_back(i);
+            unsigned int n=globvert[vertex_key(gl1,gl2,gl3)].n;
+            if(n!=3){
+                if(n==1) problem_verts.push_back(i);
                 else problem_verts32.push_back(i);
             }else{
                 if(j==current_vertices){
@@ -330,7 +360,7 @@ void v_connect::assemble_vertex(){
                 }
                 vertl[2*j]=pvertl[2*i];
                 vertl[2*j+1]=pvertl[2*i+1];
-                vert_to_gen[j]=pvert_to_gen[i];
+                vert_to_gen.add_row(pvert_to_gen[i]);
                 pmap[i]=j;
                 j++;
             }
@@ -342,18 +372,18 @@ void v_connect::assemble_vertex(){
     degenerate_vertices=j;
     //deal with problem verts
     while(problem_verts21.size()>problem_verts32.size()){
-        for(int i=0;i<problem_verts21.size();i++){
-            for(int j=i+1;j<problem_verts21.size();j++){
+        for(int i=0;i<(int) problem_verts21.size();i++){
+            for(int j=i+1;j<(int) problem_verts21.size();j++){
                 one_in_common(pvert_to_gen[problem_verts21[i]],pvert_to_gen[problem_verts21[j]],g1);
                 if(g1==-1) continue;
-                gens=pvert_to_gen[problem_verts21[i]];
+                gens.assign(pvert_to_gen[problem_verts21[i]].begin(),pvert_to_gen[problem_verts21[i]].end());
                 gens.push_back(not_this_one(pvert_to_gen[problem_verts21[j]],g1));
-                for(int k=0;k<problem_verts.size();k++){
+                for(int k=0;k<(int) problem_verts.size();k++){
                     if(contain_same_elements(gens,pvert_to_gen[problem_verts[k]])){
                         if(nv==current_vertices) add_memory_vertices();
                         vertl[2*nv]=pvertl[2*problem_verts[k]];
                         vertl[2*nv+1]=pvertl[2*problem_verts[k]+1];
-                        vert_to_gen[nv]=pvert_to_gen[problem_verts[k]];
+                        vert_to_gen.add_row(pvert_to_gen[problem_verts[k]]);
                         pmap[problem_verts21[i]]=nv;
                         pmap[problem_verts21[j]]=nv;
                         pmap[problem_verts[k]]=nv;
@@ -371,14 +401,14 @@ void v_connect::assemble_vertex(){
     }
     cout << "part 2" << endl;
     while(problem_verts32.size()>0){
-        for(int i=0;i<problem_verts32.size();i++){
-            gens=pvert_to_gen[problem_verts32[i]];
-            for(int j=0;j<problem_verts21.size();j++){
+        for(int i=0;i<(int) problem_verts32.size();i++){
+            gens.assign(pvert_to_gen[problem_verts32[i]].begin(),pvert_to_gen[problem_verts32[i]].end());
+            for(int j=0;j<(int) problem_verts21.size();j++){
                 if(subset(pvert_to_gen[problem_verts21[j]],gens)){
                     if(nv==current_vertices) add_memory_vertices();
                     vertl[2*nv]=pvertl[2*problem_verts32[i]];
                     vertl[2*nv+1]=pvertl[2*problem_verts32[i]+1];
-                    vert_to_gen[nv]=gens;
+                    vert_to_gen.add_row(gens);
                     pmap[problem_verts32[i]]=nv;
                     pmap[problem_verts21[j]]=nv;
                     nv++;
@@ -391,12 +421,12 @@ void v_connect::assemble_vertex(){
         }
     }
 
-    double standard,distance;
+    double standard,distance=0;
     cout << "part3" << endl;
     while(problem_verts.size()>0){
 
         if(nv==current_vertices) add_memory_vertices();
-        gens=pvert_to_gen[problem_verts[0]];
+        gens.assign(pvert_to_gen[problem_verts[0]].begin(),pvert_to_gen[problem_verts[0]].end());
         vx=pvertl[2*problem_verts[0]];vy=pvertl[2*problem_verts[0]+1];
         standard=pow(vx-vpos[2*mp[gens[0]]],2)+pow(vy-vpos[2*mp[gens[0]]+1],2);
         g1=gens[0];g2=gens[1];
@@ -433,21 +463,17 @@ void v_connect::assemble_vertex(){
         vertl[2*nv]=vx;
         vertl[2*nv+1]=vy;
         arrange_cc_x_to_gen(gens,vx,vy);
-        vert_to_gen[nv]=gens;
+        vert_to_gen.add_row(gens);
         nv++;
 
     }
-    delete [] pvert_to_gen;
     delete [] pvertl;
-    delete [] globvertc;
     cout << "2.4" << endl;
-    //assemble edge data structures
-    ed_to_vert=new int[2*pne];
-    vert_to_ed=new vector<int>[nv];
-    unsigned int* globedgec=new unsigned int[nv*nv];
-    for(int i=0;i<(nv*nv);i++){
-        globedgec[i]=0;
-    }
+    //assemble edge data structures. the potential edges are grouped by their
+    //lower vertex, so that an edge that has already been seen is found by
+    //scanning a short row. edges are numbered in the order they are first seen.
+    csr_table ped_by_vert;
+    ped_by_vert.count_setup(nv);
     for(int i=0;i<pne;i++){
         g1=pmap[ped_to_vert[2*i]];g2=pmap[ped_to_vert[2*i+1]];
         if(g2<g1){
@@ -455,120 +481,187 @@ void v_connect::assemble_vertex(){
             g1^=g2;
             g2^=g1;
         }
-        if(globedgec[(nv*g1+g2)]!=0){
-            continue;
-        }else{
-            globedgec[(nv*g1+g2)]=1;
-            ed_to_vert[2*ne]=g1;
-            ed_to_vert[2*ne+1]=g2;
-            vert_to_ed[g1].push_back(ne);
-            vert_to_ed[g2].push_back(ne);
-            ne++;
-        }
+        ped_to_vert[2*i]=g1;
+        ped_to_vert[2*i+1]=g2;
+        ped_by_vert.count(g1);
+    }
+    ped_by_vert.allocate();
+    for(int i=0;i<pne;i++) ped_by_vert.fill(ped_to_vert[2*i],i);
+    ed_to_vert=new int[2*pne];
+    for(int i=0;i<pne;i++){
+        g1=ped_to_vert[2*i];g2=ped_to_vert[2*i+1];
+        csr_table::row r=ped_by_vert[g1];
+        for(j=0;r[j]<i;j++) if(ped_to_vert[2*r[j]+1]==g2) break;
+        if(r[j]<i) continue;
+        ed_to_vert[2*ne]=g1;
+        ed_to_vert[2*ne+1]=g2;
+        ne++;
+    }
+    vert_to_ed.count_setup(nv);
+    for(int i=0;i<ne;i++){
+        vert_to_ed.count(ed_to_vert[2*i]);
+        vert_to_ed.count(ed_to_vert[2*i+1]);
     }
+    vert_to_ed.allocate();
+    for(int i=0;i<ne;i++){
+        vert_to_ed.fill(ed_to_vert[2*i],i);
+        vert_to_ed.fill(ed_to_vert[2*i+1],i);
+    }
+
+    //assemble gen_to_vert in two passes over the generators, rearranging the
+    //cells that contain merged problem vertices
+    char *pmark=new char[vert_size];
+    for(int i=0;i<vert_size;i++) pmark[i]=0;
+    for(int i=0;i<(int) problem_gen_to_vert.size();i++) pmark[problem_gen_to_vert[i]]=1;
+    gen_to_vert.count_setup(ng);
+#pragma omp parallel for
+    for(int i=0;i<ng;i++) if(pgen_row[i]>=0) gen_to_vert.count(i,pgen_to_vert[pgen_row[i]].size());
+    gen_to_vert.allocate();
+#pragma omp parallel for schedule(dynamic,64)
     for(int i=0;i<ng;i++){
-        for(int k=0;k<pgen_to_vert[i].size();k++){
-            gen_to_vert[i].push_back(pmap[pgen_to_vert[i][k]]);
-            if(contains(problem_gen_to_vert,pgen_to_vert[i][k])) arrange=true;
+        if(pgen_row[i]<0) continue;
+        bool arrange=false;
+        csr_table::row r=pgen_to_vert[pgen_row[i]];
+        int *gv=gen_to_vert.fill_row(i,r.size());
+        for(int k=0;k<r.size();k++){
+            gv[k]=pmap[r[k]];
+            if(pmark[r[k]]) arrange=true;
         }
-        if(arrange) arrange_cc_gen_to_vert(gen_to_vert[i],vpos[2*mp[i]],vpos[2*mp[i]+1]);
-        arrange=false;
+        if(arrange) arrange_cc_gen_to_vert(csr_table::row(gv,r.size()),vpos[2*mp[i]],vpos[2*mp[i]+1]);
     }
 
-    delete [] pgen_to_vert;
+    delete [] pmark;
+    delete [] pgen_row;
     delete [] pmap;
     delete [] ped_to_vert;
-    delete [] globedgec;
     cout << "out" << endl;
 }
 //assemble gen_to_gen , gen_to_ed , ed_to_gen
 void v_connect::assemble_gen_ed(){
     cout << "gen_ed 1" << endl;
-    ed_to_gen=new vector<int>[ne];
     //though neither ed_on_bd or vert_on_bd are modified during this method, they are initialized here in case the user
     //does not require boundary information and will not be calling assemble_boundary
-    ed_on_bd=new vector<int>[ne];
-    vert_on_bd=new vector<int>[nv];
-    vector<int> gens;
-    int g1,g2,v1,v2,j,vi;
-    double gx1,gy1,gx2,gy2,vx1,vy1,vx2,vy2;
+    ed_on_bd.count_setup(ne);
+    ed_on_bd.allocate();
+    vert_on_bd.count_setup(nv);
+    vert_on_bd.allocate();
+    int g1,g2,j;
+    //for each edge, find the generators on its left-hand and right-hand
+    //sides, and the gen_to_ed entry of the left-hand generator. this only
+    //reads the vertex connectivity, so the edges are processed in parallel.
+    int *eg=new int[3*ne];
         cout << "gen_ed 2" << endl;
+#pragma omp parallel for
     for(int i=0;i<ne;i++){
-
-        v1=ed_to_vert[2*i];v2=ed_to_vert[2*i+1];
-        two_in_common(vert_to_gen[v1],vert_to_gen[v2],g1,g2);
-        if(g1!=-1 && g2!=-1){
-            gen_to_gen_e[g1].push_back(g2);
-            gen_to_gen_e[g2].push_back(g1);
-            for(int k=0;k<gen_to_vert[g1].size();k++){
-                if(gen_to_vert[g1][k]==v1){
-                    vi=k;
-                    break;
-                }
-            }
-            if((vi!=(gen_to_vert[g1].size()-1) && gen_to_vert[g1][vi+1]==v2) ||
-                (vi==(gen_to_vert[g1].size()-1) && gen_to_vert[g1][0]==v2)){
-                ed_to_gen[i].push_back(g1);
-                ed_to_gen[i].push_back(g2);
-                gen_to_ed[g1].push_back(i);
-                gen_to_ed[g2].push_back(~i);
-            }else{
-                ed_to_gen[i].push_back(g2);
-                ed_to_gen[i].push_back(g1);
-                gen_to_ed[g2].push_back(i);
-                gen_to_ed[g1].push_back(~i);
+        int h1,h2,vi=0,v1=ed_to_vert[2*i],v2=ed_to_vert[2*i+1];
+        two_in_common(vert_to_gen[v1],vert_to_gen[v2],h1,h2);
+        eg[3*i+1]=-1;
+        if(h1==-1){
+            eg[3*i]=-1;
+            continue;
+        }
+        csr_table::row gv=gen_to_vert[h1];
+        for(int k=0;k<gv.size();k++){
+            if(gv[k]==v1){
+                vi=k;
+                break;
             }
+        }
+        bool forward=(vi!=(gv.size()-1) && gv[vi+1]==v2) ||
+            (vi==(gv.size()-1) && gv[0]==v2);
+        if(h2!=-1){
+            eg[3*i]=forward?h1:h2;
+            eg[3*i+1]=forward?h2:h1;
+            eg[3*i+2]=i;
         }else{
-            if(g1==-1) continue;
-            ed_to_gen[i].push_back(g1);
-            vx1=vertl[2*v1];vy1=vertl[2*v1+1];
-            vx2=vertl[2*v2];vy2=vertl[2*v2+1];
-            gx1=vpos[2*mp[g1]];gy1=vpos[2*mp[g1]+1];
-            for(int k=0;k<gen_to_vert[g1].size();k++){
-                if(gen_to_vert[g1][k]==v1){
-                    vi=k;
-                    break;
-                }
-            }
-            if((vi!=(gen_to_vert[g1].size()-1) && gen_to_vert[g1][vi+1]==v2) ||
-                (vi==(gen_to_vert[g1].size()-1) && gen_to_vert[g1][0]==v2)) gen_to_ed[g1].push_back(i);
-            else gen_to_ed[g1].push_back(~i);
+            eg[3*i]=h1;
+            eg[3*i+2]=forward?i:~i;
+        }
+    }
+    //count and then store the entries in the edge order
+    ed_to_gen.count_setup(ne);
+    gen_to_ed.count_setup(ng);
+    gen_to_gen_e.count_setup(ng);
+    for(int i=0;i<ne;i++){
+        g1=eg[3*i];g2=eg[3*i+1];
+        if(g1==-1) continue;
+        ed_to_gen.count(i);
+        gen_to_ed.count(g1);
+        if(g2!=-1){
+            ed_to_gen.count(i);
+            gen_to_ed.count(g2);
+            gen_to_gen_e.count(g1);
+            gen_to_gen_e.count(g2);
+        }
+    }
+    ed_to_gen.allocate();
+    gen_to_ed.allocate();
+    gen_to_gen_e.allocate();
+    for(int i=0;i<ne;i++){
+        g1=eg[3*i];g2=eg[3*i+1];
+        if(g1==-1) continue;
+        ed_to_gen.fill(i,g1);
+        gen_to_ed.fill(g1,eg[3*i+2]);
+        if(g2!=-1){
+            ed_to_gen.fill(i,g2);
+            gen_to_ed.fill(g2,~i);
+            gen_to_gen_e.fill(g1,g2);
+            gen_to_gen_e.fill(g2,g1);
         }
     }
+    delete [] eg;
     cout << "gen_ed 3" << endl;
-    for(int i=0;i<nv;i++){
-        if(vert_to_ed[i].size()<=3) continue;
-        else{
-            gens=vert_to_gen[i];
-            for(int j=0;j<gens.size();j++){
+    //neighbors through degenerate vertices, counted on the first pass and
+    //stored on the second
+    gen_to_gen_v.count_setup(ng);
+    for(int pass=0;pass<2;pass++){
+        for(int i=0;i<nv;i++){
+            if(vert_to_ed[i].size()<=3) continue;
+            csr_table::row gens=vert_to_gen[i];
+            for(j=0;j<gens.size();j++){
                 for(int k=0;k<gens.size();k++){
-                    if(!contains(gen_to_gen_e[gens[j]],gens[k])) gen_to_gen_v[gens[j]].push_back(gens[k]);
-
+                    if(!contains(gen_to_gen_e[gens[j]],gens[k])){
+                        if(pass==0) gen_to_gen_v.count(gens[j]);
+                        else gen_to_gen_v.fill(gens[j],gens[k]);
+                    }
                 }
             }
         }
+        if(pass==0) gen_to_gen_v.allocate();
     }
     cout << "gen_ed 4" << endl;
     //arrange gen_to_ed gen_to_gen_e gen_to_gen_v counterclockwise
+#pragma omp parallel for schedule(dynamic,64)
     for(int i=0;i<ng;i++){
-        gx1=vpos[2*mp[i]];gy1=vpos[2*mp[i]+1];
+        double gx=vpos[2*mp[i]],gy=vpos[2*mp[i]+1];
         arrange_cc_gen_to_ed(gen_to_ed[i]);
-        arrange_cc_x_to_gen(gen_to_gen_e[i],gx1,gy1);
-        arrange_cc_x_to_gen(gen_to_gen_v[i],gx1,gy1);
+        arrange_cc_x_to_gen(gen_to_gen_e[i],gx,gy);
+        arrange_cc_x_to_gen(gen_to_gen_v[i],gx,gy);
     }
     cout << "gen_ed 5" << endl;
     //arrange vert_to_ed cc
+#pragma omp parallel for schedule(dynamic,64)
     for(int i=0;i<nv;i++){
-        gx1=vertl[2*i];gy1=vertl[2*i+1];
-        arrange_cc_vert_to_ed(vert_to_ed[i],gx1,gy1,i);
+        arrange_cc_vert_to_ed(vert_to_ed[i],vertl[2*i],vertl[2*i+1],i);
     }
 
 }
 
 //assemble vert_on_bd and ed_on_bd as well as side edge information if neccessary.
+//the boundary is walked twice, first to count the entries of each vertex and
+//edge, and then to store them.
 void v_connect::assemble_boundary(){
+    vert_on_bd.count_setup(nv);
+    ed_on_bd.count_setup(ne);
+    walk_boundary(false);
+    vert_on_bd.allocate();
+    ed_on_bd.allocate();
+    walk_boundary(true);
+}
+
+void v_connect::walk_boundary(bool fill){
     bool begun=false;
-    int i=0,cg,ng,fg,lv,cv,nv,ev,ei,j;
+    int i=0,cg,ng,fg=0,lv,cv,nv,ev,ei,j;
     while(true){
         if(vbd[i]==1){
             begun=true;
@@ -590,12 +683,9 @@ void v_connect::assemble_boundary(){
         cv=gen_to_vert[cg][0];
         nv=gen_to_vert[cg][1];
         one_in_common(vert_to_ed[cv],vert_to_ed[nv],ei);
-        vert_on_bd[cv].push_back(cg);
-        vert_on_bd[cv].push_back(ng);
-        vert_on_bd[nv].push_back(cg);
-        vert_on_bd[nv].push_back(ng);
-        ed_on_bd[ei].push_back(cg);
-        ed_on_bd[ei].push_back(ng);
+        add_bd(vert_on_bd,cv,cg,ng,fill);
+        add_bd(vert_on_bd,nv,cg,ng,fill);
+        add_bd(ed_on_bd,ei,cg,ng,fill);
         lv=cv;
         cv=nv;
         while(nv!=ev){
@@ -609,10 +699,8 @@ void v_connect::assemble_boundary(){
             else ei=vert_to_ed[cv][j+1];
             if(ed_to_vert[2*ei]==cv) nv=ed_to_vert[2*ei+1];
             else nv=ed_to_vert[2*ei];
-            vert_on_bd[nv].push_back(cg);
-            vert_on_bd[nv].push_back(ng);
-            ed_on_bd[ei].push_back(cg);
-            ed_on_bd[ei].push_back(ng);
+            add_bd(vert_on_bd,nv,cg,ng,fill);
+            add_bd(ed_on_bd,ei,cg,ng,fill);
             lv=cv;
             cv=nv;
         }
@@ -626,13 +714,13 @@ void v_connect::assemble_boundary(){
 vector<int> v_connect::groom_vertexg_help(double x,double y,double vx, double vy,vector<int> &g){
     if(g.size()<2) return g;
     bool rightside=false;
-    int g0=g[0],g1,bestg,besti;
+    int g0=g[0],g1,bestg;
     double d1;
     double standard=pow((vpos[2*mp[g0]]-vx),2)+pow((vpos[2*mp[g0]+1]-vy),2);
     double gx0,gy0,gx1,gy1,best,current;
     vector<int> newg,temp;
     temp.push_back(g0);
-    for(int i=1;i<g.size();i++){
+    for(int i=1;i<(int) g.size();i++){
         g1=g[i];
         if(contains(temp,g1)) continue;
         d1=pow((vpos[2*mp[g1]]-vx),2)+pow((vpos[2*mp[g1]+1]-vy),2);
@@ -651,8 +739,7 @@ vector<int> v_connect::groom_vertexg_help(double x,double y,double vx, double vy
     }
     best=dot_product(gx0-vx,gy0-vy,gx1-vx,gy1-vy);
     bestg=g1;
-    besti=1;
-    for(int i=2;i<temp.size();i++){
+    for(int i=2;i<(int) temp.size();i++){
         g1=temp[i];
         if(contains(newg,g1)) continue;
         gx1=vpos[2*mp[g1]]; gy1=vpos[2*mp[g1]+1];
@@ -661,13 +748,11 @@ vector<int> v_connect::groom_vertexg_help(double x,double y,double vx, double vy
                 rightside=true;
                 best=dot_product(gx0-vx,gy0-vy,gx1-vx,gy1-vy);
                 bestg=g1;
-                besti=i;
             }else{
                 current=dot_product(gx0-vx,gy0-vy,gx1-vx,gy1-vy);
                 if(current>best){
                     best=current;
                     bestg=g1;
-                    besti=i;
                 }
             }
         }else{
@@ -677,7 +762,6 @@ vector<int> v_connect::groom_vertexg_help(double x,double y,double vx, double vy
                 if(current<best){
                     best=current;
                     bestg=g1;
-                    besti=i;
                 }
             }
         }
@@ -693,7 +777,7 @@ vector<int> v_connect::groom_vertexg_help(double x,double y,double vx, double vy
     }
     best=dot_product(gx0-vx,gy0-vy,gx1-vy,gy1-vy);
     bestg=g1;
-    for(int i=2;i<temp.size();i++){
+    for(int i=2;i<(int) temp.size();i++){
         g1=temp[i];
         if(contains(newg,g1)) continue;
         gx1=vpos[2*mp[g1]]; gy1=vpos[2*mp[g1]+1];
@@ -735,7 +819,7 @@ vector<int> v_connect::groom_vertexg_help2(double x,double y,double vx,double vy
     double dp,dcompare, temp;
     vector<int> newg;
     while(d1>=standard+tolerance){
-        if(i==g.size()-1){
+        if(i==(int) g.size()-1){
             newg.push_back(m0);
             return newg;
         }
@@ -743,7 +827,7 @@ vector<int> v_connect::groom_vertexg_help2(double x,double y,double vx,double vy
             m1=g[i];
             d1=pow((vpos[2*mp[m1]]-vx),2)+pow((vpos[2*mp[m1]+1]-vy),2);
     }
-    if(i==g.size()-1){
+    if(i==(int) g.size()-1){
         newg.push_back(m0);
         newg.push_back(m1);
         return newg;
@@ -752,7 +836,7 @@ vector<int> v_connect::groom_vertexg_help2(double x,double y,double vx,double vy
     m2=g[i];
     d2=pow((vpos[2*mp[m2]]-vx),2)+pow((vpos[2*mp[m2]+1]-vy),2);
     while(d2>=standard+tolerance){
-        if(i==g.size()-1){
+        if(i==(int) g.size()-1){
             newg.push_back(m0);
             newg.push_back(m1);
             return newg;
@@ -761,7 +845,7 @@ vector<int> v_connect::groom_vertexg_help2(double x,double y,double vx,double vy
             m2=g[i];
             d2=pow((vpos[2*mp[m2]]-vx),2)+pow((vpos[2*mp[m2]+1]-vy),2);
     }
-    if(i==g.size()-1){
+    if(i==(int) g.size()-1){
         newg.push_back(m0);
         newg.push_back(m1);
         newg.push_back(m2);
@@ -818,7 +902,7 @@ vector<int> v_connect::groom_vertexg_help2(double x,double y,double vx,double vy
         m1^=m2;
         m2^=m1;
     }
-    for(int j=i;j<g.size();j++){
+    for(int j=i;j<(int) g.size();j++){
         p=g[j];
         dcompare=pow((vpos[2*mp[p]]-vx),2)+pow((vpos[2*mp[p]+1]-vy),2);
         if(dcompare<=(standard+tolerance)){
@@ -855,19 +939,17 @@ vector<int> v_connect::groom_vertexg_help2(double x,double y,double vx,double vy
     return newg;
 }
 
-    void v_connect::arrange_cc_x_to_gen(vector<int> &list,double cx,double cy){
+//the arrange routines select the entries in order, moving each selected entry
+//forward so that the remaining entries keep their order
+void v_connect::arrange_cc_x_to_gen(csr_table::row list,double cx,double cy){
         if(list.size()==0) return;
         bool wrongside;
         int g1,ng,ni;
         double x1,y1,x2,y2,best,current;
-        vector<int> newlist;
-        vector<int> potential;
-        newlist.push_back(list[0]);
         x1=vpos[2*mp[list[0]]];y1=vpos[2*mp[list[0]]+1];
-        list.erase(list.begin());
-        while(list.size()>0){
+        for(int j=1;j<list.size();j++){
             wrongside=true;
-            for(int i=0;i<list.size();i++){
+            for(int i=j;i<list.size();i++){
                 g1=list[i];
                 x2=vpos[2*mp[g1]];y2=vpos[2*mp[g1]+1];
                 if(cross_product(cx-x1,cy-y1,cx-x2,cy-y2)>=0){
@@ -885,7 +967,7 @@ vector<int> v_connect::groom_vertexg_help2(double x,double y,double vx,double vy
                 }else{
                     if(!wrongside) continue;
                     current=dot_product(cx-x1,cy-y1,cx-x2,cy-y2);
-                    if(i==0){
+                    if(i==j){
                         best=current;
                         ng=g1;
                         ni=i;
@@ -896,25 +978,20 @@ vector<int> v_connect::groom_vertexg_help2(double x,double y,double vx,double vy
                     }
                 }
             }
-            newlist.push_back(ng);
-            list.erase(list.begin()+ni);
+            for(int i=ni;i>j;i--) list[i]=list[i-1];
+            list[j]=ng;
         }
-        list=newlist;
-    }
+}
 
-void v_connect::arrange_cc_gen_to_vert(vector<int> &list,double cx,double cy){
+void v_connect::arrange_cc_gen_to_vert(csr_table::row list,double cx,double cy){
         if(list.size()==0) return;
         bool wrongside;
         int g1,ng,ni;
         double x1,y1,x2,y2,best,current;
-        vector<int> newlist;
-        vector<int> potential;
-        newlist.push_back(list[0]);
         x1=vertl[2*list[0]];y1=vertl[2*list[0]+1];
-        list.erase(list.begin());
-        while(list.size()>0){
+        for(int j=1;j<list.size();j++){
             wrongside=true;
-            for(int i=0;i<list.size();i++){
+            for(int i=j;i<list.size();i++){
                 g1=list[i];
                 x2=vertl[2*g1];y2=vertl[2*g1+1];
                 if(cross_product(cx-x1,cy-y1,cx-x2,cy-y2)>=0){
@@ -932,7 +1009,7 @@ void v_connect::arrange_cc_gen_to_vert(vector<int> &list,double cx,double cy){
                 }else{
                     if(!wrongside) continue;
                     current=dot_product(cx-x1,cy-y1,cx-x2,cy-y2);
-                    if(i==0){
+                    if(i==j){
                         best=current;
                         ng=g1;
                         ni=i;
@@ -943,63 +1020,42 @@ void v_connect::arrange_cc_gen_to_vert(vector<int> &list,double cx,double cy){
                     }
                 }
             }
-            newlist.push_back(ng);
-            list.erase(list.begin()+ni);
+            for(int i=ni;i>j;i--) list[i]=list[i-1];
+            list[j]=ng;
         }
-        list=newlist;
 }
 
-void v_connect::arrange_cc_gen_to_ed(vector<int> &list){
-    vector<int> newlist;
-    int v1,v2,ed,i=0;
-    newlist.push_back(list[0]);
-    list.erase(list.begin());
-    if(newlist[0]<0){
-        ed=~newlist[0];
-        v1=ed_to_vert[2*ed];
-    }else{
-        ed=newlist[0];
-        v1=ed_to_vert[2*ed+1];
-    }
-    while(list.size()>0){
-            if(list[i]>=0){
-                v2=ed_to_vert[2*list[i]];
-                if(v2==v1){
-                    v1=ed_to_vert[2*list[i]+1];
-                    newlist.push_back(list[i]);
-                    list.erase(list.begin()+i);
-                    i=0;
-                }else i++;
-            }else{
-                v2=ed_to_vert[2*(~list[i])+1];
-
-                if(v2==v1){
-                    v1=ed_to_vert[2*(~list[i])];
-                    newlist.push_back(list[i]);
-                    list.erase(list.begin()+i);
-                    i=0;
-                }else i++;
-            }
+void v_connect::arrange_cc_gen_to_ed(csr_table::row list){
+    if(list.size()==0) return;
+    int v1,v2,e,i=1,j=1;
+    if(list[0]<0) v1=ed_to_vert[2*(~list[0])];
+    else v1=ed_to_vert[2*list[0]+1];
+    while(j<list.size()){
+            e=list[i];
+            if(e>=0) v2=ed_to_vert[2*e];
+            else v2=ed_to_vert[2*(~e)+1];
+            if(v2==v1){
+                if(e>=0) v1=ed_to_vert[2*e+1];
+                else v1=ed_to_vert[2*(~e)];
+                for(int k=i;k>j;k--) list[k]=list[k-1];
+                list[j++]=e;
+                i=j;
+            }else i++;
     }
-    list=newlist;
 }
 
-void v_connect::arrange_cc_vert_to_ed(vector<int> &list,double cx, double cy,int id){
+void v_connect::arrange_cc_vert_to_ed(csr_table::row list,double cx, double cy,int id){
 
     if(list.size()==0) return;
     bool wrongside;
     int g1,ng,ni,index;
     double x1,y1,x2,y2,best,current;
-    vector<int> newlist;
-    vector<int> potential;
-    newlist.push_back(list[0]);
     if(ed_to_vert[2*list[0]]==id) index=ed_to_vert[2*list[0]+1];
     else index=ed_to_vert[2*list[0]];
     x1=vertl[2*index];y1=vertl[2*index+1];
-    list.erase(list.begin());
-    while(list.size()>0){
+    for(int j=1;j<list.size();j++){
         wrongside=true;
-        for(int i=0;i<list.size();i++){
+        for(int i=j;i<list.size();i++){
             g1=list[i];
             if(ed_to_vert[2*g1]==id) index=ed_to_vert[2*g1+1];
             else index=ed_to_vert[2*g1];
@@ -1019,7 +1075,7 @@ void v_connect::arrange_cc_vert_to_ed(vector<int> &list,double cx, double cy,int
             }else{
                 if(!wrongside) continue;
                 current=dot_product(cx-x1,cy-y1,cx-x2,cy-y2);
-                if(i==0){
+                if(i==j){
                     best=current;
                     ng=g1;
                     ni=i;
@@ -1030,10 +1086,9 @@ void v_connect::arrange_cc_vert_to_ed(vector<int> &list,double cx, double cy,int
                 }
             }
         }
-        newlist.push_back(ng);
-        list.erase(list.begin()+ni);
+        for(int i=ni;i>j;i--) list[i]=list[i-1];
+        list[j]=ng;
     }
-    list=newlist;
 }
 
 void v_connect::draw_gnu(FILE *fp){
@@ -1051,7 +1106,6 @@ void v_connect::draw_gnu(FILE *fp){
 
 void v_connect::draw_vtg_gnu(FILE *fp){
     double vx, vy, gx, gy;
-    int l2;
     for(int i=0;i<ng;i++){
         gx=vpos[2*mp[i]];gy=vpos[2*mp[i]+1];
         for(int k=0;k<gen_to_vert[i].size();k++){
@@ -1089,7 +1143,7 @@ void v_connect::label_vertices(FILE *fp){
 
 void v_connect::label_generators(FILE *fp){
     double gx,gy;
-    for(int i=0;i<vid.size();i++){
+    for(int i=0;i<(int) vid.size();i++){
         gx=vpos[2*i];gy=vpos[2*i+1];
         fprintf(fp,"set label '%i' at %g,%g point lt 4 pt 4 ps 2 offset 3,-3\n",vid[i],gx,gy);
     }
@@ -1215,13 +1269,6 @@ void v_connect::add_memory_vertices(){
     while(vp<vertle) *(nvp++)=*(vp++);
     delete [] vertl;vertl=nvertl;
     cout << "2.2.2" << endl;
-    //copy vert_to_gen, vert_to_ed
-    vector<int> *nvert_to_gen(new vector<int>[current_vertices]);
-    for(int i=0;i<(current_vertices>>1);i++){
-        nvert_to_gen[i]=vert_to_gen[i];
-    }
-    delete [] vert_to_gen;vert_to_gen=nvert_to_gen;
-    cout << "2.2.3" << endl;
     //copy vertex_is_generator
     int *nvertex_is_generator(new int[current_vertices]),*nvig(nvertex_is_generator),*vig(vertex_is_generator),*nvige(nvertex_is_generator+current_vertices);
     while(vig<vertex_is_generatore) *(nvig++)=*(vig++);
@@ -1308,24 +1355,10 @@ void v_connect::lloyds(double epsilon){
         cout << "1" << endl;
         current_vertices=init_vertices;
         current_edges=init_vertices;
-        delete [] gen_to_gen_e;
-        gen_to_gen_e=new vector<int>[ng];
-        cout << "2" << endl;
-        delete [] gen_to_gen_v;
-        gen_to_gen_v=new vector<int>[ng];
-        cout << "3" << endl;
-        delete [] gen_to_ed;
-        gen_to_ed=new vector<int>[ng];
-        cout << "4" << endl;
-        delete [] gen_to_vert;
-        gen_to_vert=new vector<int>[ng];
-        cout << "5" << endl;
+        //the connectivity tables are rebuilt in place by the assemble routines
         delete [] vertl;
         vertl=new double[2*init_vertices];
         cout << "6" << endl;
-        delete [] vert_to_gen;
-        vert_to_gen=new vector<int>[init_vertices];
-        cout << "7" << endl;
         delete [] vertex_is_generator;
         cout << "7.1" << endl;
         vertex_is_generator=new int[init_vertices];
@@ -1337,10 +1370,6 @@ void v_connect::lloyds(double epsilon){
         for(int k=0;k<ng;k++) generator_is_vertex[k]=-1;
         cout << "9" << endl;
         delete [] ed_to_vert;
-        delete [] vert_to_ed;
-        delete [] ed_to_gen;
-        delete [] ed_on_bd;
-        delete [] vert_on_bd;
         cout << "1..." << endl;
         assemble_vertex();
         cout << "2..." << endl;
@@ -1373,7 +1402,7 @@ void v_connect::draw_median_mesh(FILE *fp){
 
 void v_connect::draw_closest_generator(FILE *fp,double x,double y){
     int cg,pg,ng=0;
-    double gx,gy,best,bestl,current;
+    double gx,gy,best,current;
     gx=vpos[2*mp[0]]; gy=vpos[2*mp[0]+1];
     best = pow(gx-x,2)+pow(gy-y,2);
     cout << "best=" << best << endl;
@@ -6,9 +6,107 @@ using namespace std;
 #include <stdio.h>
 #include <iostream>
 #include <stdlib.h>
+#include <cstring>
+#include <map>
 #include <vector>
 namespace voro{
 
+//Stores a table of integer lists in compressed sparse row format, so that the
+//entries of all of the lists are held in a single contiguous array. The table
+//can either be appended to one row at a time, or built in two passes by first
+//counting the entries in each row and then filling them in.
+class csr_table{
+    public:
+        //a view of a single row, with the same size() and [] accessors as a vector
+        struct row{
+            int *p;
+            int n;
+            row(int *p_,int n_) : p(p_),n(n_) {}
+            inline int size() const {return n;}
+            inline int &operator[](int k) const {return p[k];}
+            inline int *begin() const {return p;}
+            inline int *end() const {return p+n;}
+        };
+        //number of rows
+        int n;
+        //the entries of row i are dat[off[i]] to dat[off[i+1]-1]
+        int *off;
+        //the entries of all of the rows
+        int *dat;
+        csr_table() : n(0),c_rows(init_vertices),c_dat(init_vertices) {
+            off=new int[c_rows+2];
+            dat=new int[c_dat];
+            *off=0;
+        }
+        ~csr_table(){
+            delete [] off;
+            delete [] dat;
+        }
+        inline row operator[](int i) const {
+            return row(dat+off[i],off[i+1]-off[i]);
+        }
+        //total number of entries in the table
+        inline int total() const {return off[n];}
+        inline void clear(){
+            n=0;*off=0;
+        }
+        //appends an empty row to the table
+        inline void new_row(){
+            if(n==c_rows) add_memory_rows();
+            off[n+1]=off[n];n++;
+        }
+        //appends an entry to the last row of the table
+        inline void push_back(int v){
+            if(off[n]==c_dat) add_memory_dat();
+            dat[off[n]++]=v;
+        }
+        //appends a row containing the elements of a list
+        template<class l_class>
+        inline void add_row(const l_class &l){
+            new_row();
+            for(int k=0;k<(int) l.size();k++) push_back(l[k]);
+        }
+        //first pass of the two-pass construction: sets up n empty rows, after
+        //which the entries in each row are counted with count()
+        void count_setup(int n_);
+        inline void count(int i,int c=1){off[i+2]+=c;}
+        //allocates the space for the counted entries, which must then be
+        //filled in with fill() or fill_row(). Different rows can be filled
+        //by different threads.
+        void allocate();
+        inline void fill(int i,int v){dat[off[i+1]++]=v;}
+        //returns space for s entries in row i, which must be written by the caller
+        inline int *fill_row(int i,int s){
+            int *p=dat+off[i+1];
+            off[i+1]+=s;
+            return p;
+        }
+    private:
+        //current capacities for rows and entries
+        int c_rows,c_dat;
+        void add_memory_rows();
+        void add_memory_dat();
+};
+
+//Identifies a potential vertex by the generators that it is touching, in the
+//order used by assemble_vertex. For a vertex touching two generators, g3 is
+//zero.
+struct vertex_key{
+    int g1,g2,g3;
+    vertex_key(int g1_,int g2_,int g3_) : g1(g1_),g2(g2_),g3(g3_) {}
+    inline bool operator<(const vertex_key &k) const {
+        return g1<k.g1||(g1==k.g1&&(g2<k.g2||(g2==k.g2&&g3<k.g3)));
+    }
+};
+
+//Stores the number of cells in which a potential vertex has been found, and
+//its index in the potential vertex arrays
+struct vertex_count{
+    unsigned int n;
+    int index;
+    vertex_count() : n(0),index(0) {}
+};
+
 class v_connect{
     public:
         double minx,maxx,miny,maxy;
@@ -36,33 +134,39 @@ class v_connect{
         int *mp;
         //vertl[2*i]=x coordinate of ith vertex
         double *vertl;
-        //vert_to_gen[i]= vector containing list of generators that ith vertex is touching
-        vector<int> *vert_to_gen;
-        //vert_to_ed[i]= vector containing list of edges that the i'th vertex is a member of
-        vector<int> *vert_to_ed;
-        //vert_on_bd[i].size()==0 if vertex i is not on boundary. if vertex i is on boundary it is a size 2 vector of the generators that define the part of the boundary it is on
-        vector<int> *vert_on_bd;
+        //the connectivity tables below are stored in compressed sparse row format,
+        //and table[i] gives a view of the ith list with size() and [] accessors
+        //vert_to_gen[i]= list of generators that ith vertex is touching
+        csr_table vert_to_gen;
+        //vert_to_ed[i]= list of edges that the i'th vertex is a member of
+        csr_table vert_to_ed;
+        //vert_on_bd[i].size()==0 if vertex i is not on boundary. if vertex i is on boundary it is a size 2 list of the generators that define the part of the boundary it is on
+        csr_table vert_on_bd;
         //gen_to_vert[i]= list of vertices that ith generatos is touching in cc order
-        vector<int> *gen_to_vert;
+        csr_table gen_to_vert;
         //gen_to_edge[i]= list of edges that the ith generator is touching in cc order (- edge number means ~edge number with reverse orientation
-        vector<int> *gen_to_ed;
+        csr_table gen_to_ed;
         //gen_to_gen_e[i]= list of neighbors of ith generator through edges in cc order
-        vector<int> *gen_to_gen_e;
+        csr_table gen_to_gen_e;
         //gen_to_gen_v[i]= list of neighbors of ith generator through degenerate vertices in cc order
-        vector<int> *gen_to_gen_v;
+        csr_table gen_to_gen_v;
         //ed_to_vert[2*i(+1)]=the vertex with the lower(higher) id constituting edge i
         int *ed_to_vert;
-        //ed_to_gen[2*i(+1)]=the generator with the left-hand(right-hand) orientation touching the edge
-        vector<int> *ed_to_gen;
+        //ed_to_gen[i]= the generator with the left-hand orientation touching the edge, followed by the one with the right-hand orientation
+        csr_table ed_to_gen;
         //ed_on_bd[i].size()==0 if edge i is not on the boundary. if it is, ed_on_bd[i] is a 2 element list of the generators that define that part of the boundary that it is on
-        vector<int> *ed_on_bd;
+        csr_table ed_on_bd;
         //vertex_is_generator[i]=(-1 if ith vertex is not a generator)(j if ith vertex is generator j)
         int *vertex_is_generator;
         //see above
         int *generator_is_vertex;
+        //vertexg[i]= list of generators that the ith vertex of the cell being
+        //processed by assemble_vertex is touching
+        vector<vector<int> > vertexg;
 
         v_connect(){
             bd=-1;
+            mid=-1;
             nv=0;
             ne=0;
             //ng initialized during import routine.
@@ -73,23 +177,18 @@ class v_connect{
             current_vertices=init_vertices;
             current_edges=init_vertices;
             vertl=new double[2*current_vertices];
-            vert_to_gen= new vector<int>[current_vertices];
+            mp=NULL;
+            ed_to_vert=NULL;
+            generator_is_vertex=NULL;
             vertex_is_generator=new int[current_vertices];
             for(int i=0;i<current_vertices;i++) vertex_is_generator[i]=-1;
         }
 
         ~v_connect(){
             delete[] vertl;
-            delete[] vert_to_gen;
-            delete[] vert_to_ed;
-            delete[] vert_on_bd;
-            delete[] gen_to_vert;
-            delete[] gen_to_ed;
-            delete[] gen_to_gen_e;
-            delete[] gen_to_gen_v;
             delete[] ed_to_vert;
-            delete[] ed_to_gen;
-            delete[] ed_on_bd;
+            delete[] vertex_is_generator;
+            delete[] generator_is_vertex;
             delete[] mp;
         }
 
@@ -103,20 +202,21 @@ class v_connect{
 
         vector<int> groom_vertexg_help(double x, double y,double vx, double vy, vector<int> &g);
         vector<int> groom_vertexg_help2(double x,double y,double vx,double vy,vector<int> &g);
-        inline void groom_vertexg(voronoicell_nonconvex_neighbor_2d &c){
-            double x=vpos[2*mp[c.my_id]],y=vpos[2*mp[c.my_id]+1];
+        //fills vertexg[i] with the generators that the ith vertex of cell c of
+        //generator id is touching: id itself, followed by the neighbors
+        //through the two edges that meet at the vertex
+        inline void groom_vertexg(voronoicell_nonconvex_neighbor_2d &c,int id){
+            double x=vpos[2*mp[id]],y=vpos[2*mp[id]+1];
+            if((int) vertexg.size()<c.p) vertexg.resize(c.p);
             for(int i=0;i<c.p;i++){
-                c.vertexg[i]=groom_vertexg_help(x ,y,(c.pts[2*i]*.5)+x,(c.pts[2*i+1]*.5)+y,c.vertexg[i]);
+                vector<int> &g=vertexg[i];
+                int a=c.ne[i],b=c.ne[c.ed[2*i+1]];
+                g.clear();g.push_back(id);
+                if(a>=0) g.push_back(a);
+                if(b>=0&&b!=a) g.push_back(b);
+                g=groom_vertexg_help(x ,y,(c.pts[2*i]*.5)+x,(c.pts[2*i+1]*.5)+y,g);
             }
         }
-        inline void add_memory_vector(vector<int>* &old,int size){
-            vector<int> *newv=new vector<int>[size];
-            for(int i=0;i<(size>>1);i++){
-                newv[i]=old[i];
-            }
-            delete [] old;
-            old=newv;
-        }
         inline void add_memory_array(double* &old,int size){
             double *newa= new double[2*size];
             for(int i=0;i<(size);i++){
@@ -142,7 +242,8 @@ class v_connect{
             old=newt;
         }
         //return true if vector contains the two elements
-        inline bool contains_two(vector<int> &a,int b, int c){
+        template<class l_class>
+        inline bool contains_two(const l_class &a,int b, int c){
             int i=0,j=0;
             for(int k=0;k<a.size();k++){
                 if(a[k]==b){
@@ -159,14 +260,16 @@ class v_connect{
             else return false;
         }
         //returns true if a vector contains the element
-        inline bool contains(vector<int> &a,int b){
-            for(int i=0;i<a.size();i++){
+        template<class l_class>
+        inline bool contains(const l_class &a,int b){
+            for(int i=0;i<(int) a.size();i++){
                 if(a[i]==b) return true;
             }
             return false;
         }
         //given a three element vector, returns an element != b or c
-        inline int not_these_two(vector<int> &a,int b, int c){
+        template<class l_class>
+        inline int not_these_two(const l_class &a,int b, int c){
             int d=-1;
             for(int i=0;i<a.size();i++){
                 if(a[i]!=b && a[i]!=c){
@@ -177,7 +280,8 @@ class v_connect{
             return d;
         }
         //returns two elements the vectors have in common in g1,g2
-        inline void two_in_common(vector<int> a,vector<int> b,int &g1,int &g2){
+        template<class l_class,class m_class>
+        inline void two_in_common(const l_class &a,const m_class &b,int &g1,int &g2){
             g1=g2=-1;
             for(int i=0;i<a.size();i++){
                 for(int k=0;k<b.size();k++){
@@ -190,7 +294,8 @@ class v_connect{
             }
         }
         //if a and b share an element, returns it in g1, if not returns -1
-        inline void one_in_common(vector<int> a,vector<int> b,int &g1){
+        template<class l_class,class m_class>
+        inline void one_in_common(const l_class &a,const m_class &b,int &g1){
             g1=-1;
             for(int i=0;i<a.size();i++){
                 for(int j=0;j<b.size();j++){
@@ -202,8 +307,9 @@ class v_connect{
             }
         }
         //returns true iff a and b contain the same elements
-        inline bool contain_same_elements(vector<int> a,vector<int> b){
-            for(int i=0;i<a.size();i++){
+        template<class l_class,class m_class>
+        inline bool contain_same_elements(const l_class &a,const m_class &b){
+            for(int i=0;i<(int) a.size();i++){
                 if(!contains(b,a[i])) return false;
             }
             for(int i=0;i<b.size();i++){
@@ -212,14 +318,16 @@ class v_connect{
             return true;
         }
         //returns any element in a !=b
-        inline int not_this_one(vector<int> a, int b){
+        template<class l_class>
+        inline int not_this_one(const l_class &a, int b){
             for(int i=0;i<a.size();i++){
                 if(a[i]!=b) return a[i];
             }
             return -1;
         }
         //returns true if the elements of a are a subset of elements of b
-        inline bool subset(vector<int> a,vector<int> b){
+        template<class l_class,class m_class>
+        inline bool subset(const l_class &a,const m_class &b){
             for(int i=0;i<a.size();i++){
                 if(!contains(b,a[i])) return false;
             }
@@ -231,13 +339,28 @@ class v_connect{
         inline double dot_product(double x1, double y1, double x2, double y2){
             return ((x1*x2)+(y1*y2));
         }
-        void arrange_cc_x_to_gen(vector<int> &list,double cx,double cy);
-        void arrange_cc_gen_to_vert(vector<int> &list,double cx,double cy);
-        void arrange_cc_gen_to_ed(vector<int> &list);
-        void arrange_cc_vert_to_ed(vector<int> &list,double cx,double cy,int id);
+        //the arrange routines reorder a list in place, and can be applied to
+        //the rows of the connectivity tables from multiple threads
+        void arrange_cc_x_to_gen(csr_table::row list,double cx,double cy);
+        inline void arrange_cc_x_to_gen(vector<int> &list,double cx,double cy){
+            if(list.size()>0) arrange_cc_x_to_gen(csr_table::row(&list[0],list.size()),cx,cy);
+        }
+        void arrange_cc_gen_to_vert(csr_table::row list,double cx,double cy);
+        void arrange_cc_gen_to_ed(csr_table::row list);
+        void arrange_cc_vert_to_ed(csr_table::row list,double cx,double cy,int id);
         void assemble_vertex();
         void assemble_gen_ed();
         void assemble_boundary();
+        void walk_boundary(bool fill);
+        //during the first pass of the boundary walk, counts the two entries
+        //that are added to row i of a boundary table, and stores them during
+        //the second pass
+        inline void add_bd(csr_table &t,int i,int g1,int g2,bool fill){
+            if(fill){
+                t.fill(i,g1);
+                t.fill(i,g2);
+            }else t.count(i,2);
+        }
         void draw_gnu(FILE *fp=stdout);
         inline void draw_gnu(const char *filename){
             FILE *fp=safe_fopen(filename,"w");
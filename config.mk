@@ -15,6 +15,14 @@ CFLAGS+=-g
 CFLAGS+=-Wno-c++11-extensions
 CFLAGS+=-Wno-deprecated
 
+# Set ZLIB to 1 to compile with zlib, which allows the VTK output to be
+# compressed. Programs are then linked with the libraries in LIBS.
+ZLIB?=0
+ifeq ($(ZLIB),1)
+CFLAGS+=-DVOROPP_ZLIB=1
+LIBS+=-lz
+endif
+
 # Relative include and library paths for compilation of the examples
 E_INC=-I../../src
 E_LIB=-L../../src
@@ -0,0 +1,134 @@
+// Per-block wall list test code
+// Example code for Voro++, a cell-based Voronoi library
+// By Chris H. Rycroft and the Rycroft Group
+
+#include <vector>
+
+#include "voro++.hh"
+using namespace voro;
+
+// Major and minor torus radii
+const double arad=9,brad=3.5;
+
+// The outer radius of the torus, that determines how big the container should
+// be
+const double crad=arad+brad;
+
+// Set up constants for the container geometry
+const double x_min=-crad-0.5,x_max=crad+0.5;
+const double y_min=-crad-0.5,y_max=crad+0.5;
+const double z_min=-brad-0.5,z_max=brad+0.5;
+
+// Set the computational grid size
+const int n_x=12,n_y=12,n_z=4;
+
+// The number of mesh divisions around the major and minor circles
+const int n_u=48,n_v=16;
+
+// The number of plane walls, and their distance from the origin. The planes
+// cut off the outer part of the torus.
+const int n_w=24;
+const double wrad=11;
+
+// The margin used to set up the per-block wall lists, which is smaller than
+// most of the cells so that the skipped walls are often applied afterwards
+const double margin=0.5;
+
+// The numbers of particles to test
+const int n_tests=3;
+const int particles[n_tests]={30,100,1000};
+
+// The relative tolerance for comparing the cell volumes
+const double check_tol=1e-10;
+
+// The number of failed checks
+int failures=0;
+
+// Records the outcome of a check, printing a message if it failed
+void check(bool ok,const char *msg) {
+    if(!ok) {
+        fprintf(stderr,"block_wall_test: %s\n",msg);
+        failures++;
+    }
+}
+
+// This function returns a random number uniformly distributed over the range
+// from a to b
+inline double rnd(double a,double b) {
+    return a+(b-a)/RAND_MAX*static_cast<double>(rand());
+}
+
+// Computes the volume and the number of faces of every cell in the container
+void compute(container_3d &con,std::vector<double> &vol,std::vector<int> &nf) {
+    container_3d::iterator cli;
+    voronoicell_neighbor_3d c(con);
+    vol.clear();nf.clear();
+    for(cli=con.begin();cli<con.end();cli++) {
+        if(con.compute_cell(c,cli)) {
+            vol.push_back(c.volume());
+            nf.push_back(c.number_of_faces());
+        } else {
+            vol.push_back(0);
+            nf.push_back(0);
+        }
+    }
+}
+
+int main() {
+
+    // Create a triangle mesh of a torus that is centered on the origin and
+    // aligned with the xy plane. Since the torus is not convex, the cuts made
+    // by the mesh wall depend on the extent of each cell when it is applied.
+    std::vector<double> v;
+    std::vector<int> t;
+    int i,j;
+    for(i=0;i<n_u;i++) for(j=0;j<n_v;j++) {
+        double u=2*M_PI*i/n_u,w=2*M_PI*j/n_v,r=arad+brad*cos(w);
+        v.push_back(r*cos(u));v.push_back(r*sin(u));v.push_back(brad*sin(w));
+    }
+    for(i=0;i<n_u;i++) for(j=0;j<n_v;j++) {
+        int a=i*n_v+j,b=((i+1)%n_u)*n_v+j,
+            c=((i+1)%n_u)*n_v+(j+1)%n_v,d=i*n_v+(j+1)%n_v;
+        t.push_back(a);t.push_back(b);t.push_back(c);
+        t.push_back(a);t.push_back(c);t.push_back(d);
+    }
+    wall_mesh tor(v,t);
+
+    // Create plane walls around the z axis
+    wall_list_3d wl;
+    for(i=0;i<n_w;i++) {
+        double th=2*M_PI*(i+0.5)/n_w;
+        wl.add_wall(new wall_plane(cos(th),sin(th),0,wrad,-10-i));
+    }
+
+    // For each number of particles, compute the cells with every wall applied
+    // to every cell, and then using the per-block wall lists. The results
+    // must be the same.
+    std::vector<double> va,vb;
+    std::vector<int> fa,fb;
+    for(int l=0;l<n_tests;l++) {
+        container_3d con(x_min,x_max,y_min,y_max,z_min,z_max,n_x,n_y,n_z,
+                         false,false,false,8);
+        con.add_wall(tor);
+        con.add_wall(wl);
+        srand(1);
+        for(i=0;i<particles[l];) {
+            double x=rnd(-crad,crad),y=rnd(-crad,crad),z=rnd(-brad,brad);
+            if(con.point_inside(x,y,z)) con.put(i++,x,y,z);
+        }
+        compute(con,va,fa);
+        con.setup_block_walls(margin);
+        compute(con,vb,fb);
+        bool ok=va.size()==vb.size();
+        for(j=0;ok&&j<int(va.size());j++)
+            ok=fabs(va[j]-vb[j])<=check_tol*va[j]&&fa[j]==fb[j];
+        check(ok,"Cells differ when the per-block wall lists are used");
+    }
+    wl.deallocate();
+
+    if(failures>0) {
+        fprintf(stderr,"block_wall_test: %d checks failed\n",failures);
+        return 1;
+    }
+    puts("block_wall_test: All checks passed");
+}
@@ -0,0 +1,100 @@
+// Cell reduction test code
+// Example code for Voro++, a cell-based Voronoi library
+// By Chris H. Rycroft and the Rycroft Group
+
+#include <vector>
+
+#include "voro++.hh"
+using namespace voro;
+
+// Set up constants for the container geometry
+const double x_min=-1,x_max=1;
+const double y_min=-1,y_max=1;
+const double z_min=-1,z_max=1;
+const double cvol=(x_max-x_min)*(y_max-y_min)*(z_max-z_min);
+
+// Set up the number of blocks that the container is divided into
+const int n_x=6,n_y=6,n_z=6;
+
+// Set the number of particles that are going to be randomly introduced
+const int particles=2000;
+
+// The relative tolerance for comparing floating point sums
+const double check_tol=1e-10;
+
+// The number of failed checks
+int failures=0;
+
+// Records the outcome of a check, printing a message if it failed
+void check(bool ok,const char *msg) {
+    if(!ok) {
+        fprintf(stderr,"reduction_test: %s\n",msg);
+        failures++;
+    }
+}
+
+// This function returns a random number uniformly distributed over the range
+// from a to b
+inline double rnd(double a,double b) {
+    return a+(b-a)/RAND_MAX*static_cast<double>(rand());
+}
+
+int main() {
+    container_3d con(x_min,x_max,y_min,y_max,z_min,z_max,n_x,n_y,n_z,
+                     false,false,false,8);
+    for(int i=0;i<particles;i++) con.put(i,rnd(x_min,x_max),rnd(y_min,y_max),rnd(z_min,z_max));
+
+    // Compute the statistics serially, one cell at a time
+    container_3d::iterator ci;
+    voronoicell_neighbor_3d c(con);
+    std::vector<int> v,fh,ff;
+    double vol=0,area=0;
+    uint64_t cells=0,nei=0;
+    for(ci=con.begin();ci<con.end();ci++) if(con.compute_cell(c,ci)) {
+        cells++;
+        vol+=c.volume();
+        area+=c.surface_area();
+        int f=c.number_of_faces();
+        if(f>=(int) fh.size()) fh.resize(f+1,0);
+        fh[f]++;
+        c.face_freq_table(v);
+        if(v.size()>ff.size()) ff.resize(v.size(),0);
+        for(int l=0;l<(int) v.size();l++) ff[l]+=v[l];
+        c.neighbors(v);
+        for(int l=0;l<(int) v.size();l++) if(v[l]>=0) nei++;
+    }
+
+    // Construct the reduction class with the default arguments, and compare
+    // its results to the serial computation
+    cell_reduction_3d cr;
+    check(!(cr.mask&cell_reduction_3d::volume_histogram),"Default reductions include the volume histogram");
+    con.reduce_cells(cr);
+    check(cr.cells==cells&&cells==(uint64_t) particles,"Wrong number of cells");
+    check(fabs(cr.volume-vol)<check_tol*cvol&&fabs(cr.volume-cvol)<check_tol*cvol,"Wrong total volume");
+    check(fabs(cr.area-area)<check_tol*area,"Wrong total surface area");
+    check(cr.neighbors==nei,"Wrong neighbor count");
+    check(cr.vol_hist.empty(),"Volume histogram computed without limits");
+    bool ok=cr.face_hist.size()==fh.size();
+    for(int l=0;ok&&l<(int) fh.size();l++) ok=cr.face_hist[l]==(uint64_t) fh[l];
+    check(ok,"Wrong face count histogram");
+    ok=cr.face_freq_sum.size()==ff.size();
+    for(int l=0;ok&&l<(int) ff.size();l++) ok=cr.face_freq_sum[l]==(uint64_t) ff[l];
+    check(ok,"Wrong face frequency table");
+
+    // Request all of the reductions, with limits for the volume histogram
+    // that cover every cell
+    cell_reduction_3d ca(cell_reduction_3d::all,40,0,cvol);
+    con.reduce_cells(ca);
+    uint64_t hs=0;
+    for(int l=0;l<(int) ca.vol_hist.size();l++) hs+=ca.vol_hist[l];
+    check(ca.vol_hist.size()==42&&hs==cells&&ca.vol_hist[40]==0&&ca.vol_hist[41]==0,
+          "Wrong volume histogram");
+    check(ca.cells==cr.cells&&ca.volume==cr.volume&&ca.area==cr.area,
+          "Results depend on the requested reductions");
+
+    if(failures>0) {
+        fprintf(stderr,"reduction_test: %d checks failed\n",failures);
+        return 1;
+    }
+    puts("reduction_test: All checks passed");
+}
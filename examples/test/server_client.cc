@@ -0,0 +1,214 @@
+// Query server test code
+// Example code for Voro++, a cell-based Voronoi library
+// By Chris H. Rycroft and the Rycroft Group
+
+#include <cstring>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "voro++.hh"
+using namespace voro;
+
+// Set up constants for the container geometry, matching the options that the
+// server is started with in server_test.sh
+const double x_min=-5,x_max=5;
+const double y_min=-5,y_max=5;
+const double z_min=0,z_max=10;
+const double cvol=(x_max-x_min)*(y_max-y_min)*(z_max-z_min);
+
+// The check_tol for comparing the values returned by the server to those
+// computed directly
+const double check_tol=1e-10;
+
+// The time in seconds after which the test is abandoned, in case the server
+// stops responding
+const int time_limit=30;
+
+// The request and reply headers, and the reply records, following the layout
+// in the voro++-server man page
+struct header {
+    uint32_t a;
+    uint32_t n;
+};
+
+struct record_find {
+    uint64_t id;
+    double x,y,z;
+};
+
+struct record_stats {
+    double volume,area;
+    double cx,cy,cz;
+    uint32_t faces,vertices;
+};
+
+// The number of failed checks
+int failures=0;
+
+// Records the outcome of a check, printing a message if it failed
+void check(bool ok,const char *msg) {
+    if(!ok) {
+        fprintf(stderr,"server_client: %s\n",msg);
+        failures++;
+    }
+}
+
+// Opens a connection to the server
+int connect_server(const char *sock_fn) {
+    sockaddr_un sa;
+    memset(&sa,0,sizeof(sockaddr_un));
+    sa.sun_family=AF_UNIX;
+    strncpy(sa.sun_path,sock_fn,sizeof(sa.sun_path)-1);
+    int fd=socket(AF_UNIX,SOCK_STREAM,0);
+    if(fd<0||connect(fd,reinterpret_cast<sockaddr*>(&sa),sizeof(sockaddr_un))<0) {
+        fprintf(stderr,"server_client: Unable to connect to %s\n",sock_fn);
+        exit(1);
+    }
+    return fd;
+}
+
+// Sends a given number of bytes to the server
+void send_full(int fd,const void *buf,size_t len) {
+    const char *bp=static_cast<const char*>(buf);
+    while(len>0) {
+        ssize_t k=write(fd,bp,len);
+        if(k<=0) {
+            fputs("server_client: Unable to send request\n",stderr);
+            exit(1);
+        }
+        bp+=k;len-=k;
+    }
+}
+
+// Receives a given number of bytes from the server, returning false if the
+// connection was closed
+bool recv_full(int fd,void *buf,size_t len) {
+    char *bp=static_cast<char*>(buf);
+    while(len>0) {
+        ssize_t k=read(fd,bp,len);
+        if(k<=0) return false;
+        bp+=k;len-=k;
+    }
+    return true;
+}
+
+// Sends a request, and receives the header of the reply
+header request(int fd,uint32_t a,uint32_t n,const void *buf,size_t len) {
+    header h={a,n};
+    send_full(fd,&h,sizeof(header));
+    if(len>0) send_full(fd,buf,len);
+    if(!recv_full(fd,&h,sizeof(header))) {
+        fputs("server_client: Connection closed while waiting for reply\n",stderr);
+        exit(1);
+    }
+    return h;
+}
+
+int main(int argc,char **argv) {
+    if(argc!=2) {
+        fputs("Syntax: server_client <socket>\n",stderr);
+        return 1;
+    }
+    alarm(time_limit);
+
+    // Import the same particles as the server, so that the replies can be
+    // checked against a direct computation
+    container_3d con(x_min,x_max,y_min,y_max,z_min,z_max,6,6,6,
+                     false,false,false,8);
+    FILE *fp=safe_fopen("../basic/pack_ten_cube","r");
+    int id;
+    double x,y,z;
+    while(fscanf(fp,"%d %lg %lg %lg",&id,&x,&y,&z)==4) con.put(id,x,y,z);
+    fclose(fp);
+    std::vector<uint64_t> ids;
+    std::vector<double> pos,vols;
+    container_3d::iterator ci;
+    voronoicell_3d c(con);
+    for(ci=con.begin();ci<con.end();ci++) if(con.compute_cell(c,ci)) {
+        con.pos(ci,x,y,z);
+        ids.push_back(con.pid(ci));
+        pos.push_back(x);pos.push_back(y);pos.push_back(z);
+        vols.push_back(c.volume());
+    }
+    int n=ids.size();
+
+    // Open two connections. The first one to be opened sends the start of a
+    // request and then stalls, which must not prevent the other one from
+    // being answered.
+    int fd2=connect_server(argv[1]),fd=connect_server(argv[1]);
+    header h,hl={4,0};
+    send_full(fd2,&hl,sizeof(uint32_t));
+
+    // Locate the cell at each particle position, which must be the cell of
+    // that particle
+    std::vector<record_find> rf(n);
+    h=request(fd,1,n,pos.data(),pos.size()*sizeof(double));
+    check(h.a==0&&(int) h.n==n,"Bad reply header for find queries");
+    check(recv_full(fd,rf.data(),n*sizeof(record_find)),"Truncated reply for find queries");
+    for(int i=0;i<n;i++) check(rf[i].id==ids[i]&&rf[i].x==pos[3*i]
+                               &&rf[i].y==pos[3*i+1]&&rf[i].z==pos[3*i+2],
+                               "Find query returned the wrong particle");
+
+    // Request the statistics of every particle, plus one ID that does not
+    // exist. The volumes must match the direct computation and sum to the
+    // container volume.
+    ids.push_back(UINT64_MAX);
+    std::vector<record_stats> rs(n+1);
+    h=request(fd,3,n+1,ids.data(),ids.size()*sizeof(uint64_t));
+    check(h.a==0&&(int) h.n==n+1,"Bad reply header for stats queries");
+    check(recv_full(fd,rs.data(),(n+1)*sizeof(record_stats)),"Truncated reply for stats queries");
+    double vvol=0;
+    for(int i=0;i<n;i++) {
+        check(fabs(rs[i].volume-vols[i])<check_tol&&rs[i].faces>=4,
+              "Stats query returned the wrong volume");
+        vvol+=rs[i].volume;
+    }
+    check(fabs(vvol-cvol)<1e-8*cvol,"Cell volumes do not sum to the container volume");
+    check(rs[n].faces==0,"Stats query for a missing ID returned a cell");
+
+    // Compute the cell of a ghost particle, and compare it to the direct
+    // computation
+    double gp[3]={0.1,0.2,5.3},gv;
+    uint64_t m;
+    voronoicell_neighbor_3d cn(con);
+    std::vector<int> nb;
+    h=request(fd,2,1,gp,sizeof(gp));
+    check(h.a==0&&h.n==1,"Bad reply header for ghost query");
+    check(recv_full(fd,&gv,sizeof(double))&&recv_full(fd,&m,sizeof(uint64_t)),
+          "Truncated reply for ghost query");
+    std::vector<int64_t> gnb(m);
+    check(recv_full(fd,gnb.data(),m*sizeof(int64_t)),"Truncated reply for ghost query");
+    if(con.compute_ghost_cell(cn,*gp,gp[1],gp[2])) {
+        cn.neighbors(nb);
+        check(fabs(gv-cn.volume())<check_tol&&m==nb.size(),
+              "Ghost query returned the wrong cell");
+    } else check(false,"Unable to compute ghost cell directly");
+
+    // Complete the stalled latency request on the second connection. Three
+    // requests have been timed so far.
+    double pc[5];
+    send_full(fd2,&hl.n,sizeof(uint32_t));
+    check(recv_full(fd2,&h,sizeof(header))&&h.a==0&&h.n==3,"Bad reply header for latency query");
+    check(recv_full(fd2,pc,sizeof(pc))&&pc[0]>0&&pc[0]<=pc[4],"Bad latency percentiles");
+
+    // Send an invalid query type, which causes the server to reply with an
+    // error and close the connection
+    h=request(fd2,99,0,NULL,0);
+    check(h.a==1,"Invalid query type was not rejected");
+    check(!recv_full(fd2,&h,sizeof(header)),"Connection was not closed after an error");
+    close(fd2);
+
+    // Shut down the server
+    h=request(fd,5,0,NULL,0);
+    check(h.a==0&&h.n==0,"Bad reply header for shutdown");
+    close(fd);
+
+    if(failures>0) {
+        fprintf(stderr,"server_client: %d checks failed\n",failures);
+        return 1;
+    }
+    puts("server_client: All checks passed");
+}
@@ -0,0 +1,34 @@
+#!/bin/sh
+# Runs the query server on a test particle system, and checks its replies
+# using the server_client program
+server=../../src/voro++-server
+sock=server_test.sock
+
+# Check that the server refuses to replace a file that is not a socket. If it
+# is still running after a second, then it has started listening instead.
+echo "not a socket" > server_test.file
+$server -5 5 -5 5 0 10 ../basic/pack_ten_cube server_test.file 2>/dev/null &
+pid=$!
+sleep 1
+if kill $pid 2>/dev/null || [ ! -f server_test.file ] ; then
+    echo "server_test: Server replaced a regular file" >&2
+    rm -f server_test.file
+    exit 1
+fi
+rm -f server_test.file
+
+# Start the server, and wait for the socket to be created
+$server -5 5 -5 5 0 10 ../basic/pack_ten_cube $sock &
+pid=$!
+i=0
+while [ ! -S $sock ] && [ $i -lt 100 ] ; do
+    sleep 0.1
+    i=$((i+1))
+done
+
+# Run the client, which shuts the server down once it has finished
+./server_client $sock
+status=$?
+if [ $status -ne 0 ] ; then kill $pid 2>/dev/null ; fi
+wait $pid || status=1
+exit $status
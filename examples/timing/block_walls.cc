@@ -0,0 +1,85 @@
+// Voro++, a cell-based Voronoi library
+// By Chris H. Rycroft and the Rycroft Group
+
+#include <cstdlib>
+#include <cmath>
+
+#include "voro++.hh"
+using namespace voro;
+
+// Set up timing routine. If code was compiled with OpenMP, then use the
+// accurate wtime function. Otherwise use the clock function in the ctime
+// library.
+#ifdef _OPENMP
+#include "omp.h"
+inline double wtime_() {return omp_get_wtime();}
+#else
+#include <ctime>
+inline double wtime_() {return 1./CLOCKS_PER_SEC*static_cast<double>(clock());}
+#endif
+
+// Returns a random double that is uniformly distributed between 0 and 1
+inline double rnd() {return 1./RAND_MAX*static_cast<double>(rand());}
+
+// Prints out a message about the syntax of the command-line utility
+void syntax_message() {
+    puts("Syntax: ./block_walls <num> <walls>\n"
+         "Arguments:\n"
+         "<num>         The number of particles                     [100000]\n"
+         "<walls>       The number of plane walls                   [200]\n\n"
+         "If any argument is missing, the default value in the square brackets is used\n");
+    exit(1);
+}
+
+// Computes all of the cells in the container, returning the total volume and
+// the time taken
+void compute(container_3d &con,double &vol,double &t) {
+    voronoicell_3d c(con);
+    vol=0;
+    t=wtime_();
+    for(container_3d::iterator cli=con.begin();cli<con.end();cli++)
+        if(con.compute_cell(c,cli)) vol+=c.volume();
+    t=wtime_()-t;
+}
+
+int main(int argc,char **argv) {
+
+    // Check for a valid number of command-line arguments
+    if(argc>3) syntax_message();
+
+    // Read the command-line arguments, and check that they are valid
+    int num=100000,nw=200;
+    if(argc>1) {
+        num=atoi(argv[1]);
+        if(num<=0) syntax_message();
+        if(argc>2) {
+            nw=atoi(argv[2]);
+            if(nw<3) syntax_message();
+        }
+    }
+
+    // Create a container holding a cylinder of unit radius, represented by
+    // plane walls, and fill it with randomly positioned particles
+    int n=int(pow(num/(5.6*M_PI/4),1/3.0))+1;
+    container_3d con(-1,1,-1,1,-1,1,n,n,n,false,false,false,8);
+    wall_list_3d wl;
+    for(int i=0;i<nw;i++) {
+        double th=2*M_PI*i/nw;
+        wl.add_wall(new wall_plane(cos(th),sin(th),0,1,-1-i));
+    }
+    con.add_wall(wl);
+    for(int i=0;i<num;) {
+        double x=2*rnd()-1,y=2*rnd()-1,z=2*rnd()-1;
+        if(con.point_inside(x,y,z)) con.put(i++,x,y,z);
+    }
+
+    // Compute the cells with every wall applied to every cell, and then
+    // using the per-block wall lists
+    double va,ta,vb,tb;
+    compute(con,va,ta);
+    con.setup_block_walls();
+    compute(con,vb,tb);
+    printf("All walls       : volume %.12g, time %g s\n"
+           "Per-block walls : volume %.12g, time %g s\n",va,ta,vb,tb);
+    wl.deallocate();
+}
@@ -0,0 +1,111 @@
+// Voro++, a cell-based Voronoi library
+// By Chris H. Rycroft and the Rycroft Group
+
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+
+#include "voro++.hh"
+using namespace voro;
+
+// Set up timing routine. If code was compiled with OpenMP, then use the
+// accurate wtime function. Otherwise use the clock function in the ctime
+// library.
+#ifdef _OPENMP
+#include "omp.h"
+inline double wtime_() {return omp_get_wtime();}
+#else
+#include <ctime>
+inline double wtime_() {return 1./CLOCKS_PER_SEC*static_cast<double>(clock());}
+#endif
+
+// Returns a random double that is uniformly distributed between 0 and 1
+inline double rnd() {return 1./RAND_MAX*static_cast<double>(rand());}
+
+// Prints out a message about the syntax of the command-line utility
+void syntax_message() {
+    puts("Syntax: ./quad_2d <num> <threads>\n"
+         "Arguments:\n"
+         "<num>         The number of particles                     [1000000]\n"
+         "<threads>     The number of threads                       [1]\n\n"
+         "If any argument is missing, the default value in the square brackets is used\n");
+    exit(1);
+}
+
+// Creates particle positions in the unit square. If the width is zero, then
+// the particles are uniformly distributed. Otherwise they are placed in
+// Gaussian clusters of the given width, centered at random positions.
+void create_points(std::vector<double> &pt,int num,double width) {
+    const int clusters=20;
+    double cen[2*clusters];
+    srand(1);
+    for(int k=0;k<2*clusters;k++) cen[k]=0.1+0.8*rnd();
+    pt.resize(2*num);
+    for(int i=0;i<num;i++) {
+        double x,y;
+        if(width==0) {x=rnd();y=rnd();}
+        else {
+            int k=rand()%clusters;
+            do {
+                double r=width*sqrt(-2*log(1-0.999*rnd())),th=2*M_PI*rnd();
+                x=cen[2*k]+r*cos(th);y=cen[2*k+1]+r*sin(th);
+            } while(x<0||x>=1||y<0||y>=1);
+        }
+        pt[2*i]=x;pt[2*i+1]=y;
+    }
+}
+
+// Computes all of the cells in a container_2d in parallel, returning the
+// total area
+double compute(container_2d &con,int nt) {
+    double area=0;
+#pragma omp parallel num_threads(nt) reduction(+:area)
+    {
+        voronoicell_2d c(con);
+#pragma omp for schedule(dynamic,64)
+        for(container_2d::iterator cli=con.begin();cli<con.end();cli++)
+            if(con.compute_cell(c,cli)) area+=c.area();
+    }
+    return area;
+}
+
+int main(int argc,char **argv) {
+
+    // Check for a valid number of command-line arguments
+    if(argc>3) syntax_message();
+
+    // Read the command-line arguments, and check that they are valid
+    int num=1000000,nt=1;
+    if(argc>1) {
+        num=atoi(argv[1]);
+        if(num<=0) syntax_message();
+        if(argc>2) {
+            nt=atoi(argv[2]);
+            if(nt<=0) syntax_message();
+        }
+    }
+
+    // For each particle distribution, compare the uniform grid container with
+    // the adaptive quadtree container. The construction time includes adding
+    // the particles, and for the quadtree, setting up the leaf adjacencies.
+    const double widths[4]={0,0.05,0.01,0.002};
+    std::vector<double> pt;
+    puts("# Cluster width, grid build time, grid cell time, quadtree build time, quadtree cell time, grid area, quadtree area");
+    for(int w=0;w<4;w++) {
+        create_points(pt,num,widths[w]);
+
+        double t0=wtime_();
+        int n=int(sqrt(num/optimal_particles_2d))+1;
+        container_2d con(0,1,0,1,n,n,false,false,8,nt);
+        con.add_parallel(pt.data(),num,nt);
+        con.put_reconcile_overflow();
+        double t1=wtime_(),ga=compute(con,nt),t2=wtime_();
+
+        container_quad_2d qcon(0,1,0,1,nt);
+        qcon.add_parallel(pt.data(),num,nt);
+        qcon.setup_neighbors();
+        double t3=wtime_(),qa=qcon.sum_cell_areas(),t4=wtime_();
+
+        printf("%g %g %g %g %g %.12g %.12g\n",widths[w],t1-t0,t2-t1,t3-t2,t4-t3,ga,qa);
+    }
+}
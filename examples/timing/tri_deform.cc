@@ -0,0 +1,103 @@
+// Voro++, a cell-based Voronoi library
+// By Chris H. Rycroft and the Rycroft Group
+
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+
+#include "voro++.hh"
+using namespace voro;
+
+// Set up timing routine. If code was compiled with OpenMP, then use the
+// accurate wtime function. Otherwise use the clock function in the ctime
+// library.
+#ifdef _OPENMP
+#include "omp.h"
+inline double wtime_() {return omp_get_wtime();}
+#else
+#include <ctime>
+inline double wtime_() {return 1./CLOCKS_PER_SEC*static_cast<double>(clock());}
+#endif
+
+// Returns a random double that is uniformly distributed between 0 and 1
+inline double rnd() {return 1./RAND_MAX*static_cast<double>(rand());}
+
+// Prints out a message about the syntax of the command-line utility
+void syntax_message() {
+    puts("Syntax: ./tri_deform <num> <steps>\n"
+         "Arguments:\n"
+         "<num>         The number of particles                     [100000]\n"
+         "<steps>       The number of deformation steps             [50]\n\n"
+         "If any argument is missing, the default value in the square brackets is used\n");
+    exit(1);
+}
+
+// Computes the domain vectors at a given step, for a domain that is sheared
+// in the xy plane while its volume oscillates
+void domain(int s,double *b) {
+    double sc=1+0.05*sin(0.2*s);
+    b[0]=sc;b[1]=0.02*s;b[2]=sc;
+    b[3]=0.1;b[4]=-0.2;b[5]=1/(sc*sc);
+}
+
+// Computes all of the cells, returning the sum of the squared cell volumes,
+// which does not depend on the order of the particles
+double compute(container_triclinic &con) {
+    voronoicell_3d c(con);
+    double v2=0,v;
+    for(container_triclinic::iterator cli=con.begin();cli<con.end();cli++)
+        if(con.compute_cell(c,cli)) {v=c.volume();v2+=v*v;}
+    return v2;
+}
+
+int main(int argc,char **argv) {
+
+    // Check for a valid number of command-line arguments
+    if(argc>3) syntax_message();
+
+    // Read the command-line arguments, and check that they are valid
+    int num=100000,steps=50;
+    if(argc>1) {
+        num=atoi(argv[1]);
+        if(num<=0) syntax_message();
+        if(argc>2) {
+            steps=atoi(argv[2]);
+            if(steps<=0) syntax_message();
+        }
+    }
+
+    // Create random particle positions, stored as coordinates with respect to
+    // the domain vectors, and add them to a container with the initial domain
+    std::vector<double> f(3*num);
+    for(int i=0;i<3*num;i++) f[i]=rnd();
+    int n=int(pow(num/5.6,1/3.0))+1;
+    double b[6];
+    domain(0,b);
+    container_triclinic con(b[0],b[1],b[2],b[3],b[4],b[5],n,n,n,8);
+    for(int i=0;i<num;i++) {
+        double *fp=f.data()+3*i;
+        con.put(i,*fp*b[0]+fp[1]*b[1]+fp[2]*b[3],fp[1]*b[2]+fp[2]*b[4],fp[2]*b[5]);
+    }
+
+    // At each step, deform the container in place, and compare this to
+    // constructing a new container for the same domain
+    double td=0,tr=0;
+    puts("# Step, bxy, moved particles, deform time, rebuild time, sum of squared volumes");
+    for(int s=1;s<=steps;s++) {
+        domain(s,b);
+        double t0=wtime_();
+        int moved=con.deform(b[0],b[1],b[2],b[3],b[4],b[5]);
+        double t1=wtime_();
+        container_triclinic con2(b[0],b[1],b[2],b[3],b[4],b[5],n,n,n,8);
+        for(int i=0;i<num;i++) {
+            double *fp=f.data()+3*i;
+            con2.put(i,*fp*b[0]+fp[1]*b[1]+fp[2]*b[3],fp[1]*b[2]+fp[2]*b[4],fp[2]*b[5]);
+        }
+        double t2=wtime_();
+        td+=t1-t0;tr+=t2-t1;
+        double va=compute(con),vb=compute(con2);
+        if(fabs(va-vb)>1e-9*vb) fprintf(stderr,"Volume mismatch at step %d: %.12g %.12g\n",s,va,vb);
+        printf("%d %g %d %g %g %.12g\n",s,b[1],moved,t1-t0,t2-t1,va);
+    }
+    printf("# Mean deform time %g s, mean rebuild time %g s\n",td/steps,tr/steps);
+}
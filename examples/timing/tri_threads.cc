@@ -0,0 +1,92 @@
+// Voro++, a cell-based Voronoi library
+// By Chris H. Rycroft and the Rycroft Group
+
+#include <cstdlib>
+#include <cmath>
+
+#include "voro++.hh"
+using namespace voro;
+
+// Set up timing routine. If code was compiled with OpenMP, then use the
+// accurate wtime function. Otherwise use the clock function in the ctime
+// library.
+#ifdef _OPENMP
+#include "omp.h"
+inline double wtime_() {return omp_get_wtime();}
+#else
+#include <ctime>
+inline double wtime_() {return 1./CLOCKS_PER_SEC*static_cast<double>(clock());}
+#endif
+
+// Returns a random double that is uniformly distributed between 0 and 1
+inline double rnd() {return 1./RAND_MAX*static_cast<double>(rand());}
+
+// Prints out a message about the syntax of the command-line utility
+void syntax_message() {
+    puts("Syntax: ./tri_threads <num> <max_threads>\n"
+         "Arguments:\n"
+         "<num>         The number of particles                     [200000]\n"
+         "<max_threads> The maximum number of threads               [64]\n\n"
+         "If any argument is missing, the default value in the square brackets is used\n");
+    exit(1);
+}
+
+// Sets up a triclinic container with randomly positioned particles
+container_triclinic* setup(int num,int nt) {
+    const double bx=1,bxy=0.3,by=1,bxz=0.2,byz=-0.4,bz=1;
+    int n=int(pow(num/5.6,1/3.0))+1;
+    container_triclinic *con=new container_triclinic(bx,bxy,by,bxz,byz,bz,n,n,n,8,nt);
+    srand(1);
+    for(int i=0;i<num;i++) {
+        double x=rnd(),y=rnd(),z=rnd();
+        con->put(i,x*bx+y*bxy+z*bxz,y*by+z*byz,z*bz);
+    }
+    return con;
+}
+
+// Computes all of the cells in parallel, returning the total volume
+double compute(container_triclinic &con,int nt) {
+    double vol=0;
+#pragma omp parallel num_threads(nt) reduction(+:vol)
+    {
+        voronoicell_3d c(con);
+#pragma omp for schedule(dynamic,64)
+        for(container_triclinic::iterator cli=con.begin();cli<con.end();cli++)
+            if(con.compute_cell(c,cli)) vol+=c.volume();
+    }
+    return vol;
+}
+
+int main(int argc,char **argv) {
+
+    // Check for a valid number of command-line arguments
+    if(argc>3) syntax_message();
+
+    // Read the command-line arguments, and check that they are valid
+    int num=200000,mt=64;
+    if(argc>1) {
+        num=atoi(argv[1]);
+        if(num<=0) syntax_message();
+        if(argc>2) {
+            mt=atoi(argv[2]);
+            if(mt<=0) syntax_message();
+        }
+    }
+
+    // For each number of threads, compute all of the cells with the periodic
+    // images constructed on demand, and then with the images constructed in
+    // a prepass
+    puts("# Threads, lazy time, prepass time, cell time after prepass, volume");
+    for(int nt=1;nt<=mt;nt*=2) {
+        container_triclinic *con=setup(num,nt);
+        double t0=wtime_(),va=compute(*con,nt),t1=wtime_();
+        delete con;
+        con=setup(num,nt);
+        double t2=wtime_();
+        con->create_all_images();
+        double t3=wtime_(),vb=compute(*con,nt),t4=wtime_();
+        delete con;
+        if(fabs(va-vb)>1e-8) fprintf(stderr,"Volume mismatch: %.12g %.12g\n",va,vb);
+        printf("%d %g %g %g %.12g\n",nt,t1-t0,t3-t2,t4-t3,va);
+    }
+}
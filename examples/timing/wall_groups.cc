@@ -0,0 +1,104 @@
+// Voro++, a cell-based Voronoi library
+// By Chris H. Rycroft and the Rycroft Group
+
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+
+#include "voro++.hh"
+using namespace voro;
+
+// Set up timing routine. If code was compiled with OpenMP, then use the
+// accurate wtime function. Otherwise use the clock function in the ctime
+// library.
+#ifdef _OPENMP
+#include "omp.h"
+inline double wtime_() {return omp_get_wtime();}
+#else
+#include <ctime>
+inline double wtime_() {return 1./CLOCKS_PER_SEC*static_cast<double>(clock());}
+#endif
+
+// Returns a random double that is uniformly distributed between 0 and 1
+inline double rnd() {return 1./RAND_MAX*static_cast<double>(rand());}
+
+// Prints out a message about the syntax of the command-line utility
+void syntax_message() {
+    puts("Syntax: ./wall_groups <num> <walls>\n"
+         "Arguments:\n"
+         "<num>         The number of particles                     [100000]\n"
+         "<walls>       The number of plane walls                   [200]\n\n"
+         "If any argument is missing, the default value in the square brackets is used\n");
+    exit(1);
+}
+
+// Fills a container with particles at random positions inside the walls, by
+// generating candidate positions in batches and testing each batch at once.
+// Returns the time taken.
+double fill(container_3d &con,int num) {
+    const int bs=4096;
+    std::vector<double> pos(3*bs);
+    bool in[bs];
+    double t=wtime_();
+    srand(1);
+    for(int i=0;i<num;) {
+        for(double *pp=pos.data();pp<pos.data()+3*bs;pp++) *pp=2*rnd()-1;
+        con.points_inside(bs,pos.data(),in);
+        for(int j=0;j<bs&&i<num;j++) if(in[j]) con.put(i++,pos[3*j],pos[3*j+1],pos[3*j+2]);
+    }
+    return wtime_()-t;
+}
+
+// Computes all of the cells in the container, returning the total volume and
+// the time taken
+void compute(container_3d &con,double &vol,double &t) {
+    voronoicell_3d c(con);
+    vol=0;
+    t=wtime_();
+    for(container_3d::iterator cli=con.begin();cli<con.end();cli++)
+        if(con.compute_cell(c,cli)) vol+=c.volume();
+    t=wtime_()-t;
+}
+
+int main(int argc,char **argv) {
+
+    // Check for a valid number of command-line arguments
+    if(argc>3) syntax_message();
+
+    // Read the command-line arguments, and check that they are valid
+    int num=100000,nw=200;
+    if(argc>1) {
+        num=atoi(argv[1]);
+        if(num<=0) syntax_message();
+        if(argc>2) {
+            nw=atoi(argv[2]);
+            if(nw<3) syntax_message();
+        }
+    }
+
+    // Create two containers holding a cylinder of unit radius, represented
+    // by plane walls. In the first, each plane is a separate wall, and in the
+    // second, the planes are held in a single group.
+    int n=int(pow(num/(5.6*M_PI/4),1/3.0))+1;
+    container_3d cona(-1,1,-1,1,-1,1,n,n,n,false,false,false,8),
+                 conb(-1,1,-1,1,-1,1,n,n,n,false,false,false,8);
+    wall_list_3d wl;
+    wall_plane_group wg;
+    for(int i=0;i<nw;i++) {
+        double th=2*M_PI*i/nw;
+        wl.add_wall(new wall_plane(cos(th),sin(th),0,1,-1-i));
+        wg.add(cos(th),sin(th),0,1,-1-i);
+    }
+    cona.add_wall(wl);
+    conb.add_wall(wg);
+
+    // Fill both containers with the same particles, and then compute all of
+    // the cells
+    double fa=fill(cona,num),fb=fill(conb,num),va,ta,vb,tb;
+    compute(cona,va,ta);
+    compute(conb,vb,tb);
+    printf("Separate walls : fill time %g s, volume %.12g, time %g s\n"
+           "Wall group     : fill time %g s, volume %.12g, time %g s\n",
+           fa,va,ta,fb,vb,tb);
+    wl.deallocate();
+}
@@ -0,0 +1,109 @@
+// Voro++, a cell-based Voronoi library
+// By Chris H. Rycroft and the Rycroft Group
+
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+
+#include "voro++.hh"
+using namespace voro;
+
+// Set up timing routine. If code was compiled with OpenMP, then use the
+// accurate wtime function. Otherwise use the clock function in the ctime
+// library.
+#ifdef _OPENMP
+#include "omp.h"
+inline double wtime_() {return omp_get_wtime();}
+#else
+#include <ctime>
+inline double wtime_() {return 1./CLOCKS_PER_SEC*static_cast<double>(clock());}
+#endif
+
+// Returns a random double that is uniformly distributed between 0 and 1
+inline double rnd() {return 1./RAND_MAX*static_cast<double>(rand());}
+
+// Prints out a message about the syntax of the command-line utility
+void syntax_message() {
+    puts("Syntax: ./warm_start <num> <disp> <steps>\n"
+         "Arguments:\n"
+         "<num>         The number of particles                     [100000]\n"
+         "<disp>        The displacement per step, as a fraction of\n"
+         "              the mean particle spacing                   [0.05]\n"
+         "<steps>       The number of time steps                    [5]\n\n"
+         "If any argument is missing, the default value in the square brackets is used\n");
+    exit(1);
+}
+
+int main(int argc,char **argv) {
+
+    // Check for a valid number of command-line arguments
+    if(argc>4) syntax_message();
+
+    // Read the command-line arguments, and check that they are valid
+    int num=100000,steps=5;
+    double disp=0.05;
+    if(argc>1) {
+        num=atoi(argv[1]);
+        if(num<=0) syntax_message();
+        if(argc>2) {
+            disp=atof(argv[2]);
+            if(disp<0) syntax_message();
+            if(argc>3) {
+                steps=atoi(argv[3]);
+                if(steps<=0) syntax_message();
+            }
+        }
+    }
+
+    // Create a periodic container with randomly positioned particles
+    int n=int(pow(num/5.6,1/3.0))+1;
+    double d=disp*pow(num,-1/3.0);
+    container_3d con(0,1,0,1,0,1,n,n,n,true,true,true,8);
+    std::vector<double> pos(3*num);
+    for(int i=0;i<3*num;i++) pos[i]=rnd();
+    for(int i=0;i<num;i++) con.put(i,pos[3*i],pos[3*i+1],pos[3*i+2]);
+
+    // Compute the initial neighbors of each particle
+    voronoicell_neighbor_3d c(con);
+    std::vector<std::vector<int> > nb(num);
+    for(container_3d::iterator cli=con.begin();cli<con.end();cli++)
+        if(con.compute_cell(c,cli)) c.neighbors(nb[con.id[cli->ijk][cli->q]]);
+
+    puts("# Step, cold planes/cell, warm planes/cell, cold time, warm time, max volume diff");
+    for(int s=1;s<=steps;s++) {
+
+        // Move the particles by a small random displacement, and rebuild the
+        // index for finding particles from their IDs
+        for(int i=0;i<3*num;i++) {
+            pos[i]+=d*(2*rnd()-1);
+            pos[i]-=floor(pos[i]);
+        }
+        con.clear();
+        for(int i=0;i<num;i++) con.put(i,pos[3*i],pos[3*i+1],pos[3*i+2]);
+        particle_index_3d pi(con);
+
+        // Compute all of the cells from scratch
+        std::vector<double> vol(num);
+        con.reset_plane_count();
+        double t0=wtime_();
+        for(container_3d::iterator cli=con.begin();cli<con.end();cli++)
+            if(con.compute_cell(c,cli)) vol[con.id[cli->ijk][cli->q]]=c.volume();
+        double tc=wtime_()-t0,cold=double(con.plane_count())/num;
+
+        // Compute all of the cells, warm starting from the previous
+        // neighbors, and update the neighbors for the next step
+        double dmax=0;
+        con.reset_plane_count();
+        t0=wtime_();
+        for(container_3d::iterator cli=con.begin();cli<con.end();cli++) {
+            int i=con.id[cli->ijk][cli->q];
+            if(con.compute_cell(c,cli->ijk,cli->q,nb[i],pi)) {
+                double dv=fabs(c.volume()-vol[i]);
+                if(dv>dmax) dmax=dv;
+                c.neighbors(nb[i]);
+            }
+        }
+        double tw=wtime_()-t0;
+        printf("%d %g %g %g %g %g\n",s,cold,double(con.plane_count())/num,tc,tw,dmax);
+    }
+}
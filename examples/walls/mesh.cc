@@ -0,0 +1,68 @@
+// Triangle mesh wall example code
+// By Chris H. Rycroft and the Rycroft Group
+
+#include <vector>
+
+#include "voro++.hh"
+using namespace voro;
+
+// Major and minor torus radii
+const double arad=9,brad=3.5;
+
+// The outer radius of the torus, that determines how big the container should
+// be
+const double crad=arad+brad;
+
+// Set up constants for the container geometry
+const double x_min=-crad-0.5,x_max=crad+0.5;
+const double y_min=-crad-0.5,y_max=crad+0.5;
+const double z_min=-brad-0.5,z_max=brad+0.5;
+
+// Set the computational grid size
+const int n_x=10,n_y=10,n_z=3;
+
+// The number of mesh divisions around the major and minor circles
+const int n_u=120,n_v=40;
+
+int main() {
+
+    // Create a triangle mesh of a torus that is centered on the origin and
+    // aligned with the xy plane. Each quadrilateral in the grid of vertices
+    // is divided into two triangles.
+    std::vector<double> v;
+    std::vector<int> t;
+    int i,j;
+    for(i=0;i<n_u;i++) for(j=0;j<n_v;j++) {
+        double u=2*M_PI*i/n_u,w=2*M_PI*j/n_v,r=arad+brad*cos(w);
+        v.push_back(r*cos(u));v.push_back(r*sin(u));v.push_back(brad*sin(w));
+    }
+    for(i=0;i<n_u;i++) for(j=0;j<n_v;j++) {
+        int a=i*n_v+j,b=((i+1)%n_u)*n_v+j,
+            c=((i+1)%n_u)*n_v+(j+1)%n_v,d=i*n_v+(j+1)%n_v;
+        t.push_back(a);t.push_back(b);t.push_back(c);
+        t.push_back(a);t.push_back(c);t.push_back(d);
+    }
+    wall_mesh tor(v,t);
+
+    // Create a container with the geometry given above, and make it
+    // non-periodic in each of the three coordinates. Allocate space for
+    // eight particles within each computational block.
+    container_3d con(x_min,x_max,y_min,y_max,z_min,z_max,n_x,n_y,n_z,
+                     false,false,false,8);
+
+    // Add the mesh wall to the container, and import the particles from a
+    // file
+    con.add_wall(tor);
+    con.import("pack_torus");
+
+    // Compare the total volume of the Voronoi cells to the volume enclosed by
+    // the mesh
+    printf("Mesh triangles       : %d\n"
+           "Mesh volume          : %g\n"
+           "Total V. cell volume : %g\n",tor.number_of_triangles(),tor.volume(),
+           con.sum_cell_volumes());
+
+    // Output the particle positions and Voronoi cells in POV-Ray format
+    con.draw_particles_pov("mesh_p.pov");
+    con.draw_cells_pov("mesh_v.pov");
+}
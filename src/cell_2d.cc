@@ -13,22 +13,34 @@ namespace voro {
 
 /** Constructs a 2D Voronoi cell and sets up the initial memory. */
 voronoicell_base_2d::voronoicell_base_2d(double max_len_sq) :
-    current_vertices(init_vertices), current_delete_size(init_delete_size),
-    tol(tolerance*max_len_sq), ed(new int[2*current_vertices]),
-    pts(new double[2*current_vertices]), ds(new int[current_delete_size]),
-    stacke(ds+current_delete_size) {}
+    current_vertices(init_vertices), p(0), tol(tolerance*max_len_sq),
+    ed(new int[2*current_vertices]), pts(new double[2*current_vertices]),
+    cu(new double[current_vertices]) {
+    init_edges(0);
+}
 
 /** The voronoicell_2d destructor deallocates all of the dynamic memory. */
 voronoicell_base_2d::~voronoicell_base_2d() {
-    delete [] ds;
+    delete [] cu;
     delete [] pts;
     delete [] ed;
 }
 
+/** Sets the entries of the edge table from a given vertex onward to point to
+ * the adjacent vertices in the array.
+ * \param[in] k the vertex to start from. */
+void voronoicell_base_2d::init_edges(int k) {
+    for(;k<current_vertices;k++) {
+        ed[2*k]=k+1;
+        ed[2*k+1]=k-1;
+    }
+}
+
 /** Initializes a Voronoi cell as a rectangle with the given dimensions.
  * \param[in] (xmin,xmax) the minimum and maximum x coordinates.
  * \param[in] (ymin,ymax) the minimum and maximum y coordinates. */
 void voronoicell_base_2d::init_base(double xmin,double xmax,double ymin,double ymax) {
+    if(p>0) ed[2*p-2]=p;
     p=4;xmin*=2;xmax*=2;ymin*=2;ymax*=2;
     *pts=xmin;pts[1]=ymin;
     pts[2]=xmax;pts[3]=ymin;
@@ -83,166 +95,159 @@ double voronoicell_base_2d::max_radius_squared() {
     return r;
 }
 
-/** Cuts the Voronoi cell by a particle whose center is at a separation of
- * (x,y) from the cell center. The value of rsq should be initially set to
- * \f$x^2+y^2\f$.
+/** Tests to see whether a plane cuts the Voronoi cell. The positions of all of
+ * the vertices relative to the plane are computed in a single vectorizable
+ * loop.
  * \param[in] (x,y) the normal vector to the plane.
  * \param[in] rsq the distance along this vector of the plane.
- * \return False if the plane cut deleted the cell entirely, true otherwise. */
+ * \return True if the plane cuts the cell, false otherwise. */
 bool voronoicell_base_2d::plane_intersects(double x,double y,double rsq) {
-    int up=0,up2,up3;
-    double u,u2,u3;
-
-    // First try and find a vertex that is within the cutting plane, if there
-    // is one. If one can't be found, then the cell is not cut by this plane
-    // and the routine immediately returns true.
-    u=pos(x,y,rsq,up);
-    if(u<tol) {
-        up2=ed[2*up];u2=pos(x,y,rsq,up2);
-        up3=ed[2*up+1];u3=pos(x,y,rsq,up3);
-        if(u2>u3) {
-            while(u2<tol) {
-                up2=ed[2*up2];
-                u2=pos(x,y,rsq,up2);
-                if(up2==up3) return false;
-            }
-            up=up2;u=u2;
-        } else {
-            while(u3<tol) {
-                up3=ed[2*up3+1];
-                u3=pos(x,y,rsq,up3);
-                if(up2==up3) return false;
-            }
-            up=up3;u=u3;
-        }
+    return classify(x,y,rsq)>0;
+}
+
+/** Computes the positions of all of the vertices relative to a plane, storing
+ * them in the cu array. The loop has no branches, so that it can be
+ * vectorized.
+ * \param[in] (x,y) the normal vector to the plane.
+ * \param[in] rsq the distance along this vector of the plane.
+ * \return The number of vertices outside the plane. */
+int voronoicell_base_2d::classify(double x,double y,double rsq) {
+    double *pp=pts,*up=cu;
+    const int n=p;
+    int l=0;
+#pragma omp simd reduction(+:l)
+    for(int i=0;i<n;i++) {
+        double u=x*pp[2*i]+y*pp[2*i+1]-rsq;
+        up[i]=u;
+        l+=u>tol?1:0;
     }
-    return true;
+    return l;
 }
 
 /** Cuts the Voronoi cell by a particle whose center is at a separation of
  * (x,y) from the cell center. The value of rsq should be initially set to
- * \f$x^2+y^2\f$.
+ * \f$x^2+y^2\f$. The positions of all of the vertices relative to the plane
+ * are first computed together, and if any vertex lies outside the plane, the
+ * cell is clipped by nplane_cut.
  * \param[in] (x,y) the normal vector to the plane.
  * \param[in] rsq the distance along this vector of the plane.
+ * \param[in] p_id the plane ID to store for the new edge.
  * \return False if the plane cut deleted the cell entirely, true otherwise. */
 template<class vc_class>
 bool voronoicell_base_2d::nplane(vc_class &vc,double x,double y,double rsq,int p_id) {
-    int up=0,up2,up3;
-    double u,u2,u3;
-
-    // First try and find a vertex that is within the cutting plane, if there
-    // is one. If one can't be found, then the cell is not cut by this plane
-    // and the routine immediately returns true.
-    u=pos(x,y,rsq,up);
-    if(u<tol) {
-        up2=ed[2*up];u2=pos(x,y,rsq,up2);
-        up3=ed[2*up+1];u3=pos(x,y,rsq,up3);
-        if(u2>u3) {
-            while(u2<tol) {
-                up2=ed[2*up2];
-                u2=pos(x,y,rsq,up2);
-                if(up2==up3) return true;
-            }
-            up=up2;u=u2;
-        } else {
-            while(u3<tol) {
-                up3=ed[2*up3+1];
-                u3=pos(x,y,rsq,up3);
-                if(up2==up3) return true;
-            }
-            up=up3;u=u3;
-        }
-    }
-
-    return nplane_cut(vc,x,y,rsq,p_id,u,up);
+    int l=classify(x,y,rsq);
+    if(l==0) return true;
+    if(l==p) return false;
+    return nplane_cut(vc,p_id,l);
 }
 
+/** Clips the Voronoi cell by a plane, once the positions of the vertices
+ * relative to the plane have been computed in the cu array. Since the cell is
+ * convex and its vertices are stored in counter-clockwise order, the vertices
+ * outside the plane form a single run in the array, possibly wrapping around
+ * its end. The start of the run is found with a branch-free loop, and the run
+ * is replaced by up to two new vertices where the edges cross the plane, by
+ * moving the remaining vertices in blocks. Vertices that lie on the plane to
+ * within the tolerance are kept, and no new vertex is created next to them.
+ * If roundoff error splits the outside vertices into several runs, then the
+ * run containing the first outside vertex is found by walking the array, and
+ * only that run is removed.
+ * \param[in] p_id the plane ID to store for the new edge.
+ * \param[in] l the number of vertices outside the plane, which must be
+ *              between one and p-1.
+ * \return False if the plane cut deleted the cell entirely, true otherwise. */
 template<class vc_class>
-bool voronoicell_base_2d::nplane_cut(vc_class &vc,double x,double y,double rsq,int p_id,double u,int up) {
-    int cp,lp,up2,up3,*stackp=ds;
-    double fac,l,u2,u3;
-
-    // Add this point to the delete stack, and search counter-clockwise to find
-    // additional points that need to be deleted.
-    *(stackp++)=up;
-    l=u;up2=ed[2*up];
-    u2=pos(x,y,rsq,up2);
-    while(u2>tol) {
-        if(stackp==stacke) add_memory_ds(stackp);
-        *(stackp++)=up2;
-        up2=ed[2*up2];
-        l=u2;
-        u2=pos(x,y,rsq,up2);
-        if(up2==up) return false;
+bool voronoicell_base_2d::nplane_cut(vc_class &vc,int p_id,int l) {
+    int i,s,e,m,q,op=p;
+
+    // Find the first vertex of the run outside the plane, as the only
+    // vertex that is outside while the previous one is inside. The number
+    // of such vertices is also counted, to check that there is one run.
+    const double *up=cu;
+    const int n=p;
+    int r=up[0]>tol&&up[n-1]<=tol?1:0;
+    s=0;
+#pragma omp simd reduction(+:s,r)
+    for(i=1;i<n;i++) {
+        bool st=up[i]>tol&&up[i-1]<=tol;
+        s+=st?i:0;r+=st?1:0;
     }
 
-    // Consider the first point that was found in the counter-clockwise
-    // direction that was not inside the cutting plane. If it lies on the
-    // cutting plane then do nothing. Otherwise, introduce a new vertex.
-    if(u2>-tol) cp=up2;
-    else {
-        if(p==current_vertices) add_memory_vertices(vc);
-        lp=ed[2*up2+1];
-        fac=1/(u2-l);
-        pts[2*p]=(pts[2*lp]*u2-pts[2*up2]*l)*fac;
-        pts[2*p+1]=(pts[2*lp+1]*u2-pts[2*up2+1]*l)*fac;
-        vc.n_copy(p,lp);
-        ed[2*p]=up2;
-        ed[2*up2+1]=p;
-        cp=p++;
+    // If roundoff error has split the outside vertices into several runs,
+    // then walk from the first outside vertex to find the ends of its run
+    if(r!=1) {
+        for(s=0;up[s]<=tol;s++);
+        if(s==0) while(up[s==0?n-1:s-1]>tol) s=s==0?n-1:s-1;
+        for(l=1,i=s==n-1?0:s+1;up[i]>tol;i=i==n-1?0:i+1) l++;
     }
-
-    // Search clockwise for additional points that need to be deleted
-    l=u;up3=ed[2*up+1];u3=pos(x,y,rsq,up3);
-    while(u3>tol) {
-        if(stackp==stacke) add_memory_ds(stackp);
-        *(stackp++)=up3;
-        up3=ed[2*up3+1];
-        l=u3;
-        u3=pos(x,y,rsq,up3);
-        if(up3==up2) break;
+    e=s+l;if(e>=p) e-=p;
+
+    // Compute the new vertices on the edges entering and leaving the run,
+    // unless the adjacent vertices lie on the plane
+    int ls=s==0?p-1:s-1,le=e==0?p-1:e-1,bne=vc.n_get(le);
+    bool an=cu[ls]<-tol,bn=cu[e]<-tol;
+    double ax=0,ay=0,bx=0,by=0,fac;
+    if(an) {
+        fac=1/(cu[s]-cu[ls]);
+        ax=(pts[2*ls]*cu[s]-pts[2*s]*cu[ls])*fac;
+        ay=(pts[2*ls+1]*cu[s]-pts[2*s+1]*cu[ls])*fac;
     }
-
-    // Either adjust the existing vertex or create new one, and connect it with
-    // the vertex found on the previous search in the counter-clockwise
-    // direction
-    if(u3>-tol) {
-        ed[2*cp+1]=up3;
-        ed[2*up3]=cp;
-        vc.n_set(up3,p_id);
+    if(bn) {
+        fac=1/(cu[e]-cu[le]);
+        bx=(pts[2*le]*cu[e]-pts[2*e]*cu[le])*fac;
+        by=(pts[2*le+1]*cu[e]-pts[2*e+1]*cu[le])*fac;
+    }
+    m=int(an)+int(bn);
+    if(p-l+m>current_vertices) add_memory_vertices(vc);
+
+    // Remove the run, leaving space for the new vertices
+    if(s+l<=p) {
+        move_vertices(vc,s+m,s+l,p-s-l);
+        q=s;p+=m-l;
+        if(!an) vc.n_set(s>0?s-1:p-1,p_id);
     } else {
-        if(p==current_vertices) add_memory_vertices(vc);
-        lp=ed[2*up3];
-        fac=1/(u3-l);
-        pts[2*p]=(pts[2*lp]*u3-pts[2*up3]*l)*fac;
-        pts[2*p+1]=(pts[2*lp+1]*u3-pts[2*up3+1]*l)*fac;
-        ed[2*p]=cp;
-        ed[2*cp+1]=p;
-        vc.n_set(p,p_id);
-        ed[2*p+1]=up3;
-        ed[2*up3]=p++;
+        move_vertices(vc,0,e,s-e);
+        q=s-e;p=q+m;
+        if(!an) vc.n_set(q-1,p_id);
     }
 
-    // Mark points on the delete stack
-    for(int *sp=ds;sp<stackp;sp++) ed[*sp*2]=-1;
-
-    // Remove them from the memory structure
-    while(stackp>ds) {
-        while(ed[2*--p]==-1);
-        up=*(--stackp);
-        if(up<p) {
-            ed[2*ed[2*p]+1]=up;
-            ed[2*ed[2*p+1]]=up;
-            pts[2*up]=pts[2*p];
-            pts[2*up+1]=pts[2*p+1];
-            vc.n_copy(up,p);
-            ed[2*up]=ed[2*p];
-            ed[2*up+1]=ed[2*p+1];
-        } else p++;
+    // Add the new vertices
+    if(an) {
+        pts[2*q]=ax;pts[2*q+1]=ay;
+        vc.n_set(q++,p_id);
+    }
+    if(bn) {
+        pts[2*q]=bx;pts[2*q+1]=by;
+        vc.n_set(q,bne);
     }
+
+    // Update the edge table. Apart from the first and last vertices, the
+    // entries point to the adjacent vertices in the array, and do not need
+    // to be changed.
+    ed[2*op-2]=op;
+    ed[2*p-2]=0;ed[1]=p-1;
     return p>=3;
 }
 
+/** Moves a block of vertices within the arrays, along with their neighbor
+ * information.
+ * \param[in] a the index to move the block to.
+ * \param[in] b the index of the first vertex in the block.
+ * \param[in] l the number of vertices in the block. */
+template<class vc_class>
+inline void voronoicell_base_2d::move_vertices(vc_class &vc,int a,int b,int l) {
+    int i;
+    if(a<b) for(i=0;i<l;i++) {
+        pts[2*(a+i)]=pts[2*(b+i)];
+        pts[2*(a+i)+1]=pts[2*(b+i)+1];
+        vc.n_copy(a+i,b+i);
+    } else if(a>b) for(i=l-1;i>=0;i--) {
+        pts[2*(a+i)]=pts[2*(b+i)];
+        pts[2*(a+i)+1]=pts[2*(b+i)+1];
+        vc.n_copy(a+i,b+i);
+    }
+}
+
 /** Returns a vector of the vertex vectors using the local coordinate system.
  * \param[out] v the vector to store the results in. */
 void voronoicell_base_2d::vertices(std::vector<double> &v) {
@@ -542,6 +547,13 @@ void voronoicell_base_2d::add_memory_vertices(vc_class &vc) {
     memcpy(ned,ed,sizeof(int)*2*ocv);
     delete [] ed;ed=ned;
 
+    init_edges(ocv);
+
+    // Copy the vertex positions relative to the current cutting plane
+    double *ncu=new double[current_vertices];
+    memcpy(ncu,cu,sizeof(double)*ocv);
+    delete [] cu;cu=ncu;
+
     // Double the neighbor information if necessary
     vc.n_add_memory_vertices(ocv);
 }
@@ -562,27 +574,11 @@ void voronoicell_neighbor_2d::init(double xmin,double xmax,double ymin,double ym
     *ne=-3;ne[1]=-2;ne[2]=-4;ne[3]=-1;
 }
 
-/** Doubles the size allocation of the delete stack. If the allocation exceeds
- * the absolute maximum set in max_delete_size, then routine causes a fatal
- * error.
- * \param[in] stackp a reference to the current stack pointer. */
-void voronoicell_base_2d::add_memory_ds(int *&stackp) {
-    current_delete_size<<=1;
-    if(current_delete_size>max_delete_size) voro_fatal_error("Delete stack memory allocation exceeded absolute maximum",VOROPP_MEMORY_ERROR);
-#if VOROPP_VERBOSE >=2
-    fprintf(stderr,"Delete stack memory scaled up to %d\n",current_delete_size);
-#endif
-    int *dsn=new int[current_delete_size],*dsnp=dsn,*dsp=ds;
-    while(dsp<stackp) *(dsnp++)=*(dsp++);
-    delete [] ds;ds=dsn;stackp=dsnp;
-    stacke=ds+current_delete_size;
-}
-
 // Explicit instantiation
 template bool voronoicell_base_2d::nplane(voronoicell_2d&,double,double,double,int);
 template bool voronoicell_base_2d::nplane(voronoicell_neighbor_2d&,double,double,double,int);
-template bool voronoicell_base_2d::nplane_cut(voronoicell_2d&,double,double,double,int,double,int);
-template bool voronoicell_base_2d::nplane_cut(voronoicell_neighbor_2d&,double,double,double,int,double,int);
+template bool voronoicell_base_2d::nplane_cut(voronoicell_2d&,int,int);
+template bool voronoicell_base_2d::nplane_cut(voronoicell_neighbor_2d&,int,int);
 template void voronoicell_base_2d::add_memory_vertices(voronoicell_2d&);
 template void voronoicell_base_2d::add_memory_vertices(voronoicell_neighbor_2d&);
 
@@ -23,15 +23,17 @@ class voronoicell_base_2d {
          * vertices are created than can fit in these arrays, then they
          * are dynamically extended using the add_memory_vertices routine. */
         int current_vertices;
-        /** This sets the size of the current delete stack. */
-        int current_delete_size;
         /** The total nuber of vertices in the current cell. */
         int p;
         /** A tolerance (specified as a squared length) used to identify when a
          * vertex should be treated as being exactly on a cutting plane. */
 		const double tol;
         /** An array with size 2*current_vertices holding information about
-         * edge connections between vertices.*/
+         * edge connections between vertices. For each vertex, the first entry
+         * is the next vertex in the counter-clockwise direction and the
+         * second is the previous one. The vertices are stored in
+         * counter-clockwise order, so that these are the adjacent vertices in
+         * the array, wrapping around at the first and last vertices. */
         int *ed;
         /** An array with size 2*current_vertices for holding the positions of
          * the vertices. */
@@ -82,8 +84,6 @@ class voronoicell_base_2d {
         }
         template<class vc_class>
         bool nplane(vc_class &vc,double x,double y,double rs,int p_id);
-        template<class vc_class>
-        bool nplane_cut(vc_class &vc,double x,double y,double rsq,int p_id,double u,int up);
         bool plane_intersects(double x,double y,double rs);
         inline bool plane_intersects_guess(double x,double y,double rs) {
             return plane_intersects(x,y,rs);
@@ -112,13 +112,15 @@ class voronoicell_base_2d {
     private:
         template<class vc_class>
         void add_memory_vertices(vc_class &vc);
-        void add_memory_ds(int *&stackp);
-        /** The delete stack, used to store the vertices that are deleted
-         * during the plane cutting procedure. */
-        int *ds;
-        /** A pointer to the end of the delete stack, used to detect when it is
-         * full. */
-        int *stacke;
+        int classify(double x,double y,double rsq);
+        template<class vc_class>
+        bool nplane_cut(vc_class &vc,int p_id,int l);
+        template<class vc_class>
+        inline void move_vertices(vc_class &vc,int a,int b,int l);
+        void init_edges(int k);
+        /** An array with size current_vertices holding the positions of the
+         * vertices relative to the current cutting plane. */
+        double *cu;
 };
 
 class voronoicell_2d : public voronoicell_base_2d {
@@ -147,8 +149,9 @@ class voronoicell_2d : public voronoicell_base_2d {
         }
     private:
         inline void n_add_memory_vertices(int ocv) {}
-        inline void n_copy(int a,int b) {}
+        inline int n_get(int a) {return 0;}
         inline void n_set(int a,int id) {}
+        inline void n_copy(int a,int b) {}
         friend class voronoicell_base_2d;
 };
 
@@ -185,8 +188,9 @@ class voronoicell_neighbor_2d : public voronoicell_base_2d {
         virtual void neighbors(std::vector<int> &v);
     private:
         inline void n_add_memory_vertices(int ocv);
-        inline void n_copy(int a,int b) {ne[a]=ne[b];}
+        inline int n_get(int a) {return ne[a];}
         inline void n_set(int a,int id) {ne[a]=id;}
+        inline void n_copy(int a,int b) {ne[a]=ne[b];}
         friend class voronoicell_base_2d;
 };
 
@@ -0,0 +1,198 @@
+// Voro++, a cell-based Voronoi library
+// By Chris H. Rycroft and the Rycroft Group
+
+/** \file cell_estimate_3d.cc
+ * \brief Function implementations for the cell_estimate_3d class. */
+
+#include <cmath>
+#include <algorithm>
+
+#include "cell_estimate_3d.hh"
+#include "cell_3d.hh"
+#include "container_3d.hh"
+
+namespace voro {
+
+/** Initializes the class, setting the parameters of the sampling.
+ * \param[in] rel_err_ the requested relative error of the confidence
+ *                     intervals of the mean and variance of the cell volume.
+ * \param[in] z_score_ the number of standard errors on each side of the
+ *                     confidence intervals.
+ * \param[in] initial_ the number of cells in the first round.
+ * \param[in] max_samples_ the maximum number of cells to sample, or zero for
+ *                         no limit.
+ * \param[in] max_strata_ the maximum number of strata.
+ * \param[in] seed the seed for the random number generator. */
+cell_estimate_3d::cell_estimate_3d(double rel_err_,double z_score_,int initial_,uint64_t max_samples_,int max_strata_,uint64_t seed)
+    : rel_err(rel_err_), z_score(z_score_), initial(initial_), max_samples(max_samples_),
+    max_strata(max_strata_), population(0), samples(0), rounds(0), converged(false), vol_mean(0), vol_mean_ci(0),
+    vol_var(0), vol_var_ci(0), rs(seed^UINT64_C(0x9e3779b97f4a7c15)) {
+    if(initial<=0||max_strata<=0)
+        voro_fatal_error("Invalid sampling parameters",VOROPP_INTERNAL_ERROR);
+    if(rs==0) rs=1;
+}
+
+/** Divides the blocks of the container into strata holding roughly equal
+ * numbers of particles.
+ * \param[in] bo the index of the first particle of each block, plus a final
+ *               entry holding the total number of particles. */
+void cell_estimate_3d::setup_strata(std::vector<uint64_t> &bo) {
+    int nxyz=bo.size()-1;
+    sfirst.assign(1,0);
+    for(int ijk=0;ijk<nxyz;ijk++) {
+        uint64_t b=bo[ijk+1],t=population*sfirst.size()/max_strata;
+        if(b>=t&&b>sfirst.back()&&b<population) sfirst.push_back(b);
+    }
+    ns=sfirst.size();
+    sfirst.push_back(population);
+    sn.assign(ns,0);
+    sv.assign(4*ns,0);
+    sf.clear();
+}
+
+/** Computes a stratified random sample of the Voronoi cells in a container,
+ * enlarging the sample in rounds until the requested error is reached. The
+ * sample size is doubled in each round, up to the sample size limit, and the
+ * new cells are drawn serially but computed in parallel.
+ * \param[in] con the container class to use. */
+template<class c_class>
+void cell_estimate_3d::compute(c_class &con) {
+    const int nxyz=con.nxyz;
+    int *co=con.co;
+
+    // Compute the index of the first particle in each block, and set up the
+    // strata
+    std::vector<uint64_t> bo(nxyz+1);
+    bo[0]=0;
+    for(int ijk=0;ijk<nxyz;ijk++) bo[ijk+1]=bo[ijk]+co[ijk];
+    population=bo[nxyz];
+    samples=0;rounds=0;converged=false;
+    setup_strata(bo);
+    if(population==0) {converged=true;estimate();return;}
+
+    // The particle indices, which are partially shuffled within each stratum
+    // so that the sampled particles are at the start
+    std::vector<int> perm(population);
+    for(int i=0;i<(int) population;i++) perm[i]=i;
+
+    std::vector<int> l,ls;
+    std::vector<double> vol;
+    std::vector<std::vector<int> > ff;
+    uint64_t target=max_samples>0&&max_samples<(uint64_t) initial?max_samples:initial;
+    while(true) {
+        rounds++;
+
+        // Draw the new cells for this round, allocating them to the strata
+        // in proportion to their sizes, with at least two in each
+        l.clear();ls.clear();
+        for(int s=0;s<ns;s++) {
+            uint64_t f=sfirst[s],nh=sfirst[s+1]-f,
+                     w=(target*nh+population-1)/population;
+            if(w<2) w=2;
+            if(w>nh) w=nh;
+            for(;sn[s]<w;sn[s]++) {
+                uint64_t j=f+sn[s]+rnd()%(nh-sn[s]);
+                std::swap(perm[f+sn[s]],perm[j]);
+                l.push_back(perm[f+sn[s]]);ls.push_back(s);
+            }
+        }
+
+        // Compute the new cells in parallel
+        int m=l.size();
+        vol.resize(m);ff.resize(m);
+#pragma omp parallel num_threads(con.number_thread())
+        {
+            voronoicell_3d c(con);
+#pragma omp for schedule(dynamic,16)
+            for(int i=0;i<m;i++) {
+                int ijk=int(std::upper_bound(bo.begin(),bo.end(),(uint64_t) l[i])-bo.begin())-1,
+                    q=int(l[i]-bo[ijk]);
+                if(con.compute_cell(c,ijk,q)) {
+                    vol[i]=c.volume();
+                    c.face_freq_table(ff[i]);
+                } else {vol[i]=0;ff[i].clear();}
+            }
+        }
+
+        // Add the results to the sums for each stratum in the order that the
+        // cells were drawn
+        for(int i=0;i<m;i++) {
+            int s=ls[i];
+            double v=vol[i],*svp=sv.data()+4*s;
+            *svp+=v;svp[1]+=v*v;svp[2]+=v*v*v;svp[3]+=v*v*v*v;
+            if(sf.size()<2*ff[i].size()*ns) sf.resize(2*ff[i].size()*ns,0);
+            for(int k=0;k<(int) ff[i].size();k++) {
+                double *sfp=sf.data()+2*(k*ns+s),c=ff[i][k];
+                *sfp+=c;sfp[1]+=c*c;
+            }
+        }
+        samples+=m;
+        estimate();
+
+        // Stop if every cell has been computed, if the requested error has
+        // been reached, or if the sample size limit has been reached
+        if(samples==population||(vol_mean_ci<=rel_err*vol_mean&&vol_var_ci<=rel_err*vol_var)) {
+            converged=true;
+            return;
+        }
+        if(max_samples>0&&samples>=max_samples) return;
+        target*=2;
+        if(max_samples>0&&target>max_samples) target=max_samples;
+    }
+}
+
+/** Computes the estimates and their confidence intervals from the sums for
+ * each stratum, using the standard stratified sampling formulae with a finite
+ * population correction. The variance of the cell volume is estimated from
+ * the means of the volume and the squared volume, and its confidence interval
+ * is found using the delta method. */
+void cell_estimate_3d::estimate() {
+    double m1=0,m2=0,v11=0,v12=0,v22=0;
+    int nk=ns>0?sf.size()/(2*ns):0;
+    face_freq.assign(nk,0);
+    face_freq_ci.assign(nk,0);
+    for(int s=0;s<ns;s++) if(sn[s]>0) {
+        double n=sn[s],nh=sfirst[s+1]-sfirst[s],w=nh/population,
+               g=n>1?w*w*(1-n/nh)/(n*(n-1)):0,*svp=sv.data()+4*s;
+        m1+=w**svp/n;m2+=w*svp[1]/n;
+        v11+=g*(svp[1]-*svp**svp/n);
+        v12+=g*(svp[2]-*svp*svp[1]/n);
+        v22+=g*(svp[3]-svp[1]*svp[1]/n);
+        for(int k=0;k<nk;k++) {
+            double *sfp=sf.data()+2*(k*ns+s);
+            face_freq[k]+=w**sfp/n;
+            face_freq_ci[k]+=g*(sfp[1]-*sfp**sfp/n);
+        }
+    }
+    vol_mean=m1;
+    vol_mean_ci=z_score*sqrt(v11>0?v11:0);
+    vol_var=m2-m1*m1;
+    if(vol_var<0) vol_var=0;
+    double vv=4*m1*m1*v11-4*m1*v12+v22;
+    vol_var_ci=z_score*sqrt(vv>0?vv:0);
+    for(int k=0;k<nk;k++) face_freq_ci[k]=z_score*sqrt(face_freq_ci[k]>0?face_freq_ci[k]:0);
+}
+
+/** Saves the estimates to a file, with one statistic per line. The face
+ * frequencies are written with one number of edges per line, omitting those
+ * that were not found.
+ * \param[in] fp the file handle to write to. */
+void cell_estimate_3d::output(FILE *fp) {
+    fprintf(fp,"Total V. cells            : %" PRIu64 "\n"
+               "V. cells sampled          : %" PRIu64 " in %d rounds%s\n"
+               "Mean V. cell volume       : %.12g +/- %.6g\n"
+               "Variance of volume        : %.12g +/- %.6g\n"
+               "Total V. cell volume      : %.12g +/- %.6g\n",
+               population,samples,rounds,converged?"":" (not converged)",
+               vol_mean,vol_mean_ci,vol_var,vol_var_ci,
+               vol_mean*population,vol_mean_ci*population);
+    fputs("Face order frequencies    :\n",fp);
+    for(int k=0;k<(int) face_freq.size();k++) if(face_freq[k]>0)
+        fprintf(fp,"  %d : %.8g +/- %.4g\n",k,face_freq[k],face_freq_ci[k]);
+}
+
+// Explicit template instantiation
+template void cell_estimate_3d::compute<container_3d>(container_3d&);
+template void cell_estimate_3d::compute<container_poly_3d>(container_poly_3d&);
+
+}
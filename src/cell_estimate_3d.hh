@@ -0,0 +1,113 @@
+// Voro++, a cell-based Voronoi library
+// By Chris H. Rycroft and the Rycroft Group
+
+/** \file cell_estimate_3d.hh
+ * \brief Header file for the cell_estimate_3d class. */
+
+#ifndef VOROPP_CELL_ESTIMATE_3D_HH
+#define VOROPP_CELL_ESTIMATE_3D_HH
+
+#include <cstdio>
+#include <inttypes.h>
+
+#include <vector>
+
+#include "config.hh"
+#include "common.hh"
+
+namespace voro {
+
+/** \brief A class for estimating tessellation statistics from a random sample
+ * of Voronoi cells.
+ *
+ * When statistics of a tessellation need to be monitored frequently, such as
+ * during a long simulation, computing every Voronoi cell can be unnecessarily
+ * expensive. The cell_estimate_3d class computes a stratified random sample of
+ * the cells instead, and estimates the mean and variance of the cell volume
+ * and the mean number of faces with each number of edges per cell, along with
+ * confidence intervals.
+ *
+ * The strata are made up of consecutive blocks of the container, chosen so
+ * that each holds roughly the same number of particles, and the cells are
+ * sampled without replacement in proportion to the stratum sizes. The sample
+ * is enlarged in rounds until the confidence intervals of the mean and
+ * variance of the cell volume are within a requested relative error, or until
+ * every cell has been computed. Each round is computed in parallel using the
+ * container's per-thread computation objects. The sample is determined by the
+ * random seed alone, so the estimates do not depend on the number of
+ * threads. Cells that are removed entirely by walls count as having zero
+ * volume and no faces. */
+class cell_estimate_3d {
+    public:
+        /** The requested relative error of the confidence intervals. */
+        const double rel_err;
+        /** The number of standard errors spanned by each side of the
+         * confidence intervals, which is 1.96 for 95% confidence. */
+        const double z_score;
+        /** The number of cells in the first round. */
+        const int initial;
+        /** The maximum number of cells to sample, or zero for no limit. */
+        const uint64_t max_samples;
+        /** The maximum number of strata. */
+        const int max_strata;
+        /** The number of cells in the container. */
+        uint64_t population;
+        /** The number of cells that were sampled. */
+        uint64_t samples;
+        /** The number of sampling rounds. */
+        int rounds;
+        /** Whether the requested error was reached, or every cell was
+         * computed, before the sample size limit. */
+        bool converged;
+        /** The estimated mean cell volume and the half-width of its
+         * confidence interval. */
+        double vol_mean,vol_mean_ci;
+        /** The estimated variance of the cell volume and the half-width of
+         * its confidence interval. */
+        double vol_var,vol_var_ci;
+        /** The estimated mean number of faces with each number of edges per
+         * cell. */
+        std::vector<double> face_freq;
+        /** The half-widths of the confidence intervals of the face
+         * frequencies. */
+        std::vector<double> face_freq_ci;
+        cell_estimate_3d(double rel_err_=0.05,double z_score_=1.96,int initial_=1000,uint64_t max_samples_=0,int max_strata_=64,uint64_t seed=1);
+        template<class c_class>
+        void compute(c_class &con);
+        void output(FILE *fp=stdout);
+        /** Saves the estimates to a file.
+         * \param[in] filename the name of the file to write to. */
+        inline void output(const char *filename) {
+            FILE *fp=safe_fopen(filename,"w");
+            output(fp);
+            fclose(fp);
+        }
+    private:
+        /** The state of the random number generator. */
+        uint64_t rs;
+        /** The number of strata. */
+        int ns;
+        /** The first particle index of each stratum, plus a final entry
+         * holding the population. */
+        std::vector<uint64_t> sfirst;
+        /** The number of cells sampled in each stratum. */
+        std::vector<uint64_t> sn;
+        /** The sums of the first four powers of the cell volume in each
+         * stratum. */
+        std::vector<double> sv;
+        /** The sums of the face frequencies and their squares in each
+         * stratum, with 2*ns entries for each number of edges. */
+        std::vector<double> sf;
+        /** Returns a pseudorandom number, using the xorshift64* generator.
+         * \return The number. */
+        inline uint64_t rnd() {
+            rs^=rs>>12;rs^=rs<<25;rs^=rs>>27;
+            return rs*UINT64_C(2685821657736338717);
+        }
+        void setup_strata(std::vector<uint64_t> &bo);
+        void estimate();
+};
+
+}
+
+#endif
@@ -0,0 +1,171 @@
+// Voro++, a cell-based Voronoi library
+// By Chris H. Rycroft and the Rycroft Group
+
+/** \file cell_reduction_3d.cc
+ * \brief Function implementations for the cell_reduction_3d class. */
+
+#include <cfloat>
+
+#include "cell_reduction_3d.hh"
+#include "cell_3d.hh"
+#include "container_3d.hh"
+#include "container_tri.hh"
+#include "iter_3d.hh"
+
+namespace voro {
+
+/** Initializes the class with a set of reductions to compute. If the volume
+ * histogram is requested, then its number of bins and limits must be given.
+ * \param[in] mask_ a combination of the reduction flags.
+ * \param[in] vol_bins_ the number of bins in the volume histogram.
+ * \param[in] (vol_lo_,vol_hi_) the limits of the volume histogram. */
+cell_reduction_3d::cell_reduction_3d(unsigned int mask_,int vol_bins_,double vol_lo_,double vol_hi_)
+    : mask(mask_), vol_bins(vol_bins_), vol_lo(vol_lo_), vol_hi(vol_hi_) {
+    if((mask&volume_histogram)&&(vol_bins<=0||vol_hi<=vol_lo))
+        voro_fatal_error("Invalid volume histogram limits",VOROPP_INTERNAL_ERROR);
+    clear();
+}
+
+/** Resets all of the reductions. */
+void cell_reduction_3d::clear() {
+    cells=neighbors=0;
+    volume=volume_sq=area=0;
+    vol_min=DBL_MAX;vol_max=0;
+    vol_hist.assign(mask&volume_histogram?vol_bins+2:0,0);
+    face_hist.clear();
+    face_freq_sum.clear();
+}
+
+/** Computes all of the Voronoi cells in a container in parallel, and
+ * accumulates the requested reductions. Neighbor information is only tracked
+ * if the neighbor count is requested.
+ * \param[in] con the container class to use. */
+template<class c_class>
+void cell_reduction_3d::compute(c_class &con) {
+    if(mask&neighbor_count) compute_cells<c_class,voronoicell_neighbor_3d>(con);
+    else compute_cells<c_class,voronoicell_3d>(con);
+}
+
+/** Computes all of the Voronoi cells in a container in parallel, using a
+ * given Voronoi cell class. Each thread accumulates the integer counts and
+ * extrema separately, and these are merged at the end. The floating point sums
+ * are stored for each chunk, and added in chunk order.
+ * \param[in] con the container class to use. */
+template<class c_class,class v_cell>
+void cell_reduction_3d::compute_cells(c_class &con) {
+    typedef typename c_class::iterator iterator;
+    clear();
+
+    // Record the start of each chunk of particles
+    std::vector<iterator> cs;
+    int i=0;
+    for(iterator cli=con.begin();cli<con.end();cli++,i++) if(i%chunk_cells==0) cs.push_back(cli);
+    int nc=cs.size();
+    std::vector<double> cp(3*nc);
+
+#pragma omp parallel num_threads(con.number_thread())
+    {
+        v_cell c(con);
+        std::vector<int> v;
+        std::vector<uint64_t> tvh(vol_hist.size(),0),tfh,tff;
+        uint64_t tcells=0,tnei=0;
+        double tmin=DBL_MAX,tmax=0;
+        iterator cle=con.end();
+
+        // Compute the cells in each chunk, storing the floating point sums
+        // for the chunk
+#pragma omp for schedule(dynamic)
+        for(int k=0;k<nc;k++) {
+            double vs=0,vsq=0,as=0;
+            iterator cli=cs[k];
+            for(int j=0;j<chunk_cells&&cli<cle;j++,cli++) if(con.compute_cell(c,cli)) {
+                double vol=c.volume();
+                tcells++;vs+=vol;vsq+=vol*vol;
+                if(vol<tmin) tmin=vol;
+                if(vol>tmax) tmax=vol;
+                if(mask&surface_area) as+=c.surface_area();
+                if(mask&volume_histogram) {
+                    double b=(vol-vol_lo)*vol_bins/(vol_hi-vol_lo);
+                    tvh[b<0?vol_bins:(b>=vol_bins?vol_bins+1:int(b))]++;
+                }
+                if(mask&face_histogram) {
+                    int f=c.number_of_faces();
+                    if(f>=(int) tfh.size()) tfh.resize(f+1,0);
+                    tfh[f]++;
+                }
+                if(mask&face_freq) {
+                    c.face_freq_table(v);
+                    if(v.size()>tff.size()) tff.resize(v.size(),0);
+                    for(int l=0;l<(int) v.size();l++) tff[l]+=v[l];
+                }
+                if(mask&neighbor_count) {
+                    c.neighbors(v);
+                    for(int l=0;l<(int) v.size();l++) if(v[l]>=0) tnei++;
+                }
+            }
+            cp[3*k]=vs;cp[3*k+1]=vsq;cp[3*k+2]=as;
+        }
+
+        // Merge the integer counts and extrema, which does not depend on the
+        // order of the threads
+#pragma omp critical
+        {
+            cells+=tcells;neighbors+=tnei;
+            if(tmin<vol_min) vol_min=tmin;
+            if(tmax>vol_max) vol_max=tmax;
+            for(int l=0;l<(int) tvh.size();l++) vol_hist[l]+=tvh[l];
+            if(tfh.size()>face_hist.size()) face_hist.resize(tfh.size(),0);
+            for(int l=0;l<(int) tfh.size();l++) face_hist[l]+=tfh[l];
+            if(tff.size()>face_freq_sum.size()) face_freq_sum.resize(tff.size(),0);
+            for(int l=0;l<(int) tff.size();l++) face_freq_sum[l]+=tff[l];
+        }
+    }
+
+    // Add the floating point sums in chunk order
+    for(int k=0;k<nc;k++) {
+        volume+=cp[3*k];volume_sq+=cp[3*k+1];area+=cp[3*k+2];
+    }
+    if(cells==0) vol_min=0;
+}
+
+/** Saves the reductions to a file, with one statistic per line. The histograms
+ * are written with one bin per line, omitting empty bins.
+ * \param[in] fp the file handle to write to. */
+void cell_reduction_3d::output(FILE *fp) {
+    fprintf(fp,"Total V. cells computed   : %" PRIu64 "\n"
+               "Total V. cell volume      : %.12g\n",cells,volume);
+    if(mask&volume_stats)
+        fprintf(fp,"Mean V. cell volume       : %.12g\n"
+                   "Std. dev. of volume       : %.12g\n"
+                   "Minimum V. cell volume    : %.12g\n"
+                   "Maximum V. cell volume    : %.12g\n",
+                   mean_volume(),volume_sd(),vol_min,vol_max);
+    if(mask&surface_area) fprintf(fp,"Total surface area        : %.12g\n",area);
+    if(mask&neighbor_count) fprintf(fp,"Mean neighbor count       : %.12g\n",mean_neighbors());
+    if(mask&volume_histogram) {
+        double dv=(vol_hi-vol_lo)/vol_bins;
+        fputs("Volume histogram          :\n",fp);
+        if(vol_hist[vol_bins]>0) fprintf(fp,"  < %g : %" PRIu64 "\n",vol_lo,vol_hist[vol_bins]);
+        for(int l=0;l<vol_bins;l++) if(vol_hist[l]>0)
+            fprintf(fp,"  %g %g : %" PRIu64 "\n",vol_lo+l*dv,vol_lo+(l+1)*dv,vol_hist[l]);
+        if(vol_hist[vol_bins+1]>0) fprintf(fp,"  >= %g : %" PRIu64 "\n",vol_hi,vol_hist[vol_bins+1]);
+    }
+    if(mask&face_histogram) {
+        fputs("Face count histogram      :\n",fp);
+        for(int l=0;l<(int) face_hist.size();l++) if(face_hist[l]>0)
+            fprintf(fp,"  %d : %" PRIu64 "\n",l,face_hist[l]);
+    }
+    if(mask&face_freq) {
+        fputs("Face order frequencies    :\n",fp);
+        for(int l=0;l<(int) face_freq_sum.size();l++) if(face_freq_sum[l]>0)
+            fprintf(fp,"  %d : %" PRIu64 "\n",l,face_freq_sum[l]);
+    }
+}
+
+// Explicit template instantiation
+template void cell_reduction_3d::compute<container_3d>(container_3d&);
+template void cell_reduction_3d::compute<container_poly_3d>(container_poly_3d&);
+template void cell_reduction_3d::compute<container_triclinic>(container_triclinic&);
+template void cell_reduction_3d::compute<container_triclinic_poly>(container_triclinic_poly&);
+
+}
@@ -0,0 +1,123 @@
+// Voro++, a cell-based Voronoi library
+// By Chris H. Rycroft and the Rycroft Group
+
+/** \file cell_reduction_3d.hh
+ * \brief Header file for the cell_reduction_3d class. */
+
+#ifndef VOROPP_CELL_REDUCTION_3D_HH
+#define VOROPP_CELL_REDUCTION_3D_HH
+
+#include <cstdio>
+#include <cmath>
+#include <inttypes.h>
+
+#include <vector>
+
+#include "config.hh"
+#include "common.hh"
+
+namespace voro {
+
+/** \brief A class for computing aggregate statistics over all of the Voronoi
+ * cells in a container.
+ *
+ * Many calculations only need totals and distributions of the cell
+ * properties, rather than the properties of each individual cell. The
+ * cell_reduction_3d class computes all of the Voronoi cells in a container in
+ * parallel, and accumulates a requested set of reductions without storing any
+ * per-cell information. The set of reductions is given as a combination of
+ * the flags below. The number of cells and their total volume are always
+ * computed.
+ *
+ * The particles are divided into chunks of a fixed size, which are handed out
+ * to the threads dynamically. The floating point sums for each chunk are
+ * stored separately and added together in order at the end, and all of the
+ * other reductions are integer counts or extrema, so the results are
+ * identical for any number of threads. */
+class cell_reduction_3d {
+    public:
+        /** The flags for the available reductions. */
+        enum reduction {
+            /** The mean, standard deviation, minimum, and maximum of the
+             * cell volumes. */
+            volume_stats=1,
+            /** The total surface area of the cells. */
+            surface_area=2,
+            /** A histogram of the cell volumes. */
+            volume_histogram=4,
+            /** A histogram of the number of faces of each cell. */
+            face_histogram=8,
+            /** The face frequency tables of the cells, summed over all
+             * cells. */
+            face_freq=16,
+            /** The total number of neighboring particles, excluding walls. */
+            neighbor_count=32,
+            /** All of the reductions. */
+            all=63,
+            /** All of the reductions except for the volume histogram, which
+             * can only be computed if its limits are given. */
+            all_but_histogram=59
+        };
+        /** The requested reductions. */
+        const unsigned int mask;
+        /** The number of bins in the volume histogram. */
+        const int vol_bins;
+        /** The lower and upper limits of the volume histogram. */
+        const double vol_lo,vol_hi;
+        /** The number of Voronoi cells that were computed. */
+        uint64_t cells;
+        /** The total volume of the cells. */
+        double volume;
+        /** The sum of the squared volumes of the cells. */
+        double volume_sq;
+        /** The minimum and maximum cell volumes. */
+        double vol_min,vol_max;
+        /** The total surface area of the cells. */
+        double area;
+        /** The total number of neighboring particles. */
+        uint64_t neighbors;
+        /** The volume histogram. Entry i counts the cells with volumes in
+         * the ith bin, and the two extra entries at the end count the cells
+         * below and above the histogram limits. */
+        std::vector<uint64_t> vol_hist;
+        /** The face count histogram, where entry i is the number of cells
+         * with i faces. */
+        std::vector<uint64_t> face_hist;
+        /** The summed face frequency table, where entry i is the number of
+         * faces with i edges. */
+        std::vector<uint64_t> face_freq_sum;
+        cell_reduction_3d(unsigned int mask_=all_but_histogram,int vol_bins_=0,double vol_lo_=0,double vol_hi_=0);
+        template<class c_class>
+        void compute(c_class &con);
+        /** Returns the mean cell volume.
+         * \return The mean volume. */
+        inline double mean_volume() {return cells>0?volume/cells:0;}
+        /** Returns the standard deviation of the cell volumes.
+         * \return The standard deviation. */
+        inline double volume_sd() {
+            if(cells==0) return 0;
+            double m=volume/cells,v=volume_sq/cells-m*m;
+            return v>0?sqrt(v):0;
+        }
+        /** Returns the mean number of neighboring particles per cell.
+         * \return The mean neighbor count. */
+        inline double mean_neighbors() {return cells>0?double(neighbors)/cells:0;}
+        void output(FILE *fp=stdout);
+        /** Saves the reductions to a file.
+         * \param[in] filename the name of the file to write to. */
+        inline void output(const char *filename) {
+            FILE *fp=safe_fopen(filename,"w");
+            output(fp);
+            fclose(fp);
+        }
+    private:
+        /** The number of particles in each chunk. */
+        static const int chunk_cells=256;
+        void clear();
+        template<class c_class,class v_cell>
+        void compute_cells(c_class &con);
+};
+
+}
+
+#endif
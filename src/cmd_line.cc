@@ -4,12 +4,18 @@
 /** \file cmd_line.cc
  * \brief Source code for the command-line utility. */
 
+#include <cctype>
+#include <cstdlib>
 #include <cstring>
+#include <inttypes.h>
+#include <string>
+#include <vector>
 
 #include "voro++.hh"
 using namespace voro;
 
 #ifdef _OPENMP
+#include <sched.h>
 #include "omp.h"
 #endif
 
@@ -23,6 +29,9 @@ enum blocks_mode {
 // allocated
 const int max_regions=1<<28;
 
+// The number of bins in the volume histogram of the aggregate statistics
+const int stats_bins=40;
+
 // This message gets displayed if the user requests the help flag
 void help_message() {
     puts("Voro++ version 1.0.0, by Chris H. Rycroft and the Rycroft Group\n\n"
@@ -33,11 +42,25 @@ void help_message() {
          "If not specified, the output is saved to \"<input_file>.vor\". Using '-' for any\n"
          "filename will read/write from standard input/output.\n\n"
          "Available options:\n"
+#ifdef _OPENMP
+         " -a          : Write the output files asynchronously using a dedicated\n"
+         "               writer thread\n"
+#endif
          " -c <str>    : Specify a custom output string\n"
+         " -f          : Read the input file as a trajectory of multiple frames,\n"
+         "               separated by '#' header lines or in LAMMPS dump format\n"
+         " -fs         : Trajectory mode, saving each frame to separate files\n"
          " -g          : Turn on the Gnuplot output to <input_file.gnu>\n"
          " -G <gfile>  : Turn on the Gnuplot output to <gfile>\n"
          " -h/--help   : Print this information\n"
          " -hc         : Print information about custom output\n"
+         " -k          : Turn on the VTK unstructured grid output to <input_file.vtu>\n"
+         " -K <kfile>  : Turn on the VTK unstructured grid output to <kfile>. In\n"
+         "               trajectory mode, one file is written for each frame,\n"
+         "               named by appending the frame number and \".vtu\"\n"
+#if VOROPP_ZLIB
+         " -kz         : Compress the VTK unstructured grid output with zlib\n"
+#endif
          " -l <len>    : Manually specify a length scale to configure the internal\n"
          "               computational grid\n"
          " -m <mem>    : Manually choose the memory allocation per grid block\n"
@@ -50,6 +73,12 @@ void help_message() {
          " -py         : Make container periodic in the y direction\n"
          " -pz         : Make container periodic in the z direction\n"
          " -r          : Assume the input file has an extra coordinate for radii\n"
+         " -s <str>    : Save aggregate statistics over all cells to the output file,\n"
+         "               instead of the per-cell output. The string selects the\n"
+         "               statistics: 'v' for the volume distribution, 'a' for the\n"
+         "               surface area, 'h' for a volume histogram, 'f' for a face\n"
+         "               count histogram, 'F' for the face order frequencies, 'n'\n"
+         "               for the mean neighbor count, or 'A' for all of them\n"
 #ifdef _OPENMP
          " -t <num>    : Use <num> threads for the computation [default: 1]\n"
 #endif
@@ -157,6 +186,7 @@ FILE* open_extra(char *buffer,char **argv,wall_list_3d &wl,int f_output,const ch
            stdout_used=true;
            return stdout;
         }
+        return safe_fopen(argv[f_output],"w");
     }
     return NULL;
 }
@@ -166,6 +196,233 @@ inline void fclosec(FILE *fp) {
     if(fp!=NULL&&fp!=stdout) fclose(fp);
 }
 
+#ifdef _OPENMP
+// The number of Voronoi cells that are formatted into each chunk of buffered
+// output when the computation is multithreaded or the output files are written
+// asynchronously
+const int output_chunk_cells=512;
+
+// The number of chunks of buffered output per thread that can be held in
+// memory while waiting to be written
+const int output_chunks_per_thread=8;
+
+// A class for merging buffered output. The output for a consecutive run of
+// Voronoi cells is formatted into in-memory streams, which are handed over
+// through a ring of slots. The chunks can be completed in any order by
+// different threads, and they are saved to the output files in the order of
+// the chunk indices, either by a dedicated writer thread or by whichever
+// compute thread finds the next chunk ready.
+class chunk_writer {
+    public:
+        chunk_writer(FILE *out_file,FILE *gnu_file,FILE *povp_file,FILE *povv_file,int ring_);
+        ~chunk_writer();
+        void open_chunk(int n,FILE **mf);
+        void close_chunk(int n,FILE **mf);
+        void finish(int n);
+        bool write_ready();
+        void run();
+    private:
+        // The number of slots in the ring
+        const int ring;
+        // The output files to write to, which are NULL if not in use
+        FILE *fp[4];
+        // The formatted output held in each slot of the ring
+        char **buf;
+        // The length of the formatted output held in each slot
+        size_t *len;
+        // One plus the index of the chunk held in each slot, or zero if the
+        // slot is not ready to be written
+        int *seq;
+        // The number of chunks that have been written so far
+        int n_written;
+        // The total number of chunks, or -1 if this is not yet known
+        int n_total;
+        // A lock ensuring that only one thread writes at a time
+        omp_lock_t wr_lock;
+        inline int written() {
+            int n;
+#pragma omp atomic read
+            n=n_written;
+            return n;
+        }
+};
+
+// Initializes the class, setting all slots in the ring to be free
+chunk_writer::chunk_writer(FILE *out_file,FILE *gnu_file,FILE *povp_file,FILE *povv_file,int ring_)
+    : ring(ring_), buf(new char*[4*ring_]), len(new size_t[4*ring_]),
+    seq(new int[ring_]), n_written(0), n_total(-1) {
+    *fp=out_file;fp[1]=gnu_file;fp[2]=povp_file;fp[3]=povv_file;
+    for(int s=0;s<ring;s++) seq[s]=0;
+    omp_init_lock(&wr_lock);
+}
+
+// Frees the dynamically allocated memory
+chunk_writer::~chunk_writer() {
+    omp_destroy_lock(&wr_lock);
+    delete [] seq;
+    delete [] len;
+    delete [] buf;
+}
+
+// Opens in-memory streams to hold the output for a chunk of cells. If the ring
+// is full, this waits until the chunk is within range, saving any ready chunks
+// in the meantime.
+void chunk_writer::open_chunk(int n,FILE **mf) {
+    while(n-written()>=ring) if(!write_ready()) sched_yield();
+    int s=4*(n%ring);
+    for(int i=0;i<4;i++) {
+        if(fp[i]==NULL) mf[i]=NULL;
+        else if((mf[i]=open_memstream(buf+s+i,len+s+i))==NULL)
+            voro_fatal_error("Unable to allocate output buffer",VOROPP_MEMORY_ERROR);
+    }
+}
+
+// Closes the in-memory streams for a chunk of cells, and marks the chunk as
+// ready to be written
+void chunk_writer::close_chunk(int n,FILE **mf) {
+    for(int i=0;i<4;i++) if(mf[i]!=NULL) fclose(mf[i]);
+#pragma omp flush
+#pragma omp atomic write
+    seq[n%ring]=n+1;
+}
+
+// Records the total number of chunks, so that the writer loop knows when to
+// finish
+void chunk_writer::finish(int n) {
+#pragma omp flush
+#pragma omp atomic write
+    n_total=n;
+}
+
+// Saves all of the chunks that are ready to be written, stopping at the first
+// chunk that is not yet available. If another thread is already writing, then
+// this returns immediately. The return value records whether any chunks were
+// written.
+bool chunk_writer::write_ready() {
+    if(!omp_test_lock(&wr_lock)) return false;
+    int n=n_written,s=n%ring,q;
+    bool wrote=false;
+    while(true) {
+#pragma omp atomic read
+        q=seq[s];
+        if(q!=n+1) break;
+#pragma omp flush
+        for(int i=0;i<4;i++) if(fp[i]!=NULL) {
+            fwrite(buf[4*s+i],1,len[4*s+i],fp[i]);
+            free(buf[4*s+i]);
+        }
+        seq[s]=0;n++;wrote=true;
+#pragma omp flush
+#pragma omp atomic write
+        n_written=n;
+        if(++s==ring) s=0;
+    }
+    omp_unset_lock(&wr_lock);
+    return wrote;
+}
+
+// The main loop of the writer thread, which saves chunks as they become ready
+// until all of them have been written
+void chunk_writer::run() {
+    int tot;
+    while(true) {
+        if(write_ready()) continue;
+#pragma omp atomic read
+        tot=n_total;
+        if(written()==tot) return;
+        sched_yield();
+    }
+}
+
+// Divides the particles in a container into chunks made up of consecutive
+// blocks, each holding roughly output_chunk_cells particles, so that looping
+// over the chunks in order visits the particles in the same order as the
+// container iterator
+class block_chunks {
+    public:
+        typedef container_base_3d::iterator iterator;
+        // The number of chunks
+        int n_chunks;
+        template<class c_class>
+        block_chunks(c_class &con) : co(con.co), nxyz(con.nxyz) {
+            int ijk=0,m;
+            while(ijk<nxyz&&co[ijk]==0) ijk++;
+            while(ijk<nxyz) {
+                cb.push_back(ijk);
+                m=0;
+                while(ijk<nxyz&&m<output_chunk_cells) m+=co[ijk++];
+                while(ijk<nxyz&&co[ijk]==0) ijk++;
+            }
+            n_chunks=cb.size();
+            cb.push_back(nxyz);
+        }
+        // Sets iterators to the start and end of a chunk
+        inline void range(int n,iterator &cli,iterator &cle) {
+            cli=iterator(co,c_info(cb[n],0),nxyz);
+            cle=iterator(co,c_info(cb[n+1],0),nxyz);
+        }
+    private:
+        int *co;
+        const int nxyz;
+        // The first block of each chunk, plus a final entry of nxyz
+        std::vector<int> cb;
+};
+
+// Divides the particles in a particle ordering into chunks of
+// output_chunk_cells particles
+class order_chunks {
+    public:
+        typedef container_base_3d::iterator_order iterator;
+        // The number of chunks
+        int n_chunks;
+        template<class c_class>
+        order_chunks(particle_order &vo_,c_class &con) : vo(vo_),
+            np((vo_.op-vo_.o)>>1), nxyz(con.nxyz) {
+            n_chunks=(np+output_chunk_cells-1)/output_chunk_cells;
+        }
+        // Sets iterators to the start and end of a chunk
+        inline void range(int n,iterator &cli,iterator &cle) {
+            int l=(n+1)*output_chunk_cells;
+            cli=iterator(vo,n*output_chunk_cells,nxyz);
+            cle=iterator(vo,l<np?l:np,nxyz);
+        }
+    private:
+        particle_order &vo;
+        const int np;
+        const int nxyz;
+};
+#endif
+
+// Converts a string of letters selecting aggregate statistics into a set of
+// cell reduction flags, returning zero if an unknown letter is found
+unsigned int stats_mask(const char *str) {
+    unsigned int m=0;
+    for(const char *c=str;*c!='\0';c++) switch(*c) {
+        case 'v': m|=cell_reduction_3d::volume_stats;break;
+        case 'a': m|=cell_reduction_3d::surface_area;break;
+        case 'h': m|=cell_reduction_3d::volume_histogram;break;
+        case 'f': m|=cell_reduction_3d::face_histogram;break;
+        case 'F': m|=cell_reduction_3d::face_freq;break;
+        case 'n': m|=cell_reduction_3d::neighbor_count;break;
+        case 'A': m|=cell_reduction_3d::all;break;
+        default: return 0;
+    }
+    return m;
+}
+
+// Computes aggregate statistics over all of the Voronoi cells in parallel, and
+// saves them to a file. The volume histogram spans from zero to four times the
+// mean volume per particle in the container box.
+template<class c_class>
+void stats_output(c_class &con,unsigned int smask,FILE *out_file,bool verbose,double &vol,int &vcc) {
+    int tp=con.total_particles();
+    double bv=(con.bx-con.ax)*(con.by-con.ay)*(con.bz-con.az);
+    cell_reduction_3d cr(smask,stats_bins,0,tp>0?4*bv/tp:1);
+    con.reduce_cells(cr);
+    if(out_file!=NULL) cr.output(out_file);
+    if(verbose) {vol+=cr.volume;vcc+=cr.cells;}
+}
+
 template<class v_class,class i_class>
 inline void cell_output(v_class &c,i_class &cli,const int ps,double** conp,uint64_t **conid,const char* format,FILE* out_file,FILE* gnu_file,FILE* povp_file,FILE* povv_file) {
     int ijk=cli->ijk,q=cli->q,pid=conid[ijk][q];
@@ -183,39 +440,387 @@ inline void cell_output(v_class &c,i_class &cli,const int ps,double** conp,uint6
     }
 }
 
+#ifdef _OPENMP
+// Carries out the Voronoi computation using multiple threads. Chunks of cells
+// are handed out to the threads dynamically, and the output for each chunk is
+// formatted into memory. The chunks are then merged into the output files in
+// order, so that the output is identical to the serial computation. If
+// asynchronous output is requested, then an extra thread is used exclusively
+// for writing the files. The volume and cell totals are computed using a
+// reduction over the threads.
+template<class c_class,class v_class,class ch_class>
+void chunk_output(c_class &con,ch_class &ch,const char* format,FILE* out_file,FILE* gnu_file,FILE* povp_file,FILE* povv_file,bool verbose,bool async,int nt,double &vol,int &vcc) {
+    double **conp=con.p,tvol=0;uint64_t **conid=con.id;
+    int next=0,tvcc=0;
+    chunk_writer cw(out_file,gnu_file,povp_file,povv_file,output_chunks_per_thread*(nt+1));
+    cw.finish(ch.n_chunks);
+#pragma omp parallel num_threads(async?nt+1:nt) reduction(+:tvol,tvcc)
+    {
+        // If the team is large enough, then the last thread is used
+        // exclusively for writing the output files
+        bool writer=async&&omp_get_num_threads()>nt;
+        if(writer&&omp_get_thread_num()==nt) cw.run();
+        else {
+            v_class c(con);
+            typename ch_class::iterator cli,cle;
+            FILE *mf[4];
+            int n;
+
+            // Take the next available chunk of cells, and format the output
+            // for each into memory
+            while(true) {
+#pragma omp atomic capture
+                n=next++;
+                if(n>=ch.n_chunks) break;
+                cw.open_chunk(n,mf);
+                for(ch.range(n,cli,cle);cli<cle;cli++) if(con.compute_cell(c,cli)) {
+                    cell_output(c,cli,con.ps,conp,conid,format,*mf,mf[1],mf[2],mf[3]);
+                    if(verbose) {tvol+=c.volume();tvcc++;}
+                }
+                cw.close_chunk(n,mf);
+
+                // Unless there is a dedicated writer thread, save any chunks
+                // that are ready
+                if(!writer) cw.write_ready();
+            }
+        }
+    }
+
+    // Save any remaining chunks
+    cw.run();
+    vol+=tvol;vcc+=tvcc;
+}
+#endif
+
 // Carries out the Voronoi computation and outputs the results to the requested
 // files
 template<class c_class,class v_class>
-void cmd_line_output(c_class &con,v_class &c,const char* format,FILE* out_file,FILE* gnu_file,FILE* povp_file,FILE* povv_file,bool verbose,double &vol,int &vcc,int &tp) {
+void cmd_line_output(c_class &con,v_class &c,const char* format,FILE* out_file,FILE* gnu_file,FILE* povp_file,FILE* povv_file,unsigned int smask,bool verbose,bool async,int nt,double &vol,int &vcc,int &tp) {
     container_base_3d::iterator cli;
+    if(verbose) tp=con.total_particles();
+
+    // If aggregate statistics are requested, then they replace the per-cell
+    // output, and the cells only need to be computed again for any other
+    // output files
+    if(smask!=0) {
+        stats_output(con,smask,out_file,verbose,vol,vcc);
+        if(gnu_file==NULL&&povp_file==NULL&&povv_file==NULL) return;
+        out_file=NULL;verbose=false;
+    }
     double **conp=con.p;uint64_t **conid=con.id;
+#ifdef _OPENMP
+    if(async||nt>1) {
+        block_chunks ch(con);
+        chunk_output<c_class,v_class>(con,ch,format,out_file,gnu_file,povp_file,povv_file,verbose,async,nt,vol,vcc);
+    } else
+#endif
     for(cli=con.begin();cli<con.end();cli++) if(con.compute_cell(c,cli)) {
         cell_output(c,cli,con.ps,conp,conid,format,out_file,gnu_file,povp_file,povv_file);
         if(verbose) {vol+=c.volume();vcc++;}
     }
-    if(verbose) tp=con.total_particles();
 }
 
 // Carries out the Voronoi computation and outputs the results to the requested
 // files, for the case when a particle order has been computed
 template<class c_class,class v_class>
-void cmd_line_output(particle_order vo,c_class &con,v_class &c,const char* format,FILE* out_file,FILE* gnu_file,FILE* povp_file,FILE* povv_file,bool verbose,double &vol,int &vcc,int &tp) {
+void cmd_line_output(particle_order &vo,c_class &con,v_class &c,const char* format,FILE* out_file,FILE* gnu_file,FILE* povp_file,FILE* povv_file,unsigned int smask,bool verbose,bool async,int nt,double &vol,int &vcc,int &tp) {
     container_base_3d::iterator_order cli;
+    if(verbose) tp=con.total_particles();
+
+    // If aggregate statistics are requested, then they replace the per-cell
+    // output, and the cells only need to be computed again for any other
+    // output files
+    if(smask!=0) {
+        stats_output(con,smask,out_file,verbose,vol,vcc);
+        if(gnu_file==NULL&&povp_file==NULL&&povv_file==NULL) return;
+        out_file=NULL;verbose=false;
+    }
     double **conp=con.p;uint64_t **conid=con.id;
+#ifdef _OPENMP
+    if(async||nt>1) {
+        order_chunks ch(vo,con);
+        chunk_output<c_class,v_class>(con,ch,format,out_file,gnu_file,povp_file,povv_file,verbose,async,nt,vol,vcc);
+    } else
+#endif
     for(cli=con.begin(vo);cli<con.end(vo);cli++) if(con.compute_cell(c,cli)) {
         cell_output(c,cli,con.ps,conp,conid,format,out_file,gnu_file,povp_file,povv_file);
         if(verbose) {vol+=c.volume();vcc++;}
     }
-    if(verbose) tp=con.total_particles();
+}
+
+// A class for reading a trajectory made up of multiple frames of particles.
+// Frames can be separated by header lines beginning with '#', in which case
+// the rest of the header line is used as the frame label. Alternatively,
+// frames can be given as LAMMPS dump blocks beginning with "ITEM: TIMESTEP",
+// in which case the timestep is used as the label and the particles are read
+// from the columns named in the "ITEM: ATOMS" line. The particles in each
+// frame are buffered in memory, which is reused between frames.
+class frame_reader {
+    public:
+        // The label of the current frame
+        std::string label;
+        // The IDs of the particles in the current frame
+        std::vector<uint64_t> id;
+        // The positions, and radii if polydisperse, of the particles in the
+        // current frame
+        std::vector<double> pos;
+        frame_reader(FILE *fp_,bool poly) : fp(fp_), ps(poly?4:3), line(NULL),
+            lsize(0), pending(false), lammps(false), in_atoms(false) {}
+        ~frame_reader() {free(line);}
+        bool next_frame();
+        void guess_optimal(double lx,double ly,double lz,int &nx,int &ny,int &nz);
+        // Adds the particles in the current frame to a container
+        template<class c_class>
+        inline void setup(c_class &con) {
+            for(int k=0;k<(int) id.size();k++) put(con,k);
+        }
+        // Adds the particles in the current frame to a container, also
+        // recording the order in which they were read
+        template<class c_class>
+        inline void setup(particle_order &vo,c_class &con) {
+            for(int k=0;k<(int) id.size();k++) put(vo,con,k);
+        }
+    private:
+        // The file handle to read from
+        FILE *fp;
+        // The number of doubles stored for each particle
+        const int ps;
+        // The buffer holding the current line of the file
+        char *line;
+        // The size of the line buffer
+        size_t lsize;
+        // Whether the line buffer holds a frame header that has been read but
+        // not yet processed
+        bool pending;
+        // Whether the current frame is a LAMMPS dump block
+        bool lammps;
+        // Whether the LAMMPS reader is within the ATOMS section of a block
+        bool in_atoms;
+        // The role of each LAMMPS column, set to 0 for the ID, 1 to 3 for the
+        // position, 4 for the radius, and -1 for columns that are ignored
+        std::vector<int> role;
+        inline bool read_line() {
+            return getline(&line,&lsize,fp)!=-1;
+        }
+        inline void put(container_3d &con,int k) {
+            double *pp=pos.data()+3*k;
+            con.put(id[k],*pp,pp[1],pp[2]);
+        }
+        inline void put(container_poly_3d &con,int k) {
+            double *pp=pos.data()+4*k;
+            con.put(id[k],*pp,pp[1],pp[2],pp[3]);
+        }
+        inline void put(particle_order &vo,container_3d &con,int k) {
+            double *pp=pos.data()+3*k;
+            con.put(vo,id[k],*pp,pp[1],pp[2]);
+        }
+        inline void put(particle_order &vo,container_poly_3d &con,int k) {
+            double *pp=pos.data()+4*k;
+            con.put(vo,id[k],*pp,pp[1],pp[2],pp[3]);
+        }
+        void set_label(char *lp);
+        void parse_columns(char *lp);
+        void parse_atom(char *lp);
+        void parse_particle(char *lp);
+};
+
+// Reads the next frame of the trajectory. It returns true if a frame was
+// read, and false if the end of the file has been reached.
+bool frame_reader::next_frame() {
+    bool started=false;
+    char *lp;
+    id.clear();pos.clear();label.clear();
+    while(pending||read_line()) {
+        pending=false;
+        lp=line;
+        while(isspace(*lp)) lp++;
+        if(*lp=='\0') continue;
+
+        // Check for the start of a new frame. If a frame has already been
+        // read, then keep the header for the next call.
+        if(*lp=='#'||strncmp(lp,"ITEM: TIMESTEP",14)==0) {
+            if(started) {pending=true;return true;}
+            started=true;
+            if(*lp=='#') {
+                lammps=false;
+                set_label(lp+1);
+            } else {
+                lammps=true;in_atoms=false;
+                if(!read_line()) voro_fatal_error("LAMMPS dump ends without a timestep",VOROPP_FILE_ERROR);
+                set_label(line);
+            }
+        } else if(strncmp(lp,"ITEM:",5)==0) {
+            if(!lammps) voro_fatal_error("LAMMPS item found outside of a LAMMPS frame",VOROPP_FILE_ERROR);
+            if((in_atoms=strncmp(lp+5," ATOMS",6)==0)) parse_columns(lp+11);
+        } else {
+
+            // A file without any headers is treated as a single frame
+            if(!started) {started=true;lammps=false;}
+            if(!lammps) parse_particle(lp);
+            else if(in_atoms) parse_atom(lp);
+        }
+    }
+    return started;
+}
+
+// Sets the frame label from the text of a header line, removing leading and
+// trailing whitespace
+void frame_reader::set_label(char *lp) {
+    while(isspace(*lp)) lp++;
+    char *le=lp+strlen(lp);
+    while(le>lp&&isspace(le[-1])) le--;
+    label.assign(lp,le-lp);
+}
+
+// Determines which columns of a LAMMPS dump hold the particle IDs, positions,
+// and radii, from the list of names in the "ITEM: ATOMS" line
+void frame_reader::parse_columns(char *lp) {
+    const char *nm[5]={"id","x","y","z","radius"},
+               *nmu[5]={"id","xu","yu","zu","radius"};
+    char *tok,*sp;
+    int found=0,r;
+    role.clear();
+    for(tok=strtok_r(lp," \t\r\n",&sp);tok!=NULL;tok=strtok_r(NULL," \t\r\n",&sp)) {
+        for(r=0;r<ps+1;r++) if(se(tok,nm[r])||se(tok,nmu[r])) break;
+        if(r==ps+1) r=-1;
+        else found|=1<<r;
+        role.push_back(r);
+    }
+    if(found!=(1<<(ps+1))-1)
+        voro_fatal_error(ps==4?"LAMMPS dump must have id, x, y, z, and radius columns"
+                              :"LAMMPS dump must have id, x, y, and z columns",VOROPP_FILE_ERROR);
+}
+
+// Reads a particle from a line in the ATOMS section of a LAMMPS dump
+void frame_reader::parse_atom(char *lp) {
+    double v[5];
+    uint64_t i=0;
+    char *e;
+    for(int k=0;k<(int) role.size();k++) {
+        while(isspace(*lp)) lp++;
+        if(*lp=='\0') voro_fatal_error("LAMMPS dump has too few columns",VOROPP_FILE_ERROR);
+        if(role[k]==-1) e=lp+strcspn(lp," \t\r\n");
+        else if(role[k]==0) i=strtoull(lp,&e,10);
+        else v[role[k]-1]=strtod(lp,&e);
+        if(e==lp) voro_fatal_error("File import error",VOROPP_FILE_ERROR);
+        lp=e;
+    }
+    id.push_back(i);
+    pos.insert(pos.end(),v,v+ps);
+}
+
+// Reads a particle from a line holding its ID and position, plus its radius
+// if polydisperse
+void frame_reader::parse_particle(char *lp) {
+    double v[4];
+    uint64_t i;
+    if(sscanf(lp,"%" SCNu64 " %lg %lg %lg %lg",&i,v,v+1,v+2,v+3)<ps+1)
+        voro_fatal_error("File import error",VOROPP_FILE_ERROR);
+    id.push_back(i);
+    pos.insert(pos.end(),v,v+ps);
+}
+
+// Estimates a good grid size for a container based on the number of particles
+// in the current frame, using the same heuristic as the particle_list class
+void frame_reader::guess_optimal(double lx,double ly,double lz,int &nx,int &ny,int &nz) {
+    double ilscale=pow(id.size()/(optimal_particles_3d*lx*ly*lz),1/3.0);
+    nx=int(lx*ilscale+1);
+    ny=int(ly*ilscale+1);
+    nz=int(lz*ilscale+1);
+}
+
+// A class for managing the output files in trajectory mode. The output for all
+// of the frames is either written to a single set of files with a marker line
+// at the start of each frame, or to a separate set of files for each frame.
+// The separate files are named by appending the frame number to a filename
+// stem, followed by a suffix.
+class frame_files {
+    public:
+        // The output files for the current frame, which are NULL if not in
+        // use
+        FILE *fp[4];
+        frame_files(FILE *out_file,FILE *gnu_file,FILE *povp_file,FILE *povv_file)
+            : separate(false) {
+            *fp=out_file;fp[1]=gnu_file;fp[2]=povp_file;fp[3]=povv_file;
+        }
+        frame_files(const char **stem_,const char **suf_,FILE *out_file,FILE *gnu_file,FILE *povp_file,FILE *povv_file)
+            : separate(true) {
+            *fp=out_file;fp[1]=gnu_file;fp[2]=povp_file;fp[3]=povv_file;
+            for(int i=0;i<4;i++) {stem[i]=stem_[i];suf[i]=suf_[i];}
+        }
+        void open_frame(int n,const std::string &label);
+        void close_frame();
+    private:
+        // Whether to use separate files for each frame
+        const bool separate;
+        // The filename stems and suffixes, which are NULL for files that are
+        // shared between frames
+        const char *stem[4];
+        const char *suf[4];
+};
+
+// Prepares the output files for a frame. Separate files for the frame are
+// opened, and shared files have a marker line written to them.
+void frame_files::open_frame(int n,const std::string &label) {
+    for(int i=0;i<4;i++) {
+        if(separate&&stem[i]!=NULL) {
+            char nb[16];
+            sprintf(nb,".%d",n);
+            std::string fn(stem[i]);
+            fn+=nb;fn+=suf[i];
+            fp[i]=safe_fopen(fn.c_str(),"w");
+        } else if(fp[i]!=NULL)
+            fprintf(fp[i],i<2?"# frame %d %s\n":"// frame %d %s\n",n,label.c_str());
+    }
+}
+
+// Closes any separate output files for a frame
+void frame_files::close_frame() {
+    if(separate) for(int i=0;i<4;i++) if(stem[i]!=NULL) fclose(fp[i]);
+}
+
+// Carries out the Voronoi computation for each frame of a trajectory. The
+// container, the Voronoi cell, and the particle ordering are reused between
+// frames, so that the memory allocation only happens once. If a VTK filename
+// stem is given, then a separate VTK file is written for each frame.
+template<class c_class,class v_class>
+void trajectory_output(frame_reader &fr,c_class &con,v_class &c,bool ordered,const char* format,frame_files &ff,const char *vtu_stem,bool vtu_compress,unsigned int smask,bool verbose,bool async,int nt,double &vol,int &vcc,int &tp,int &nf) {
+    particle_order vo;
+    int ftp=0;
+    nf=0;
+    do {
+        con.clear();
+        ff.open_frame(nf,fr.label);
+        if(ordered) {
+            vo.clear();
+            fr.setup(vo,con);
+            cmd_line_output(vo,con,c,format,*ff.fp,ff.fp[1],ff.fp[2],ff.fp[3],smask,verbose,async,nt,vol,vcc,ftp);
+        } else {
+            fr.setup(con);
+            cmd_line_output(con,c,format,*ff.fp,ff.fp[1],ff.fp[2],ff.fp[3],smask,verbose,async,nt,vol,vcc,ftp);
+        }
+        ff.close_frame();
+        if(vtu_stem!=NULL) {
+            char nb[16];
+            sprintf(nb,".%d.vtu",nf);
+            std::string fn(vtu_stem);
+            fn+=nb;
+            con.draw_cells_vtu(fn.c_str(),vtu_compress);
+        }
+        tp+=ftp;nf++;
+    } while(fr.next_frame());
 }
 
 int main(int argc,char **argv) {
     int i=1,j=-7,custom_output=0,num_thread=1,nx,ny,nz,init_mem=8,
-    gnuplot_output=-1,povv_output=-1,povp_output=-1;
+    gnuplot_output=-1,povv_output=-1,povp_output=-1,vtu_output=-1;
+    unsigned int smask=0;
+    const char *s_str=NULL;
     double ls=0;
     blocks_mode bm=none;
     bool polydisperse=false,x_prd=false,y_prd=false,z_prd=false,
-         ordered=false,verbose=false,stdout_used=false;
+         ordered=false,verbose=false,stdout_used=false,async=false,
+         trajectory=false,separate=false,vtu_compress=false;
 
     particle_list3 *plist3=NULL;particle_list4 *plist4=NULL;
     wall_list_3d wl;
@@ -244,6 +849,10 @@ int main(int argc,char **argv) {
 
     // We have enough arguments. Now start searching for command-line options.
     while(i<argc-7) {
+#ifdef _OPENMP
+        if(se(argv[i],"-a")) async=true;
+        else
+#endif
         if(se(argv[i],"-c")) {
             if(i>=argc-8) {error_message();wl.deallocate();return VOROPP_CMD_LINE_ERROR;}
             if(custom_output==0) {
@@ -253,7 +862,9 @@ int main(int argc,char **argv) {
                 wl.deallocate();
                 return VOROPP_CMD_LINE_ERROR;
             }
-        } else if(se(argv[i],"-g")) {
+        } else if(se(argv[i],"-f")) trajectory=true;
+        else if(se(argv[i],"-fs")) trajectory=separate=true;
+        else if(se(argv[i],"-g")) {
             if(gnuplot_output==-1) gnuplot_output=0;
         } else if(se(argv[i],"-G")) {
             if(i>=argc-8) {error_message();wl.deallocate();return VOROPP_CMD_LINE_ERROR;}
@@ -266,7 +877,20 @@ int main(int argc,char **argv) {
             help_message();wl.deallocate();return 0;
         } else if(se(argv[i],"-hc")) {
             custom_output_message();wl.deallocate();return 0;
-        } else if(se(argv[i],"-l")) {
+        } else if(se(argv[i],"-k")) {
+            if(vtu_output==-1) vtu_output=0;
+        } else if(se(argv[i],"-K")) {
+            if(i>=argc-8) {error_message();wl.deallocate();return VOROPP_CMD_LINE_ERROR;}
+            if(vtu_output>0) {
+                fputs("voro++: multiple VTK output filenames detected\n",stderr);
+                wl.deallocate();
+                return VOROPP_CMD_LINE_ERROR;
+            } else vtu_output=++i;
+        }
+#if VOROPP_ZLIB
+        else if(se(argv[i],"-kz")) vtu_compress=true;
+#endif
+        else if(se(argv[i],"-l")) {
             if(i>=argc-8) {error_message();wl.deallocate();return VOROPP_CMD_LINE_ERROR;}
             if(bm!=none) {
                 fputs("voro++: Conflicting options about grid setup (-l/-n)\n",stderr);
@@ -299,6 +923,21 @@ int main(int argc,char **argv) {
         else if(se(argv[i],"-py")) y_prd=true;
         else if(se(argv[i],"-pz")) z_prd=true;
         else if(se(argv[i],"-r")) polydisperse=true;
+        else if(se(argv[i],"-s")) {
+            if(i>=argc-8) {error_message();wl.deallocate();return VOROPP_CMD_LINE_ERROR;}
+            if(smask!=0) {
+                fputs("voro++: multiple statistics strings detected\n",stderr);
+                wl.deallocate();
+                return VOROPP_CMD_LINE_ERROR;
+            }
+            s_str=argv[++i];
+            smask=stats_mask(s_str);
+            if(smask==0) {
+                fputs("voro++: Unrecognized statistics string\n",stderr);
+                wl.deallocate();
+                return VOROPP_CMD_LINE_ERROR;
+            }
+        }
 #ifdef _OPENMP
         else if(se(argv[i],"-t")) {
             if(i>=argc-8) {error_message();wl.deallocate();return VOROPP_CMD_LINE_ERROR;}
@@ -385,6 +1024,14 @@ int main(int argc,char **argv) {
         i++;
     }
 
+    // Check that the per-cell output has not been customized if it is
+    // replaced by aggregate statistics
+    if(smask!=0&&custom_output!=0) {
+        fputs("voro++: The custom output and statistics options cannot be used together\n",stderr);
+        wl.deallocate();
+        return VOROPP_CMD_LINE_ERROR;
+    }
+
     // Check the memory guess is positive
     if(init_mem<=0) {
         fputs("voro++: The memory allocation must be positive\n",stderr);
@@ -436,12 +1083,26 @@ int main(int argc,char **argv) {
         base_fn=argv[i+6];
     }
 
+    // In trajectory mode, read in the first frame
+    frame_reader *fr=NULL;
+    if(trajectory) {
+        fr=new frame_reader(in_file,polydisperse);
+        if(!fr->next_frame()) {
+            fputs("voro++: No frames found in the trajectory\n",stderr);
+            delete fr;
+            wl.deallocate();
+            return VOROPP_FILE_ERROR;
+        }
+    }
+
     // Calculate the number of blocks to use in the computation
     if(bm==none) {
 
         // If no information has been given, then read all the particles into
-        // the a particle_list class in order to estimate the number of blocks
-        if(polydisperse) {
+        // the a particle_list class in order to estimate the number of blocks.
+        // In trajectory mode, the first frame is used for the estimate.
+        if(trajectory) fr->guess_optimal(lx,ly,lz,nx,ny,nz);
+        else if(polydisperse) {
             plist4=new particle_list4();
             plist4->import(in_file);
             plist4->guess_optimal(lx,ly,lz,nx,ny,nz);
@@ -450,7 +1111,7 @@ int main(int argc,char **argv) {
             plist3->import(in_file);
             plist3->guess_optimal(lx,ly,lz,nx,ny,nz);
         }
-        if(in_file!=stdin) fclose(in_file);
+        if(!trajectory&&in_file!=stdin) fclose(in_file);
     } else {
         double nxf,nyf,nzf;
         if(bm==length_scale) {
@@ -490,9 +1151,29 @@ int main(int argc,char **argv) {
         }
     }
 
+    // If separate files are written for each frame of a trajectory, then
+    // assemble the filename stems and suffixes
+    const char *stem[4]={NULL,NULL,NULL,NULL},*suf[4]={"",".gnu","_p.pov","_v.pov"};
+    if(separate) {
+        if(custom_output==0||!se(argv[custom_output],"")) {
+            if(i+7>=argc) {stem[0]=base_fn;suf[0]=".vor";}
+            else if(!se(argv[i+7],"-")) stem[0]=argv[i+7];
+        }
+        int fo[3]={gnuplot_output,povp_output,povv_output};
+        for(int k=0;k<3;k++) {
+            if(fo[k]==0) stem[k+1]=base_fn;
+            else if(fo[k]>0) {
+                suf[k+1]="";
+                if(!se(argv[fo[k]],"-")) stem[k+1]=argv[fo[k]];
+            }
+            if(stem[k+1]!=NULL) fo[k]=-1;
+        }
+        gnuplot_output=fo[0];povp_output=fo[1];povv_output=fo[2];
+    }
+
     // Open the main output file
     char *buffer=new char[flen+10];
-    if(custom_output!=0&&se(argv[custom_output],"")) out_file=NULL;
+    if((custom_output!=0&&se(argv[custom_output],""))||stem[0]!=NULL) out_file=NULL;
     else {
         if(i+7<argc) {
             if(se(argv[i+7],"-")) {
@@ -510,14 +1191,54 @@ int main(int argc,char **argv) {
          *povv_file=open_extra(buffer,argv,wl,povv_output,"_v.pov",base_fn,stdout_used);
     delete [] buffer;
 
+    // Set up the VTK output filename. Since the VTK writer needs to seek
+    // within the file, standard output cannot be used.
+    std::string vtu_fn;
+    if(vtu_output>0&&se(argv[vtu_output],"-")) {
+        fputs("voro++: The VTK output cannot be written to standard output\n",stderr);
+        wl.deallocate();
+        return VOROPP_CMD_LINE_ERROR;
+    }
+    if(vtu_output>=0) {
+        vtu_fn=vtu_output==0?base_fn:argv[vtu_output];
+        if(vtu_output==0&&!trajectory) vtu_fn+=".vtu";
+    }
+    const char *vtu_name=vtu_output>=0?vtu_fn.c_str():NULL;
+
     // Set up the output string
     const char *c_str=custom_output!=0?argv[custom_output]:(polydisperse?"%i %q %v %r":"%i %q %v");
     bool neigh=custom_output!=0&&voro_contains_neighbor(argv[custom_output]);
 
     // Now switch depending on whether polydispersity was enabled, and whether
     // output ordering is requested
-    double vol=0;int tp=0,vcc=0;
-    if(polydisperse) {
+    double vol=0;int tp=0,vcc=0,nf=0;
+    if(trajectory) {
+        frame_files *ff=separate?new frame_files(stem,suf,out_file,gnu_file,povp_file,povv_file)
+                                :new frame_files(out_file,gnu_file,povp_file,povv_file);
+        if(polydisperse) {
+            container_poly_3d con(ax,bx,ay,by,az,bz,nx,ny,nz,x_prd,y_prd,z_prd,init_mem,num_thread);
+            con.add_wall(wl);
+            if(neigh) {
+                voronoicell_neighbor_3d c(con);
+                trajectory_output(*fr,con,c,ordered,c_str,*ff,vtu_name,vtu_compress,smask,verbose,async,num_thread,vol,vcc,tp,nf);
+            } else {
+                voronoicell_3d c(con);
+                trajectory_output(*fr,con,c,ordered,c_str,*ff,vtu_name,vtu_compress,smask,verbose,async,num_thread,vol,vcc,tp,nf);
+            }
+        } else {
+            container_3d con(ax,bx,ay,by,az,bz,nx,ny,nz,x_prd,y_prd,z_prd,init_mem,num_thread);
+            con.add_wall(wl);
+            if(neigh) {
+                voronoicell_neighbor_3d c(con);
+                trajectory_output(*fr,con,c,ordered,c_str,*ff,vtu_name,vtu_compress,smask,verbose,async,num_thread,vol,vcc,tp,nf);
+            } else {
+                voronoicell_3d c(con);
+                trajectory_output(*fr,con,c,ordered,c_str,*ff,vtu_name,vtu_compress,smask,verbose,async,num_thread,vol,vcc,tp,nf);
+            }
+        }
+        delete ff;delete fr;
+        if(in_file!=stdin) fclose(in_file);
+    } else if(polydisperse) {
         container_poly_3d con(ax,bx,ay,by,az,bz,nx,ny,nz,x_prd,y_prd,z_prd,init_mem,num_thread);
         con.add_wall(wl);
 
@@ -531,10 +1252,10 @@ int main(int argc,char **argv) {
             }
             if(neigh) {
                 voronoicell_neighbor_3d c(con);
-                cmd_line_output(vo,con,c,c_str,out_file,gnu_file,povp_file,povv_file,verbose,vol,vcc,tp);
+                cmd_line_output(vo,con,c,c_str,out_file,gnu_file,povp_file,povv_file,smask,verbose,async,num_thread,vol,vcc,tp);
             } else {
                 voronoicell_3d c(con);
-                cmd_line_output(vo,con,c,c_str,out_file,gnu_file,povp_file,povv_file,verbose,vol,vcc,tp);
+                cmd_line_output(vo,con,c,c_str,out_file,gnu_file,povp_file,povv_file,smask,verbose,async,num_thread,vol,vcc,tp);
             }
         } else {
             if(bm==none) {
@@ -545,12 +1266,13 @@ int main(int argc,char **argv) {
             }
             if(neigh) {
                 voronoicell_neighbor_3d c(con);
-                cmd_line_output(con,c,c_str,out_file,gnu_file,povp_file,povv_file,verbose,vol,vcc,tp);
+                cmd_line_output(con,c,c_str,out_file,gnu_file,povp_file,povv_file,smask,verbose,async,num_thread,vol,vcc,tp);
             } else {
                 voronoicell_3d c(con);
-                cmd_line_output(con,c,c_str,out_file,gnu_file,povp_file,povv_file,verbose,vol,vcc,tp);
+                cmd_line_output(con,c,c_str,out_file,gnu_file,povp_file,povv_file,smask,verbose,async,num_thread,vol,vcc,tp);
             }
         }
+        if(vtu_name!=NULL) con.draw_cells_vtu(vtu_name,vtu_compress);
     } else {
         container_3d con(ax,bx,ay,by,az,bz,nx,ny,nz,x_prd,y_prd,z_prd,init_mem,num_thread);
         con.add_wall(wl);
@@ -565,10 +1287,10 @@ int main(int argc,char **argv) {
             }
             if(neigh) {
                 voronoicell_neighbor_3d c(con);
-                cmd_line_output(vo,con,c,c_str,out_file,gnu_file,povp_file,povv_file,verbose,vol,vcc,tp);
+                cmd_line_output(vo,con,c,c_str,out_file,gnu_file,povp_file,povv_file,smask,verbose,async,num_thread,vol,vcc,tp);
             } else {
                 voronoicell_3d c(con);
-                cmd_line_output(vo,con,c,c_str,out_file,gnu_file,povp_file,povv_file,verbose,vol,vcc,tp);
+                cmd_line_output(vo,con,c,c_str,out_file,gnu_file,povp_file,povv_file,smask,verbose,async,num_thread,vol,vcc,tp);
             }
         } else {
             if(bm==none) {
@@ -579,12 +1301,13 @@ int main(int argc,char **argv) {
             }
             if(neigh) {
                 voronoicell_neighbor_3d c(con);
-                cmd_line_output(con,c,c_str,out_file,gnu_file,povp_file,povv_file,verbose,vol,vcc,tp);
+                cmd_line_output(con,c,c_str,out_file,gnu_file,povp_file,povv_file,smask,verbose,async,num_thread,vol,vcc,tp);
             } else {
                 voronoicell_3d c(con);
-                cmd_line_output(con,c,c_str,out_file,gnu_file,povp_file,povv_file,verbose,vol,vcc,tp);
+                cmd_line_output(con,c,c_str,out_file,gnu_file,povp_file,povv_file,smask,verbose,async,num_thread,vol,vcc,tp);
             }
         }
+        if(vtu_name!=NULL) con.draw_cells_vtu(vtu_name,vtu_compress);
     }
     wl.deallocate();
 
@@ -601,9 +1324,10 @@ int main(int argc,char **argv) {
                ax,bx,ay,by,az,bz,nx,ny,nz,
                bm==none?"estimated from file":(bm==length_scale?
                "estimated using length scale":"directly specified"),
-               argv[i+6],c_str,custom_output==0?" (default)":"",
-               tp,static_cast<double>(tp)/(nx*ny*nz),vcc,
-               lx*ly*lz,vol);
+               argv[i+6],smask!=0?s_str:c_str,smask!=0?" (statistics)":(custom_output==0?" (default)":""),
+               tp,static_cast<double>(tp)/(nx*ny*nz*(trajectory?nf:1)),vcc,
+               lx*ly*lz*(trajectory?nf:1),vol);
+        if(trajectory) printf("Frames processed          : %d\n",nf);
     }
 
     // Close output files
@@ -4,6 +4,8 @@
 /** \file common.cc
  * \brief Implementations of the small helper functions. */
 
+#include <algorithm>
+
 #include "common.hh"
 
 namespace voro {
@@ -236,4 +238,59 @@ bool voro_read_precision(FILE *fp,char *&fmp,int &pr) {
     return true;
 }
 
+/** \brief Sorts a set of particles into rows in order of increasing ID.
+ *
+ * The neighbor graph, Voronoi mesh, and Delaunay classes store one row per
+ * particle, and look rows up by particle ID. If the IDs are exactly 0 to n-1,
+ * then each particle is placed directly in the row given by its ID, and
+ * otherwise a full sort is carried out.
+ * \param[in,out] id the particle IDs.
+ * \param[in,out] ijk the block of each particle, which is permuted along with
+ *                    the IDs.
+ * \param[in,out] q the index of each particle within its block, which is
+ *                  permuted along with the IDs.
+ * \return True if the particles were placed directly, false otherwise. */
+bool voro_sort_rows(std::vector<uint64_t> &id,std::vector<int> &ijk,std::vector<int> &q) {
+    const int n=id.size();
+    std::vector<int> pl(n,-1);
+    bool direct=true;
+    int i;
+
+    // Test whether the particles can be placed directly
+    for(i=0;i<n;i++) {
+        if(id[i]>=(uint64_t) n||pl[id[i]]!=-1) {direct=false;break;}
+        pl[id[i]]=i;
+    }
+
+    // Otherwise, sort the IDs to find the ordering
+    if(!direct) {
+        std::vector<std::pair<uint64_t,int> > s(n);
+        for(i=0;i<n;i++) s[i]=std::make_pair(id[i],i);
+        std::sort(s.begin(),s.end());
+        for(i=0;i<n;i++) pl[i]=s[i].second;
+    }
+
+    // Apply the permutation
+    std::vector<int> nijk(n),nq(n);
+    std::vector<uint64_t> nid(n);
+    for(i=0;i<n;i++) {nijk[i]=ijk[pl[i]];nq[i]=q[pl[i]];nid[i]=id[pl[i]];}
+    ijk.swap(nijk);q.swap(nq);id.swap(nid);
+    return direct;
+}
+
+/** \brief Finds the row corresponding to a particle ID.
+ *
+ * Finds the row of a particle in a set of rows that has been sorted by
+ * voro_sort_rows.
+ * \param[in] direct whether the particles were placed directly.
+ * \param[in] id the particle IDs of the rows.
+ * \param[in] pid the particle ID to find.
+ * \return The row, or -1 if the particle is not present. */
+int voro_find_row(bool direct,std::vector<uint64_t> &id,int pid) {
+    if(pid<0) return -1;
+    if(direct) return pid<int(id.size())?pid:-1;
+    std::vector<uint64_t>::iterator it=std::lower_bound(id.begin(),id.end(),(uint64_t) pid);
+    return it!=id.end()&&*it==(uint64_t) pid?int(it-id.begin()):-1;
+}
+
 }
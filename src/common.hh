@@ -9,6 +9,7 @@
 
 #include <cstdio>
 #include <cstdlib>
+#include <inttypes.h>
 #include <vector>
 
 #include "config.hh"
@@ -28,6 +29,8 @@ void voro_print_vector(int pr,std::vector<double> &v,FILE *fp=stdout);
 void voro_print_face_vertices(std::vector<int> &v,FILE *fp=stdout);
 bool voro_contains_neighbor(const char *format);
 bool voro_read_precision(FILE *fp,char *&fmp,int &pr);
+bool voro_sort_rows(std::vector<uint64_t> &id,std::vector<int> &ijk,std::vector<int> &q);
+int voro_find_row(bool direct,std::vector<uint64_t> &id,int pid);
 }
 
 #endif
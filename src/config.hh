@@ -79,6 +79,12 @@ const int particle_list_chunk_size=4096;
 #define VOROPP_VERBOSE 2
 #endif
 
+#ifndef VOROPP_ZLIB
+/** If this is set to 1, then the VTK output routines can compress their data
+ * using zlib, in which case programs must be linked with -lz. */
+#define VOROPP_ZLIB 0
+#endif
+
 /** If a point is within this distance of a cutting plane, then the code
  * assumes that point exactly lies on the plane. */
 const double tolerance=10.*std::numeric_limits<double>::epsilon();
@@ -96,6 +102,34 @@ const double default_radius=0.5;
 /** The maximum number of shells of periodic images to test over. */
 const int max_unit_voro_shells=10;
 
+/** The maximum number of unit Voronoi cells for triclinic domains that are
+ * kept in the process-wide cache. */
+const int unit_voro_cache_size=64;
+
+/** The relative tolerance within which two triclinic domain shapes are
+ * treated as identical by the cache of unit Voronoi cells. */
+const double unit_voro_cache_tolerance=1e-12;
+
+/** The maximum relative difference in shape for which a cached unit Voronoi
+ * cell is used as the starting point for computing the cell of a deformed
+ * triclinic domain. */
+const double unit_voro_update_range=0.05;
+
+/** The relative tolerance on the volume that is used to check that a unit
+ * Voronoi cell computed from the cached cell of a similar domain is correct.
+ */
+const double unit_voro_update_tolerance=1e-10;
+
+/** If the ratio of the largest to the smallest dimension of the computational
+ * blocks exceeds this value, then the block worklists for three-dimensional
+ * computations are generated for the actual block shape, instead of using the
+ * precomputed worklists for cubic blocks. */
+const double worklist_aspect_limit=1.25;
+
+/** The maximum subgrid resolution of the block worklists for
+ * three-dimensional computations. */
+const int max_worklist_hgrid=16;
+
 /** A guess for the optimal number of particles per block in two-dimensional
  * computations, used to set up the container grid. */
 const double optimal_particles_2d=4.2;
@@ -104,6 +138,16 @@ const double optimal_particles_2d=4.2;
  * computations, used to set up the container grid. */
 const double optimal_particles_3d=5.6;
 
+/** The maximum number of particles in a leaf of the quadtree used by the
+ * adaptive 2D containers. A leaf that is full is split into four when another
+ * particle is added. */
+const int quad_leaf_size=6;
+
+/** The maximum depth of the quadtree used by the adaptive 2D containers.
+ * Leaves at this depth are not split, so that many coincident particles do not
+ * cause unbounded refinement. */
+const int max_quad_depth=24;
+
 /** If this is set to 1, then the code reports any instances of particles being
  * put outside of the container geometry. */
 #define VOROPP_REPORT_OUT_OF_BOUNDS 0
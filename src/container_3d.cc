@@ -5,9 +5,14 @@
  * \brief Function implementations for the container_3d and related classes. */
 
 #include <cstring>
+#include <algorithm>
 
 #include "container_3d.hh"
 #include "iter_3d.hh"
+#include "vtu_writer_3d.hh"
+#include "cell_reduction_3d.hh"
+#include "cell_estimate_3d.hh"
+#include "particle_search_3d.hh"
 
 namespace voro {
 
@@ -27,17 +32,20 @@ namespace voro {
  * \param[in] ps_ the number of floating point entries to store for each
  *                particle.
  * \param[in] nt_ the maximum number of threads that will be used for Voronoi
- *                computations. */
+ *                computations.
+ * \param[in] hgrid_ half the number of subregions that each block is divided
+ *                   into along each direction for the block worklists. */
 container_base_3d::container_base_3d(double ax_,double bx_,double ay_,double by_,double az_,double bz_,
-        int nx_,int ny_,int nz_,bool x_prd_,bool y_prd_,bool z_prd_,int init_mem,int ps_,int nt_)
-    : voro_base_3d(nx_,ny_,nz_,(bx_-ax_)/nx_,(by_-ay_)/ny_,(bz_-az_)/nz_),
+        int nx_,int ny_,int nz_,bool x_prd_,bool y_prd_,bool z_prd_,int init_mem,int ps_,int nt_,int hgrid_)
+    : voro_base_3d(nx_,ny_,nz_,(bx_-ax_)/nx_,(by_-ay_)/ny_,(bz_-az_)/nz_,hgrid_),
     ax(ax_), bx(bx_), ay(ay_), by(by_), az(az_), bz(bz_),
     max_len_sq((bx-ax)*(bx-ax)*(x_prd_?0.25:1)+(by-ay)*(by-ay)*(y_prd_?0.25:1)
           +(bz-az)*(bz-az)*(z_prd_?0.25:1)),
     x_prd(x_prd_), y_prd(y_prd_), z_prd(z_prd_), id(new uint64_t*[nxyz]),
     p(new double*[nxyz]), co(new int[nxyz]), mem(new int[nxyz]), ps(ps_),
     nt(nt_), oflow_co(0), oflow_mem(init_overflow_size),
-    ijk_m_id_oflow(new int[3*oflow_mem]), p_oflow(new double[ps*oflow_mem]) {
+    ijk_m_id_oflow(new int[3*oflow_mem]), p_oflow(new double[ps*oflow_mem]),
+    bw_margin(0), bw_nwalls(-1) {
     int l;
     for(l=0;l<nxyz;l++) co[l]=0;
     for(l=0;l<nxyz;l++) mem[l]=init_mem;
@@ -74,10 +82,12 @@ container_base_3d::~container_base_3d() {
  *                                   periodic in each coordinate direction.
  * \param[in] init_mem the initial memory allocation for each block.
  * \param[in] nt_ the maximum number of threads that will be used for Voronoi
- *                computations. */
+ *                computations.
+ * \param[in] hgrid_ half the number of subregions that each block is divided
+ *                   into along each direction for the block worklists. */
 container_3d::container_3d(double ax_,double bx_,double ay_,double by_,double az_,double bz_,
-    int nx_,int ny_,int nz_,bool x_prd_,bool y_prd_,bool z_prd_,int init_mem,int nt_)
-    : container_base_3d(ax_,bx_,ay_,by_,az_,bz_,nx_,ny_,nz_,x_prd_,y_prd_,z_prd_,init_mem,3,nt_),
+    int nx_,int ny_,int nz_,bool x_prd_,bool y_prd_,bool z_prd_,int init_mem,int nt_,int hgrid_)
+    : container_base_3d(ax_,bx_,ay_,by_,az_,bz_,nx_,ny_,nz_,x_prd_,y_prd_,z_prd_,init_mem,3,nt_,hgrid_),
     vc(new voro_compute_3d<container_3d>*[nt]) {
 
     // Allocate as many Voronoi computation objects as there are threads
@@ -121,10 +131,12 @@ void container_3d::change_number_thread(int nt_){
  *                                   periodic in each coordinate direction.
  * \param[in] init_mem the initial memory allocation for each block.
  * \param[in] nt_ the maximum number of threads that will be used for Voronoi
- *                computations. */
+ *                computations.
+ * \param[in] hgrid_ half the number of subregions that each block is divided
+ *                   into along each direction for the block worklists. */
 container_poly_3d::container_poly_3d(double ax_,double bx_,double ay_,double by_,double az_,double bz_,
-    int nx_,int ny_,int nz_,bool x_prd_,bool y_prd_,bool z_prd_,int init_mem,int nt_)
-    : container_base_3d(ax_,bx_,ay_,by_,az_,bz_,nx_,ny_,nz_,x_prd_,y_prd_,z_prd_,init_mem,4,nt_),
+    int nx_,int ny_,int nz_,bool x_prd_,bool y_prd_,bool z_prd_,int init_mem,int nt_,int hgrid_)
+    : container_base_3d(ax_,bx_,ay_,by_,az_,bz_,nx_,ny_,nz_,x_prd_,y_prd_,z_prd_,init_mem,4,nt_,hgrid_),
     vc(new voro_compute_3d<container_poly_3d>*[nt]), max_r(new double[nt]) {
     for(int j=0;j<nt;j++) max_r[j]=0.;
 #pragma omp parallel num_threads(nt)
@@ -567,6 +579,267 @@ bool container_poly_3d::find_voronoi_cell(double x,double y,double z,double &rx,
     return false;
 }
 
+/** Finds the Voronoi cells that contain a batch of vectors. The vectors are
+ * first remapped into the primary domain and bucketed by the block that they
+ * are in, using a counting sort. The buckets are then processed in parallel.
+ * Within a bucket, each search is seeded with the particle found for the
+ * previous vector, so that when the vectors are close together the search
+ * radius is small from the outset and few blocks need to be tested.
+ * \param[in] vc the array of per-thread Voronoi computation objects.
+ * \param[in] n the number of vectors.
+ * \param[in] pos an array of length 3*n holding the vectors to test.
+ * \param[out] pid an array of length n in which to store the particle IDs.
+ * \param[out] rpos an array of length 3*n in which to store the particle
+ *                  positions. If the container is periodic, these may point to
+ *                  particles in periodic images of the primary domain.
+ * \param[out] found an optional array of length n in which to record whether
+ *                   a Voronoi cell was found for each vector. Entries of pid
+ *                   and rpos for vectors that are not found are left
+ *                   unchanged.
+ * \return The number of vectors for which a Voronoi cell was found. */
+template<class vc_class>
+int container_base_3d::find_voronoi_cells(vc_class **vc,int n,const double *pos,uint64_t *pid,double *rpos,bool *found) {
+    int i,nfound=0,*bq=new int[n],*bs=new int[nxyz+1],*bl=new int[n],*img=new int[3*n];
+    double *qp=new double[3*n];
+
+    // Find the block that each vector is in, and count the number of vectors
+    // in each block
+    for(i=0;i<=nxyz;i++) bs[i]=0;
+    for(i=0;i<n;i++) {
+        int ai,aj,ak,ci,cj,ck;
+        double x=pos[3*i],y=pos[3*i+1],z=pos[3*i+2];
+        if(remap(ai,aj,ak,ci,cj,ck,x,y,z,bq[i])) bs[bq[i]+1]++;
+        else bq[i]=-1;
+    }
+    if(found!=NULL) for(i=0;i<n;i++) found[i]=false;
+
+    // Bucket the vectors by block with a counting sort. The remapped vectors
+    // and their periodic images are stored contiguously in bucket order, so
+    // that each bucket can be processed with sequential memory access.
+    for(i=0;i<nxyz;i++) bs[i+1]+=bs[i];
+    for(i=0;i<n;i++) if(bq[i]!=-1) {
+        int j=bs[bq[i]]++,ai=0,aj=0,ak=0,ci,cj,ck;
+        double *qpp=qp+3*j;
+        *qpp=pos[3*i];qpp[1]=pos[3*i+1];qpp[2]=pos[3*i+2];
+        remap(ai,aj,ak,ci,cj,ck,*qpp,qpp[1],qpp[2],bq[i]);
+        img[3*j]=ai;img[3*j+1]=aj;img[3*j+2]=ak;bl[j]=i;
+    }
+    for(i=nxyz;i>0;i--) bs[i]=bs[i-1];
+    *bs=0;
+
+    // Process the buckets in parallel
+#pragma omp parallel for num_threads(nt) schedule(dynamic) reduction(+:nfound)
+    for(int ijk=0;ijk<nxyz;ijk++) if(bs[ijk]<bs[ijk+1]) {
+        vc_class *vcp=vc[t_num()];
+        particle_record_3d w;
+        double mrs,*qpp;
+        int ci=ijk%nx,cj=(ijk/nx)%ny,ck=ijk/nxy,j,q;
+        w.ijk=-1;
+        for(j=bs[ijk];j<bs[ijk+1];j++) {
+            qpp=qp+3*j;
+            vcp->find_voronoi_cell(*qpp,qpp[1],qpp[2],ci,cj,ck,ijk,w,mrs,true);
+            if(w.ijk==-1) continue;
+
+            // Assemble the position vector of the particle, applying a
+            // periodic remapping if necessary
+            q=bl[j];
+            image_position(img[3*j],img[3*j+1],img[3*j+2],ci,cj,ck,w,rpos+3*q);
+            pid[q]=id[w.ijk][w.l];
+            if(found!=NULL) found[q]=true;
+            nfound++;
+        }
+    }
+    delete [] qp;
+    delete [] img;
+    delete [] bl;
+    delete [] bs;
+    delete [] bq;
+    return nfound;
+}
+
+/** Takes a batch of vectors and finds the particles whose Voronoi cells
+ * contain them, making use of multiple threads. Additional wall classes are
+ * not considered by this routine.
+ * \param[in] n the number of vectors.
+ * \param[in] pos an array of length 3*n holding the vectors to test.
+ * \param[out] pid an array of length n in which to store the particle IDs.
+ * \param[out] rpos an array of length 3*n in which to store the particle
+ *                  positions, which may lie in periodic images of the primary
+ *                  domain.
+ * \param[out] found an optional array of length n in which to record whether
+ *                   a Voronoi cell was found for each vector.
+ * \return The number of vectors for which a Voronoi cell was found. */
+int container_3d::find_voronoi_cells(int n,const double *pos,uint64_t *pid,double *rpos,bool *found) {
+    return container_base_3d::find_voronoi_cells(vc,n,pos,pid,rpos,found);
+}
+
+/** Takes a batch of vectors and finds the particles whose Voronoi cells
+ * contain them, making use of multiple threads. Additional wall classes are
+ * not considered by this routine.
+ * \param[in] n the number of vectors.
+ * \param[in] pos an array of length 3*n holding the vectors to test.
+ * \param[out] pid an array of length n in which to store the particle IDs.
+ * \param[out] rpos an array of length 3*n in which to store the particle
+ *                  positions, which may lie in periodic images of the primary
+ *                  domain.
+ * \param[out] found an optional array of length n in which to record whether
+ *                   a Voronoi cell was found for each vector.
+ * \return The number of vectors for which a Voronoi cell was found. */
+int container_poly_3d::find_voronoi_cells(int n,const double *pos,uint64_t *pid,double *rpos,bool *found) {
+    return container_base_3d::find_voronoi_cells(vc,n,pos,pid,rpos,found);
+}
+
+/** Finds the k particles that are closest to a given vector, using the
+ * Euclidean distance.
+ * \param[in] (x,y,z) the vector to test.
+ * \param[in] kn the number of particles to find.
+ * \param[out] pid a vector in which to store the particle IDs, in order of
+ *                 increasing distance.
+ * \param[out] rpos a vector in which to store the particle positions, which
+ *                  may lie in periodic images of the primary domain.
+ * \param[out] rsq a vector in which to store the squared distances.
+ * \return The number of particles found. */
+int container_3d::find_k_nearest(double x,double y,double z,int kn,std::vector<uint64_t> &pid,std::vector<double> &rpos,std::vector<double> &rsq) {
+    return particle_search_3d<container_base_3d>(*this).find_k_nearest(vc,x,y,z,kn,pid,rpos,rsq);
+}
+
+/** Finds the k particles that are closest to each vector in a batch, making
+ * use of multiple threads.
+ * \param[in] n the number of vectors.
+ * \param[in] pos an array of length 3*n holding the vectors to test.
+ * \param[in] kn the number of particles to find for each vector.
+ * \param[out] pid an array of length n*kn in which to store the particle IDs.
+ * \param[out] rpos an array of length 3*n*kn in which to store the particle
+ *                  positions.
+ * \param[out] rsq an array of length n*kn in which to store the squared
+ *                 distances, or NULL if this is not required.
+ * \param[out] cnt an array of length n in which to store the number of
+ *                 particles found for each vector. */
+void container_3d::find_k_nearest(int n,const double *pos,int kn,uint64_t *pid,double *rpos,double *rsq,int *cnt) {
+    particle_search_3d<container_base_3d>(*this).find_k_nearest(vc,n,pos,kn,pid,rpos,rsq,cnt);
+}
+
+/** Finds all of the particles within a given distance of a vector.
+ * \param[in] (x,y,z) the vector to test.
+ * \param[in] r the search radius.
+ * \param[out] pid a vector in which to store the particle IDs.
+ * \param[out] rpos a vector in which to store the particle positions, which
+ *                  may lie in periodic images of the primary domain.
+ * \param[out] rsq a vector in which to store the squared distances.
+ * \return The number of particles found. */
+int container_3d::find_within_radius(double x,double y,double z,double r,std::vector<uint64_t> &pid,std::vector<double> &rpos,std::vector<double> &rsq) {
+    return particle_search_3d<container_base_3d>(*this).find_within_radius(vc,x,y,z,r,pid,rpos,rsq);
+}
+
+/** Finds all of the particles within a given distance of each vector in a
+ * batch, making use of multiple threads, and stores the results in compressed
+ * sparse row format.
+ * \param[in] n the number of vectors.
+ * \param[in] pos an array of length 3*n holding the vectors to test.
+ * \param[in] r the search radius.
+ * \param[out] off a vector of length n+1 in which to store the offsets into
+ *                 the other vectors for each vector.
+ * \param[out] pid a vector in which to store the particle IDs.
+ * \param[out] rpos a vector in which to store the particle positions.
+ * \param[out] rsq a vector in which to store the squared distances. */
+void container_3d::find_within_radius(int n,const double *pos,double r,std::vector<uint64_t> &off,std::vector<uint64_t> &pid,std::vector<double> &rpos,std::vector<double> &rsq) {
+    particle_search_3d<container_base_3d>(*this).find_within_radius(vc,n,pos,r,off,pid,rpos,rsq);
+}
+
+/** Finds the k particles that are closest to a given vector, using the
+ * Euclidean distance.
+ * \param[in] (x,y,z) the vector to test.
+ * \param[in] kn the number of particles to find.
+ * \param[out] pid a vector in which to store the particle IDs, in order of
+ *                 increasing distance.
+ * \param[out] rpos a vector in which to store the particle positions, which
+ *                  may lie in periodic images of the primary domain.
+ * \param[out] rsq a vector in which to store the squared distances.
+ * \return The number of particles found. */
+int container_poly_3d::find_k_nearest(double x,double y,double z,int kn,std::vector<uint64_t> &pid,std::vector<double> &rpos,std::vector<double> &rsq) {
+    return particle_search_3d<container_base_3d>(*this).find_k_nearest(vc,x,y,z,kn,pid,rpos,rsq);
+}
+
+/** Finds the k particles that are closest to each vector in a batch, making
+ * use of multiple threads.
+ * \param[in] n the number of vectors.
+ * \param[in] pos an array of length 3*n holding the vectors to test.
+ * \param[in] kn the number of particles to find for each vector.
+ * \param[out] pid an array of length n*kn in which to store the particle IDs.
+ * \param[out] rpos an array of length 3*n*kn in which to store the particle
+ *                  positions.
+ * \param[out] rsq an array of length n*kn in which to store the squared
+ *                 distances, or NULL if this is not required.
+ * \param[out] cnt an array of length n in which to store the number of
+ *                 particles found for each vector. */
+void container_poly_3d::find_k_nearest(int n,const double *pos,int kn,uint64_t *pid,double *rpos,double *rsq,int *cnt) {
+    particle_search_3d<container_base_3d>(*this).find_k_nearest(vc,n,pos,kn,pid,rpos,rsq,cnt);
+}
+
+/** Finds all of the particles within a given distance of a vector.
+ * \param[in] (x,y,z) the vector to test.
+ * \param[in] r the search radius.
+ * \param[out] pid a vector in which to store the particle IDs.
+ * \param[out] rpos a vector in which to store the particle positions, which
+ *                  may lie in periodic images of the primary domain.
+ * \param[out] rsq a vector in which to store the squared distances.
+ * \return The number of particles found. */
+int container_poly_3d::find_within_radius(double x,double y,double z,double r,std::vector<uint64_t> &pid,std::vector<double> &rpos,std::vector<double> &rsq) {
+    return particle_search_3d<container_base_3d>(*this).find_within_radius(vc,x,y,z,r,pid,rpos,rsq);
+}
+
+/** Finds all of the particles within a given distance of each vector in a
+ * batch, making use of multiple threads, and stores the results in compressed
+ * sparse row format.
+ * \param[in] n the number of vectors.
+ * \param[in] pos an array of length 3*n holding the vectors to test.
+ * \param[in] r the search radius.
+ * \param[out] off a vector of length n+1 in which to store the offsets into
+ *                 the other vectors for each vector.
+ * \param[out] pid a vector in which to store the particle IDs.
+ * \param[out] rpos a vector in which to store the particle positions.
+ * \param[out] rsq a vector in which to store the squared distances. */
+void container_poly_3d::find_within_radius(int n,const double *pos,double r,std::vector<uint64_t> &off,std::vector<uint64_t> &pid,std::vector<double> &rpos,std::vector<double> &rsq) {
+    particle_search_3d<container_base_3d>(*this).find_within_radius(vc,n,pos,r,off,pid,rpos,rsq);
+}
+
+/** Computes the Voronoi cell for a ghost particle at a given location. The
+ * ghost particle is passed directly to the Voronoi computation rather than
+ * being inserted into the container, so the container is not modified and
+ * several threads can call this routine concurrently.
+ * \param[out] c a Voronoi cell class in which to store the computed cell.
+ * \param[in] (x,y,z) the location of the ghost particle.
+ * \return True if the cell was computed. If the cell cannot be computed, if it
+ * is removed entirely by a wall or boundary condition, then the routine
+ * returns false. */
+template<class v_cell>
+bool container_3d::compute_ghost_cell(v_cell &c,double x,double y,double z) {
+    int ijk;
+    if(!put_remap(ijk,x,y,z)) return false;
+    int k=ijk/nxy,ijkt=ijk-nxy*k,j=ijkt/nx,i=ijkt-j*nx;
+    const int tn=t_num();
+    return vc[tn]->compute_ghost_cell(c,ijk,i,j,k,x,y,z,0);
+}
+
+/** Computes the Voronoi cell for a ghost particle at a given location. The
+ * ghost particle is passed directly to the Voronoi computation rather than
+ * being inserted into the container, so the container is not modified and
+ * several threads can call this routine concurrently.
+ * \param[out] c a Voronoi cell class in which to store the computed cell.
+ * \param[in] (x,y,z) the location of the ghost particle.
+ * \param[in] r the radius of the ghost particle.
+ * \return True if the cell was computed. If the cell cannot be computed, if it
+ * is removed entirely by a wall or boundary condition, then the routine
+ * returns false. */
+template<class v_cell>
+bool container_poly_3d::compute_ghost_cell(v_cell &c,double x,double y,double z,double r) {
+    int ijk;
+    if(!put_remap(ijk,x,y,z)) return false;
+    int k=ijk/nxy,ijkt=ijk-nxy*k,j=ijkt/nx,i=ijkt-j*nx;
+    const int tn=t_num();
+    return vc[tn]->compute_ghost_cell(c,ijk,i,j,k,x,y,z,r);
+}
+
 /** Increase memory for a particular region.
  * \param[in] i the index of the region to reallocate.
  * \param[in] m a minimum size for the reallocated region. */
@@ -671,7 +944,78 @@ void container_poly_3d::clear() {
  *         outside. */
 bool container_base_3d::point_inside(double x,double y,double z) {
     if(x<ax||x>bx||y<ay||y>by||z<az||z>bz) return false;
-    return point_inside_walls(x,y,z);
+    if(!block_walls_active()) return point_inside_walls(x,y,z);
+
+    // Only test the walls for the block that the point is in, since the
+    // point must be inside all of the others
+    int i=int((x-ax)*xsp),j=int((y-ay)*ysp),k=int((z-az)*zsp);
+    if(i>=nx) i=nx-1;
+    if(j>=ny) j=ny-1;
+    if(k>=nz) k=nz-1;
+    int ijk=i+nx*(j+ny*k);
+    for(wall_3d **wp=bw.data()+bw_start[ijk],**we=bw.data()+bw_start[ijk+1];wp<we;wp++)
+        if(!((*wp)->point_inside(x,y,z))) return false;
+    return true;
+}
+
+/** Tests whether each of a batch of points lies within the container bounds
+ * and all of the walls. This gives the same results as calling point_inside
+ * for each point, but the walls are tested against the whole batch at once,
+ * which is faster when the walls are held in groups such as
+ * wall_plane_group.
+ * \param[in] n the number of points.
+ * \param[in] pos the point positions, as consecutive (x,y,z) triplets.
+ * \param[out] in an array of n flags, which are set to true for the points
+ *                 that are inside the container, and false otherwise. */
+void container_base_3d::points_inside(int n,const double *pos,bool *in) {
+    points_inside_walls(n,pos,in);
+    for(int i=0;i<n;i++,pos+=3)
+        if(*pos<ax||*pos>bx||pos[1]<ay||pos[1]>by||pos[2]<az||pos[2]>bz) in[i]=false;
+}
+
+/** Sets up lists of the walls that need to be applied to the Voronoi cells in
+ * each block, so that walls that are far from a block are skipped. A wall is
+ * skipped for a block if the block, enlarged by a margin on each side, lies
+ * entirely inside the wall. Cells that extend further than the margin from
+ * their particle have the skipped walls applied after they are computed, so
+ * the results are the same as when every wall is applied. The lists must be
+ * set up again if the walls are changed. They are ignored if walls are added
+ * afterwards.
+ * \param[in] margin the margin to add around each block, which should be
+ *                   larger than the typical distance from a particle to its
+ *                   furthest Voronoi cell vertex. If this is zero or
+ *                   negative, twice the largest block dimension is used. */
+void container_base_3d::setup_block_walls(double margin) {
+    if(margin<=0) {
+        margin=boxx>boxy?boxx:boxy;
+        if(boxz>margin) margin=boxz;
+        margin*=2;
+    }
+    bw_margin=margin;
+    bw.clear();
+    bw_start.resize(nxyz+1);
+
+    // Find the walls that can cut cells in each block. In the non-periodic
+    // directions, the cells cannot extend beyond the container.
+    double xlo,xhi,ylo,yhi,zlo,zhi;
+    int i,j,k,ijk=0;
+    for(k=0;k<nz;k++) {
+        zlo=az+k*boxz-margin;zhi=az+(k+1)*boxz+margin;
+        if(!z_prd) {if(zlo<az) zlo=az;if(zhi>bz) zhi=bz;}
+        for(j=0;j<ny;j++) {
+            ylo=ay+j*boxy-margin;yhi=ay+(j+1)*boxy+margin;
+            if(!y_prd) {if(ylo<ay) ylo=ay;if(yhi>by) yhi=by;}
+            for(i=0;i<nx;i++,ijk++) {
+                xlo=ax+i*boxx-margin;xhi=ax+(i+1)*boxx+margin;
+                if(!x_prd) {if(xlo<ax) xlo=ax;if(xhi>bx) xhi=bx;}
+                bw_start[ijk]=bw.size();
+                for(wall_3d **wp=walls;wp<wep;wp++)
+                    if(!((*wp)->box_inside(xlo,xhi,ylo,yhi,zlo,zhi))) bw.push_back(*wp);
+            }
+        }
+    }
+    bw_start[nxyz]=bw.size();
+    bw_nwalls=int(wep-walls);
 }
 
 /** Draws an outline of the domain in Gnuplot format.
@@ -759,6 +1103,15 @@ void container_3d::draw_cells_pov(FILE *fp) {
     }
 }
 
+/** Computes all Voronoi cells in parallel and saves the output in the VTK
+ * unstructured grid format, using the vtu_writer_3d class.
+ * \param[in] filename the name of the file to write to.
+ * \param[in] compress whether to compress the data with zlib. */
+void container_3d::draw_cells_vtu(const char *filename,bool compress) {
+    vtu_writer_3d vw(compress);
+    vw.write(*this,filename);
+}
+
 /** Computes the Voronoi cells and saves customized information about
  * them.
  * \param[in] vl the loop class to use.
@@ -803,6 +1156,38 @@ double container_3d::sum_cell_volumes() {
     return vol;
 }
 
+/** Computes all of the Voronoi cells in parallel and accumulates aggregate
+ * statistics about them, using the cell_reduction_3d class.
+ * \param[in,out] cr the class holding the requested reductions, in which to
+ *                   store the results. */
+void container_3d::reduce_cells(cell_reduction_3d &cr) {
+    cr.compute(*this);
+}
+
+/** Computes a stratified random sample of the Voronoi cells in parallel, and
+ * estimates statistics of the tessellation from it, using the
+ * cell_estimate_3d class.
+ * \param[in,out] ce the class holding the sampling parameters, in which to
+ *                   store the estimates. */
+void container_3d::estimate_cells(cell_estimate_3d &ce) {
+    ce.compute(*this);
+}
+
+/** Returns the total number of plane cuts that have been applied by the
+ * Voronoi computation objects of all threads, which can be used to measure
+ * the cost of the cell computations.
+ * \return The number of plane cuts. */
+uint64_t container_3d::plane_count() {
+    uint64_t n=0;
+    for(int l=0;l<nt;l++) n+=vc[l]->nplane_calls;
+    return n;
+}
+
+/** Resets the count of plane cuts to zero. */
+void container_3d::reset_plane_count() {
+    for(int l=0;l<nt;l++) vc[l]->nplane_calls=0;
+}
+
 /** Dumps particle IDs and positions to a file.
  * \param[in] fp a file handle to write to. */
 void container_poly_3d::draw_particles(FILE *fp) {
@@ -846,6 +1231,15 @@ void container_poly_3d::draw_cells_pov(FILE *fp) {
     }
 }
 
+/** Computes all Voronoi cells in parallel and saves the output in the VTK
+ * unstructured grid format, using the vtu_writer_3d class.
+ * \param[in] filename the name of the file to write to.
+ * \param[in] compress whether to compress the data with zlib. */
+void container_poly_3d::draw_cells_vtu(const char *filename,bool compress) {
+    vtu_writer_3d vw(compress);
+    vw.write(*this,filename);
+}
+
 /** Computes the Voronoi cells and saves customized information about
  * them.
  * \param[in] vl the loop class to use.
@@ -890,4 +1284,42 @@ double container_poly_3d::sum_cell_volumes() {
     return vol;
 }
 
+/** Computes all of the Voronoi cells in parallel and accumulates aggregate
+ * statistics about them, using the cell_reduction_3d class.
+ * \param[in,out] cr the class holding the requested reductions, in which to
+ *                   store the results. */
+void container_poly_3d::reduce_cells(cell_reduction_3d &cr) {
+    cr.compute(*this);
+}
+
+/** Computes a stratified random sample of the Voronoi cells in parallel, and
+ * estimates statistics of the tessellation from it, using the
+ * cell_estimate_3d class.
+ * \param[in,out] ce the class holding the sampling parameters, in which to
+ *                   store the estimates. */
+void container_poly_3d::estimate_cells(cell_estimate_3d &ce) {
+    ce.compute(*this);
+}
+
+/** Returns the total number of plane cuts that have been applied by the
+ * Voronoi computation objects of all threads, which can be used to measure
+ * the cost of the cell computations.
+ * \return The number of plane cuts. */
+uint64_t container_poly_3d::plane_count() {
+    uint64_t n=0;
+    for(int l=0;l<nt;l++) n+=vc[l]->nplane_calls;
+    return n;
+}
+
+/** Resets the count of plane cuts to zero. */
+void container_poly_3d::reset_plane_count() {
+    for(int l=0;l<nt;l++) vc[l]->nplane_calls=0;
+}
+
+// Explicit template instantiation
+template bool container_3d::compute_ghost_cell(voronoicell_3d&,double,double,double);
+template bool container_3d::compute_ghost_cell(voronoicell_neighbor_3d&,double,double,double);
+template bool container_poly_3d::compute_ghost_cell(voronoicell_3d&,double,double,double,double);
+template bool container_poly_3d::compute_ghost_cell(voronoicell_neighbor_3d&,double,double,double,double);
+
 }
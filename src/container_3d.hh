@@ -8,6 +8,7 @@
 #define VOROPP_CONTAINER_3D_HH
 
 #include <cstdio>
+#include <cmath>
 #include <vector>
 
 #include "config.hh"
@@ -22,6 +23,9 @@
 namespace voro {
 
 class subset_info_3d;
+class cell_reduction_3d;
+class cell_estimate_3d;
+template<class c_class> class particle_search_3d;
 
 /** \brief Class for representing a particle system in a three-dimensional
  * rectangular box.
@@ -86,10 +90,27 @@ class container_base_3d : public voro_base_3d, public wall_list_3d {
         const int ps;
         container_base_3d(double ax_,double bx_,double ay_,double by_,double az_,double bz_,
                 int nx_,int ny_,int nz_,bool x_prd_,bool y_prd_,bool z_prd_,
-                int init_mem,int ps_,int nt_);
+                int init_mem,int ps_,int nt_,int hgrid_);
         ~container_base_3d();
         bool point_inside(double x,double y,double z);
+        void points_inside(int n,const double *pos,bool *in);
         void region_count();
+        /** Returns the maximum number of threads that can be used for
+         * computation.
+         * \return The number of threads. */
+        inline int number_thread() {return nt;}
+        void setup_block_walls(double margin=0);
+        /** Discards the per-block wall lists, so that every wall is applied
+         * to every cell. */
+        inline void clear_block_walls() {
+            bw_nwalls=-1;
+            std::vector<wall_3d*>().swap(bw);
+            std::vector<int>().swap(bw_start);
+        }
+        /** Returns whether the per-block wall lists are in use. The lists are
+         * ignored if walls have been added since they were set up.
+         * \return True if they are in use, false otherwise. */
+        inline bool block_walls_active() {return bw_nwalls==int(wep-walls);}
         /** Initializes the Voronoi cell prior to a compute_cell operation for
          * a specific particle being carried out by a voro_compute class. The
          * cell is initialized to fill the entire container. For non-periodic
@@ -112,16 +133,73 @@ class container_base_3d : public voro_base_3d, public wall_list_3d {
         template<class v_cell>
         inline bool initialize_voronoicell(v_cell &c,int ijk,int q,int ci,int cj,int ck,
                 int &i,int &j,int &k,double &x,double &y,double &z,int &disp) {
-            double x1,x2,y1,y2,z1,z2,*pp=p[ijk]+ps*q;
+            double *pp=p[ijk]+ps*q;
             x=*(pp++);y=*(pp++);z=*pp;
+            return initialize_ghost_voronoicell(c,ijk,ci,cj,ck,i,j,k,x,y,z,disp);
+        }
+        /** Initializes a Voronoi cell prior to a compute_ghost_cell
+         * operation, for a ghost particle at a given position that is not
+         * stored in the container.
+         * \param[in,out] c a reference to a voronoicell_3d object.
+         * \param[in] ijk the block that the ghost particle is within.
+         * \param[in] (ci,cj,ck) the coordinates of the block in the container
+         *                       coordinate system.
+         * \param[out] (i,j,k) the coordinates of the test block relative to
+         *                     the voro_compute coordinate system.
+         * \param[in] (x,y,z) the position of the ghost particle.
+         * \param[out] disp a block displacement used internally by the
+         *                  compute_cell routine.
+         * \return False if the plane cuts applied by walls completely removed
+         * the cell, true otherwise. */
+        template<class v_cell>
+        inline bool initialize_ghost_voronoicell(v_cell &c,int ijk,int ci,int cj,int ck,
+                int &i,int &j,int &k,double x,double y,double z,int &disp) {
+            double x1,x2,y1,y2,z1,z2;
             if(x_prd) {x1=-(x2=0.5*(bx-ax));i=nx;} else {x1=ax-x;x2=bx-x;i=ci;}
             if(y_prd) {y1=-(y2=0.5*(by-ay));j=ny;} else {y1=ay-y;y2=by-y;j=cj;}
             if(z_prd) {z1=-(z2=0.5*(bz-az));k=nz;} else {z1=az-z;z2=bz-z;k=ck;}
             c.init(x1,x2,y1,y2,z1,z2);
-            if(!apply_walls(c,x,y,z)) return false;
+            if(block_walls_active()) {
+                for(wall_3d **wp=bw.data()+bw_start[ijk],**we=bw.data()+bw_start[ijk+1];wp<we;wp++)
+                    if(!(*wp)->apply_last()&&!((*wp)->cut_cell(c,x,y,z))) return false;
+            } else if(!apply_walls_first(c,x,y,z)) return false;
             disp=ijk-i-nx*(j+ny*k);
             return true;
         }
+        /** Completes a Voronoi cell after a compute_cell operation. If the
+         * per-block wall lists are in use and the cell extends further than
+         * the margin that was used to set them up, then the walls that were
+         * skipped for the block are applied first. Since the order of these
+         * plane cuts does not affect the cell, this gives the same result as
+         * applying them during initialization. Any walls that are applied
+         * last are then applied. These choose their cuts based on the extent
+         * of the cell, so they must see the cell after all of the other
+         * walls.
+         * \param[in,out] c a reference to a voronoicell_3d object.
+         * \param[in] ijk the block that the particle is within.
+         * \param[in] (x,y,z) the position of the particle.
+         * \return False if the plane cuts applied by walls completely removed
+         * the cell, true otherwise. */
+        template<class v_cell>
+        inline bool finalize_voronoicell(v_cell &c,int ijk,double x,double y,double z) {
+            if(block_walls_active()&&bw_start[ijk+1]-bw_start[ijk]!=bw_nwalls
+             &&0.25*c.max_radius_squared()>bw_margin*bw_margin) {
+                wall_3d **np=bw.data()+bw_start[ijk],**ne=bw.data()+bw_start[ijk+1];
+                for(wall_3d **wp=walls;wp<wep;wp++) {
+                    if(np<ne&&*np==*wp) np++;
+                    else if(!(*wp)->apply_last()&&!((*wp)->cut_cell(c,x,y,z))) return false;
+                }
+            }
+            return apply_walls_last(c,x,y,z);
+        }
+        /** Replaces a displacement vector by the displacement to the nearest
+         * periodic image, in each of the periodic directions.
+         * \param[in,out] (x,y,z) the displacement vector. */
+        inline void nearest_image(double &x,double &y,double &z) {
+            if(x_prd) x-=(bx-ax)*nearbyint(x/(bx-ax));
+            if(y_prd) y-=(by-ay)*nearbyint(y/(by-ay));
+            if(z_prd) z-=(bz-az)*nearbyint(z/(bz-az));
+        }
         /** Initializes parameters for a find_voronoi_cell call within the
          * voro_compute template.
          * \param[in] (ci,cj,ck) the coordinates of the test block in the
@@ -218,6 +296,7 @@ class container_base_3d : public voro_base_3d, public wall_list_3d {
         iterator_subset begin(subset_info_3d& si);
         iterator_subset end(subset_info_3d& si);
         friend class iterator_order;
+        friend class particle_search_3d<container_base_3d>;
         class iterator_order;
         iterator_order begin(particle_order &vo);
         iterator_order end(particle_order &vo);
@@ -227,6 +306,25 @@ class container_base_3d : public voro_base_3d, public wall_list_3d {
         bool put_locate_block(int &ijk,double &x,double &y,double &z);
         inline bool put_remap(int &ijk,double &x,double &y,double &z);
         inline bool remap(int &ai,int &aj,int &ak,int &ci,int &cj,int &ck,double &x,double &y,double &z,int &ijk);
+        template<class vc_class>
+        int find_voronoi_cells(vc_class **vc,int n,const double *pos,uint64_t *pid,double *rpos,bool *found);
+        /** Computes the position of a particle found by a search, applying
+         * the periodic image shifts of the search vector and of the block that
+         * the particle was found in.
+         * \param[in] (ai,aj,ak) the periodic image of the search vector.
+         * \param[in] (ci,cj,ck) the block that the search vector is in.
+         * \param[in] w the particle record from the search.
+         * \param[out] rp an array of length three in which to store the
+         *                particle position. */
+        inline void image_position(int ai,int aj,int ak,int ci,int cj,int ck,const particle_record_3d &w,double *rp) {
+            if(x_prd) {ci+=w.di;if(ci<0||ci>=nx) ai+=step_div(ci,nx);}
+            if(y_prd) {cj+=w.dj;if(cj<0||cj>=ny) aj+=step_div(cj,ny);}
+            if(z_prd) {ck+=w.dk;if(ck<0||ck>=nz) ak+=step_div(ck,nz);}
+            double *pp=p[w.ijk]+ps*w.l;
+            *rp=*pp+ai*(bx-ax);
+            rp[1]=pp[1]+aj*(by-ay);
+            rp[2]=pp[2]+ak*(bz-az);
+        }
         /** The maximum number of threads that can be used for computation. */
         int nt;
         /** The number of particles in the overflow buffer. */
@@ -239,6 +337,18 @@ class container_base_3d : public voro_base_3d, public wall_list_3d {
         int *ijk_m_id_oflow;
         /** An array of particle positions in the overflow buffer. */
         double *p_oflow;
+        /** The margin around each block that was used to set up the
+         * per-block wall lists. */
+        double bw_margin;
+        /** The number of walls when the per-block wall lists were set up, or
+         * -1 if they have not been set up. */
+        int bw_nwalls;
+        /** The walls that can cut the cells in each block, stored
+         * consecutively in the order that they appear in the wall list. */
+        std::vector<wall_3d*> bw;
+        /** The index in bw of the first wall for each block, plus a final
+         * entry holding the total number of entries. */
+        std::vector<int> bw_start;
 };
 
 /** \brief Extension of the container_base_3d class for computing regular
@@ -250,7 +360,7 @@ class container_base_3d : public voro_base_3d, public wall_list_3d {
 class container_3d : public container_base_3d, public radius_mono {
     public:
         container_3d(double ax_,double bx_,double ay_,double by_,double az_,double bz_,
-                  int nx_,int ny_,int nz_,bool x_prd_,bool y_prd_,bool z_prd_,int init_mem,int nt_=1);
+                  int nx_,int ny_,int nz_,bool x_prd_,bool y_prd_,bool z_prd_,int init_mem,int nt_=1,int hgrid_=wl_hgrid_3d);
         ~container_3d();
         void change_number_thread(int nt_);
         void clear();
@@ -287,6 +397,10 @@ class container_3d : public container_base_3d, public radius_mono {
         }
         void compute_all_cells();
         double sum_cell_volumes();
+        void reduce_cells(cell_reduction_3d &cr);
+        void estimate_cells(cell_estimate_3d &ce);
+        uint64_t plane_count();
+        void reset_plane_count();
         void draw_particles(FILE *fp=stdout);
         /** Dumps all of the particle IDs and positions to a file.
          * \param[in] filename the name of the file to write to. */
@@ -319,6 +433,7 @@ class container_3d : public container_base_3d, public radius_mono {
             draw_cells_pov(fp);
             fclose(fp);
         }
+        void draw_cells_vtu(const char *filename,bool compress=false);
         void print_custom(const char *format,FILE *fp=stdout);
         /** Computes all the Voronoi cells and saves customized information about them.
          * \param[in] format the custom output string to use.
@@ -329,6 +444,11 @@ class container_3d : public container_base_3d, public radius_mono {
             fclose(fp);
         }
         bool find_voronoi_cell(double x,double y,double z,double &rx,double &ry,double &rz,uint64_t &pid);
+        int find_voronoi_cells(int n,const double *pos,uint64_t *pid,double *rpos,bool *found=NULL);
+        int find_k_nearest(double x,double y,double z,int kn,std::vector<uint64_t> &pid,std::vector<double> &rpos,std::vector<double> &rsq);
+        void find_k_nearest(int n,const double *pos,int kn,uint64_t *pid,double *rpos,double *rsq,int *cnt);
+        int find_within_radius(double x,double y,double z,double r,std::vector<uint64_t> &pid,std::vector<double> &rpos,std::vector<double> &rsq);
+        void find_within_radius(int n,const double *pos,double r,std::vector<uint64_t> &off,std::vector<uint64_t> &pid,std::vector<double> &rpos,std::vector<double> &rsq);
         /** Computes the Voronoi cell for given particle.
          * \param[out] c a Voronoi cell class in which to store the computed
          *               cell.
@@ -343,6 +463,28 @@ class container_3d : public container_base_3d, public radius_mono {
             const int tn=t_num();
             return vc[tn]->compute_cell(c,ijk,q,i,j,k);
         }
+        /** Computes the Voronoi cell for given particle, warm starting the
+         * computation from the neighbors of the particle at a previous time
+         * step, which can considerably reduce the number of plane cuts when
+         * the particles have only moved a small amount.
+         * \param[out] c a Voronoi cell class in which to store the computed
+         *               cell.
+         * \param[in] ijk the block that the particle is within.
+         * \param[in] q the index of the particle within the block.
+         * \param[in] nb the IDs of the previous neighbors, as returned by
+         *               the voronoicell_neighbor_3d::neighbors() routine.
+         * \param[in] pi an index for finding the particles in the container
+         *               from their IDs, which must be built after the
+         *               particles have been added.
+         * \return True if the cell was computed. If the cell cannot be
+         * computed, if it is removed entirely by a wall or boundary condition,
+         * then the routine returns false. */
+        template<class v_cell>
+        inline bool compute_cell(v_cell &c,int ijk,int q,const std::vector<int> &nb,particle_index_3d &pi) {
+            int k=ijk/nxy,ijkt=ijk-nxy*k,j=ijkt/nx,i=ijkt-j*nx;
+            const int tn=t_num();
+            return vc[tn]->compute_cell_warm(c,ijk,q,i,j,k,nb.data(),nb.size(),pi);
+        }
         /** Computes the Voronoi cell for a particle currently being referenced
          * by an iterator.
          * \param[out] c a Voronoi cell class in which to store the computed
@@ -355,25 +497,8 @@ class container_3d : public container_base_3d, public radius_mono {
         inline bool compute_cell(v_cell &c,c_iter_3d &cli) {
             return compute_cell(c,cli->ijk,cli->q);
         }
-        /** Computes the Voronoi cell for a ghost particle at a given location.
-         * \param[out] c a Voronoi cell class in which to store the
-         *               computed cell.
-         * \param[in] (x,y,z) the location of the ghost particle.
-         * \return True if the cell was computed. If the cell cannot be
-         * computed, if it is removed entirely by a wall or boundary condition,
-         * then the routine returns false. */
         template<class v_cell>
-        inline bool compute_ghost_cell(v_cell &c,double x,double y,double z) {
-            int ijk;
-            if(put_locate_block(ijk,x,y,z)) {
-                double *pp=p[ijk]+3*co[ijk]++;
-                *(pp++)=x;*(pp++)=y;*pp=z;
-                bool q=compute_cell(c,ijk,co[ijk]-1);
-                co[ijk]--;
-                return q;
-            }
-            return false;
-        }
+        bool compute_ghost_cell(v_cell &c,double x,double y,double z);
     private:
         /** An array of pointers to Voronoi computation objects for use by the
          * different threads. */
@@ -390,7 +515,7 @@ class container_3d : public container_base_3d, public radius_mono {
 class container_poly_3d : public container_base_3d, public radius_poly_3d {
     public:
         container_poly_3d(double ax_,double bx_,double ay_,double by_,double az_,double bz_,
-                          int nx_,int ny_,int nz_,bool x_prd_,bool y_prd_,bool z_prd_,int init_mem,int nt_=1);
+                          int nx_,int ny_,int nz_,bool x_prd_,bool y_prd_,bool z_prd_,int init_mem,int nt_=1,int hgrid_=wl_hgrid_3d);
         ~container_poly_3d();
         void change_number_thread(int nt_);
         void clear();
@@ -428,6 +553,10 @@ class container_poly_3d : public container_base_3d, public radius_poly_3d {
         }
         void compute_all_cells();
         double sum_cell_volumes();
+        void reduce_cells(cell_reduction_3d &cr);
+        void estimate_cells(cell_estimate_3d &ce);
+        uint64_t plane_count();
+        void reset_plane_count();
         void draw_particles(FILE *fp=stdout);
         /** Dumps all of the particle IDs, positions and radii to a file.
          * \param[in] filename the name of the file to write to. */
@@ -460,6 +589,7 @@ class container_poly_3d : public container_base_3d, public radius_poly_3d {
             draw_cells_pov(fp);
             fclose(fp);
         }
+        void draw_cells_vtu(const char *filename,bool compress=false);
         void print_custom(const char *format,FILE *fp=stdout);
         /** Computes the Voronoi cells and saves customized information about
          * them.
@@ -483,6 +613,28 @@ class container_poly_3d : public container_base_3d, public radius_poly_3d {
             const int tn=t_num();
             return vc[tn]->compute_cell(c,ijk,q,i,j,k);
         }
+        /** Computes the Voronoi cell for given particle, warm starting the
+         * computation from the neighbors of the particle at a previous time
+         * step, which can considerably reduce the number of plane cuts when
+         * the particles have only moved a small amount.
+         * \param[out] c a Voronoi cell class in which to store the computed
+         *               cell.
+         * \param[in] ijk the block that the particle is within.
+         * \param[in] q the index of the particle within the block.
+         * \param[in] nb the IDs of the previous neighbors, as returned by
+         *               the voronoicell_neighbor_3d::neighbors() routine.
+         * \param[in] pi an index for finding the particles in the container
+         *               from their IDs, which must be built after the
+         *               particles have been added.
+         * \return True if the cell was computed. If the cell cannot be
+         * computed, if it is removed entirely by a wall or boundary condition,
+         * then the routine returns false. */
+        template<class v_cell>
+        inline bool compute_cell(v_cell &c,int ijk,int q,const std::vector<int> &nb,particle_index_3d &pi) {
+            int k=ijk/nxy,ijkt=ijk-nxy*k,j=ijkt/nx,i=ijkt-j*nx;
+            const int tn=t_num();
+            return vc[tn]->compute_cell_warm(c,ijk,q,i,j,k,nb.data(),nb.size(),pi);
+        }
         /** Computes the Voronoi cell for a particle currently being referenced
          * by an iterator.
          * \param[out] c a Voronoi cell class in which to store the computed
@@ -495,28 +647,14 @@ class container_poly_3d : public container_base_3d, public radius_poly_3d {
         inline bool compute_cell(v_cell &c,c_iter_3d &cli) {
             return compute_cell(c,cli->ijk,cli->q);
         }
-        /** Computes the Voronoi cell for a ghost particle at a given location.
-         * \param[out] c a Voronoi cell class in which to store the
-         *               computed cell.
-         * \param[in] (x,y,z) the location of the ghost particle.
-         * \param[in] r the radius of the ghost particle.
-         * \return True if the cell was computed. If the cell cannot be
-         * computed, if it is removed entirely by a wall or boundary condition,
-         * then the routine returns false. */
         template<class v_cell>
-        inline bool compute_ghost_cell(v_cell &c,double x,double y,double z,double r) {
-            int ijk;
-            if(put_locate_block(ijk,x,y,z)) {
-                double *pp=p[ijk]+4*co[ijk]++,tm=max_radius;
-                *(pp++)=x;*(pp++)=y;*(pp++)=z;*pp=r;
-                if(r>max_radius) max_radius=r;
-                bool q=compute_cell(c,ijk,co[ijk]-1);
-                co[ijk]--;max_radius=tm;
-                return q;
-            }
-            return false;
-        }
+        bool compute_ghost_cell(v_cell &c,double x,double y,double z,double r);
         bool find_voronoi_cell(double x,double y,double z,double &rx,double &ry,double &rz,uint64_t &pid);
+        int find_voronoi_cells(int n,const double *pos,uint64_t *pid,double *rpos,bool *found=NULL);
+        int find_k_nearest(double x,double y,double z,int kn,std::vector<uint64_t> &pid,std::vector<double> &rpos,std::vector<double> &rsq);
+        void find_k_nearest(int n,const double *pos,int kn,uint64_t *pid,double *rpos,double *rsq,int *cnt);
+        int find_within_radius(double x,double y,double z,double r,std::vector<uint64_t> &pid,std::vector<double> &rpos,std::vector<double> &rsq);
+        void find_within_radius(int n,const double *pos,double r,std::vector<uint64_t> &off,std::vector<uint64_t> &pid,std::vector<double> &rpos,std::vector<double> &rsq);
     private:
         /** An array of pointers to Voronoi computation objects for use by the
          * different threads. */
@@ -0,0 +1,787 @@
+// Voro++, a cell-based Voronoi library
+// By Chris H. Rycroft and the Rycroft Group
+
+/** \file container_quad_2d.cc
+ * \brief Function implementations for the quadtree_2d class and the adaptive
+ * 2D container classes. */
+
+#include <cmath>
+
+#include "container_quad_2d.hh"
+
+namespace voro {
+
+/** The initial memory allocation for the list of adjacent leaves of a leaf. */
+static const int init_quad_neighbors=8;
+
+/** The maximum memory allocation for the list of adjacent leaves of a leaf. */
+static const int max_quad_neighbors=16777216;
+
+/** The maximum depth below the root to which the tree is divided into
+ * independent subtrees for multithreaded construction. */
+static const int quad_parallel_depth=6;
+
+/** \brief A class for marching along the leaves on one edge of a quadtree
+ * node.
+ *
+ * This class steps through the leaves that are on one edge of a node of the
+ * quadtree, in order. The template parameter sets the edge: 0 for the east
+ * edge, 1 for the west edge, 2 for the north edge, and 3 for the south edge.
+ * The east and west edges are traversed from north to south, and the north
+ * and south edges from west to east. The positions along the edge are
+ * measured as integers, with the full edge having length ma. */
+template<int ca>
+class quad_march {
+    public:
+        /** The length of the full edge. */
+        const int ma;
+        /** The start of the current leaf along the edge, which is set to a
+         * value larger than ma once the march is complete. */
+        int s;
+        /** The end of the current leaf along the edge. */
+        int ns;
+        /** The depth of the current leaf relative to the starting node. */
+        int p;
+        /** The nodes from the starting node down to the current leaf. */
+        quadtree_2d* list[max_quad_depth+1];
+        quad_march(quadtree_2d *q);
+        void step();
+        /** Returns the current leaf.
+         * \return A pointer to the leaf. */
+        inline quadtree_2d* cu() {
+            return list[p];
+        }
+    private:
+        /** Returns the first child of a node along the edge.
+         * \param[in] q a pointer to the node.
+         * \return A pointer to the child. */
+        inline quadtree_2d* up(quadtree_2d* q) {
+            return ca<2?(ca==0?q->qne:q->qnw):(ca==2?q->qnw:q->qsw);
+        }
+        /** Returns the second child of a node along the edge.
+         * \param[in] q a pointer to the node.
+         * \return A pointer to the child. */
+        inline quadtree_2d* down(quadtree_2d* q) {
+            return ca<2?(ca==0?q->qse:q->qsw):(ca==2?q->qne:q->qse);
+        }
+};
+
+/** Initializes the march at the first leaf along the edge of a node.
+ * \param[in] q a pointer to the node. */
+template<int ca>
+quad_march<ca>::quad_march(quadtree_2d *q) : ma(1<<30), s(0), p(0) {
+    list[p]=q;
+    while(list[p]->id==NULL) {list[p+1]=up(list[p]);p++;}
+    ns=ma>>p;
+}
+
+/** Moves to the next leaf along the edge. */
+template<int ca>
+void quad_march<ca>::step() {
+    if(ns>=ma) {s=ma+1;return;}
+    while(down(list[p-1])==list[p]) p--;
+    list[p]=down(list[p-1]);
+    while(list[p]->id==NULL) {list[p+1]=up(list[p]);p++;}
+    s=ns;ns+=ma>>p;
+}
+
+/** Constructs a quadtree node as an empty leaf.
+ * \param[in] (cx_,cy_) the center of the node.
+ * \param[in] (lx_,ly_) half of the width of the node in each direction.
+ * \param[in] depth_ the depth of the node in the tree.
+ * \param[in] ps_ the number of floating point entries to store for each
+ *                particle. */
+quadtree_2d::quadtree_2d(double cx_,double cy_,double lx_,double ly_,int depth_,int ps_) :
+    cx(cx_), cy(cy_), lx(lx_), ly(ly_), depth(depth_), ps(ps_),
+    id(new int[quad_leaf_size]), p(new double[ps*quad_leaf_size]), co(0),
+    nco(0), li(-1), mem(quad_leaf_size), nmax(0) {}
+
+/** The quadtree node destructor frees the dynamically allocated memory,
+ * including the memory for any children. */
+quadtree_2d::~quadtree_2d() {
+    if(id==NULL) {
+        delete qne;delete qnw;
+        delete qse;delete qsw;
+    } else {
+        delete [] p;
+        delete [] id;
+    }
+    if(nmax>0) delete [] nei;
+}
+
+/** Splits a leaf into four children, and moves its particles into them. */
+void quadtree_2d::split() {
+    double hx=0.5*lx,hy=0.5*ly;
+    int d=depth+1;
+    qsw=new quadtree_2d(cx-hx,cy-hy,hx,hy,d,ps);
+    qse=new quadtree_2d(cx+hx,cy-hy,hx,hy,d,ps);
+    qnw=new quadtree_2d(cx-hx,cy+hy,hx,hy,d,ps);
+    qne=new quadtree_2d(cx+hx,cy+hy,hx,hy,d,ps);
+    for(int i=0;i<co;i++) {
+        double *pp=p+ps*i;
+        child(*pp,pp[1])->quick_put(id[i],pp);
+    }
+    delete [] id;id=NULL;
+    delete [] p;p=NULL;
+    co=0;
+}
+
+/** Adds a particle to the subtree below this node, splitting the leaf that it
+ * is within if that leaf is full.
+ * \param[in] i the ID of the particle.
+ * \param[in] pp a pointer to the ps entries of the particle. */
+void quadtree_2d::put(int i,const double *pp) {
+    quadtree_2d *q=this;
+    while(true) {
+        if(q->id==NULL) q=q->child(*pp,pp[1]);
+        else if(q->co>=quad_leaf_size&&q->depth<max_quad_depth) q->split();
+        else {
+            q->quick_put(i,pp);
+            return;
+        }
+    }
+}
+
+/** Doubles the particle memory of a leaf. If the allocation exceeds the
+ * absolute maximum set in max_particle_memory, then the routine causes a fatal
+ * error. */
+void quadtree_2d::add_particle_memory() {
+    mem<<=1;
+    if(mem>max_particle_memory)
+        voro_fatal_error("Absolute maximum particle memory allocation exceeded",VOROPP_MEMORY_ERROR);
+#if VOROPP_VERBOSE >=3
+    fprintf(stderr,"Particle memory in quadtree leaf scaled up to %d\n",mem);
+#endif
+    int *idp=new int[mem];
+    for(int i=0;i<co;i++) idp[i]=id[i];
+    double *pp=new double[ps*mem];
+    for(int i=0;i<ps*co;i++) pp[i]=p[i];
+    delete [] id;id=idp;
+    delete [] p;p=pp;
+}
+
+/** Increases the memory for the list of adjacent leaves. If the allocation
+ * exceeds the absolute maximum set in max_quad_neighbors, then the routine
+ * causes a fatal error. */
+void quadtree_2d::add_neighbor_memory() {
+    if(nmax==0) {
+        nmax=init_quad_neighbors;
+        nei=new quadtree_2d*[nmax];
+        return;
+    }
+    nmax<<=1;
+    if(nmax>max_quad_neighbors)
+        voro_fatal_error("Maximum quadtree neighbor memory exceeded",VOROPP_MEMORY_ERROR);
+    quadtree_2d **pp=new quadtree_2d*[nmax];
+    for(int i=0;i<nco;i++) pp[i]=nei[i];
+    delete [] nei;
+    nei=pp;
+}
+
+/** Sets up the lists of adjacent leaves for all of the leaves below this
+ * node, considering only adjacencies within the subtree. */
+void quadtree_2d::setup_neighbors() {
+    if(id==NULL) {
+        qsw->setup_neighbors();
+        qse->setup_neighbors();
+        qnw->setup_neighbors();
+        qne->setup_neighbors();
+        link_children();
+    }
+}
+
+/** Adds the adjacencies between leaves that lie on either side of the two
+ * lines that divide this node into its children. */
+void quadtree_2d::link_children() {
+    we_neighbors(qsw,qse);
+    we_neighbors(qnw,qne);
+    ns_neighbors(qsw,qnw);
+    ns_neighbors(qse,qne);
+}
+
+/** Adds the adjacencies between the leaves on either side of the boundary
+ * between two nodes that are side by side, by marching along both sides of the
+ * boundary at once.
+ * \param[in] (qw,qe) pointers to the western and eastern nodes. */
+void quadtree_2d::we_neighbors(quadtree_2d *qw,quadtree_2d *qe) {
+    const int ma=1<<30;
+    quad_march<0> mw(qw);
+    quad_march<1> me(qe);
+    while(mw.s<ma||me.s<ma) {
+        mw.cu()->add_neighbor(me.cu());
+        me.cu()->add_neighbor(mw.cu());
+        if(mw.ns>me.ns) me.step();
+        else {
+            if(mw.ns==me.ns) me.step();
+            mw.step();
+        }
+    }
+}
+
+/** Adds the adjacencies between the leaves on either side of the boundary
+ * between two nodes that are above one another, by marching along both sides
+ * of the boundary at once.
+ * \param[in] (qs,qn) pointers to the southern and northern nodes. */
+void quadtree_2d::ns_neighbors(quadtree_2d *qs,quadtree_2d *qn) {
+    const int ma=1<<30;
+    quad_march<2> ms(qs);
+    quad_march<3> mn(qn);
+    while(ms.s<ma||mn.s<ma) {
+        ms.cu()->add_neighbor(mn.cu());
+        mn.cu()->add_neighbor(ms.cu());
+        if(ms.ns>mn.ns) mn.step();
+        else {
+            if(ms.ns==mn.ns) mn.step();
+            ms.step();
+        }
+    }
+}
+
+/** Outputs the lines that divide the nodes below this one into their children,
+ * in Gnuplot format.
+ * \param[in] fp a file handle to write to. */
+void quadtree_2d::draw_cross(FILE *fp) {
+    if(id==NULL) {
+        fprintf(fp,"%g %g\n%g %g\n\n\n%g %g\n%g %g\n\n\n",
+            cx-lx,cy,cx+lx,cy,cx,cy-ly,cx,cy+ly);
+        qsw->draw_cross(fp);
+        qse->draw_cross(fp);
+        qnw->draw_cross(fp);
+        qne->draw_cross(fp);
+    }
+}
+
+/** The class constructor sets up the geometry of the container, and creates
+ * the quadtree as a single empty leaf.
+ * \param[in] (ax_,bx_) the minimum and maximum x coordinates.
+ * \param[in] (ay_,by_) the minimum and maximum y coordinates.
+ * \param[in] ps_ the number of floating point entries to store for each
+ *                particle.
+ * \param[in] nt_ the maximum number of threads that will be used for Voronoi
+ *                computations. */
+container_quad_base_2d::container_quad_base_2d(double ax_,double bx_,double ay_,double by_,int ps_,int nt_)
+    : ax(ax_), bx(bx_), ay(ay_), by(by_),
+    max_len_sq((bx-ax)*(bx-ax)+(by-ay)*(by-ay)), ps(ps_),
+    root(new quadtree_2d(0.5*(ax+bx),0.5*(ay+by),0.5*(bx-ax),0.5*(by-ay),0,ps)),
+    nt(nt_), ready(false), max_radius(0) {
+    allocate_search();
+}
+
+/** The container destructor frees the dynamically allocated memory. */
+container_quad_base_2d::~container_quad_base_2d() {
+    free_search();
+    delete root;
+}
+
+/** Removes all of the particles, replacing the quadtree with a single empty
+ * leaf. */
+void container_quad_base_2d::clear_tree() {
+    delete root;
+    root=new quadtree_2d(0.5*(ax+bx),0.5*(ay+by),0.5*(bx-ax),0.5*(by-ay),0,ps);
+    lv.clear();
+    ready=false;
+}
+
+/** Allocates the memory that each thread uses to search through the leaves,
+ * based on the current number of leaves. */
+void container_quad_base_2d::allocate_search() {
+    const int nl=lv.size();
+    mk=new unsigned int*[nt];
+    mv=new unsigned int[nt];
+    qu=new int*[nt];
+    for(int t=0;t<nt;t++) {
+        mk[t]=new unsigned int[nl];
+        for(int l=0;l<nl;l++) mk[t][l]=0;
+        mv[t]=0;
+        qu[t]=new int[nl];
+    }
+}
+
+/** Frees the memory that each thread uses to search through the leaves. */
+void container_quad_base_2d::free_search() {
+    for(int t=0;t<nt;t++) {
+        delete [] qu[t];
+        delete [] mk[t];
+    }
+    delete [] qu;
+    delete [] mv;
+    delete [] mk;
+}
+
+/** Changes the maximum number of threads that can be used in multithreaded
+ * computations.
+ * \param[in] nt_ the new maximum number of threads. */
+void container_quad_base_2d::change_number_thread(int nt_) {
+    free_search();
+    nt=nt_;
+    allocate_search();
+}
+
+/** Builds the list of leaves and the lists of adjacent leaves. The subtrees
+ * below a fixed depth are processed in parallel, after which the adjacencies
+ * between the leaves of different subtrees are added by marching along the
+ * boundaries of the nodes near the top of the tree. */
+void container_quad_base_2d::setup_neighbors() {
+    int d=0;
+    while(d<quad_parallel_depth&&(1<<(2*d))<16*nt) d++;
+
+    // Make a list of the leaves in depth-first order. In addition, find the
+    // nodes at the chosen depth, and the nodes above them that have children.
+    std::vector<quadtree_2d*> st(1,root),fr,tp;
+    lv.clear();
+    while(!st.empty()) {
+        quadtree_2d *q=st.back();st.pop_back();
+        if(q->id!=NULL) {
+            q->li=lv.size();
+            q->nco=0;
+            lv.push_back(q);
+        } else {
+            if(q->depth==d) fr.push_back(q);
+            else if(q->depth<d) tp.push_back(q);
+            st.push_back(q->qne);st.push_back(q->qnw);
+            st.push_back(q->qse);st.push_back(q->qsw);
+        }
+    }
+
+    // Set up the adjacencies within each subtree in parallel, and then add
+    // the adjacencies between the subtrees
+    const int nf=fr.size();
+#pragma omp parallel for num_threads(nt) schedule(dynamic)
+    for(int k=0;k<nf;k++) fr[k]->setup_neighbors();
+    for(int k=0;k<(int) tp.size();k++) tp[k]->link_children();
+
+    // Reallocate the search memory for the new number of leaves
+    free_search();
+    allocate_search();
+    ready=true;
+}
+
+/** Divides the nodes above a given depth so that every position in the
+ * container is covered by a node at that depth, and collects these nodes.
+ * \param[in] q the node to consider.
+ * \param[in] l the depth.
+ * \param[in,out] fr the list of nodes at the depth, in depth-first order. */
+void container_quad_base_2d::refine(quadtree_2d *q,int l,std::vector<quadtree_2d*> &fr) {
+    if(q->depth==l) {fr.push_back(q);return;}
+    if(q->id!=NULL) q->split();
+    refine(q->qsw,l,fr);
+    refine(q->qse,l,fr);
+    refine(q->qnw,l,fr);
+    refine(q->qne,l,fr);
+}
+
+/** Adds an array of particles to the container using multithreaded insertion.
+ * The top of the tree is first divided into a uniform grid of nodes. The
+ * particles are sorted according to which of these nodes they are within, and
+ * then the subtrees are filled in parallel.
+ * \param[in] pt_list a pointer to the array of particles, with ps entries for
+ *                    each. The particles are given IDs corresponding to their
+ *                    position in the array.
+ * \param[in] num the number of particles.
+ * \param[in] nt_ the number of threads to use. */
+void container_quad_base_2d::add_parallel_base(const double *pt_list,int num,int nt_) {
+    int d=0,i;
+    while(d<quad_parallel_depth&&(1<<(2*d))<16*nt_) d++;
+    std::vector<quadtree_2d*> fr;
+    refine(root,d,fr);
+    const int nf=fr.size();
+
+    // Find the node at the chosen depth that each particle is within, using
+    // the same comparisons as when inserting the particle
+    std::vector<int> f(num);
+#pragma omp parallel for num_threads(nt_)
+    for(i=0;i<num;i++) {
+        const double *pp=pt_list+ps*i;
+        if(inside(*pp,pp[1])) {
+            quadtree_2d *q=root;
+            int k=0;
+            while(q->depth<d) {
+                k=(k<<2)+(*pp<q->cx?0:1)+(pp[1]<q->cy?0:2);
+                q=q->child(*pp,pp[1]);
+            }
+            f[i]=k;
+        } else f[i]=-1;
+    }
+
+    // Sort the particles by node
+    std::vector<int> fo(nf+1,0),ord;
+    for(i=0;i<num;i++) if(f[i]>=0) fo[f[i]+1]++;
+    for(i=0;i<nf;i++) fo[i+1]+=fo[i];
+    ord.resize(fo[nf]);
+    {
+        std::vector<int> fp(fo.begin(),fo.end()-1);
+        for(i=0;i<num;i++) if(f[i]>=0) ord[fp[f[i]]++]=i;
+    }
+
+    // Fill the subtrees in parallel
+#pragma omp parallel for num_threads(nt_) schedule(dynamic)
+    for(int k=0;k<nf;k++)
+        for(int j=fo[k];j<fo[k+1];j++) fr[k]->put(ord[j],pt_list+ps*ord[j]);
+    ready=false;
+}
+
+/** Sums up the total number of stored particles.
+ * \return The number of particles. */
+int container_quad_base_2d::total_particles() {
+    int tp=0;
+    std::vector<quadtree_2d*> st(1,root);
+    while(!st.empty()) {
+        quadtree_2d *q=st.back();st.pop_back();
+        if(q->id!=NULL) tp+=q->co;
+        else {
+            st.push_back(q->qne);st.push_back(q->qnw);
+            st.push_back(q->qse);st.push_back(q->qsw);
+        }
+    }
+    return tp;
+}
+
+/** This function tests to see if a given vector lies within the container
+ * bounds and any walls.
+ * \param[in] (x,y) the position vector to be tested.
+ * \return True if the point is inside the container, false if the point is
+ * outside. */
+bool container_quad_base_2d::point_inside(double x,double y) {
+    if(x<ax||x>bx||y<ay||y>by) return false;
+    return point_inside_walls(x,y);
+}
+
+/** Cuts a Voronoi cell by the plane associated with a particle in a leaf.
+ * \param[in,out] c a reference to the Voronoi cell.
+ * \param[in] q a pointer to the leaf.
+ * \param[in] s the index of the particle within the leaf.
+ * \param[in] (x,y) the position of the particle whose cell is computed.
+ * \param[in] rs the squared radius of the particle whose cell is computed, or
+ *               zero if radii are not stored.
+ * \return False if the cell was deleted, true otherwise. */
+template<class v_cell_2d>
+inline bool container_quad_base_2d::cut_particle(v_cell_2d &c,quadtree_2d *q,int s,double x,double y,double rs) {
+    double *pp=q->p+ps*s,x1=*pp-x,y1=pp[1]-y,rsq=x1*x1+y1*y1;
+    if(ps==3) rsq+=rs-pp[2]*pp[2];
+    return c.nplane(x1,y1,rsq,q->id[s]);
+}
+
+/** Tests whether a leaf can be skipped in the search, because none of the
+ * particles that it could contain could cut the Voronoi cell. The tests are
+ * the same as those used by the voro_compute_2d class for the blocks of a
+ * uniform grid.
+ * \param[in] c a reference to the Voronoi cell.
+ * \param[in] q a pointer to the leaf.
+ * \param[in] (x,y) the position of the particle whose cell is computed.
+ * \param[in] rm the squared radius of the particle whose cell is computed,
+ *               minus the squared maximum radius, or zero if radii are not
+ *               stored.
+ * \return True if the leaf can be skipped, false otherwise. */
+template<class v_cell_2d>
+inline bool container_quad_base_2d::skip_leaf(v_cell_2d &c,quadtree_2d *q,double x,double y,double rm) {
+    double xlo,xhi,ylo,yhi;
+    q->bound(xlo,xhi,ylo,yhi);
+    xlo-=x;xhi-=x;ylo-=y;yhi-=y;
+    if(xlo>0) {
+        if(ylo>0) return corner_test(c,xlo,ylo,xhi,yhi,rm);
+        if(yhi<0) return corner_test(c,xlo,yhi,xhi,ylo,rm);
+        return edge_x_test(c,xlo,ylo,yhi,rm);
+    }
+    if(xhi<0) {
+        if(ylo>0) return corner_test(c,xhi,ylo,xlo,yhi,rm);
+        if(yhi<0) return corner_test(c,xhi,yhi,xlo,ylo,rm);
+        return edge_x_test(c,xhi,ylo,yhi,rm);
+    }
+    if(ylo>0) return edge_y_test(c,xlo,ylo,xhi,rm);
+    if(yhi<0) return edge_y_test(c,xlo,yhi,xhi,rm);
+
+    // The leaf touches the particle, which can happen if the particle is on
+    // the boundary of its own leaf, so it must be searched
+    return false;
+}
+
+/** Tests whether a leaf whose closest point to the particle is a corner could
+ * contain particles that cut the Voronoi cell.
+ * \param[in] c a reference to the Voronoi cell.
+ * \param[in] (xl,yl) the relative coordinates of the corner of the leaf
+ *                    closest to the particle.
+ * \param[in] (xh,yh) the relative coordinates of the corner of the leaf
+ *                    farthest away from the particle.
+ * \param[in] rm the radius adjustment, as for skip_leaf.
+ * \return False if the leaf could contain particles that cut the cell, true
+ * otherwise. */
+template<class v_cell_2d>
+inline bool container_quad_base_2d::corner_test(v_cell_2d &c,double xl,double yl,double xh,double yh,double rm) {
+    double rv=1+rm/(xl*xl+yl*yl);
+    if(c.plane_intersects_guess(xl,yh,(xl*xl+yl*yh)*rv)) return false;
+    if(c.plane_intersects(xh,yl,(xl*xh+yl*yl)*rv)) return false;
+    return true;
+}
+
+/** Tests whether a leaf whose closest point to the particle is on an edge
+ * normal to the x direction could contain particles that cut the Voronoi cell.
+ * \param[in] c a reference to the Voronoi cell.
+ * \param[in] xl the relative x coordinate of the edge closest to the particle.
+ * \param[in] (y0,y1) the relative y coordinates of the ends of the edge.
+ * \param[in] rm the radius adjustment, as for skip_leaf.
+ * \return False if the leaf could contain particles that cut the cell, true
+ * otherwise. */
+template<class v_cell_2d>
+inline bool container_quad_base_2d::edge_x_test(v_cell_2d &c,double xl,double y0,double y1,double rm) {
+    double rs=xl*xl+rm;
+    if(c.plane_intersects_guess(xl,y0,rs)) return false;
+    if(c.plane_intersects(xl,y1,rs)) return false;
+    return true;
+}
+
+/** Tests whether a leaf whose closest point to the particle is on an edge
+ * normal to the y direction could contain particles that cut the Voronoi cell.
+ * \param[in] c a reference to the Voronoi cell.
+ * \param[in] (x0,x1) the relative x coordinates of the ends of the edge.
+ * \param[in] yl the relative y coordinate of the edge closest to the particle.
+ * \param[in] rm the radius adjustment, as for skip_leaf.
+ * \return False if the leaf could contain particles that cut the cell, true
+ * otherwise. */
+template<class v_cell_2d>
+inline bool container_quad_base_2d::edge_y_test(v_cell_2d &c,double x0,double yl,double x1,double rm) {
+    double rs=yl*yl+rm;
+    if(c.plane_intersects_guess(x0,yl,rs)) return false;
+    if(c.plane_intersects(x1,yl,rs)) return false;
+    return true;
+}
+
+/** Computes the Voronoi cell for a particle. The cell is first cut by the
+ * other particles in the same leaf, and then the adjacent leaves are searched
+ * outwards in breadth-first order. A leaf that cannot contain any particles
+ * that cut the cell is skipped, and its adjacent leaves are not added to the
+ * search. This routine requires that setup_neighbors has been called since
+ * the last particle was added.
+ * \param[out] c a Voronoi cell class in which to store the computed cell.
+ * \param[in] l the index of the leaf that the particle is within.
+ * \param[in] q the index of the particle within the leaf.
+ * \return True if the cell was computed. If the cell cannot be computed, if
+ * it is removed entirely by a wall, then the routine returns false. */
+template<class v_cell_2d>
+bool container_quad_base_2d::compute_cell(v_cell_2d &c,int l,int q) {
+    quadtree_2d *qp=lv[l],*qn;
+    double *pp=qp->p+ps*q,x=*pp,y=pp[1],rs=0,rm=0;
+    if(ps==3) {rs=pp[2]*pp[2];rm=rs-max_radius*max_radius;}
+    int i;
+
+    // Initialize the cell to fill the container, apply the walls, and cut the
+    // cell by the other particles in the leaf
+    c.init(ax-x,bx-x,ay-y,by-y);
+    if(!apply_walls(c,x,y)) return false;
+    for(i=0;i<qp->co;i++) if(i!=q&&!cut_particle(c,qp,i,x,y,rs)) return false;
+
+    // Start a new search, clearing the marks if the mark value wraps around
+    const int tn=t_num();
+    unsigned int *m=mk[tn],&b=mv[tn];
+    int *qh=qu[tn],*qt=qh;
+    if(++b==0) {
+        for(i=0;i<(int) lv.size();i++) m[i]=0;
+        b=1;
+    }
+    m[l]=b;
+    for(i=0;i<qp->nco;i++) {
+        qn=qp->nei[i];
+        m[qn->li]=b;*(qt++)=qn->li;
+    }
+
+    // Search outwards through the leaves
+    while(qh<qt) {
+        qn=lv[*(qh++)];
+        if(skip_leaf(c,qn,x,y,rm)) continue;
+        for(i=0;i<qn->co;i++) if(!cut_particle(c,qn,i,x,y,rs)) return false;
+        for(i=0;i<qn->nco;i++) {
+            quadtree_2d *qa=qn->nei[i];
+            if(m[qa->li]!=b) {m[qa->li]=b;*(qt++)=qa->li;}
+        }
+    }
+    return true;
+}
+
+/** Computes all of the Voronoi cells in the container, but does nothing with
+ * the output. The leaves are shared out between the threads. It is useful for
+ * measuring the pure computation time of the Voronoi algorithm. */
+void container_quad_base_2d::compute_all_cells() {
+    if(!ready) setup_neighbors();
+    const int nl=lv.size();
+#pragma omp parallel num_threads(nt)
+    {
+        voronoicell_2d c(*this);
+#pragma omp for schedule(dynamic,16)
+        for(int l=0;l<nl;l++)
+            for(int q=0;q<lv[l]->co;q++) compute_cell(c,l,q);
+    }
+}
+
+/** Calculates all of the Voronoi cells and sums their areas, using multiple
+ * threads. In most cases without walls, the sum of the Voronoi cell areas
+ * should equal the area of the container to numerical precision.
+ * \return The sum of all of the computed Voronoi areas. */
+double container_quad_base_2d::sum_cell_areas() {
+    if(!ready) setup_neighbors();
+    const int nl=lv.size();
+    double area=0;
+#pragma omp parallel num_threads(nt)
+    {
+        voronoicell_2d c(*this);
+#pragma omp for schedule(dynamic,16) reduction(+:area)
+        for(int l=0;l<nl;l++)
+            for(int q=0;q<lv[l]->co;q++) if(compute_cell(c,l,q)) area+=c.area();
+    }
+    return area;
+}
+
+/** Computes Voronoi cells and saves the output in Gnuplot format.
+ * \param[in] fp a file handle to write to. */
+void container_quad_base_2d::draw_cells_gnuplot(FILE *fp) {
+    if(!ready) setup_neighbors();
+    voronoicell_2d c(*this);
+    for(int l=0;l<(int) lv.size();l++) for(int q=0;q<lv[l]->co;q++)
+        if(compute_cell(c,l,q)) {
+            double *pp=lv[l]->p+ps*q;
+            c.draw_gnuplot(*pp,pp[1],fp);
+        }
+}
+
+/** Computes the Voronoi cells and saves customized information about them.
+ * \param[in] format the custom output string to use.
+ * \param[in] fp a file handle to write to. */
+void container_quad_base_2d::print_custom(const char *format,FILE *fp) {
+    if(!ready) setup_neighbors();
+    int l,q;double *pp;
+    if(voro_contains_neighbor(format)) {
+        voronoicell_neighbor_2d c(*this);
+        for(l=0;l<(int) lv.size();l++) for(q=0;q<lv[l]->co;q++) if(compute_cell(c,l,q)) {
+            pp=lv[l]->p+ps*q;
+            c.output_custom(format,lv[l]->id[q],*pp,pp[1],ps==3?pp[2]:default_radius,fp);
+        }
+    } else {
+        voronoicell_2d c(*this);
+        for(l=0;l<(int) lv.size();l++) for(q=0;q<lv[l]->co;q++) if(compute_cell(c,l,q)) {
+            pp=lv[l]->p+ps*q;
+            c.output_custom(format,lv[l]->id[q],*pp,pp[1],ps==3?pp[2]:default_radius,fp);
+        }
+    }
+}
+
+/** Draws the domain and the lines that divide the quadtree nodes, in Gnuplot
+ * format.
+ * \param[in] fp a file handle to write to. */
+void container_quad_base_2d::draw_quadtree(FILE *fp) {
+    draw_domain_gnuplot(fp);
+    root->draw_cross(fp);
+}
+
+/** Draws an outline of the domain in Gnuplot format.
+ * \param[in] fp the file handle to write to. */
+void container_quad_base_2d::draw_domain_gnuplot(FILE *fp) {
+    fprintf(fp,"%g %g\n%g %g\n%g %g\n%g %g\n%g %g\n",ax,ay,bx,ay,bx,by,ax,by,ax,ay);
+}
+
+/** The class constructor sets up the geometry of the container.
+ * \param[in] (ax_,bx_) the minimum and maximum x coordinates.
+ * \param[in] (ay_,by_) the minimum and maximum y coordinates.
+ * \param[in] nt_ the maximum number of threads that will be used for Voronoi
+ *                computations. */
+container_quad_2d::container_quad_2d(double ax_,double bx_,double ay_,double by_,int nt_)
+    : container_quad_base_2d(ax_,bx_,ay_,by_,2,nt_) {}
+
+/** Clears the container of particles. */
+void container_quad_2d::clear() {
+    clear_tree();
+}
+
+/** Adds an array of particle positions to the container using multithreaded
+ * insertion.
+ * \param[in] pt_list a pointer to the array of positions, stored as (x,y)
+ *                    doublets.
+ * \param[in] num the number of particles.
+ * \param[in] nt_ the number of threads to use. */
+void container_quad_2d::add_parallel(double *pt_list,int num,int nt_) {
+    add_parallel_base(pt_list,num,nt_);
+}
+
+/** Import a list of particles from an open file stream into the container.
+ * Entries of three numbers (Particle ID, x position, y position) are searched
+ * for. If the file cannot be successfully read, then the routine causes a
+ * fatal error.
+ * \param[in] fp the file handle to read from. */
+void container_quad_2d::import(FILE *fp) {
+    int i,j;
+    double x,y;
+    while((j=fscanf(fp,"%d %lg %lg",&i,&x,&y))==3) put(i,x,y);
+    if(j!=EOF) voro_fatal_error("File import error",VOROPP_FILE_ERROR);
+}
+
+/** Dumps particle IDs and positions to a file.
+ * \param[in] fp a file handle to write to. */
+void container_quad_2d::draw_particles(FILE *fp) {
+    std::vector<quadtree_2d*> st(1,root);
+    while(!st.empty()) {
+        quadtree_2d *q=st.back();st.pop_back();
+        if(q->id!=NULL) {
+            for(int i=0;i<q->co;i++)
+                fprintf(fp,"%d %g %g\n",q->id[i],q->p[2*i],q->p[2*i+1]);
+        } else {
+            st.push_back(q->qne);st.push_back(q->qnw);
+            st.push_back(q->qse);st.push_back(q->qsw);
+        }
+    }
+}
+
+/** The class constructor sets up the geometry of the container.
+ * \param[in] (ax_,bx_) the minimum and maximum x coordinates.
+ * \param[in] (ay_,by_) the minimum and maximum y coordinates.
+ * \param[in] nt_ the maximum number of threads that will be used for Voronoi
+ *                computations. */
+container_quad_poly_2d::container_quad_poly_2d(double ax_,double bx_,double ay_,double by_,int nt_)
+    : container_quad_base_2d(ax_,bx_,ay_,by_,3,nt_) {}
+
+/** Clears the container of particles, also resetting the maximum radius to
+ * zero. */
+void container_quad_poly_2d::clear() {
+    clear_tree();
+    max_radius=0;
+}
+
+/** Adds an array of particles to the container using multithreaded insertion.
+ * \param[in] pt_list a pointer to the array of particles, stored as (x,y,r)
+ *                    triplets.
+ * \param[in] num the number of particles.
+ * \param[in] nt_ the number of threads to use. */
+void container_quad_poly_2d::add_parallel(double *pt_list,int num,int nt_) {
+    for(int i=0;i<num;i++) if(pt_list[3*i+2]>max_radius) max_radius=pt_list[3*i+2];
+    add_parallel_base(pt_list,num,nt_);
+}
+
+/** Import a list of particles from an open file stream into the container.
+ * Entries of four numbers (Particle ID, x position, y position, radius) are
+ * searched for. If the file cannot be successfully read, then the routine
+ * causes a fatal error.
+ * \param[in] fp the file handle to read from. */
+void container_quad_poly_2d::import(FILE *fp) {
+    int i,j;
+    double x,y,r;
+    while((j=fscanf(fp,"%d %lg %lg %lg",&i,&x,&y,&r))==4) put(i,x,y,r);
+    if(j!=EOF) voro_fatal_error("File import error",VOROPP_FILE_ERROR);
+}
+
+/** Dumps particle IDs, positions, and radii to a file.
+ * \param[in] fp a file handle to write to. */
+void container_quad_poly_2d::draw_particles(FILE *fp) {
+    std::vector<quadtree_2d*> st(1,root);
+    while(!st.empty()) {
+        quadtree_2d *q=st.back();st.pop_back();
+        if(q->id!=NULL) {
+            for(int i=0;i<q->co;i++)
+                fprintf(fp,"%d %g %g %g\n",q->id[i],q->p[3*i],q->p[3*i+1],q->p[3*i+2]);
+        } else {
+            st.push_back(q->qne);st.push_back(q->qnw);
+            st.push_back(q->qse);st.push_back(q->qsw);
+        }
+    }
+}
+
+// Explicit instantiation
+template bool container_quad_base_2d::compute_cell(voronoicell_2d&,int,int);
+template bool container_quad_base_2d::compute_cell(voronoicell_neighbor_2d&,int,int);
+
+}
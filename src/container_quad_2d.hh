@@ -0,0 +1,332 @@
+// Voro++, a cell-based Voronoi library
+// By Chris H. Rycroft and the Rycroft Group
+
+/** \file container_quad_2d.hh
+ * \brief Header file for the quadtree_2d class and the adaptive 2D container
+ * classes. */
+
+#ifndef VOROPP_CONTAINER_QUAD_2D_HH
+#define VOROPP_CONTAINER_QUAD_2D_HH
+
+#include <cstdio>
+#include <vector>
+
+#include "config.hh"
+#include "common.hh"
+#include "rad_option.hh"
+#include "cell_2d.hh"
+#include "wall.hh"
+
+namespace voro {
+
+/** \brief A node in the quadtree of an adaptive 2D container.
+ *
+ * Each node represents a rectangle within the container. A leaf node stores
+ * the particles within its rectangle, and is split into four equal children
+ * when it becomes full. Once the tree has been constructed, each leaf also
+ * stores a list of the leaves that share part of an edge with it, which is
+ * used to search outwards from a particle when computing its Voronoi cell. */
+class quadtree_2d {
+    public:
+        /** The x coordinate of the center of the node. */
+        const double cx;
+        /** The y coordinate of the center of the node. */
+        const double cy;
+        /** Half of the width of the node in the x direction. */
+        const double lx;
+        /** Half of the width of the node in the y direction. */
+        const double ly;
+        /** The depth of the node in the tree, which is zero for the root. */
+        const int depth;
+        /** The number of floating point entries stored for each particle,
+         * which is 2 for positions only and 3 if the radii are also stored.
+         */
+        const int ps;
+        /** For a leaf, the IDs of the particles. Otherwise NULL. */
+        int *id;
+        /** For a leaf, the particle positions and radii, with ps entries for
+         * each particle. */
+        double *p;
+        /** The number of particles in the leaf. */
+        int co;
+        /** The child covering the lower left quarter of the node. */
+        quadtree_2d *qsw;
+        /** The child covering the lower right quarter of the node. */
+        quadtree_2d *qse;
+        /** The child covering the upper left quarter of the node. */
+        quadtree_2d *qnw;
+        /** The child covering the upper right quarter of the node. */
+        quadtree_2d *qne;
+        /** The leaves that are adjacent to this leaf. */
+        quadtree_2d **nei;
+        /** The number of adjacent leaves. */
+        int nco;
+        /** The index of the leaf in the list of leaves of the container. */
+        int li;
+        quadtree_2d(double cx_,double cy_,double lx_,double ly_,int depth_,int ps_);
+        ~quadtree_2d();
+        void put(int i,const double *pp);
+        void split();
+        void setup_neighbors();
+        void link_children();
+        /** Returns the child that a position is within.
+         * \param[in] (x,y) the position.
+         * \return A pointer to the child. */
+        inline quadtree_2d* child(double x,double y) {
+            return x<cx?(y<cy?qsw:qnw):(y<cy?qse:qne);
+        }
+        /** Adds a leaf to the list of adjacent leaves.
+         * \param[in] qt a pointer to the leaf to add. */
+        inline void add_neighbor(quadtree_2d *qt) {
+            if(nco==nmax) add_neighbor_memory();
+            nei[nco++]=qt;
+        }
+        /** Computes the bounds of the node.
+         * \param[out] (xlo,xhi) the minimum and maximum x coordinates.
+         * \param[out] (ylo,yhi) the minimum and maximum y coordinates. */
+        inline void bound(double &xlo,double &xhi,double &ylo,double &yhi) {
+            xlo=cx-lx;xhi=cx+lx;
+            ylo=cy-ly;yhi=cy+ly;
+        }
+        void draw_cross(FILE *fp=stdout);
+    private:
+        /** The current memory allocation for particles in the leaf. */
+        int mem;
+        /** The current memory allocation for adjacent leaves. */
+        int nmax;
+        /** Adds a particle to the leaf, without checking whether the leaf
+         * needs to be split.
+         * \param[in] i the ID of the particle.
+         * \param[in] pp a pointer to the ps entries of the particle. */
+        inline void quick_put(int i,const double *pp) {
+            if(co==mem) add_particle_memory();
+            id[co]=i;
+            for(double *q=p+ps*co++,*qe=q+ps;q<qe;q++) *q=*(pp++);
+        }
+        void add_particle_memory();
+        void add_neighbor_memory();
+        void we_neighbors(quadtree_2d *qw,quadtree_2d *qe);
+        void ns_neighbors(quadtree_2d *qs,quadtree_2d *qn);
+};
+
+/** \brief Base class for the adaptive 2D containers.
+ *
+ * This class represents a system of particles in a non-periodic rectangular
+ * domain, stored in a quadtree instead of the uniform grid of blocks used by
+ * container_2d. Each leaf of the tree holds at most quad_leaf_size particles,
+ * so that the tree adapts to the local particle density. This makes the
+ * class well suited to strongly clustered particle distributions, where a
+ * uniform grid has many empty blocks in some places and crowded blocks in
+ * others.
+ *
+ * The Voronoi cell of a particle is computed by cutting it with the other
+ * particles in its leaf, and then by searching outwards through the adjacent
+ * leaves, skipping any leaf that can be shown not to intersect the cell. Each
+ * thread has its own search memory, so that the cells can be computed in
+ * parallel. The leaf adjacency information is built by setup_neighbors, which
+ * must be called after adding particles and before computing cells with the
+ * compute_cell routine. The routines that compute all of the cells call it
+ * automatically if needed. */
+class container_quad_base_2d : public wall_list_2d {
+    public:
+        /** The minimum x coordinate of the container. */
+        const double ax;
+        /** The maximum x coordinate of the container. */
+        const double bx;
+        /** The minimum y coordinate of the container. */
+        const double ay;
+        /** The maximum y coordinate of the container. */
+        const double by;
+        /** The maximum length squared that could be encountered in the Voronoi
+         * cell calculation. */
+        const double max_len_sq;
+        /** The number of floating point entries stored for each particle. */
+        const int ps;
+        /** The root of the quadtree. */
+        quadtree_2d *root;
+        /** The leaves of the quadtree, which are set up by setup_neighbors. */
+        std::vector<quadtree_2d*> lv;
+        container_quad_base_2d(double ax_,double bx_,double ay_,double by_,int ps_,int nt_);
+        ~container_quad_base_2d();
+        void setup_neighbors();
+        void change_number_thread(int nt_);
+        /** Returns the maximum number of threads that can be used for
+         * computations.
+         * \return The number of threads. */
+        inline int number_thread() {return nt;}
+        /** Returns the number of leaves in the quadtree, once setup_neighbors
+         * has been called.
+         * \return The number of leaves. */
+        inline int number_of_leaves() {return lv.size();}
+        int total_particles();
+        bool point_inside(double x,double y);
+        template<class v_cell_2d>
+        bool compute_cell(v_cell_2d &c,int l,int q);
+        void compute_all_cells();
+        double sum_cell_areas();
+        void draw_cells_gnuplot(FILE *fp=stdout);
+        /** Computes all Voronoi cells and saves the output in Gnuplot format.
+         * \param[in] filename the name of the file to write to. */
+        inline void draw_cells_gnuplot(const char *filename) {
+            FILE *fp=safe_fopen(filename,"w");
+            draw_cells_gnuplot(fp);
+            fclose(fp);
+        }
+        void print_custom(const char *format,FILE *fp=stdout);
+        /** Computes all the Voronoi cells and saves customized information
+         * about them.
+         * \param[in] format the custom output string to use.
+         * \param[in] filename the name of the file to write to. */
+        inline void print_custom(const char *format,const char *filename) {
+            FILE *fp=safe_fopen(filename,"w");
+            print_custom(format,fp);
+            fclose(fp);
+        }
+        void draw_quadtree(FILE *fp=stdout);
+        /** Draws the domain and the boundaries between the quadtree nodes in
+         * Gnuplot format.
+         * \param[in] filename the filename to write to. */
+        inline void draw_quadtree(const char* filename) {
+            FILE *fp=safe_fopen(filename,"w");
+            draw_quadtree(fp);
+            fclose(fp);
+        }
+        void draw_domain_gnuplot(FILE *fp=stdout);
+        /** Draws an outline of the domain in Gnuplot format.
+         * \param[in] filename the filename to write to. */
+        inline void draw_domain_gnuplot(const char* filename) {
+            FILE *fp=safe_fopen(filename,"w");
+            draw_domain_gnuplot(fp);
+            fclose(fp);
+        }
+    protected:
+        /** The maximum number of threads that can be used for computation. */
+        int nt;
+        /** Whether the leaf list and adjacency information are up to date. */
+        bool ready;
+        /** The maximum radius of any particle, which is zero if the radii are
+         * not stored. */
+        double max_radius;
+        /** For each thread, an array of marks for the leaves that have been
+         * visited in the current search. */
+        unsigned int **mk;
+        /** For each thread, the mark value for the current search. */
+        unsigned int *mv;
+        /** For each thread, a queue of the leaves to visit. */
+        int **qu;
+        /** Tests whether a position is within the container.
+         * \param[in] (x,y) the position.
+         * \return True if the position is inside, false otherwise. */
+        inline bool inside(double x,double y) {
+            if(x<ax||x>=bx||y<ay||y>=by) {
+#if VOROPP_REPORT_OUT_OF_BOUNDS ==1
+                fprintf(stderr,"Out of bounds: (x,y)=(%g,%g)\n",x,y);
+#endif
+                return false;
+            }
+            return true;
+        }
+        /** Adds a particle to the quadtree.
+         * \param[in] n the ID of the particle.
+         * \param[in] pp a pointer to the ps entries of the particle. */
+        inline void put_base(int n,const double *pp) {
+            if(inside(*pp,pp[1])) {root->put(n,pp);ready=false;}
+        }
+        void clear_tree();
+        void add_parallel_base(const double *pt_list,int num,int nt_);
+    private:
+        void refine(quadtree_2d *q,int l,std::vector<quadtree_2d*> &fr);
+        void allocate_search();
+        void free_search();
+        template<class v_cell_2d>
+        inline bool cut_particle(v_cell_2d &c,quadtree_2d *q,int s,double x,double y,double rs);
+        template<class v_cell_2d>
+        inline bool skip_leaf(v_cell_2d &c,quadtree_2d *q,double x,double y,double rm);
+        template<class v_cell_2d>
+        inline bool corner_test(v_cell_2d &c,double xl,double yl,double xh,double yh,double rm);
+        template<class v_cell_2d>
+        inline bool edge_x_test(v_cell_2d &c,double xl,double y0,double y1,double rm);
+        template<class v_cell_2d>
+        inline bool edge_y_test(v_cell_2d &c,double x0,double yl,double x1,double rm);
+};
+
+/** \brief An adaptive 2D container for computing regular Voronoi
+ * tessellations. */
+class container_quad_2d : public container_quad_base_2d {
+    public:
+        container_quad_2d(double ax_,double bx_,double ay_,double by_,int number_thread=1);
+        void clear();
+        /** Adds a particle to the container. If the particle is outside the
+         * container, then it is ignored.
+         * \param[in] n the numerical ID of the particle.
+         * \param[in] (x,y) the position of the particle. */
+        inline void put(int n,double x,double y) {
+            double pp[2]={x,y};
+            put_base(n,pp);
+        }
+        void add_parallel(double *pt_list,int num,int nt_);
+        void import(FILE *fp=stdin);
+        /** Imports a list of particles from a file. Entries of three numbers
+         * (Particle ID, x position, y position) are searched for. If the file
+         * cannot be successfully read, then the routine causes a fatal error.
+         * \param[in] filename the name of the file to open and read from. */
+        inline void import(const char* filename) {
+            FILE *fp=safe_fopen(filename,"r");
+            import(fp);
+            fclose(fp);
+        }
+        void draw_particles(FILE *fp=stdout);
+        /** Dumps all of the particle IDs and positions to a file.
+         * \param[in] filename the name of the file to write to. */
+        inline void draw_particles(const char *filename) {
+            FILE *fp=safe_fopen(filename,"w");
+            draw_particles(fp);
+            fclose(fp);
+        }
+};
+
+/** \brief An adaptive 2D container for computing radical Voronoi
+ * tessellations.
+ *
+ * This class stores a radius for each particle, and computes the radical
+ * Voronoi tessellation. The search for neighboring particles takes into
+ * account the maximum radius of the particles in the container. */
+class container_quad_poly_2d : public container_quad_base_2d {
+    public:
+        container_quad_poly_2d(double ax_,double bx_,double ay_,double by_,int number_thread=1);
+        void clear();
+        /** Adds a particle to the container. If the particle is outside the
+         * container, then it is ignored.
+         * \param[in] n the numerical ID of the particle.
+         * \param[in] (x,y) the position of the particle.
+         * \param[in] r the radius of the particle. */
+        inline void put(int n,double x,double y,double r) {
+            double pp[3]={x,y,r};
+            if(r>max_radius) max_radius=r;
+            put_base(n,pp);
+        }
+        void add_parallel(double *pt_list,int num,int nt_);
+        void import(FILE *fp=stdin);
+        /** Imports a list of particles from a file. Entries of four numbers
+         * (Particle ID, x position, y position, radius) are searched for. If
+         * the file cannot be successfully read, then the routine causes a
+         * fatal error.
+         * \param[in] filename the name of the file to open and read from. */
+        inline void import(const char* filename) {
+            FILE *fp=safe_fopen(filename,"r");
+            import(fp);
+            fclose(fp);
+        }
+        void draw_particles(FILE *fp=stdout);
+        /** Dumps all of the particle IDs, positions, and radii to a file.
+         * \param[in] filename the name of the file to write to. */
+        inline void draw_particles(const char *filename) {
+            FILE *fp=safe_fopen(filename,"w");
+            draw_particles(fp);
+            fclose(fp);
+        }
+};
+
+}
+
+#endif
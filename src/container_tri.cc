@@ -6,9 +6,13 @@
  * related classes. */
 
 #include <cstring>
+#include <algorithm>
 
 #include "container_tri.hh"
 #include "iter_3d.hh"
+#include "vtu_writer_3d.hh"
+#include "cell_reduction_3d.hh"
+#include "particle_search_3d.hh"
 
 namespace voro {
 
@@ -27,14 +31,16 @@ namespace voro {
  * \param[in] ps_ the number of floating point entries to store for each
  *                particle.
  * \param[in] nt_ the maximum number of threads that will be used for Voronoi
- *                computations. */
+ *                computations.
+ * \param[in] hgrid_ half the number of subregions that each block is divided
+ *                   into along each direction for the block worklists. */
 container_triclinic_base::container_triclinic_base(double bx_,double bxy_,double by_,
-        double bxz_,double byz_,double bz_,int nx_,int ny_,int nz_,int init_mem_,int ps_,int nt_)
+        double bxz_,double byz_,double bz_,int nx_,int ny_,int nz_,int init_mem_,int ps_,int nt_,int hgrid_)
     : unitcell(bx_,bxy_,by_,bxz_,byz_,bz_),
-    voro_base_3d(nx_,ny_,nz_,bx_/nx_,by_/ny_,bz_/nz_), max_len_sq(unit_voro.max_radius_squared()),
+    voro_base_3d(nx_,ny_,nz_,bx_/nx_,by_/ny_,bz_/nz_,hgrid_), max_len_sq(unit_voro.max_radius_squared()),
     ey(int(max_uv_y*ysp+1)), ez(int(max_uv_z*zsp+1)), wy(ny+ey), wz(nz+ez),
     oy(ny+2*ey), oz(nz+2*ez), oxyz(nx*oy*oz), id(new uint64_t*[oxyz]), p(new double*[oxyz]),
-    co(new int[oxyz]), mem(new int[oxyz]), img(new char[oxyz]), init_mem(init_mem_), ps(ps_),
+    co(new int[oxyz]), mem(new int[oxyz]), img(new char[oxyz]), img_done(new char[oxyz]), init_mem(init_mem_), ps(ps_),
     nt(nt_), oflow_co(0), oflow_mem(init_overflow_size),
     ijk_m_id_oflow(new int[3*oflow_mem]), p_oflow(new double[ps*oflow_mem])  {
     int i,j,k,l;
@@ -43,6 +49,7 @@ container_triclinic_base::container_triclinic_base(double bx_,double bxy_,double
     int *pp=co;while(pp<co+oxyz) *(pp++)=0;
     pp=mem;while(pp<mem+oxyz) *(pp++)=0;
     char *cp=img;while(cp<img+oxyz) *(cp++)=0;
+    cp=img_done;while(cp<img_done+oxyz) *(cp++)=0;
 
     // Set up memory for the blocks in the primary domain
     for(k=ez;k<wz;k++) for(j=ey;j<wy;j++) for(i=0;i<nx;i++) {
@@ -81,6 +88,7 @@ container_triclinic_base::~container_triclinic_base() {
     delete [] ijk_m_id_oflow;
 
     // Delete the block arrays
+    delete [] img_done;
     delete [] img;
     delete [] mem;
     delete [] co;
@@ -97,10 +105,12 @@ container_triclinic_base::~container_triclinic_base() {
  *                coordinate directions.
  * \param[in] init_mem_ the initial memory allocation for each block.
  * \param[in] nt_ the maximum number of threads that will be used for Voronoi
- *                computations. */
+ *                computations.
+ * \param[in] hgrid_ half the number of subregions that each block is divided
+ *                   into along each direction for the block worklists. */
 container_triclinic::container_triclinic(double bx_,double bxy_,double by_,double bxz_,double byz_,double bz_,
-    int nx_,int ny_,int nz_,int init_mem_,int nt_)
-    : container_triclinic_base(bx_,bxy_,by_,bxz_,byz_,bz_,nx_,ny_,nz_,init_mem_,3,nt_),
+    int nx_,int ny_,int nz_,int init_mem_,int nt_,int hgrid_)
+    : container_triclinic_base(bx_,bxy_,by_,bxz_,byz_,bz_,nx_,ny_,nz_,init_mem_,3,nt_,hgrid_),
     vc(new voro_compute_3d<container_triclinic>*[nt]) {
 #pragma omp parallel num_threads(nt)
     {
@@ -139,10 +149,14 @@ void container_triclinic::change_number_thread(int nt_){
  *                            vector.
  * \param[in] (nx_,ny_,nz_) the number of grid blocks in each of the three
  *                coordinate directions.
- * \param[in] init_mem_ the initial memory allocation for each block. */
+ * \param[in] init_mem_ the initial memory allocation for each block.
+ * \param[in] nt_ the maximum number of threads that will be used for Voronoi
+ *                computations.
+ * \param[in] hgrid_ half the number of subregions that each block is divided
+ *                   into along each direction for the block worklists. */
 container_triclinic_poly::container_triclinic_poly(double bx_,double bxy_,double by_,double bxz_,double byz_,double bz_,
-    int nx_,int ny_,int nz_,int init_mem_,int nt_)
-    : container_triclinic_base(bx_,bxy_,by_,bxz_,byz_,bz_,nx_,ny_,nz_,init_mem_,4,nt_),
+    int nx_,int ny_,int nz_,int init_mem_,int nt_,int hgrid_)
+    : container_triclinic_base(bx_,bxy_,by_,bxz_,byz_,bz_,nx_,ny_,nz_,init_mem_,4,nt_,hgrid_),
     vc(new voro_compute_3d<container_triclinic_poly>*[nt]), max_r(new double[nt]) {
     for(int j=0;j<nt;j++) max_r[j]=0.;
 #pragma omp parallel num_threads(nt)
@@ -528,8 +542,10 @@ void container_triclinic_base::put_locate_block(int &ijk,double &x,double &y,dou
  *                        within, once it has been remapped.
  * \param[in,out] (x,y,z) the position vector to consider, which is remapped
  *                        into the primary domain during the routine.
- * \param[out] ijk the block index that the vector is within. */
-inline void container_triclinic_base::remap(int &ai,int &aj,int &ak,int &ci,int &cj,int &ck,double &x,double &y,double &z,int &ijk) {
+ * \param[out] ijk the block index that the vector is within.
+ * \return True, since the container is periodic in all three directions and
+ * every vector can be remapped. */
+inline bool container_triclinic_base::remap(int &ai,int &aj,int &ak,int &ci,int &cj,int &ck,double &x,double &y,double &z,int &ijk) {
 
     // Remap particle in the z direction if necessary
     ck=step_int(z*zsp);
@@ -554,6 +570,7 @@ inline void container_triclinic_base::remap(int &ai,int &aj,int &ak,int &ci,int
 
     cj+=ey;ck+=ez;
     ijk=ci+nx*(cj+oy*ck);
+    return true;
 }
 
 /** Takes a vector and finds the particle whose Voronoi cell contains that
@@ -624,6 +641,120 @@ bool container_triclinic_poly::find_voronoi_cell(double x,double y,double z,doub
     return false;
 }
 
+/** Finds the k particles that are closest to a given vector, using the
+ * Euclidean distance.
+ * \param[in] (x,y,z) the vector to test.
+ * \param[in] kn the number of particles to find.
+ * \param[out] pid a vector in which to store the particle IDs, in order of
+ *                 increasing distance.
+ * \param[out] rpos a vector in which to store the particle positions, which
+ *                  may lie in periodic images of the primary domain.
+ * \param[out] rsq a vector in which to store the squared distances.
+ * \return The number of particles found. */
+int container_triclinic::find_k_nearest(double x,double y,double z,int kn,std::vector<uint64_t> &pid,std::vector<double> &rpos,std::vector<double> &rsq) {
+    return particle_search_3d<container_triclinic_base>(*this).find_k_nearest(vc,x,y,z,kn,pid,rpos,rsq);
+}
+
+/** Finds the k particles that are closest to each vector in a batch, making
+ * use of multiple threads.
+ * \param[in] n the number of vectors.
+ * \param[in] pos an array of length 3*n holding the vectors to test.
+ * \param[in] kn the number of particles to find for each vector.
+ * \param[out] pid an array of length n*kn in which to store the particle IDs.
+ * \param[out] rpos an array of length 3*n*kn in which to store the particle
+ *                  positions.
+ * \param[out] rsq an array of length n*kn in which to store the squared
+ *                 distances, or NULL if this is not required.
+ * \param[out] cnt an array of length n in which to store the number of
+ *                 particles found for each vector. */
+void container_triclinic::find_k_nearest(int n,const double *pos,int kn,uint64_t *pid,double *rpos,double *rsq,int *cnt) {
+    particle_search_3d<container_triclinic_base>(*this).find_k_nearest(vc,n,pos,kn,pid,rpos,rsq,cnt);
+}
+
+/** Finds all of the particles within a given distance of a vector.
+ * \param[in] (x,y,z) the vector to test.
+ * \param[in] r the search radius.
+ * \param[out] pid a vector in which to store the particle IDs.
+ * \param[out] rpos a vector in which to store the particle positions, which
+ *                  may lie in periodic images of the primary domain.
+ * \param[out] rsq a vector in which to store the squared distances.
+ * \return The number of particles found. */
+int container_triclinic::find_within_radius(double x,double y,double z,double r,std::vector<uint64_t> &pid,std::vector<double> &rpos,std::vector<double> &rsq) {
+    return particle_search_3d<container_triclinic_base>(*this).find_within_radius(vc,x,y,z,r,pid,rpos,rsq);
+}
+
+/** Finds all of the particles within a given distance of each vector in a
+ * batch, making use of multiple threads, and stores the results in compressed
+ * sparse row format.
+ * \param[in] n the number of vectors.
+ * \param[in] pos an array of length 3*n holding the vectors to test.
+ * \param[in] r the search radius.
+ * \param[out] off a vector of length n+1 in which to store the offsets into
+ *                 the other vectors for each vector.
+ * \param[out] pid a vector in which to store the particle IDs.
+ * \param[out] rpos a vector in which to store the particle positions.
+ * \param[out] rsq a vector in which to store the squared distances. */
+void container_triclinic::find_within_radius(int n,const double *pos,double r,std::vector<uint64_t> &off,std::vector<uint64_t> &pid,std::vector<double> &rpos,std::vector<double> &rsq) {
+    particle_search_3d<container_triclinic_base>(*this).find_within_radius(vc,n,pos,r,off,pid,rpos,rsq);
+}
+
+/** Finds the k particles that are closest to a given vector, using the
+ * Euclidean distance.
+ * \param[in] (x,y,z) the vector to test.
+ * \param[in] kn the number of particles to find.
+ * \param[out] pid a vector in which to store the particle IDs, in order of
+ *                 increasing distance.
+ * \param[out] rpos a vector in which to store the particle positions, which
+ *                  may lie in periodic images of the primary domain.
+ * \param[out] rsq a vector in which to store the squared distances.
+ * \return The number of particles found. */
+int container_triclinic_poly::find_k_nearest(double x,double y,double z,int kn,std::vector<uint64_t> &pid,std::vector<double> &rpos,std::vector<double> &rsq) {
+    return particle_search_3d<container_triclinic_base>(*this).find_k_nearest(vc,x,y,z,kn,pid,rpos,rsq);
+}
+
+/** Finds the k particles that are closest to each vector in a batch, making
+ * use of multiple threads.
+ * \param[in] n the number of vectors.
+ * \param[in] pos an array of length 3*n holding the vectors to test.
+ * \param[in] kn the number of particles to find for each vector.
+ * \param[out] pid an array of length n*kn in which to store the particle IDs.
+ * \param[out] rpos an array of length 3*n*kn in which to store the particle
+ *                  positions.
+ * \param[out] rsq an array of length n*kn in which to store the squared
+ *                 distances, or NULL if this is not required.
+ * \param[out] cnt an array of length n in which to store the number of
+ *                 particles found for each vector. */
+void container_triclinic_poly::find_k_nearest(int n,const double *pos,int kn,uint64_t *pid,double *rpos,double *rsq,int *cnt) {
+    particle_search_3d<container_triclinic_base>(*this).find_k_nearest(vc,n,pos,kn,pid,rpos,rsq,cnt);
+}
+
+/** Finds all of the particles within a given distance of a vector.
+ * \param[in] (x,y,z) the vector to test.
+ * \param[in] r the search radius.
+ * \param[out] pid a vector in which to store the particle IDs.
+ * \param[out] rpos a vector in which to store the particle positions, which
+ *                  may lie in periodic images of the primary domain.
+ * \param[out] rsq a vector in which to store the squared distances.
+ * \return The number of particles found. */
+int container_triclinic_poly::find_within_radius(double x,double y,double z,double r,std::vector<uint64_t> &pid,std::vector<double> &rpos,std::vector<double> &rsq) {
+    return particle_search_3d<container_triclinic_base>(*this).find_within_radius(vc,x,y,z,r,pid,rpos,rsq);
+}
+
+/** Finds all of the particles within a given distance of each vector in a
+ * batch, making use of multiple threads, and stores the results in compressed
+ * sparse row format.
+ * \param[in] n the number of vectors.
+ * \param[in] pos an array of length 3*n holding the vectors to test.
+ * \param[in] r the search radius.
+ * \param[out] off a vector of length n+1 in which to store the offsets into
+ *                 the other vectors for each vector.
+ * \param[out] pid a vector in which to store the particle IDs.
+ * \param[out] rpos a vector in which to store the particle positions.
+ * \param[out] rsq a vector in which to store the squared distances. */
+void container_triclinic_poly::find_within_radius(int n,const double *pos,double r,std::vector<uint64_t> &off,std::vector<uint64_t> &pid,std::vector<double> &rpos,std::vector<double> &rsq) {
+    particle_search_3d<container_triclinic_base>(*this).find_within_radius(vc,n,pos,r,off,pid,rpos,rsq);
+}
+
 /** Increase memory for a particular region.
  * \param[in] i the index of the region to reallocate.
  * \param[in] m a minimum size for the reallocated region. */
@@ -724,6 +855,7 @@ void container_triclinic_base::region_count() {
 void container_triclinic::clear() {
     for(int *cop=co;cop<co+oxyz;cop++) *cop=0;
     char *cp=img;while(cp<img+oxyz) *(cp++)=0;
+    cp=img_done;while(cp<img_done+oxyz) *(cp++)=0;
 }
 
 /** Clears a container of particles, also clearing resetting the maximum radius
@@ -731,15 +863,180 @@ void container_triclinic::clear() {
 void container_triclinic_poly::clear() {
     for(int *cop=co;cop<co+oxyz;cop++) *cop=0;
     char *cp=img;while(cp<img+oxyz) *(cp++)=0;
+    cp=img_done;while(cp<img_done+oxyz) *(cp++)=0;
     max_radius=0;
 }
 
-/** This routine creates all periodic images of the particles. It is meant for
- * diagnostic purposes only, since usually periodic images are dynamically
- * created in when they are referenced. */
+/** Changes the vectors defining the periodic domain, keeping the particles in
+ * the container, and sets up the Voronoi computation objects for the new
+ * geometry.
+ * \param[in] (bx_) The x coordinate of the first unit vector.
+ * \param[in] (bxy_,by_) The x and y coordinates of the second unit vector.
+ * \param[in] (bxz_,byz_,bz_) The x, y, and z coordinates of the third unit
+ *                            vector.
+ * \return The number of particles that were moved into a different block. */
+int container_triclinic::deform(double bx_,double bxy_,double by_,double bxz_,double byz_,double bz_) {
+    int moved=deform_domain(bx_,bxy_,by_,bxz_,byz_,bz_);
+    change_number_thread(nt);
+    return moved;
+}
+
+/** Changes the vectors defining the periodic domain, keeping the particles in
+ * the container, and sets up the Voronoi computation objects for the new
+ * geometry.
+ * \param[in] (bx_) The x coordinate of the first unit vector.
+ * \param[in] (bxy_,by_) The x and y coordinates of the second unit vector.
+ * \param[in] (bxz_,byz_,bz_) The x, y, and z coordinates of the third unit
+ *                            vector.
+ * \return The number of particles that were moved into a different block. */
+int container_triclinic_poly::deform(double bx_,double bxy_,double by_,double bxz_,double byz_,double bz_) {
+    int moved=deform_domain(bx_,bxy_,by_,bxz_,byz_,bz_);
+    ppr=p;
+    change_number_thread(nt);
+    return moved;
+}
+
+/** Changes the vectors defining the periodic domain, keeping the particles in
+ * the container. Each particle is mapped affinely, so that its coordinates
+ * with respect to the domain vectors are unchanged. The particles are updated
+ * in place, and only those that move into a different block are transferred.
+ * The unit Voronoi cell and the block dimensions are recomputed, and the
+ * image blocks are emptied so that they are constructed again when they are
+ * next needed. The image region is only enlarged if the new unit Voronoi cell
+ * requires it, in which case the block arrays are reallocated.
+ * \param[in] (bx_) The x coordinate of the first unit vector.
+ * \param[in] (bxy_,by_) The x and y coordinates of the second unit vector.
+ * \param[in] (bxz_,byz_,bz_) The x, y, and z coordinates of the third unit
+ *                            vector.
+ * \return The number of particles that were moved into a different block. */
+int container_triclinic_base::deform_domain(double bx_,double bxy_,double by_,double bxz_,double byz_,double bz_) {
+    if(bx_<=0||by_<=0||bz_<=0)
+        voro_fatal_error("Domain vectors must have positive diagonal components",VOROPP_INTERNAL_ERROR);
+
+    // Store the inverse of the old domain vectors, and set up the new
+    // domain geometry
+    const double ibx=1/bx,iby=1/by,ibz=1/bz,obxy=bxy,obxz=bxz,obyz=byz;
+    set_domain(bx_,bxy_,by_,bxz_,byz_,bz_);
+    set_block_size(bx_/nx,by_/ny,bz_/nz);
+    max_len_sq=unit_voro.max_radius_squared();
+
+    // Empty the image blocks, enlarging the image region if the new unit
+    // Voronoi cell extends further than the current one
+    int ney=int(max_uv_y*ysp+1),nez=int(max_uv_z*zsp+1);
+    if(ney>ey||nez>ez) resize_image_region(ney>ey?ney:ey,nez>ez?nez:ez);
+    else {
+        const int nxoy=nx*oy;
+        for(int k=0;k<oz;k++) {
+            int l,*cop=co+nxoy*k;
+            if(k<ez||k>=wz) for(l=0;l<nxoy;l++) cop[l]=0;
+            else {
+                for(l=0;l<nx*ey;l++) cop[l]=0;
+                for(l=nx*wy;l<nxoy;l++) cop[l]=0;
+            }
+        }
+    }
+    char *cp=img;while(cp<img+oxyz) *(cp++)=0;
+    cp=img_done;while(cp<img_done+oxyz) *(cp++)=0;
+
+    // Map the particles to the new domain, keeping their coordinates with
+    // respect to the domain vectors fixed
+#pragma omp parallel for num_threads(nt)
+    for(int k=ez;k<wz;k++) for(int j=ey;j<wy;j++) for(int i=0;i<nx;i++) {
+        int l=i+nx*(j+oy*k);
+        double fx,fy,fz,*pp=p[l],*pe=pp+ps*co[l];
+        for(;pp<pe;pp+=ps) {
+            fz=pp[2]*ibz;
+            fy=(pp[1]-obyz*fz)*iby;
+            fx=(*pp-obxy*fy-obxz*fz)*ibx;
+            *pp=fx*bx+fy*bxy+fz*bxz;
+            pp[1]=fy*by+fz*byz;
+            pp[2]=fz*bz;
+        }
+    }
+
+    // Transfer the particles that are no longer in their block. A
+    // transferred particle is replaced by the last particle in the block.
+    // Particles that are transferred into a later block are checked again
+    // when that block is reached, but they are already in the correct place.
+    int ai,aj,ak,ci,cj,ck,ijk,l,q,moved=0;
+    double x,y,z,*pp,*np;
+    for(int k=ez;k<wz;k++) for(int j=ey;j<wy;j++) for(int i=0;i<nx;i++) {
+        l=i+nx*(j+oy*k);
+        for(q=0;q<co[l];) {
+            pp=p[l]+ps*q;
+            x=*pp;y=pp[1];z=pp[2];
+            remap(ai,aj,ak,ci,cj,ck,x,y,z,ijk);
+            if(ijk==l) {
+                *pp=x;pp[1]=y;pp[2]=z;q++;
+                continue;
+            }
+            if(co[ijk]==mem[ijk]) add_particle_memory(ijk,co[ijk]);
+            id[ijk][co[ijk]]=id[l][q];
+            np=p[ijk]+ps*co[ijk]++;
+            *np=x;np[1]=y;np[2]=z;
+            for(int c=3;c<ps;c++) np[c]=pp[c];
+            if(q<--co[l]) {
+                id[l][q]=id[l][co[l]];
+                memcpy(pp,p[l]+ps*co[l],ps*sizeof(double));
+            }
+            moved++;
+        }
+    }
+    return moved;
+}
+
+/** Enlarges the region of image blocks surrounding the primary domain. The
+ * block arrays are reallocated, the blocks in the primary domain are
+ * transferred into them, and the memory for the image blocks is freed.
+ * \param[in] (ney,nez) the new numbers of image blocks on each side of the
+ *                      primary domain in the y and z directions. */
+void container_triclinic_base::resize_image_region(int ney,int nez) {
+    int noy=ny+2*ney,noz=nz+2*nez,noxyz=nx*noy*noz,i,j,k,l,nl;
+    uint64_t **nid=new uint64_t*[noxyz];
+    double **np=new double*[noxyz];
+    int *nco=new int[noxyz],*nmem=new int[noxyz];
+    for(l=0;l<noxyz;l++) nco[l]=nmem[l]=0;
+
+    // Transfer the primary blocks and free the image blocks
+    for(k=l=0;k<oz;k++) for(j=0;j<oy;j++) for(i=0;i<nx;i++,l++) {
+        if(k>=ez&&k<wz&&j>=ey&&j<wy) {
+            nl=i+nx*(j-ey+ney+noy*(k-ez+nez));
+            nid[nl]=id[l];np[nl]=p[l];
+            nco[nl]=co[l];nmem[nl]=mem[l];
+        } else if(mem[l]>0) {
+            delete [] p[l];
+            delete [] id[l];
+        }
+    }
+    delete [] id;id=nid;
+    delete [] p;p=np;
+    delete [] co;co=nco;
+    delete [] mem;mem=nmem;
+    delete [] img;img=new char[noxyz];
+    delete [] img_done;img_done=new char[noxyz];
+
+    // Recreate the locks for the new number of z layers
+#ifdef _OPENMP
+    for(k=0;k<oz;k++) omp_destroy_lock(img_lock+k);
+    delete [] img_lock;
+    img_lock=new omp_lock_t[noz];
+    for(k=0;k<noz;k++) omp_init_lock(img_lock+k);
+#endif
+
+    // Update the dimensions of the block structure
+    ey=ney;ez=nez;wy=ny+ey;wz=nz+ez;
+    oy=noy;oz=noz;oxyz=noxyz;
+}
+
+/** This routine creates all periodic images of the particles. Usually periodic
+ * images are dynamically created when they are referenced, but calling this
+ * routine before a multithreaded computation means that the threads never
+ * need to wait for each other to construct them. Since constructing an image
+ * block only modifies blocks in the same z layer, the layers are processed in
+ * parallel. */
 void container_triclinic_base::create_all_images() {
-    int i,j,k;
-    for(k=0;k<oz;k++) for(j=0;j<oy;j++) for(i=0;i<nx;i++) create_periodic_image(i,j,k);
+#pragma omp parallel for num_threads(nt) schedule(dynamic)
+    for(int k=0;k<oz;k++) for(int j=0;j<oy;j++) for(int i=0;i<nx;i++) create_periodic_image(i,j,k);
 }
 
 /** Checks that the particles within each block lie within that block's bounds.
@@ -1005,6 +1302,15 @@ void container_triclinic::draw_cells_pov(FILE *fp) {
     }
 }
 
+/** Computes all Voronoi cells in parallel and saves the output in the VTK
+ * unstructured grid format, using the vtu_writer_3d class.
+ * \param[in] filename the name of the file to write to.
+ * \param[in] compress whether to compress the data with zlib. */
+void container_triclinic::draw_cells_vtu(const char *filename,bool compress) {
+    vtu_writer_3d vw(compress);
+    vw.write(*this,filename);
+}
+
 /** Computes the Voronoi cells and saves customized information about
  * them.
  * \param[in] vl the loop class to use.
@@ -1049,6 +1355,14 @@ double container_triclinic::sum_cell_volumes() {
     return vol;
 }
 
+/** Computes all of the Voronoi cells in parallel and accumulates aggregate
+ * statistics about them, using the cell_reduction_3d class.
+ * \param[in,out] cr the class holding the requested reductions, in which to
+ *                   store the results. */
+void container_triclinic::reduce_cells(cell_reduction_3d &cr) {
+    cr.compute(*this);
+}
+
 /** Dumps particle IDs and positions to a file.
  * \param[in] fp a file handle to write to. */
 void container_triclinic_poly::draw_particles(FILE *fp) {
@@ -1092,6 +1406,15 @@ void container_triclinic_poly::draw_cells_pov(FILE *fp) {
     }
 }
 
+/** Computes all Voronoi cells in parallel and saves the output in the VTK
+ * unstructured grid format, using the vtu_writer_3d class.
+ * \param[in] filename the name of the file to write to.
+ * \param[in] compress whether to compress the data with zlib. */
+void container_triclinic_poly::draw_cells_vtu(const char *filename,bool compress) {
+    vtu_writer_3d vw(compress);
+    vw.write(*this,filename);
+}
+
 /** Computes the Voronoi cells and saves customized information about
  * them.
  * \param[in] vl the loop class to use.
@@ -1136,4 +1459,12 @@ double container_triclinic_poly::sum_cell_volumes() {
     return vol;
 }
 
+/** Computes all of the Voronoi cells in parallel and accumulates aggregate
+ * statistics about them, using the cell_reduction_3d class.
+ * \param[in,out] cr the class holding the requested reductions, in which to
+ *                   store the results. */
+void container_triclinic_poly::reduce_cells(cell_reduction_3d &cr) {
+    cr.compute(*this);
+}
+
 }
@@ -21,6 +21,9 @@
 
 namespace voro {
 
+class cell_reduction_3d;
+template<class c_class> class particle_search_3d;
+
 /** \brief Class for representing a particle system in a 3D triclinic domain.
  *
  * This class represents a particle system in a three-dimensional triclinic
@@ -37,7 +40,7 @@ namespace voro {
  * information about the underlying computational grid. */
 class container_triclinic_base : public unitcell,  public voro_base_3d {
     public:
-        const double max_len_sq;
+        double max_len_sq;
         /** The lower y index (inclusive) of the primary domain within the
          * block structure. */
         int ey;
@@ -75,6 +78,10 @@ class container_triclinic_base : public unitcell,  public voro_base_3d {
         /** An array holding information about periodic image construction at a
          * given location. */
         char *img;
+        /** An array of flags that record which image blocks have been fully
+         * constructed. Once set, a flag is not changed until the container is
+         * cleared, so it can be read without taking a lock. */
+        char *img_done;
         /** The initial amount of memory to allocate for particles for each
          * block. */
         const int init_mem;
@@ -85,7 +92,7 @@ class container_triclinic_base : public unitcell,  public voro_base_3d {
          * also hold the particle radii. */
         const int ps;
         container_triclinic_base(double bx_,double bxy_,double by_,double bxz_,double byz_,double bz_,
-                int nx_,int ny_,int nz_,int init_mem_,int ps_,int nt_);
+                int nx_,int ny_,int nz_,int init_mem_,int ps_,int nt_,int hgrid_);
         ~container_triclinic_base();
         /** Prints all particles in the container, including those that have
          * been constructed in image blocks. */
@@ -95,6 +102,10 @@ class container_triclinic_base : public unitcell,  public voro_base_3d {
                 printf("%d %g %g %g\n",id[ijk][q],p[ijk][ps*q],p[ijk][ps*q+1],p[ijk][ps*q+2]);
         }
         void region_count();
+        /** Returns the maximum number of threads that can be used for
+         * computation.
+         * \return The number of threads. */
+        inline int number_thread() {return nt;}
         /** Initializes the Voronoi cell prior to a compute_cell operation for
          * a specific particle being carried out by a voro_compute class. The
          * cell is initialized to be the pre-computed unit Voronoi cell based
@@ -116,9 +127,14 @@ class container_triclinic_base : public unitcell,  public voro_base_3d {
             c=unit_voro;
             double *pp=p[ijk]+ps*q;
             x=*(pp++);y=*(pp++);z=*pp;
-            i=nx;j=ey;k=ez;
+            i=nx;j=ey;k=ez;disp=0;
             return true;
         }
+        /** Completes a Voronoi cell after a compute_cell operation. This has
+         * no effect for this container, which does not support walls.
+         * \return True, since the cell is never removed. */
+        template<class v_cell>
+        inline bool finalize_voronoicell(v_cell &c,int ijk,double x,double y,double z) {return true;}
         /** Initializes parameters for a find_voronoi_cell call within the
          * voro_compute template.
          * \param[in] (ci,cj,ck) the coordinates of the test block in the
@@ -130,7 +146,7 @@ class container_triclinic_base : public unitcell,  public voro_base_3d {
          *                  find_voronoi_cell routine (but not needed in this
          *                  instance.) */
         inline void initialize_search(int ci,int cj,int ck,int ijk,int &i,int &j,int &k,int &disp) {
-            i=nx;j=ey;k=ez;
+            i=nx;j=ey;k=ez;disp=0;
         }
         /** Returns the position of a particle currently being computed
          * relative to the computational block that it is within. It is used to
@@ -172,6 +188,7 @@ class container_triclinic_base : public unitcell,  public voro_base_3d {
         iterator end();
 
         friend class iterator_order;
+        friend class particle_search_3d<container_triclinic_base>;
         class iterator_order;
         iterator_order begin(particle_order &vo);
         iterator_order end(particle_order &vo);
@@ -187,17 +204,38 @@ class container_triclinic_base : public unitcell,  public voro_base_3d {
          * particles from up to two primary blocks. Otherwise is calls the more
          * complex create_vertical_image where the image block may comprise of
          * particles from up to four primary blocks.
+         *
+         * Blocks in the primary domain and image blocks that have already
+         * been constructed are detected without taking a lock, so that
+         * threads only wait for each other when an image block is first
+         * needed. Constructing an image block also adds particles to the
+         * neighboring image blocks in the same z layer, so the construction
+         * itself is carried out while holding the lock for that layer.
          * \param[in] (di,dj,dk) the coordinates of the image block to create.
          */
         inline void create_periodic_image(int di,int dj,int dk) {
             if(di<0||di>=nx||dj<0||dj>=oy||dk<0||dk>=oz)
                 voro_fatal_error("Constructing periodic image for nonexistent point",VOROPP_INTERNAL_ERROR);
+            bool side=dk>=ez&&dk<wz;
+            if(side&&dj>=ey&&dj<wy) return;
+            int dijk=di+nx*(dj+oy*dk);
+            char done;
+#pragma omp atomic read
+            done=img_done[dijk];
+            if(done) {
+#pragma omp flush
+                return;
+            }
 #ifdef _OPENMP
             omp_set_lock(img_lock+dk);
 #endif
-            if(dk>=ez&&dk<wz) {
-                if(dj<ey||dj>=wy) create_side_image(di,dj,dk);
-            } else create_vertical_image(di,dj,dk);
+            if(!img_done[dijk]) {
+                if(side) create_side_image(di,dj,dk);
+                else create_vertical_image(di,dj,dk);
+#pragma omp flush
+#pragma omp atomic write
+                img_done[dijk]=1;
+            }
 #ifdef _OPENMP
             omp_unset_lock(img_lock+dk);
 #endif
@@ -205,7 +243,24 @@ class container_triclinic_base : public unitcell,  public voro_base_3d {
         void create_side_image(int di,int dj,int dk);
         void create_vertical_image(int di,int dj,int dk);
         void put_image(int reg,int fijk,int l,double dx,double dy,double dz);
-        inline void remap(int &ai,int &aj,int &ak,int &ci,int &cj,int &ck,double &x,double &y,double &z,int &ijk);
+        int deform_domain(double bx_,double bxy_,double by_,double bxz_,double byz_,double bz_);
+        void resize_image_region(int ney,int nez);
+        inline bool remap(int &ai,int &aj,int &ak,int &ci,int &cj,int &ck,double &x,double &y,double &z,int &ijk);
+        /** Computes the position of a particle found by a search, applying
+         * the periodic image shifts of the search vector and of the block that
+         * the particle was found in.
+         * \param[in] (ai,aj,ak) the periodic image of the search vector.
+         * \param[in] (ci,cj,ck) the block that the search vector is in.
+         * \param[in] w the particle record from the search.
+         * \param[out] rp an array of length three in which to store the
+         *                particle position. */
+        inline void image_position(int ai,int aj,int ak,int ci,int cj,int ck,const particle_record_3d &w,double *rp) {
+            ci+=w.di;if(ci<0||ci>=nx) ai+=step_div(ci,nx);
+            double *pp=p[w.ijk]+ps*w.l;
+            *rp=*pp+ak*bxz+aj*bxy+ai*bx;
+            rp[1]=pp[1]+ak*byz+aj*by;
+            rp[2]=pp[2]+ak*bz;
+        }
         /** The maximum number of threads that can be used for computation. */
         int nt;
         /** The number of particles in the overflow buffer. */
@@ -232,10 +287,11 @@ class container_triclinic_base : public unitcell,  public voro_base_3d {
 class container_triclinic : public container_triclinic_base, public radius_mono {
     public:
         container_triclinic(double bx_,double bxy_,double by_,double bxz_,double byz_,double bz_,
-                int nx_,int ny_,int nz_,int init_mem_,int number_thread=1);
+                int nx_,int ny_,int nz_,int init_mem_,int number_thread=1,int hgrid_=wl_hgrid_3d);
         ~container_triclinic();
         void change_number_thread(int number_thread);
         void clear();
+        int deform(double bx_,double bxy_,double by_,double bxz_,double byz_,double bz_);
         void put(int i,double x,double y,double z);
         void put(int n,double x,double y,double z,int &ai,int &aj,int &ak);
         /** Put a particle into the correct region of the container.
@@ -288,6 +344,7 @@ class container_triclinic : public container_triclinic_base, public radius_mono
         }
         void compute_all_cells();
         double sum_cell_volumes();
+        void reduce_cells(cell_reduction_3d &cr);
         void draw_particles(FILE *fp=stdout);
         /** Dumps all of the particle IDs and positions to a file.
          * \param[in] filename the name of the file to write to. */
@@ -320,6 +377,7 @@ class container_triclinic : public container_triclinic_base, public radius_mono
             draw_cells_pov(fp);
             fclose(fp);
         }
+        void draw_cells_vtu(const char *filename,bool compress=false);
         void print_custom(const char *format,FILE *fp=stdout);
         /** Computes all the Voronoi cells and saves customized information
          * about them.
@@ -331,6 +389,10 @@ class container_triclinic : public container_triclinic_base, public radius_mono
             fclose(fp);
         }
         bool find_voronoi_cell(double x,double y,double z,double &rx,double &ry,double &rz,int &pid);
+        int find_k_nearest(double x,double y,double z,int kn,std::vector<uint64_t> &pid,std::vector<double> &rpos,std::vector<double> &rsq);
+        void find_k_nearest(int n,const double *pos,int kn,uint64_t *pid,double *rpos,double *rsq,int *cnt);
+        int find_within_radius(double x,double y,double z,double r,std::vector<uint64_t> &pid,std::vector<double> &rpos,std::vector<double> &rsq);
+        void find_within_radius(int n,const double *pos,double r,std::vector<uint64_t> &off,std::vector<uint64_t> &pid,std::vector<double> &rpos,std::vector<double> &rsq);
         /** Computes the Voronoi cell for given particle.
          * \param[out] c a Voronoi cell class in which to store the computed
          *               cell.
@@ -391,10 +453,11 @@ class container_triclinic : public container_triclinic_base, public radius_mono
 class container_triclinic_poly : public container_triclinic_base, public radius_poly_3d {
     public:
         container_triclinic_poly(double bx_,double bxy_,double by_,double bxz_,double byz_,double bz_,
-                int nx_,int ny_,int nz_,int init_mem_,int number_thread=1);
+                int nx_,int ny_,int nz_,int init_mem_,int number_thread=1,int hgrid_=wl_hgrid_3d);
         ~container_triclinic_poly();
         void change_number_thread(int number_thread);
         void clear();
+        int deform(double bx_,double bxy_,double by_,double bxz_,double byz_,double bz_);
         void put(int n,double x,double y,double z,double r);
         void put(int n,double x,double y,double z,double r,int &ai,int &aj,int &ak);
         /** Put a particle into the correct region of the container.
@@ -449,6 +512,7 @@ class container_triclinic_poly : public container_triclinic_base, public radius_
         }
         void compute_all_cells();
         double sum_cell_volumes();
+        void reduce_cells(cell_reduction_3d &cr);
         void draw_particles(FILE *fp=stdout);
         /** Dumps all of the particle IDs, positions and radii to a file.
          * \param[in] filename the name of the file to write to. */
@@ -481,6 +545,7 @@ class container_triclinic_poly : public container_triclinic_base, public radius_
             draw_cells_pov(fp);
             fclose(fp);
         }
+        void draw_cells_vtu(const char *filename,bool compress=false);
         void print_custom(const char *format,FILE *fp=stdout);
         /** Computes all the Voronoi cells and saves customized information
          * about them.
@@ -538,6 +603,10 @@ class container_triclinic_poly : public container_triclinic_base, public radius_
             return q;
         }
         bool find_voronoi_cell(double x,double y,double z,double &rx,double &ry,double &rz,int &pid);
+        int find_k_nearest(double x,double y,double z,int kn,std::vector<uint64_t> &pid,std::vector<double> &rpos,std::vector<double> &rsq);
+        void find_k_nearest(int n,const double *pos,int kn,uint64_t *pid,double *rpos,double *rsq,int *cnt);
+        int find_within_radius(double x,double y,double z,double r,std::vector<uint64_t> &pid,std::vector<double> &rpos,std::vector<double> &rsq);
+        void find_within_radius(int n,const double *pos,double r,std::vector<uint64_t> &off,std::vector<uint64_t> &pid,std::vector<double> &rpos,std::vector<double> &rsq);
     private:
         void put_parallel_internal(int i,int ijk,double x,double y,double z,double r);
         /** An array of pointers to Voronoi computation objects for use by the
@@ -0,0 +1,412 @@
+// Voro++, a cell-based Voronoi library
+// By Chris H. Rycroft and the Rycroft Group
+
+/** \file delaunay_3d.cc
+ * \brief Function implementations for the delaunay_3d class. */
+
+#include <cmath>
+#include <algorithm>
+#include <utility>
+
+#include "delaunay_3d.hh"
+#include "cell_3d.hh"
+#include "container_3d.hh"
+#include "container_tri.hh"
+#include "iter_3d.hh"
+
+namespace voro {
+
+/** Compares two simplices stored in flattened arrays, first by size and then
+ * lexicographically by their vertices. */
+struct delaunay_order_3d {
+    const std::vector<int> &k;
+    const std::vector<uint64_t> &o;
+    const std::vector<delaunay_member_3d> &m;
+    delaunay_order_3d(const std::vector<int> &k_,const std::vector<uint64_t> &o_,const std::vector<delaunay_member_3d> &m_)
+        : k(k_), o(o_), m(m_) {}
+    inline bool operator()(int r,int s) const {
+        if(k[r]!=k[s]) return k[r]<k[s];
+        for(int l=0;l<k[r];l++) if(!(m[o[r]+l]==m[o[s]+l])) return m[o[r]+l]<m[o[s]+l];
+        return r<s;
+    }
+    inline bool same(int r,int s) const {
+        if(k[r]!=k[s]) return false;
+        for(int l=0;l<k[r];l++) if(!(m[o[r]+l]==m[o[s]+l])) return false;
+        return true;
+    }
+};
+
+/** Computes all of the Voronoi cells in a container in parallel, and extracts
+ * the dual Delaunay tetrahedralization. The computation has three stages:
+ *
+ * 1. Each thread computes a range of cells, and for every vertex of each
+ *    cell, it stores the simplex made up of the particle and the neighbors
+ *    of the faces that meet at the vertex. The periodic image of each
+ *    neighbor is found by reflecting the particle through the face plane.
+ * 2. The simplices are hashed into partitions, and each partition is sorted
+ *    in parallel to merge the copies that are found by different cells.
+ * 3. Simplices that have vertices of order higher than three, or that are
+ *    not found by all of their cells, are grouped with the other simplices
+ *    that share a particle and have a coincident Voronoi vertex. Each group
+ *    is merged into one degenerate simplex, or into a tetrahedron if it only
+ *    has four particles.
+ *
+ * \param[in] con the container class to use. */
+template<class c_class>
+void delaunay_3d::compute(c_class &con) {
+    std::vector<int> ijk,q;
+    const int nt=con.number_thread();
+    const double tol=sqrt(tolerance*con.max_len_sq);
+    int i;
+
+    // Collect the particles in the container, and sort them into rows
+    setup_lattice(con);
+    id.clear();
+    for(typename c_class::iterator cli=con.begin();cli<con.end();cli++) {
+        ijk.push_back(cli->ijk);q.push_back(cli->q);
+        id.push_back(con.id[cli->ijk][cli->q]);
+    }
+    n=id.size();
+    direct=voro_sort_rows(id,ijk,q);
+    pos.resize(4*n);
+    for(i=0;i<n;i++) {
+        double *pp=con.p[ijk[i]]+con.ps*q[i],*qp=pos.data()+4*i;
+        *qp=*pp;qp[1]=pp[1];qp[2]=pp[2];qp[3]=con.ps==4?pp[3]:0;
+    }
+
+    // Compute the cells, and store the simplex and the Voronoi vertex
+    // position for every vertex that does not touch a wall
+    std::vector<int> *tk=new std::vector<int>[nt];
+    std::vector<delaunay_member_3d> *tm=new std::vector<delaunay_member_3d>[nt];
+    std::vector<double> *tp=new std::vector<double>[nt];
+#pragma omp parallel num_threads(nt)
+    {
+        voronoicell_neighbor_3d c(con);
+        std::vector<int> nb,fv,vo,vfo,vf;
+        std::vector<double> vv,nm;
+        std::vector<delaunay_member_3d> fm,s;
+        const int t=t_num();
+#pragma omp for schedule(dynamic,64)
+        for(int i=0;i<n;i++) {
+            if(!con.compute_cell(c,ijk[i],q[i])) continue;
+            const double *pp=pos.data()+4*i;
+            c.neighbors(nb);c.face_vertices(fv);c.vertices(vv);
+            c.normals(nm);c.vertex_orders(vo);
+            int nf=nb.size(),nv=vo.size(),f,l,v;
+
+            // Find the periodic image of the neighbor across each face. The
+            // neighbor lies along the face normal, at the distance where the
+            // plane is the (radical) bisector. If the normal is degenerate,
+            // then the nearest image is used.
+            fm.resize(nf);
+            std::vector<int>::iterator fp=fv.begin();
+            for(f=0;f<nf;f++,fp+=*fp+1) {
+                int j=row(nb[f]);
+                if(j<0) {fm[f].id=-1;continue;}
+                const double *np=nm.data()+3*f,*vp=vv.data()+3*fp[1],*pj=pos.data()+4*j;
+                double D=0;
+                if(np[0]*np[0]+np[1]*np[1]+np[2]*np[2]>0.5) {
+                    double h=np[0]*vp[0]+np[1]*vp[1]+np[2]*vp[2],
+                           dis=h*h+pj[3]*pj[3]-pp[3]*pp[3];
+                    D=h+sqrt(dis>0?dis:0);
+                }
+                fm[f].id=nb[f];
+                image(*pp+D*np[0],pp[1]+D*np[1],pp[2]+D*np[2],pj,fm[f]);
+            }
+
+            // Find the faces that meet at each vertex
+            vfo.assign(nv+1,0);
+            for(fp=fv.begin();fp!=fv.end();fp+=*fp+1) for(l=1;l<=*fp;l++) vfo[fp[l]+1]++;
+            for(v=0;v<nv;v++) vfo[v+1]+=vfo[v];
+            vf.resize(vfo[nv]);
+            for(f=0,fp=fv.begin();fp!=fv.end();f++,fp+=*fp+1) for(l=1;l<=*fp;l++) vf[vfo[fp[l]]++]=f;
+            for(v=nv;v>0;v--) vfo[v]=vfo[v-1];
+            vfo[0]=0;
+
+            // Store the simplex of each vertex in canonical form
+            for(v=0;v<nv;v++) {
+                s.resize(1);
+                s[0].id=int(id[i]);s[0].a=s[0].b=s[0].c=0;
+                for(l=vfo[v];l<vfo[v+1];l++) {
+                    if(fm[vf[l]].id<0) break;
+                    s.push_back(fm[vf[l]]);
+                }
+                if(l<vfo[v+1]) continue;
+                double x[3]={*pp+vv[3*v],pp[1]+vv[3*v+1],pp[2]+vv[3*v+2]};
+                canonical(s.data(),s.size(),x);
+                tk[t].push_back(s.size());
+                tm[t].insert(tm[t].end(),s.begin(),s.end());
+                tp[t].insert(tp[t].end(),x,x+3);
+            }
+        }
+    }
+
+    // Concatenate the simplices from each thread
+    std::vector<int> rk;
+    std::vector<uint64_t> ro;
+    std::vector<delaunay_member_3d> rm;
+    std::vector<double> rp;
+    for(int t=0;t<nt;t++) {
+        rk.insert(rk.end(),tk[t].begin(),tk[t].end());
+        rm.insert(rm.end(),tm[t].begin(),tm[t].end());
+        rp.insert(rp.end(),tp[t].begin(),tp[t].end());
+    }
+    delete [] tp;delete [] tm;delete [] tk;
+    const int nr=rk.size();
+    ro.resize(nr+1);ro[0]=0;
+    for(i=0;i<nr;i++) ro[i+1]=ro[i]+rk[i];
+
+    // Hash the simplices into partitions
+    std::vector<unsigned int> ph(nr);
+    std::vector<int> po(partitions+1,0);
+    std::vector<std::pair<unsigned int,int> > pi(nr);
+#pragma omp parallel for num_threads(nt)
+    for(int r=0;r<nr;r++) ph[r]=hash(rm.data()+ro[r],rk[r]);
+    for(i=0;i<nr;i++) po[ph[i]%partitions+1]++;
+    for(i=0;i<partitions;i++) po[i+1]+=po[i];
+    {
+        std::vector<int> pc(po.begin(),po.end()-1);
+        for(i=0;i<nr;i++) pi[pc[ph[i]%partitions]++]=std::make_pair(ph[i],i);
+    }
+
+    // Sort each partition by hash value, and merge the identical simplices
+    // within each run of equal hash values, recording the number of cells
+    // that found each one
+    delaunay_order_3d dord(rk,ro,rm);
+    std::vector<std::vector<std::pair<int,int> > > pu(partitions);
+#pragma omp parallel for num_threads(nt) schedule(dynamic,1)
+    for(int p=0;p<partitions;p++) {
+        std::vector<std::pair<unsigned int,int> >::iterator pb=pi.begin()+po[p],pe=pi.begin()+po[p+1],it,it2;
+        std::vector<int> w;
+        std::sort(pb,pe);
+        for(it=pb;it<pe;it=it2) {
+            for(it2=it+1;it2<pe&&it2->first==it->first;it2++);
+            w.clear();
+            for(;it<it2;it++) w.push_back(it->second);
+            if(w.size()>1) std::sort(w.begin(),w.end(),dord);
+            for(std::vector<int>::iterator wi=w.begin(),wj;wi<w.end();wi=wj) {
+                for(wj=wi+1;wj<w.end()&&dord.same(*wi,*wj);wj++);
+                pu[p].push_back(std::make_pair(*wi,int(wj-wi)));
+            }
+        }
+    }
+    std::vector<std::pair<int,int> > u;
+    for(int p=0;p<partitions;p++) u.insert(u.end(),pu[p].begin(),pu[p].end());
+    const int nu=u.size();
+
+    // Index the unique simplices by the rows of their particles
+    std::vector<uint64_t> xo(n+1,0);
+    std::vector<int> xs;
+    for(int r=0;r<nu;r++) for(uint64_t e=ro[u[r].first];e<ro[u[r].first+1];e++) xo[row(rm[e].id)+1]++;
+    for(i=0;i<n;i++) xo[i+1]+=xo[i];
+    xs.resize(xo[n]);
+    {
+        std::vector<uint64_t> xc(xo.begin(),xo.end()-1);
+        for(int r=0;r<nu;r++) for(uint64_t e=ro[u[r].first];e<ro[u[r].first+1];e++) xs[xc[row(rm[e].id)]++]=r;
+    }
+
+    // Group the degenerate and inconsistent simplices with any simplices
+    // that share a particle and a Voronoi vertex, using a union-find
+    // structure
+    std::vector<int> uf(nu),fl;
+    for(int r=0;r<nu;r++) {
+        uf[r]=r;
+        if(u[r].second<rk[u[r].first]||rk[u[r].first]>4) fl.push_back(r);
+    }
+    for(std::vector<int>::iterator it=fl.begin();it<fl.end();it++) {
+        int r=*it,rr=u[r].first,kk[3];
+        for(uint64_t e=ro[rr];e<ro[rr+1];e++) {
+            int j=row(rm[e].id);
+            for(uint64_t g=xo[j];g<xo[j+1];g++) {
+                int s=xs[g],sr=u[s].first;
+                double d[3]={rp[3*rr]-rp[3*sr],rp[3*rr+1]-rp[3*sr+1],rp[3*rr+2]-rp[3*sr+2]};
+                lattice_round(d,kk);
+                if(d[0]*d[0]+d[1]*d[1]+d[2]*d[2]<tol*tol) {
+                    int a=r,b=s;
+                    while(uf[a]!=a) a=uf[a]=uf[uf[a]];
+                    while(uf[b]!=b) b=uf[b]=uf[uf[b]];
+                    if(a<b) uf[b]=a;else uf[a]=b;
+                }
+            }
+        }
+    }
+
+    // Store the tetrahedra that are consistent and not grouped
+    std::vector<char> gr(nu,0);
+    for(std::vector<int>::iterator it=fl.begin();it<fl.end();it++) {
+        int r=*it;
+        gr[r]=1;
+        while(uf[r]!=r) r=uf[r];
+        gr[r]=1;
+    }
+    for(int r=0;r<nu;r++) if(uf[r]!=r) gr[r]=1;
+    tet.clear();
+    for(int r=0;r<nu;r++) if(!gr[r]) tet.insert(tet.end(),rm.begin()+ro[u[r].first],rm.begin()+ro[u[r].first+1]);
+
+    // Merge each group into a single simplex, shifting the particles of each
+    // simplex into the frame of the root
+    std::vector<std::pair<int,int> > gl;
+    for(int r=0;r<nu;r++) if(gr[r]) {
+        int a=r;
+        while(uf[a]!=a) a=uf[a];
+        gl.push_back(std::make_pair(a,r));
+    }
+    std::sort(gl.begin(),gl.end());
+    deg.clear();deg_off.assign(1,0);
+    inconsistent=0;
+    std::vector<delaunay_member_3d> s;
+    for(std::vector<std::pair<int,int> >::iterator it=gl.begin();it<gl.end();) {
+        int a=it->first,ar=u[a].first,kk[3];
+        bool inc=false;
+        s.clear();
+        for(;it<gl.end()&&it->first==a;it++) {
+            int sr=u[it->second].first;
+            if(u[it->second].second<rk[sr]) inc=true;
+            double d[3]={rp[3*ar]-rp[3*sr],rp[3*ar+1]-rp[3*sr+1],rp[3*ar+2]-rp[3*sr+2]};
+            lattice_round(d,kk);
+            for(uint64_t e=ro[sr];e<ro[sr+1];e++) {
+                delaunay_member_3d m=rm[e];
+                m.a+=*kk;m.b+=kk[1];m.c+=kk[2];
+                s.push_back(m);
+            }
+        }
+        std::sort(s.begin(),s.end());
+        s.erase(std::unique(s.begin(),s.end()),s.end());
+        canonical(s.data(),s.size(),NULL);
+        if(inc) inconsistent++;
+        if(s.size()==4) tet.insert(tet.end(),s.begin(),s.end());
+        else {
+            deg.insert(deg.end(),s.begin(),s.end());
+            deg_off.push_back(deg.size());
+        }
+    }
+
+    // Orient the tetrahedra to have positive volume
+#pragma omp parallel for num_threads(nt)
+    for(int r=0;r<int(tet.size()/4);r++) if(orient(tet.data()+4*r)<0) std::swap(tet[4*r+2],tet[4*r+3]);
+}
+
+/** Sets up the lattice vectors for a rectangular container, using the
+ * container dimensions in the periodic directions.
+ * \param[in] con the container. */
+void delaunay_3d::setup_lattice(container_base_3d &con) {
+    for(int l=0;l<9;l++) lat[l]=0;
+    if(con.x_prd) *lat=con.bx-con.ax;
+    if(con.y_prd) lat[4]=con.by-con.ay;
+    if(con.z_prd) lat[8]=con.bz-con.az;
+}
+
+/** Sets up the lattice vectors for a triclinic container.
+ * \param[in] con the container. */
+void delaunay_3d::setup_lattice(container_triclinic_base &con) {
+    *lat=con.bx;lat[1]=lat[2]=0;
+    lat[3]=con.bxy;lat[4]=con.by;lat[5]=0;
+    lat[6]=con.bxz;lat[7]=con.byz;lat[8]=con.bz;
+}
+
+/** Finds the periodic image of a particle that lies closest to a given
+ * position.
+ * \param[in] (x,y,z) the position.
+ * \param[in] pj a pointer to the position of the particle.
+ * \param[out] m the vertex in which to store the periodic image. */
+void delaunay_3d::image(double x,double y,double z,const double *pj,delaunay_member_3d &m) {
+    double d[3]={x-*pj,y-pj[1],z-pj[2]};
+    int k[3];
+    lattice_round(d,k);
+    m.a=*k;m.b=k[1];m.c=k[2];
+}
+
+/** Reduces a vector by the nearest combination of lattice vectors.
+ * \param[in,out] d the vector to reduce.
+ * \param[out] k the number of each lattice vector that was removed. */
+void delaunay_3d::lattice_round(double *d,int *k) {
+    for(int l=2;l>=0;l--) {
+        const double *lp=lat+3*l;
+        k[l]=lp[l]>0?int(nearbyint(d[l]/lp[l])):0;
+        *d-=k[l]*(*lp);d[1]-=k[l]*lp[1];d[2]-=k[l]*lp[2];
+    }
+}
+
+/** Puts a simplex into canonical form. The simplex is translated by a
+ * lattice vector so that one of its particles with the lowest ID is in the
+ * primary image, and its vertices are sorted. Of the possible choices, the
+ * lexicographically smallest is used.
+ * \param[in,out] s the vertices of the simplex.
+ * \param[in] k the number of vertices.
+ * \param[in,out] x the position of the Voronoi vertex, which is translated
+ *                  along with the simplex. This may be NULL. */
+void delaunay_3d::canonical(delaunay_member_3d *s,int k,double *x) {
+    const int ms=16;
+    delaunay_member_3d bs[ms],ws[ms];
+    std::vector<delaunay_member_3d> bv,wv;
+    if(k>ms) {bv.resize(k);wv.resize(k);}
+    delaunay_member_3d *b=k>ms?bv.data():bs,*w=k>ms?wv.data():ws;
+    int l,mid=s[0].id,ba=0,bb=0,bc=0;
+    bool f=true;
+    for(l=1;l<k;l++) if(s[l].id<mid) mid=s[l].id;
+    for(l=0;l<k;l++) if(s[l].id==mid) {
+        int a=s[l].a,bq=s[l].b,c=s[l].c;
+        for(int e=0;e<k;e++) {
+            w[e]=s[e];w[e].a-=a;w[e].b-=bq;w[e].c-=c;
+        }
+        std::sort(w,w+k);
+        if(f||std::lexicographical_compare(w,w+k,b,b+k)) {
+            std::swap(b,w);
+            ba=a;bb=bq;bc=c;f=false;
+        }
+    }
+    std::copy(b,b+k,s);
+    if(x!=NULL) for(l=0;l<3;l++) x[l]-=ba*lat[l]+bb*lat[3+l]+bc*lat[6+l];
+}
+
+/** Computes a hash of a simplex.
+ * \param[in] s the vertices of the simplex.
+ * \param[in] k the number of vertices.
+ * \return The hash value. */
+unsigned int delaunay_3d::hash(const delaunay_member_3d *s,int k) {
+    unsigned int h=2166136261u;
+    for(int l=0;l<k;l++) {
+        h=(h^unsigned(s[l].id))*16777619u;
+        h=(h^(unsigned(s[l].a)+(unsigned(s[l].b)<<8)+(unsigned(s[l].c)<<16)))*16777619u;
+    }
+    return h^(h>>15);
+}
+
+/** Computes six times the signed volume of a tetrahedron.
+ * \param[in] s the vertices of the tetrahedron.
+ * \return The signed volume. */
+double delaunay_3d::orient(const delaunay_member_3d *s) {
+    double x[12];
+    for(int l=0;l<4;l++) {
+        const double *pp=pos.data()+4*row(s[l].id);
+        for(int e=0;e<3;e++) x[3*l+e]=pp[e]+s[l].a*lat[e]+s[l].b*lat[3+e]+s[l].c*lat[6+e];
+    }
+    for(int l=3;l<12;l++) x[l]-=x[l%3];
+    return x[3]*(x[7]*x[11]-x[8]*x[10])-x[4]*(x[6]*x[11]-x[8]*x[9])+x[5]*(x[6]*x[10]-x[7]*x[9]);
+}
+
+/** Outputs the tetrahedra, followed by the degenerate simplices. Each line
+ * gives the number of vertices, followed by the particle ID and the periodic
+ * image of each vertex.
+ * \param[in] fp a file handle to write to. */
+void delaunay_3d::output(FILE *fp) {
+    int i,l;
+    for(i=0;i<tetrahedra();i++) {
+        fputc('4',fp);
+        for(l=4*i;l<4*i+4;l++) fprintf(fp," %d %d %d %d",tet[l].id,tet[l].a,tet[l].b,tet[l].c);
+        fputc('\n',fp);
+    }
+    for(i=0;i<degenerate();i++) {
+        fprintf(fp,"%d",int(deg_off[i+1]-deg_off[i]));
+        for(l=deg_off[i];l<int(deg_off[i+1]);l++) fprintf(fp," %d %d %d %d",deg[l].id,deg[l].a,deg[l].b,deg[l].c);
+        fputc('\n',fp);
+    }
+}
+
+// Explicit template instantiation
+template void delaunay_3d::compute(container_3d&);
+template void delaunay_3d::compute(container_poly_3d&);
+template void delaunay_3d::compute(container_triclinic&);
+template void delaunay_3d::compute(container_triclinic_poly&);
+
+}
@@ -0,0 +1,125 @@
+// Voro++, a cell-based Voronoi library
+// By Chris H. Rycroft and the Rycroft Group
+
+/** \file delaunay_3d.hh
+ * \brief Header file for the delaunay_3d class. */
+
+#ifndef VOROPP_DELAUNAY_3D_HH
+#define VOROPP_DELAUNAY_3D_HH
+
+#include <cstdio>
+#include <inttypes.h>
+
+#include <vector>
+
+#include "config.hh"
+#include "common.hh"
+
+namespace voro {
+
+class container_base_3d;
+class container_triclinic_base;
+
+/** \brief A structure holding a vertex of a Delaunay simplex.
+ *
+ * A vertex of a Delaunay simplex is given by a particle ID and the periodic
+ * image of the particle. The image is specified by the number of periodic
+ * lengths to add in each lattice direction, so that for a rectangular
+ * container the position is (x+a*(bx-ax),y+b*(by-ay),z+c*(bz-az)), and for a
+ * triclinic container it is the particle position plus a*(bx,0,0) +
+ * b*(bxy,by,0) + c*(bxz,byz,bz). */
+struct delaunay_member_3d {
+    /** The particle ID. */
+    int id;
+    /** The periodic image in each lattice direction. */
+    int a,b,c;
+    /** Compares two vertices lexicographically by ID and then by image. */
+    inline bool operator<(const delaunay_member_3d &o) const {
+        return id!=o.id?id<o.id:(a!=o.a?a<o.a:(b!=o.b?b<o.b:c<o.c));
+    }
+    /** Tests whether two vertices are identical. */
+    inline bool operator==(const delaunay_member_3d &o) const {
+        return id==o.id&&a==o.a&&b==o.b&&c==o.c;
+    }
+};
+
+/** \brief A class for extracting the Delaunay tetrahedralization that is dual
+ * to a Voronoi tessellation.
+ *
+ * Each vertex of a Voronoi cell is equidistant from the particle and from the
+ * neighbors that generate the faces meeting at the vertex. A vertex of order
+ * three therefore corresponds to a Delaunay tetrahedron, and a vertex of
+ * higher order corresponds to a degenerate set of five or more cospherical
+ * particles, for which the Delaunay tetrahedralization is not unique.
+ *
+ * The delaunay_3d class computes all of the Voronoi cells in a container in
+ * parallel and collects the simplex of every vertex, determining the periodic
+ * image of each neighbor from the geometry of the shared face. Each simplex
+ * is put into a canonical form relative to its lowest particle ID, and the
+ * copies that are found by the different cells are merged by hashing the
+ * simplices into partitions that are sorted independently. The results are
+ * ordered deterministically, independent of the number of threads. Vertices
+ * that lie on walls or on the container boundary are not part of any
+ * simplex. */
+class delaunay_3d {
+    public:
+        /** The vertices of the tetrahedra, with four entries per
+         * tetrahedron. The vertices are ordered so that each tetrahedron has
+         * positive volume. */
+        std::vector<delaunay_member_3d> tet;
+        /** The offsets of each degenerate simplex into the deg array. */
+        std::vector<uint64_t> deg_off;
+        /** The vertices of the degenerate simplices, in canonical order. */
+        std::vector<delaunay_member_3d> deg;
+        /** The number of simplices that were not found by all of the cells
+         * that they belong to, which indicates that the topology of the
+         * neighboring cells is inconsistent due to numerical tolerances. */
+        int inconsistent;
+        delaunay_3d() : inconsistent(0) {}
+        template<class c_class>
+        void compute(c_class &con);
+        /** Returns the number of tetrahedra.
+         * \return The number of tetrahedra. */
+        inline int tetrahedra() {return tet.size()/4;}
+        /** Returns the number of degenerate simplices.
+         * \return The number of degenerate simplices. */
+        inline int degenerate() {return deg_off.empty()?0:int(deg_off.size())-1;}
+        void output(FILE *fp=stdout);
+        /** Saves the tetrahedra and the degenerate simplices to a file.
+         * \param[in] filename the name of the file to write to. */
+        inline void output(const char *filename) {
+            FILE *fp=safe_fopen(filename,"w");
+            output(fp);
+            fclose(fp);
+        }
+    private:
+        /** The number of partitions that the simplices are hashed into. */
+        static const int partitions=64;
+        /** The number of particles. */
+        int n;
+        /** Whether the particle IDs are exactly 0 to n-1, in which case the
+         * row of a particle is equal to its ID. */
+        bool direct;
+        /** The particle ID of each row, in ascending order. */
+        std::vector<uint64_t> id;
+        /** The position and radius of the particle in each row. */
+        std::vector<double> pos;
+        /** The three lattice vectors, which are zero in non-periodic
+         * directions. */
+        double lat[9];
+        void setup_lattice(container_base_3d &con);
+        void setup_lattice(container_triclinic_base &con);
+        /** Finds the row corresponding to a particle ID.
+         * \param[in] pid the particle ID to find.
+         * \return The row, or -1 if the particle is not in the container. */
+        inline int row(int pid) {return voro_find_row(direct,id,pid);}
+        void image(double x,double y,double z,const double *pj,delaunay_member_3d &m);
+        void lattice_round(double *d,int *k);
+        void canonical(delaunay_member_3d *s,int k,double *x);
+        unsigned int hash(const delaunay_member_3d *s,int k);
+        double orient(const delaunay_member_3d *s);
+};
+
+}
+
+#endif
@@ -0,0 +1,181 @@
+// Voro++, a cell-based Voronoi library
+// By Chris H. Rycroft and the Rycroft Group
+
+/** \file neighbor_graph_3d.cc
+ * \brief Function implementations for the neighbor_graph_3d class. */
+
+#include <algorithm>
+#include <utility>
+
+#include "neighbor_graph_3d.hh"
+#include "cell_3d.hh"
+#include "container_3d.hh"
+#include "container_tri.hh"
+#include "iter_3d.hh"
+
+namespace voro {
+
+/** Computes all of the Voronoi cells in a container in parallel, and stores
+ * the neighbor graph. The particles are split into one contiguous range of
+ * rows per thread, and each thread gathers the entries for its range before
+ * they are copied into the CSR arrays.
+ * \param[in] con the container class to use.
+ * \param[in] face_areas whether to store the area of each shared face.
+ * \param[in] face_normals whether to store the normal of each shared face.
+ * \param[in] walls whether to store faces that are formed by walls or by the
+ *                  container boundary. */
+template<class c_class>
+void neighbor_graph_3d::compute(c_class &con,bool face_areas,bool face_normals,bool walls) {
+    std::vector<int> ijk,q;
+    const int nt=con.number_thread();
+
+    // Collect the particles in the container, and sort them into rows
+    id.clear();
+    for(typename c_class::iterator cli=con.begin();cli<con.end();cli++) {
+        ijk.push_back(cli->ijk);q.push_back(cli->q);
+        id.push_back(con.id[cli->ijk][cli->q]);
+    }
+    n=id.size();
+    direct=voro_sort_rows(id,ijk,q);
+    off.resize(n+1);
+
+    // Compute the cells and gather the entries for each range of rows
+    std::vector<int> *tnbr=new std::vector<int>[nt];
+    std::vector<double> *tarea=new std::vector<double>[nt],*tnorm=new std::vector<double>[nt];
+#pragma omp parallel num_threads(nt)
+    {
+        voronoicell_neighbor_3d c(con);
+        std::vector<int> v;
+        std::vector<double> fa,fn;
+#pragma omp for schedule(static,1)
+        for(int t=0;t<nt;t++) {
+            for(int i=int((int64_t) n*t/nt);i<int((int64_t) n*(t+1)/nt);i++) {
+                int m=0;
+                if(con.compute_cell(c,ijk[i],q[i])) {
+                    c.neighbors(v);
+                    if(face_areas) c.face_areas(fa);
+                    if(face_normals) c.normals(fn);
+                    for(int f=0;f<(int) v.size();f++) if(walls||v[f]>=0) {
+                        tnbr[t].push_back(v[f]);
+                        if(face_areas) tarea[t].push_back(fa[f]);
+                        if(face_normals) tnorm[t].insert(tnorm[t].end(),fn.begin()+3*f,fn.begin()+3*f+3);
+                        m++;
+                    }
+                }
+                off[i+1]=m;
+            }
+        }
+    }
+
+    // Compute the offsets, and copy the entries into the CSR arrays
+    off[0]=0;
+    for(int i=0;i<n;i++) off[i+1]+=off[i];
+    nbr.resize(off[n]);
+    area.resize(face_areas?off[n]:0);
+    normal.resize(face_normals?3*off[n]:0);
+#pragma omp parallel for num_threads(nt)
+    for(int t=0;t<nt;t++) {
+        uint64_t o=off[int((int64_t) n*t/nt)];
+        std::copy(tnbr[t].begin(),tnbr[t].end(),nbr.begin()+o);
+        std::copy(tarea[t].begin(),tarea[t].end(),area.begin()+(face_areas?o:0));
+        std::copy(tnorm[t].begin(),tnorm[t].end(),normal.begin()+(face_normals?3*o:0));
+    }
+    delete [] tnorm;
+    delete [] tarea;
+    delete [] tnbr;
+}
+
+/** Tests whether an entry in the graph has a matching entry in the row of the
+ * neighbor.
+ * \param[in] i the row of the entry.
+ * \param[in] e the index of the entry.
+ * \param[out] j the row of the neighbor, or -1 if the neighbor is not in the
+ *               graph.
+ * \return True if the matching entry exists, false otherwise. */
+bool neighbor_graph_3d::reverse_entry(int i,uint64_t e,int &j) {
+    j=row(nbr[e]);
+    if(j<0) return false;
+    const int pi=int(id[i]);
+    for(uint64_t f=off[j];f<off[j+1];f++) if(nbr[f]==pi) return true;
+    return false;
+}
+
+/** Counts the asymmetric entries in the graph, where a particle lists a
+ * neighbor that does not list it in return. Wall faces are not considered.
+ * \return The number of asymmetric entries. */
+uint64_t neighbor_graph_3d::validate() {
+    uint64_t na=0;
+#pragma omp parallel for schedule(dynamic,1024) reduction(+:na)
+    for(int i=0;i<n;i++) {
+        int j;
+        for(uint64_t e=off[i];e<off[i+1];e++)
+            if(nbr[e]>=0&&!reverse_entry(i,e,j)) na++;
+    }
+    return na;
+}
+
+/** Makes the graph symmetric. By default, asymmetric entries are removed, so
+ * that two particles are neighbors only if both cells have the shared face.
+ * Alternatively, the missing reverse entries can be added, taking the face
+ * area from the existing entry and reversing its normal. Entries referring to
+ * particles that are not in the graph are removed in both cases.
+ * \param[in] keep_union whether to add the missing reverse entries instead of
+ *                       removing the asymmetric entries.
+ * \return The number of asymmetric entries that were found. */
+uint64_t neighbor_graph_3d::symmetrize(bool keep_union) {
+    uint64_t na=0,ne=entries();
+    std::vector<int> rj(ne,-2);
+
+    // Mark each asymmetric entry with the row of its neighbor, leaving -2 for
+    // entries that are kept as they are
+#pragma omp parallel for schedule(dynamic,1024) reduction(+:na)
+    for(int i=0;i<n;i++) {
+        int j;
+        for(uint64_t e=off[i];e<off[i+1];e++)
+            if(nbr[e]>=0&&!reverse_entry(i,e,j)) {rj[e]=j;na++;}
+    }
+    if(na==0) return 0;
+
+    // Assemble the list of reverse entries to add, sorted by row
+    std::vector<std::pair<int,uint64_t> > add;
+    if(keep_union) {
+        for(int i=0;i<n;i++) for(uint64_t e=off[i];e<off[i+1];e++)
+            if(rj[e]>=0) add.push_back(std::make_pair(rj[e],e));
+        std::sort(add.begin(),add.end());
+    }
+
+    // Build the new CSR arrays
+    const bool fa=!area.empty(),fn=!normal.empty();
+    std::vector<uint64_t> noff(n+1);
+    std::vector<int> nnbr;
+    std::vector<double> narea,nnorm;
+    nnbr.reserve(ne+add.size());
+    std::vector<std::pair<int,uint64_t> >::iterator ap=add.begin();
+    noff[0]=0;
+    for(int i=0;i<n;i++) {
+        for(uint64_t e=off[i];e<off[i+1];e++) {
+            if(rj[e]==-1||(rj[e]>=0&&!keep_union)) continue;
+            nnbr.push_back(nbr[e]);
+            if(fa) narea.push_back(area[e]);
+            if(fn) nnorm.insert(nnorm.end(),normal.begin()+3*e,normal.begin()+3*e+3);
+        }
+        for(;ap!=add.end()&&ap->first==i;ap++) {
+            uint64_t e=ap->second;
+            nnbr.push_back(int(id[std::upper_bound(off.begin(),off.end(),e)-off.begin()-1]));
+            if(fa) narea.push_back(area[e]);
+            if(fn) for(int k=0;k<3;k++) nnorm.push_back(-normal[3*e+k]);
+        }
+        noff[i+1]=nnbr.size();
+    }
+    off.swap(noff);nbr.swap(nnbr);
+    area.swap(narea);normal.swap(nnorm);
+    return na;
+}
+
+// Explicit template instantiation
+template void neighbor_graph_3d::compute(container_3d&,bool,bool,bool);
+template void neighbor_graph_3d::compute(container_poly_3d&,bool,bool,bool);
+template void neighbor_graph_3d::compute(container_triclinic&,bool,bool,bool);
+template void neighbor_graph_3d::compute(container_triclinic_poly&,bool,bool,bool);
+
+}
@@ -0,0 +1,76 @@
+// Voro++, a cell-based Voronoi library
+// By Chris H. Rycroft and the Rycroft Group
+
+/** \file neighbor_graph_3d.hh
+ * \brief Header file for the neighbor_graph_3d class. */
+
+#ifndef VOROPP_NEIGHBOR_GRAPH_3D_HH
+#define VOROPP_NEIGHBOR_GRAPH_3D_HH
+
+#include <inttypes.h>
+
+#include <vector>
+
+#include "config.hh"
+#include "common.hh"
+
+namespace voro {
+
+/** \brief A class for storing the neighbor graph of a Voronoi tessellation.
+ *
+ * The neighbor_graph_3d class computes all of the Voronoi cells in a container
+ * in parallel, and stores the graph of which cells share faces in compressed
+ * sparse row (CSR) format. There is one row for each particle, and the rows
+ * are sorted by particle ID. The neighbors of the particle in row i are stored
+ * in entries off[i] to off[i+1]-1 of the nbr array, and optionally the area
+ * and the outward normal vector of each shared face can be stored alongside.
+ *
+ * Since the two cells on either side of a face are computed independently,
+ * the graph may be asymmetric. This can occur when a tiny face is found on one
+ * side only due to numerical tolerances, when a wall cuts one cell but not
+ * its neighbor, or when a neighboring cell is removed entirely by a wall. The
+ * validate() routine counts these cases and the symmetrize() routine removes
+ * them. */
+class neighbor_graph_3d {
+    public:
+        /** The number of rows in the graph. */
+        int n;
+        /** The particle ID corresponding to each row, in ascending order. */
+        std::vector<uint64_t> id;
+        /** The offsets of each row into the entry arrays, of length n+1. */
+        std::vector<uint64_t> off;
+        /** The neighbor IDs. If wall faces are included, then these are
+         * stored with the negative IDs that are used by the Voronoi cell
+         * classes. */
+        std::vector<int> nbr;
+        /** The area of each shared face, if computed. */
+        std::vector<double> area;
+        /** The outward unit normal of each shared face, with three entries
+         * per face, if computed. */
+        std::vector<double> normal;
+        neighbor_graph_3d() : n(0), direct(true) {}
+        template<class c_class>
+        void compute(c_class &con,bool face_areas=false,bool face_normals=false,bool walls=false);
+        /** Returns the number of entries in the graph.
+         * \return The number of entries. */
+        inline uint64_t entries() {return off.empty()?0:off[n];}
+        /** Returns the number of neighbors of a given row.
+         * \param[in] i the row to consider.
+         * \return The number of neighbors. */
+        inline int degree(int i) {return int(off[i+1]-off[i]);}
+        /** Finds the row corresponding to a particle ID.
+         * \param[in] pid the particle ID to find.
+         * \return The row, or -1 if the particle is not in the graph. */
+        inline int row(int pid) {return voro_find_row(direct,id,pid);}
+        uint64_t validate();
+        uint64_t symmetrize(bool keep_union=false);
+    private:
+        /** Whether the particle IDs are exactly 0 to n-1, in which case the
+         * row of a particle is equal to its ID. */
+        bool direct;
+        bool reverse_entry(int i,uint64_t e,int &j);
+};
+
+}
+
+#endif
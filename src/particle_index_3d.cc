@@ -0,0 +1,60 @@
+// Voro++, a cell-based Voronoi library
+// By Chris H. Rycroft and the Rycroft Group
+
+/** \file particle_index_3d.cc
+ * \brief Function implementations for the particle_index_3d class. */
+
+#include <algorithm>
+
+#include "particle_index_3d.hh"
+#include "container_3d.hh"
+
+namespace voro {
+
+/** Orders the sorted entries of the index by ID. */
+static inline bool index_order(const std::pair<uint64_t,c_info> &a,const std::pair<uint64_t,c_info> &b) {
+    return a.first<b.first;
+}
+
+/** Builds the index for a container. The locations are stored directly if the
+ * largest ID is less than twice the number of particles.
+ * \param[in] con the container to index. */
+void particle_index_3d::build(container_base_3d &con) {
+    uint64_t n=0,mid=0;
+    int ijk,q;
+    for(ijk=0;ijk<con.nxyz;ijk++) for(q=0;q<con.co[ijk];q++) {
+        if(con.id[ijk][q]>mid) mid=con.id[ijk][q];
+        n++;
+    }
+    direct=n==0||mid<2*n;
+    loc.clear();sorted.clear();
+    if(direct) {
+        loc.assign(n==0?0:mid+1,c_info(-1,0));
+        for(ijk=0;ijk<con.nxyz;ijk++) for(q=0;q<con.co[ijk];q++)
+            loc[con.id[ijk][q]].set(ijk,q);
+    } else {
+        sorted.reserve(n);
+        for(ijk=0;ijk<con.nxyz;ijk++) for(q=0;q<con.co[ijk];q++)
+            sorted.push_back(std::make_pair(con.id[ijk][q],c_info(ijk,q)));
+        std::sort(sorted.begin(),sorted.end(),index_order);
+    }
+}
+
+/** Finds the location of a particle from its ID.
+ * \param[in] pid the particle ID to find.
+ * \param[out] ci the block and the index within the block of the particle.
+ * \return True if the particle was found, false otherwise. */
+bool particle_index_3d::find(uint64_t pid,c_info &ci) {
+    if(direct) {
+        if(pid>=loc.size()||loc[pid].ijk==-1) return false;
+        ci=loc[pid];
+        return true;
+    }
+    std::vector<std::pair<uint64_t,c_info> >::iterator it=
+        std::lower_bound(sorted.begin(),sorted.end(),std::make_pair(pid,c_info(0,0)),index_order);
+    if(it==sorted.end()||it->first!=pid) return false;
+    ci=it->second;
+    return true;
+}
+
+}
@@ -0,0 +1,54 @@
+// Voro++, a cell-based Voronoi library
+// By Chris H. Rycroft and the Rycroft Group
+
+/** \file particle_index_3d.hh
+ * \brief Header file for the particle_index_3d class. */
+
+#ifndef VOROPP_PARTICLE_INDEX_3D_HH
+#define VOROPP_PARTICLE_INDEX_3D_HH
+
+#include <inttypes.h>
+
+#include <vector>
+#include <utility>
+
+#include "config.hh"
+#include "c_info.hh"
+
+namespace voro {
+
+class container_base_3d;
+
+/** \brief A class for looking up the location of a particle in a container
+ * from its ID.
+ *
+ * The particle_index_3d class stores the block and the index within the block
+ * of every particle in a container, so that a particle can be found from its
+ * ID. This is used to warm start the Voronoi cell computation with the
+ * neighbors of a particle from a previous time step, after the particles have
+ * moved between blocks. If the IDs are reasonably dense, then the locations
+ * are stored in an array indexed by ID, and otherwise they are stored in a
+ * sorted array and found by a binary search. The index must be rebuilt
+ * whenever particles are added to or removed from the container. */
+class particle_index_3d {
+    public:
+        particle_index_3d() : direct(true) {}
+        /** Initializes the class and builds the index for a container.
+         * \param[in] con the container to index. */
+        particle_index_3d(container_base_3d &con) {build(con);}
+        void build(container_base_3d &con);
+        bool find(uint64_t pid,c_info &ci);
+    private:
+        /** Whether the locations are stored in an array indexed by ID. */
+        bool direct;
+        /** The location of each ID, if they are stored directly. Missing IDs
+         * are marked with a block index of -1. */
+        std::vector<c_info> loc;
+        /** The IDs and locations, sorted by ID, if they are not stored
+         * directly. */
+        std::vector<std::pair<uint64_t,c_info> > sorted;
+};
+
+}
+
+#endif
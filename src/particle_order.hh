@@ -57,6 +57,9 @@ class particle_order {
         *(op++) = ijk;
         *(op++) = q;
     }
+    /** Removes all records from the order, keeping the memory allocation
+     * so that the class can be reused when a container is refilled. */
+    inline void clear() { op = o; }
 
    private:
     inline void add_ordering_memory() {
@@ -0,0 +1,219 @@
+// Voro++, a cell-based Voronoi library
+// By Chris H. Rycroft and the Rycroft Group
+
+/** \file particle_search_3d.hh
+ * \brief Header file for the particle_search_3d template. */
+
+#ifndef VOROPP_PARTICLE_SEARCH_3D_HH
+#define VOROPP_PARTICLE_SEARCH_3D_HH
+
+#include <inttypes.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "config.hh"
+#include "rad_option.hh"
+#include "v_compute_3d.hh"
+
+namespace voro {
+
+/** \brief Template for the nearest neighbor and radius searches.
+ *
+ * This template carries out the k nearest neighbor and fixed radius searches
+ * for both the rectangular and triclinic container classes. The searches
+ * themselves are done by the voro_compute_3d template. This template handles
+ * the parts that are common to all containers: it remaps each search vector
+ * into the primary domain, divides batches of vectors between threads, and
+ * gathers the particle IDs and positions that were found. The container
+ * classes differ only in how vectors are remapped and how the positions of
+ * periodic images are computed, and these are provided by the remap and
+ * image_position functions of the container. */
+template<class c_class>
+class particle_search_3d {
+    public:
+        /** Initializes the search for a given container.
+         * \param[in] con_ a reference to the container class to search. */
+        particle_search_3d(c_class &con_) : con(con_) {}
+        template<class vc_class>
+        int find_k_nearest(vc_class **vc,double x,double y,double z,int kn,std::vector<uint64_t> &pid,std::vector<double> &rpos,std::vector<double> &rsq);
+        template<class vc_class>
+        void find_k_nearest(vc_class **vc,int n,const double *pos,int kn,uint64_t *pid,double *rpos,double *rsq,int *cnt);
+        template<class vc_class>
+        int find_within_radius(vc_class **vc,double x,double y,double z,double r,std::vector<uint64_t> &pid,std::vector<double> &rpos,std::vector<double> &rsq);
+        template<class vc_class>
+        void find_within_radius(vc_class **vc,int n,const double *pos,double r,std::vector<uint64_t> &off,std::vector<uint64_t> &pid,std::vector<double> &rpos,std::vector<double> &rsq);
+    private:
+        /** A reference to the container class to search. */
+        c_class &con;
+        int gather(int ai,int aj,int ak,int ci,int cj,int ck,std::vector<neighbor_record_3d> &nr,std::vector<uint64_t> &pid,std::vector<double> &rpos,std::vector<double> &rsq);
+};
+
+/** Finds the k particles that are closest to a given vector.
+ * \param[in] vc the array of per-thread Voronoi computation objects.
+ * \param[in] (x,y,z) the vector to test.
+ * \param[in] kn the number of particles to find.
+ * \param[out] pid a vector in which to store the particle IDs, in order of
+ *                 increasing distance.
+ * \param[out] rpos a vector in which to store the particle positions, which
+ *                  may lie in periodic images of the primary domain.
+ * \param[out] rsq a vector in which to store the squared distances.
+ * \return The number of particles found, which is less than kn if the
+ * container does not hold enough particles. */
+template<class c_class>
+template<class vc_class>
+int particle_search_3d<c_class>::find_k_nearest(vc_class **vc,double x,double y,double z,int kn,std::vector<uint64_t> &pid,std::vector<double> &rpos,std::vector<double> &rsq) {
+    int ai,aj,ak,ci,cj,ck,ijk;
+    std::vector<neighbor_record_3d> nr;
+    pid.clear();rpos.clear();rsq.clear();
+    if(!con.remap(ai,aj,ak,ci,cj,ck,x,y,z,ijk)) return 0;
+    vc[t_num()]->find_k_nearest(x,y,z,ci,cj,ck,ijk,kn,nr);
+    return gather(ai,aj,ak,ci,cj,ck,nr,pid,rpos,rsq);
+}
+
+/** Finds the k particles that are closest to each vector in a batch, making
+ * use of multiple threads.
+ * \param[in] vc the array of per-thread Voronoi computation objects.
+ * \param[in] n the number of vectors.
+ * \param[in] pos an array of length 3*n holding the vectors to test.
+ * \param[in] kn the number of particles to find for each vector.
+ * \param[out] pid an array of length n*kn in which to store the particle IDs.
+ *                 The entries for the ith vector start at index i*kn and are
+ *                 in order of increasing distance.
+ * \param[out] rpos an array of length 3*n*kn in which to store the particle
+ *                  positions.
+ * \param[out] rsq an array of length n*kn in which to store the squared
+ *                 distances. This may be NULL if it is not required.
+ * \param[out] cnt an array of length n in which to store the number of
+ *                 particles found for each vector. */
+template<class c_class>
+template<class vc_class>
+void particle_search_3d<c_class>::find_k_nearest(vc_class **vc,int n,const double *pos,int kn,uint64_t *pid,double *rpos,double *rsq,int *cnt) {
+#pragma omp parallel num_threads(con.nt)
+    {
+        std::vector<neighbor_record_3d> nr;
+        vc_class *vcp=vc[t_num()];
+#pragma omp for schedule(dynamic,64)
+        for(int i=0;i<n;i++) {
+            int ai,aj,ak,ci,cj,ck,ijk,m;
+            double x=pos[3*i],y=pos[3*i+1],z=pos[3*i+2];
+            if(!con.remap(ai,aj,ak,ci,cj,ck,x,y,z,ijk)) {cnt[i]=0;continue;}
+            vcp->find_k_nearest(x,y,z,ci,cj,ck,ijk,kn,nr);
+            cnt[i]=m=nr.size();
+            for(int l=0;l<m;l++) {
+                con.image_position(ai,aj,ak,ci,cj,ck,nr[l],rpos+3*(i*kn+l));
+                pid[i*kn+l]=con.id[nr[l].ijk][nr[l].l];
+                if(rsq!=NULL) rsq[i*kn+l]=nr[l].rs;
+            }
+        }
+    }
+}
+
+/** Finds all of the particles within a given distance of a vector.
+ * \param[in] vc the array of per-thread Voronoi computation objects.
+ * \param[in] (x,y,z) the vector to test.
+ * \param[in] r the search radius.
+ * \param[out] pid a vector in which to store the particle IDs, in no
+ *                 particular order.
+ * \param[out] rpos a vector in which to store the particle positions, which
+ *                  may lie in periodic images of the primary domain.
+ * \param[out] rsq a vector in which to store the squared distances.
+ * \return The number of particles found. */
+template<class c_class>
+template<class vc_class>
+int particle_search_3d<c_class>::find_within_radius(vc_class **vc,double x,double y,double z,double r,std::vector<uint64_t> &pid,std::vector<double> &rpos,std::vector<double> &rsq) {
+    int ai,aj,ak,ci,cj,ck,ijk;
+    std::vector<neighbor_record_3d> nr;
+    pid.clear();rpos.clear();rsq.clear();
+    if(!con.remap(ai,aj,ak,ci,cj,ck,x,y,z,ijk)) return 0;
+    vc[t_num()]->find_within_radius(x,y,z,ci,cj,ck,ijk,r,nr);
+    return gather(ai,aj,ak,ci,cj,ck,nr,pid,rpos,rsq);
+}
+
+/** Finds all of the particles within a given distance of each vector in a
+ * batch, making use of multiple threads. The results are stored in compressed
+ * sparse row format. The vectors are split into one contiguous range per
+ * thread, and each thread gathers the results for its range before they are
+ * copied into the output arrays.
+ * \param[in] vc the array of per-thread Voronoi computation objects.
+ * \param[in] n the number of vectors.
+ * \param[in] pos an array of length 3*n holding the vectors to test.
+ * \param[in] r the search radius.
+ * \param[out] off a vector of length n+1 in which to store the offsets. The
+ *                 particles found for the ith vector are stored in entries
+ *                 off[i] to off[i+1]-1 of the other vectors.
+ * \param[out] pid a vector in which to store the particle IDs.
+ * \param[out] rpos a vector in which to store the particle positions, with
+ *                  three entries per particle.
+ * \param[out] rsq a vector in which to store the squared distances. */
+template<class c_class>
+template<class vc_class>
+void particle_search_3d<c_class>::find_within_radius(vc_class **vc,int n,const double *pos,double r,std::vector<uint64_t> &off,std::vector<uint64_t> &pid,std::vector<double> &rpos,std::vector<double> &rsq) {
+    const int nt=con.nt;
+    std::vector<uint64_t> *tpid=new std::vector<uint64_t>[nt];
+    std::vector<double> *trpos=new std::vector<double>[nt],*trsq=new std::vector<double>[nt];
+    off.resize(n+1);
+
+    // Gather the results for each range of vectors
+#pragma omp parallel num_threads(nt)
+    {
+        std::vector<neighbor_record_3d> nr;
+        vc_class *vcp=vc[t_num()];
+#pragma omp for schedule(static,1)
+        for(int t=0;t<nt;t++) {
+            for(int i=int((int64_t) n*t/nt);i<int((int64_t) n*(t+1)/nt);i++) {
+                int ai,aj,ak,ci,cj,ck,ijk,m;
+                double x=pos[3*i],y=pos[3*i+1],z=pos[3*i+2],rp[3];
+                if(!con.remap(ai,aj,ak,ci,cj,ck,x,y,z,ijk)) {off[i+1]=0;continue;}
+                vcp->find_within_radius(x,y,z,ci,cj,ck,ijk,r,nr);
+                off[i+1]=m=nr.size();
+                for(int l=0;l<m;l++) {
+                    con.image_position(ai,aj,ak,ci,cj,ck,nr[l],rp);
+                    tpid[t].push_back(con.id[nr[l].ijk][nr[l].l]);
+                    trpos[t].insert(trpos[t].end(),rp,rp+3);
+                    trsq[t].push_back(nr[l].rs);
+                }
+            }
+        }
+    }
+
+    // Compute the offsets, and copy the results into the output arrays
+    off[0]=0;
+    for(int i=0;i<n;i++) off[i+1]+=off[i];
+    pid.resize(off[n]);rpos.resize(3*off[n]);rsq.resize(off[n]);
+#pragma omp parallel for num_threads(nt)
+    for(int t=0;t<nt;t++) {
+        uint64_t o=off[int((int64_t) n*t/nt)];
+        std::copy(tpid[t].begin(),tpid[t].end(),pid.begin()+o);
+        std::copy(trpos[t].begin(),trpos[t].end(),rpos.begin()+3*o);
+        std::copy(trsq[t].begin(),trsq[t].end(),rsq.begin()+o);
+    }
+    delete [] trsq;
+    delete [] trpos;
+    delete [] tpid;
+}
+
+/** Copies the particles found by a search for a single vector into the output
+ * vectors.
+ * \param[in] (ai,aj,ak) the periodic image of the search vector.
+ * \param[in] (ci,cj,ck) the block that the search vector is in.
+ * \param[in] nr the particles found by the search.
+ * \param[out] pid a vector in which to store the particle IDs.
+ * \param[out] rpos a vector in which to store the particle positions.
+ * \param[out] rsq a vector in which to store the squared distances.
+ * \return The number of particles found. */
+template<class c_class>
+int particle_search_3d<c_class>::gather(int ai,int aj,int ak,int ci,int cj,int ck,std::vector<neighbor_record_3d> &nr,std::vector<uint64_t> &pid,std::vector<double> &rpos,std::vector<double> &rsq) {
+    int m=nr.size();
+    pid.resize(m);rpos.resize(3*m);rsq.resize(m);
+    for(int l=0;l<m;l++) {
+        con.image_position(ai,aj,ak,ci,cj,ck,nr[l],rpos.data()+3*l);
+        pid[l]=con.id[nr[l].ijk][nr[l].l];
+        rsq[l]=nr[l].rs;
+    }
+    return m;
+}
+
+}
+
+#endif
@@ -52,6 +52,10 @@ class radius_mono {
          * \param[in] ijk the block that the particle is within.
          * \param[in] s the index of the particle within the block. */
         inline void r_init(int ijk,int s,double &r_rad,double &r_mul) {}
+        /** This is called prior to computing a Voronoi cell for a ghost
+         * particle that is not stored in the container, to initialize any
+         * required constants. */
+        inline void r_init_ghost(double r,double &r_rad,double &r_mul) {}
         /** Sets a required constant to be used when carrying out a plane
          * bounds check. */
         inline void r_prime(double rv,double &r_mul,double &r_val) {}
@@ -120,6 +124,16 @@ class radius_poly_3d {
             r_rad=ppr[ijk][4*s+3]*ppr[ijk][4*s+3];
             r_mul=r_rad-max_radius*max_radius;
         }
+        /** This is called prior to computing a Voronoi cell for a ghost
+         * particle that is not stored in the container, to initialize any
+         * required constants. The radius bounds checks assume that the
+         * particle is no larger than the maximum radius, so the ghost
+         * particle's radius is included in the maximum.
+         * \param[in] r the radius of the ghost particle. */
+        inline void r_init_ghost(double r,double &r_rad,double &r_mul) {
+            r_rad=r*r;
+            r_mul=r>max_radius?0:r_rad-max_radius*max_radius;
+        }
         /** Sets a required constant to be used when carrying out a plane
          * bounds check. */
         inline void r_prime(double rv,double &r_mul,double &r_val) {
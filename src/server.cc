@@ -0,0 +1,635 @@
+// Voro++, a cell-based Voronoi library
+// By Chris H. Rycroft and the Rycroft Group
+
+/** \file server.cc
+ * \brief Source code for the query server utility. */
+
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "voro++.hh"
+using namespace voro;
+
+#ifdef _OPENMP
+#include "omp.h"
+#endif
+
+// The server answers requests over a UNIX domain socket. Each request is made
+// up of a header of two 32-bit unsigned integers, giving the query type and
+// the number of queries n in the batch, followed by the query data. Each reply
+// begins with a header of two 32-bit unsigned integers, giving a status code
+// and a count, followed by the reply data. All numbers are in the native byte
+// order of the host.
+//
+// Query type 1 (find): the data is n sets of three doubles (x,y,z). For each,
+// the reply holds a record_find structure with the ID and position of the
+// particle whose Voronoi cell contains the point, or an ID of UINT64_MAX if no
+// cell was found.
+//
+// Query type 2 (ghost): the data is n sets of three doubles (x,y,z), or four
+// doubles (x,y,z,r) for a polydisperse server. For each, the reply holds a
+// double with the volume of the Voronoi cell of a ghost particle at that
+// position, a 64-bit unsigned integer m with the number of neighbors, and m
+// 64-bit signed integers with the neighboring particle or wall IDs. A volume
+// of -1 is returned if the cell could not be computed.
+//
+// Query type 3 (stats): the data is n 64-bit unsigned particle IDs. For each,
+// the reply holds a record_stats structure. The number of faces is zero if
+// the particle was not found or its cell could not be computed.
+//
+// Query type 4 (latency): no data. The count in the reply is the number of
+// requests timed so far, followed by five doubles giving the 50th, 90th, 99th,
+// and 99.9th percentiles and the maximum of the request latency in
+// microseconds. The percentiles are taken from a histogram, and are accurate to
+// about one percent.
+//
+// Query type 5 (shutdown): no data. The server sends an empty reply and
+// exits.
+enum query_type {
+    q_find=1,
+    q_ghost=2,
+    q_stats=3,
+    q_latency=4,
+    q_shutdown=5
+};
+
+// Status codes for the replies
+enum reply_status {
+    r_ok=0,
+    r_bad_type=1,
+    r_bad_size=2
+};
+
+// The maximum number of queries allowed in a single request
+const unsigned int max_batch=1<<22;
+
+// The number of queries that are handed to a thread at a time
+const int batch_chunk=16;
+
+// The maximum number of bytes read from a connection at a time
+const size_t read_chunk=65536;
+
+// The time in seconds that the server waits for a client to accept a reply,
+// after which the connection is closed
+const int send_timeout=10;
+
+// The smallest request latency in microseconds that is resolved by the
+// latency histogram, the number of histogram bins per factor of ten, and the
+// number of factors of ten covered. Longer latencies are counted in the last
+// bin.
+const double lat_min=0.1;
+const int lat_bins=100;
+const int lat_decades=9;
+
+// The header at the start of each request and reply
+struct header {
+    uint32_t a;
+    uint32_t n;
+};
+
+// The reply record for a find query
+struct record_find {
+    uint64_t id;
+    double x,y,z;
+};
+
+// The reply record for a stats query
+struct record_stats {
+    // The volume and surface area of the Voronoi cell
+    double volume,area;
+    // The centroid of the Voronoi cell, in the global coordinate system
+    double cx,cy,cz;
+    // The number of faces and vertices of the Voronoi cell
+    uint32_t faces,vertices;
+};
+
+// The location of a particle within the container, used to look up particles
+// by ID
+struct id_entry {
+    uint64_t id;
+    int ijk,q;
+    inline bool operator<(const id_entry &e) const {return id<e.id;}
+};
+
+// A histogram of the request latencies with logarithmically spaced bins, so
+// that the memory use and the cost of computing percentiles do not grow with
+// the number of requests
+class latency_histogram {
+    public:
+        latency_histogram() : count(0), lmax(0), hist(lat_bins*lat_decades,0) {}
+        void add(double t);
+        void percentiles(double *pc);
+        // The number of latencies recorded
+        uint64_t count;
+    private:
+        // The largest latency recorded
+        double lmax;
+        // The number of latencies in each bin
+        std::vector<uint64_t> hist;
+};
+
+// Records a request latency, given in microseconds
+void latency_histogram::add(double t) {
+    int b=t>lat_min?static_cast<int>(lat_bins*log10(t/lat_min)):0;
+    if(b>=static_cast<int>(hist.size())) b=hist.size()-1;
+    hist[b]++;count++;
+    if(t>lmax) lmax=t;
+}
+
+// Computes the 50th, 90th, 99th, and 99.9th percentiles of the latencies,
+// using the center of the bin that each one falls in, followed by the maximum
+// latency, and stores them in an array of five doubles
+void latency_histogram::percentiles(double *pc) {
+    const double f[4]={0.5,0.9,0.99,0.999};
+    if(count==0) {
+        for(int i=0;i<5;i++) pc[i]=0;
+        return;
+    }
+    uint64_t cum=0;
+    int b=0;
+    for(int i=0;i<4;i++) {
+        uint64_t r=static_cast<uint64_t>(f[i]*(count-1));
+        while(cum+hist[b]<=r) cum+=hist[b++];
+        pc[i]=std::min(lat_min*pow(10.,(b+0.5)/lat_bins),lmax);
+    }
+    pc[4]=lmax;
+}
+
+// This message gets displayed if the user requests the help flag
+void help_message() {
+    puts("Voro++ version 1.0.0, query server\n\n"
+         "Syntax: voro++-server [options] <x_min> <x_max> <y_min>\n"
+         "                      <y_max> <z_min> <z_max> <input_file> <socket>\n\n"
+         "The server reads in the input file of particle IDs and positions, and then\n"
+         "answers batched point location, ghost cell, and cell statistics queries\n"
+         "over a UNIX domain socket until it receives a shutdown request.\n\n"
+         "Available options:\n"
+         " -h/--help   : Print this information\n"
+         " -m <mem>    : Manually choose the memory allocation per grid block\n"
+         "               (default 8)\n"
+         " -n [3]      : Manually specify the internal grid size\n"
+         " -p          : Make container periodic in all three directions\n"
+         " -px         : Make container periodic in the x direction\n"
+         " -py         : Make container periodic in the y direction\n"
+         " -pz         : Make container periodic in the z direction\n"
+         " -r          : Assume the input file has an extra coordinate for radii\n"
+#ifdef _OPENMP
+         " -t <num>    : Use <num> threads for answering queries [default: 1]\n"
+#endif
+         " -v          : Verbose output");
+}
+
+// Prints an error message. This is called when the program is unable to make
+// sense of the command-line options.
+void error_message() {
+    fputs("voro++-server: Unrecognized command-line options; type \"voro++-server -h\"\n"
+          "for more information.\n",stderr);
+}
+
+// Checks to see if two strings are equal
+inline bool se(const char* f1,const char* f2) {
+    return strcmp(f1,f2)==0;
+}
+
+// Writes a given number of bytes to a socket, returning false if an error
+// occurred
+bool write_full(int fd,const void *buf,size_t len) {
+    const char *bp=static_cast<const char*>(buf);
+    while(len>0) {
+        ssize_t k=write(fd,bp,len);
+        if(k<0) {
+            if(errno==EINTR) continue;
+            return false;
+        }
+        bp+=k;len-=k;
+    }
+    return true;
+}
+
+// Computes the Voronoi cell of a ghost particle for a monodisperse container
+inline bool ghost_cell(container_3d &con,voronoicell_neighbor_3d &c,double *qp) {
+    return con.compute_ghost_cell(c,*qp,qp[1],qp[2]);
+}
+
+// Computes the Voronoi cell of a ghost particle for a polydisperse container
+inline bool ghost_cell(container_poly_3d &con,voronoicell_neighbor_3d &c,double *qp) {
+    return con.compute_ghost_cell(c,*qp,qp[1],qp[2],qp[3]);
+}
+
+// A class that holds a loaded container and answers batches of queries about
+// it. The queries in each batch are divided between threads, which each use
+// their own Voronoi cell and the container's per-thread computation object.
+template<class c_class>
+class query_server {
+    public:
+        query_server(c_class &con_,int nt_);
+        bool receive(int fd,std::vector<char> &ib,bool &shutdown);
+        // The latencies of the requests answered so far
+        latency_histogram lat;
+    private:
+        // The container to query
+        c_class &con;
+        // The number of threads to use
+        const int nt;
+        // A table of particle locations, sorted by ID
+        std::vector<id_entry> tab;
+        // Buffers for the query data and the reply
+        std::vector<char> qbuf,rbuf;
+        // The volumes and neighbor lists computed by ghost queries
+        std::vector<double> gvol;
+        std::vector<std::vector<int> > gnb;
+        long request_length(const char *buf,size_t len,int fd);
+        int query_size(uint32_t a);
+        bool serve(int fd,const char *buf,bool &shutdown);
+        void find(uint32_t n);
+        void ghost(uint32_t n);
+        void stats(uint32_t n);
+};
+
+// Initializes the server, building the table for looking up particles by ID
+template<class c_class>
+query_server<c_class>::query_server(c_class &con_,int nt_) : con(con_), nt(nt_) {
+    tab.reserve(con.total_particles());
+    for(int ijk=0;ijk<con.nxyz;ijk++) for(int q=0;q<con.co[ijk];q++) {
+        id_entry e={con.id[ijk][q],ijk,q};
+        tab.push_back(e);
+    }
+    std::sort(tab.begin(),tab.end());
+}
+
+// Reads the data that is available on a connection, adding it to the input
+// buffer of the connection, and then answers any requests that are complete.
+// Since only the data that has arrived is read, a slow or idle client does not
+// hold up the others. It returns false if the connection should be closed.
+template<class c_class>
+bool query_server<c_class>::receive(int fd,std::vector<char> &ib,bool &shutdown) {
+    size_t l=ib.size();
+    ib.resize(l+read_chunk);
+    ssize_t k=recv(fd,ib.data()+l,read_chunk,MSG_DONTWAIT);
+    if(k<=0) {
+        ib.resize(l);
+        return k<0&&(errno==EINTR||errno==EAGAIN||errno==EWOULDBLOCK);
+    }
+    ib.resize(l+k);
+
+    // Answer each complete request, and remove it from the buffer
+    size_t s=0;
+    long rl;
+    while(!shutdown&&(rl=request_length(ib.data()+s,ib.size()-s,fd))!=0) {
+        if(rl<0||!serve(fd,ib.data()+s,shutdown)) return false;
+        s+=rl;
+    }
+    ib.erase(ib.begin(),ib.begin()+s);
+    return !shutdown;
+}
+
+// Checks whether a buffer starts with a complete request. It returns the
+// length of the request, or zero if more data is needed. If the request is
+// invalid, then an error reply is sent and -1 is returned.
+template<class c_class>
+long query_server<c_class>::request_length(const char *buf,size_t len,int fd) {
+    if(len<sizeof(header)) return 0;
+    header h;
+    memcpy(&h,buf,sizeof(header));
+    int qs=query_size(h.a);
+    if(qs<0) {
+        header r={r_bad_type,0};
+        write_full(fd,&r,sizeof(header));
+        return -1;
+    }
+    if(qs>0&&h.n>max_batch) {
+        header r={r_bad_size,0};
+        write_full(fd,&r,sizeof(header));
+        return -1;
+    }
+    size_t rl=sizeof(header)+static_cast<size_t>(qs)*h.n;
+    return len<rl?0:static_cast<long>(rl);
+}
+
+// Returns the number of bytes of data for each query of a given type, or -1 if
+// the type is invalid
+template<class c_class>
+int query_server<c_class>::query_size(uint32_t a) {
+    switch(a) {
+        case q_find: return 3*sizeof(double);
+        case q_ghost: return con.ps*sizeof(double);
+        case q_stats: return sizeof(uint64_t);
+        case q_latency:
+        case q_shutdown: return 0;
+    }
+    return -1;
+}
+
+// Answers a complete request and sends the reply. It returns false if the
+// connection should be closed.
+template<class c_class>
+bool query_server<c_class>::serve(int fd,const char *buf,bool &shutdown) {
+    double t0=wtime();
+    header h;
+    memcpy(&h,buf,sizeof(header));
+
+    // Copy the query data, so that it is suitably aligned
+    int qs=query_size(h.a);
+    qbuf.resize(static_cast<size_t>(qs)*h.n);
+    if(qs>0) memcpy(qbuf.data(),buf+sizeof(header),qbuf.size());
+
+    // Assemble the reply
+    rbuf.resize(sizeof(header));
+    header *rh=reinterpret_cast<header*>(rbuf.data());
+    rh->a=r_ok;rh->n=h.n;
+    switch(h.a) {
+        case q_find: find(h.n);break;
+        case q_ghost: ghost(h.n);break;
+        case q_stats: stats(h.n);break;
+        case q_latency:
+            rbuf.resize(sizeof(header)+5*sizeof(double));
+            rh=reinterpret_cast<header*>(rbuf.data());
+            rh->n=lat.count;
+            lat.percentiles(reinterpret_cast<double*>(rbuf.data()+sizeof(header)));
+            break;
+        case q_shutdown:
+            rh->n=0;shutdown=true;
+    }
+    if(!write_full(fd,rbuf.data(),rbuf.size())) return false;
+    if(qs>0) lat.add(1e6*(wtime()-t0));
+    return true;
+}
+
+// Answers a batch of point location queries
+template<class c_class>
+void query_server<c_class>::find(uint32_t n) {
+    rbuf.resize(sizeof(header)+n*sizeof(record_find));
+    double *qp=reinterpret_cast<double*>(qbuf.data());
+    record_find *rp=reinterpret_cast<record_find*>(rbuf.data()+sizeof(header));
+#pragma omp parallel for num_threads(nt) schedule(dynamic,batch_chunk)
+    for(int i=0;i<(int) n;i++) {
+        record_find &r=rp[i];
+        if(!con.find_voronoi_cell(qp[3*i],qp[3*i+1],qp[3*i+2],r.x,r.y,r.z,r.id)) {
+            r.id=UINT64_MAX;r.x=r.y=r.z=0;
+        }
+    }
+}
+
+// Answers a batch of ghost cell queries
+template<class c_class>
+void query_server<c_class>::ghost(uint32_t n) {
+    double *qp=reinterpret_cast<double*>(qbuf.data());
+    const int ps=con.ps;
+    gvol.resize(n);
+    if(gnb.size()<n) gnb.resize(n);
+#pragma omp parallel num_threads(nt)
+    {
+        voronoicell_neighbor_3d c(con);
+#pragma omp for schedule(dynamic,batch_chunk)
+        for(int i=0;i<(int) n;i++) {
+            if(ghost_cell(con,c,qp+ps*i)) {
+                gvol[i]=c.volume();
+                c.neighbors(gnb[i]);
+            } else {
+                gvol[i]=-1;
+                gnb[i].clear();
+            }
+        }
+    }
+
+    // Pack the variable-length records into the reply
+    size_t l=sizeof(header);
+    for(int i=0;i<(int) n;i++) l+=sizeof(double)+(gnb[i].size()+1)*sizeof(uint64_t);
+    rbuf.resize(l);
+    char *rp=rbuf.data()+sizeof(header);
+    for(int i=0;i<(int) n;i++) {
+        uint64_t m=gnb[i].size();
+        memcpy(rp,&gvol[i],sizeof(double));rp+=sizeof(double);
+        memcpy(rp,&m,sizeof(uint64_t));rp+=sizeof(uint64_t);
+        for(int j=0;j<(int) m;j++) {
+            int64_t v=gnb[i][j];
+            memcpy(rp,&v,sizeof(int64_t));rp+=sizeof(int64_t);
+        }
+    }
+}
+
+// Answers a batch of cell statistics queries
+template<class c_class>
+void query_server<c_class>::stats(uint32_t n) {
+    rbuf.resize(sizeof(header)+n*sizeof(record_stats));
+    uint64_t *qp=reinterpret_cast<uint64_t*>(qbuf.data());
+    record_stats *rp=reinterpret_cast<record_stats*>(rbuf.data()+sizeof(header));
+#pragma omp parallel num_threads(nt)
+    {
+        voronoicell_3d c(con);
+#pragma omp for schedule(dynamic,batch_chunk)
+        for(int i=0;i<(int) n;i++) {
+            record_stats &r=rp[i];
+            id_entry e={qp[i],0,0};
+            std::vector<id_entry>::iterator it=std::lower_bound(tab.begin(),tab.end(),e);
+            if(it!=tab.end()&&it->id==qp[i]&&con.compute_cell(c,it->ijk,it->q)) {
+                double *pp=con.p[it->ijk]+con.ps*it->q;
+                r.volume=c.volume();
+                r.area=c.surface_area();
+                c.centroid(r.cx,r.cy,r.cz);
+                r.cx+=*pp;r.cy+=pp[1];r.cz+=pp[2];
+                r.faces=c.number_of_faces();
+                r.vertices=c.p;
+            } else {
+                r.volume=r.area=r.cx=r.cy=r.cz=0;
+                r.faces=r.vertices=0;
+            }
+        }
+    }
+}
+
+// Loads the particles into a container and runs the server until a shutdown
+// request is received
+template<class c_class,class l_class>
+int run_server(c_class &con,l_class &pl,int nt,const char *sock_fn,bool verbose) {
+    pl.setup(con);
+    query_server<c_class> qs(con,nt);
+
+    // Set up the socket
+    sockaddr_un sa;
+    memset(&sa,0,sizeof(sockaddr_un));
+    sa.sun_family=AF_UNIX;
+    if(strlen(sock_fn)>=sizeof(sa.sun_path)) {
+        fputs("voro++-server: Socket filename too long\n",stderr);
+        return VOROPP_CMD_LINE_ERROR;
+    }
+    strcpy(sa.sun_path,sock_fn);
+
+    // Remove a socket left over from a previous run, but refuse to replace
+    // any other type of file
+    struct stat st;
+    if(lstat(sock_fn,&st)==0) {
+        if(!S_ISSOCK(st.st_mode)) {
+            fprintf(stderr,"voro++-server: %s exists and is not a socket\n",sock_fn);
+            return VOROPP_FILE_ERROR;
+        }
+        unlink(sock_fn);
+    }
+    int sfd=socket(AF_UNIX,SOCK_STREAM,0);
+    if(sfd<0||bind(sfd,reinterpret_cast<sockaddr*>(&sa),sizeof(sockaddr_un))<0||listen(sfd,16)<0) {
+        fprintf(stderr,"voro++-server: Unable to listen on socket %s: %s\n",sock_fn,strerror(errno));
+        if(sfd>=0) close(sfd);
+        return VOROPP_FILE_ERROR;
+    }
+    if(verbose) fprintf(stderr,"voro++-server: Loaded %d particles, listening on %s\n",
+                            static_cast<int>(con.total_particles()),sock_fn);
+
+    // Wait for activity on the listening socket and on all of the open
+    // connections, accepting new connections and answering the requests that
+    // have arrived. Each connection has its own input buffer, so that a
+    // request can arrive over several reads.
+    bool shutdown=false;
+    std::vector<pollfd> pf(1);
+    std::vector<std::vector<char> > ib(1);
+    pf[0].fd=sfd;pf[0].events=POLLIN;
+    while(!shutdown) {
+        if(poll(pf.data(),pf.size(),-1)<0) {
+            if(errno==EINTR) continue;
+            fprintf(stderr,"voro++-server: Unable to poll connections: %s\n",strerror(errno));
+            break;
+        }
+        for(size_t k=1;k<pf.size()&&!shutdown;) {
+            if((pf[k].revents&(POLLIN|POLLHUP|POLLERR))&&!qs.receive(pf[k].fd,ib[k],shutdown)) {
+                close(pf[k].fd);
+                pf.erase(pf.begin()+k);
+                ib.erase(ib.begin()+k);
+            } else k++;
+        }
+        if(!shutdown&&(pf[0].revents&POLLIN)) {
+            int fd=accept(sfd,NULL,NULL);
+            if(fd<0) {
+                if(errno==EINTR||errno==ECONNABORTED) continue;
+                fprintf(stderr,"voro++-server: Unable to accept connection: %s\n",strerror(errno));
+                break;
+            }
+
+            // Replies are sent with blocking writes, so limit the time spent
+            // waiting for a client that is not reading them
+            timeval tv={send_timeout,0};
+            setsockopt(fd,SOL_SOCKET,SO_SNDTIMEO,&tv,sizeof(timeval));
+            pollfd p={fd,POLLIN,0};
+            pf.push_back(p);
+            ib.push_back(std::vector<char>());
+        }
+    }
+    for(size_t k=1;k<pf.size();k++) close(pf[k].fd);
+    close(sfd);
+    unlink(sock_fn);
+
+    // Print a summary of the request latencies
+    if(verbose) {
+        double pc[5];
+        qs.lat.percentiles(pc);
+        fprintf(stderr,"Requests answered         : %d\n"
+                       "Latency percentiles (us)  : p50 %g, p90 %g, p99 %g, p99.9 %g, max %g\n",
+                       static_cast<int>(qs.lat.count),*pc,pc[1],pc[2],pc[3],pc[4]);
+    }
+    return 0;
+}
+
+int main(int argc,char **argv) {
+    int i=1,num_thread=1,nx=0,ny=0,nz=0,init_mem=8;
+    bool polydisperse=false,x_prd=false,y_prd=false,z_prd=false,
+         verbose=false,grid=false;
+
+    // Check for the help flag, and that there are enough arguments
+    if(argc==2&&(se(argv[1],"-h")||se(argv[1],"--help"))) {
+        help_message();return 0;
+    }
+    if(argc<9) {
+        error_message();
+        return VOROPP_CMD_LINE_ERROR;
+    }
+
+    // Search for command-line options
+    while(i<argc-8) {
+        if(se(argv[i],"-h")||se(argv[i],"--help")) {
+            help_message();return 0;
+        } else if(se(argv[i],"-m")) init_mem=atoi(argv[++i]);
+        else if(se(argv[i],"-n")) {
+            if(i>=argc-11) {error_message();return VOROPP_CMD_LINE_ERROR;}
+            grid=true;
+            nx=atoi(argv[++i]);
+            ny=atoi(argv[++i]);
+            nz=atoi(argv[++i]);
+            if(nx<=0||ny<=0||nz<=0) {
+                fputs("voro++-server: Computational grid specified with -n must be greater than one\n"
+                      "in each direction\n",stderr);
+                return VOROPP_CMD_LINE_ERROR;
+            }
+        } else if(se(argv[i],"-p")) x_prd=y_prd=z_prd=true;
+        else if(se(argv[i],"-px")) x_prd=true;
+        else if(se(argv[i],"-py")) y_prd=true;
+        else if(se(argv[i],"-pz")) z_prd=true;
+        else if(se(argv[i],"-r")) polydisperse=true;
+#ifdef _OPENMP
+        else if(se(argv[i],"-t")) {
+            if(i>=argc-9) {error_message();return VOROPP_CMD_LINE_ERROR;}
+            num_thread=atoi(argv[++i]);
+            int max_thread=omp_get_max_threads();
+            if(num_thread<1||num_thread>max_thread) {
+                fprintf(stderr,"voro++-server: The number of threads must be between one and the maximum\n"
+                        "available, which is %d on this system\n",max_thread);
+                return VOROPP_CMD_LINE_ERROR;
+            }
+        }
+#endif
+        else if(se(argv[i],"-v")) verbose=true;
+        else {
+            error_message();
+            return VOROPP_CMD_LINE_ERROR;
+        }
+        i++;
+    }
+
+    // Check the memory guess is positive
+    if(init_mem<=0) {
+        fputs("voro++-server: The memory allocation must be positive\n",stderr);
+        return VOROPP_CMD_LINE_ERROR;
+    }
+
+    // Read in the dimensions of the container
+    double ax=atof(argv[i]),bx=atof(argv[i+1]),
+           ay=atof(argv[i+2]),by=atof(argv[i+3]),
+           az=atof(argv[i+4]),bz=atof(argv[i+5]);
+    if(bx<ax||by<ay||bz<az) {
+        fputs("voro++-server: Minimum coordinate exceeds maximum coordinate\n",stderr);
+        return VOROPP_CMD_LINE_ERROR;
+    }
+
+    // Ignore broken connections, which are detected when writing replies
+    signal(SIGPIPE,SIG_IGN);
+
+    // Read in the particles, estimate the grid size if needed, and run the
+    // server
+    FILE *in_file=se(argv[i+6],"-")?stdin:safe_fopen(argv[i+6],"r");
+    const char *sock_fn=argv[i+7];
+    int ret;
+    if(polydisperse) {
+        particle_list4 pl;
+        pl.import(in_file);
+        if(in_file!=stdin) fclose(in_file);
+        if(!grid) pl.guess_optimal(bx-ax,by-ay,bz-az,nx,ny,nz);
+        container_poly_3d con(ax,bx,ay,by,az,bz,nx,ny,nz,x_prd,y_prd,z_prd,init_mem,num_thread);
+        ret=run_server(con,pl,num_thread,sock_fn,verbose);
+    } else {
+        particle_list3 pl;
+        pl.import(in_file);
+        if(in_file!=stdin) fclose(in_file);
+        if(!grid) pl.guess_optimal(bx-ax,by-ay,bz-az,nx,ny,nz);
+        container_3d con(ax,bx,ay,by,az,bz,nx,ny,nz,x_prd,y_prd,z_prd,init_mem,num_thread);
+        ret=run_server(con,pl,num_thread,sock_fn,verbose);
+    }
+    return ret;
+}
@@ -12,22 +12,151 @@
 
 namespace voro {
 
+/** \brief An entry in the process-wide cache of unit Voronoi cells. */
+struct unitcell_cache_entry {
+    /** The vectors defining the periodic domain, in the order bx, bxy, by,
+     * bxz, byz, bz. */
+    double b[6];
+    /** The unit Voronoi cell. */
+    voronoicell_3d uv;
+    /** The maximum y-coordinate that could possibly cut the unit Voronoi
+     * cell. */
+    double max_uv_y;
+    /** The maximum z-coordinate that could possibly cut the unit Voronoi
+     * cell. */
+    double max_uv_z;
+    /** The periodic images whose planes cut the unit Voronoi cell, as
+     * triplets of indices with respect to the domain vectors. */
+    std::vector<int> cuts;
+    /** Whether the list of intersecting domain images has been computed. */
+    bool im_done;
+    /** The periodic domain images that intersect the unit Voronoi cell. */
+    std::vector<int> vi;
+    /** The fractions of the unit Voronoi cell volume within each image. */
+    std::vector<double> vd;
+    unitcell_cache_entry() : im_done(false) {}
+    /** Computes the difference between the domain shape of this entry and
+     * another domain shape, relative to the size of the other domain.
+     * \param[in] c the vectors of the other domain, in the same order as b.
+     * \return The maximum difference over the six components. */
+    inline double difference(const double *c) {
+        double l=c[0];
+        if(c[2]>l) l=c[2];
+        if(c[5]>l) l=c[5];
+        double d=0,e;
+        for(int i=0;i<6;i++) {
+            e=fabs(b[i]-c[i]);
+            if(e>d) d=e;
+        }
+        return d/l;
+    }
+};
+
+/** \brief The process-wide cache of unit Voronoi cells.
+ *
+ * This class holds unit Voronoi cells that have been computed previously, so
+ * that containers with recurring domain shapes do not need to compute them
+ * again. The entries are ordered from least to most recently used. */
+class unitcell_cache {
+    public:
+        /** The cache entries. */
+        std::vector<unitcell_cache_entry*> e;
+        /** Whether the cache is used. */
+        bool enable;
+        /** Whether cells for new domain shapes are computed starting from a
+         * cached cell for a similar shape. */
+        bool incremental;
+        /** The number of cells found in the cache. */
+        int hits;
+        /** The number of cells computed starting from a cached cell. */
+        int updates;
+        /** The number of cells computed from scratch. */
+        int misses;
+        unitcell_cache() : enable(true), incremental(false), hits(0), updates(0), misses(0) {}
+        ~unitcell_cache() {clear();}
+        /** Removes all of the entries from the cache. */
+        inline void clear() {
+            for(std::vector<unitcell_cache_entry*>::iterator it=e.begin();it!=e.end();it++) delete *it;
+            e.clear();
+        }
+        /** Moves an entry to the end of the list, marking it as the most
+         * recently used.
+         * \param[in] i the index of the entry. */
+        inline void touch(int i) {
+            unitcell_cache_entry *q=e[i];
+            e.erase(e.begin()+i);
+            e.push_back(q);
+        }
+};
+
+/** The process-wide cache of unit Voronoi cells. */
+static unitcell_cache uc_cache;
+
 /** Initializes the unit cell class for a particular non-orthogonal periodic
  * geometry, corresponding to a parallelepiped with sides given by three
  * vectors. The class constructs the unit Voronoi cell corresponding to this
- * geometry.
+ * geometry. If the cell for the same geometry has been computed previously,
+ * then it is taken from a process-wide cache.
  * \param[in] (bx_) The x coordinate of the first unit vector.
  * \param[in] (bxy_,by_) The x and y coordinates of the second unit vector.
  * \param[in] (bxz_,byz_,bz_) The x, y, and z coordinates of the third unit
  *                            vector. */
 unitcell::unitcell(double bx_,double bxy_,double by_,double bxz_,double byz_,double bz_)
     : bx(bx_), bxy(bxy_), by(by_), bxz(bxz_), byz(byz_), bz(bz_),
-    unit_voro(max_unit_voro_shells*max_unit_voro_shells*4*(bx*bx+by*by+bz*bz)) {
+    unit_voro(max_unit_voro_shells*max_unit_voro_shells*4*(bx*bx+by*by+bz*bz)),
+    im_done(false) {
+    setup();
+}
+
+/** Changes the vectors defining the periodic domain, and recomputes the unit
+ * Voronoi cell. This is used by containers whose domain is deformed. If
+ * incremental updates are enabled for the cache, then the computation starts
+ * from the images that cut the cell of the most similar cached domain, which
+ * is usually the previous domain shape.
+ * \param[in] (bx_) The x coordinate of the first unit vector.
+ * \param[in] (bxy_,by_) The x and y coordinates of the second unit vector.
+ * \param[in] (bxz_,byz_,bz_) The x, y, and z coordinates of the third unit
+ *                            vector. */
+void unitcell::set_domain(double bx_,double bxy_,double by_,double bxz_,double byz_,double bz_) {
+    bx=bx_;bxy=bxy_;by=by_;bxz=bxz_;byz=byz_;bz=bz_;
+    im_done=false;
+    im_vi.clear();im_vd.clear();
+    setup();
+}
+
+/** Computes a reduced basis for the lattice of periodic images, and sets up
+ * the unit Voronoi cell, taking it from the cache if possible. */
+void unitcell::setup() {
+
+    // Reduce the second and third vectors by integer multiples of the
+    // previous ones, so that their off-diagonal components are at most half
+    // of the corresponding diagonal components. This describes the same
+    // lattice of periodic images, and therefore the same unit Voronoi cell,
+    // but the shells of images used below grow outward from the cell in a
+    // regular way. For highly sheared domains, the unreduced vectors can
+    // cause the shell search to stop before the cell has been fully cut.
+    syz=int(floor(byz/by+0.5));
+    ryz=byz-syz*by;
+    rxz=bxz-syz*bxy;
+    sxz=int(floor(rxz/bx+0.5));
+    rxz-=sxz*bx;
+    sxy=int(floor(bxy/bx+0.5));
+    rxy=bxy-sxy*bx;
+
+    // Look for the cell in the cache, and otherwise compute it and add it to
+    // the cache
+    if(!cache_fetch()) cache_store();
+}
+
+/** Computes the unit Voronoi cell by cutting a large box by successive shells
+ * of periodic images, until none of the images in a shell cut the cell. */
+void unitcell::compute_unit_voro() {
     int i,j,l=1;
 
     // Initialize the Voronoi cell to be a very large rectangular box
     const double ucx=max_unit_voro_shells*bx,ucy=max_unit_voro_shells*by,ucz=max_unit_voro_shells*bz;
     unit_voro.init(-ucx,ucx,-ucy,ucy,-ucz,ucz);
+    uv_cuts.clear();
 
     // Repeatedly cut the cell by shells of periodic image particles
     while(l<2*max_unit_voro_shells) {
@@ -51,22 +180,7 @@ unitcell::unitcell(double bx_,double bxy_,double by_,double bxz_,double byz_,dou
             }
             for(i=-l;i<=l;i++) for(j=-l;j<=l;j++) unit_voro_apply(i,j,l);
         } else {
-
-            // Calculate a bound on the maximum y and z coordinates that could
-            // possibly cut the cell. This is based upon a geometric result
-            // that particles with z>l can't cut a cell lying within the
-            // paraboloid z<=(l*l-x*x-y*y)/(2*l). It is always a tighter bound
-            // than the one based on computing the maximum radius of a Voronoi
-            // cell vertex.
-            max_uv_y=max_uv_z=0;
-            double y,z,q,*pts=unit_voro.pts,*pp=pts;
-            while(pp<pts+3*unit_voro.p) {
-                q=*(pp++);y=*(pp++);z=*(pp++);q=sqrt(q*q+y*y+z*z);
-                if(y+q>max_uv_y) max_uv_y=y+q;
-                if(z+q>max_uv_z) max_uv_z=z+q;
-            }
-            max_uv_z*=0.5;
-            max_uv_y*=0.5;
+            compute_max_uv();
             return;
         }
         l++;
@@ -79,11 +193,185 @@ unitcell::unitcell(double bx_,double bxy_,double by_,double bxz_,double byz_,dou
     voro_fatal_error("Periodic cell computation failed",VOROPP_MEMORY_ERROR);
 }
 
+/** Computes the unit Voronoi cell by cutting a large box by the planes of a
+ * given list of periodic images, typically those that cut the unit Voronoi
+ * cell of a slightly different domain. Since the unit Voronoi cell tiles
+ * space with one cell per domain, the result is accepted if its volume
+ * matches the volume of the domain. If an image is missing from the list, the
+ * cell is too large and the volume check fails, unless the missing image
+ * only removes a sliver that is smaller than the tolerance. In that case, the
+ * cell is very slightly larger than the true cell, which is conservative for
+ * its use in the triclinic containers.
+ * \param[in] cuts the periodic images to use, as triplets of indices with
+ *                 respect to the domain vectors.
+ * \return True if the unit Voronoi cell was computed, false otherwise. */
+bool unitcell::update_unit_voro(const std::vector<int> &cuts) {
+    const double ucx=max_unit_voro_shells*bx,ucy=max_unit_voro_shells*by,ucz=max_unit_voro_shells*bz;
+    unit_voro.init(-ucx,ucx,-ucy,ucy,-ucz,ucz);
+    uv_cuts.clear();
+    for(std::vector<int>::const_iterator it=cuts.begin();it!=cuts.end();it+=3) {
+        double x=*it*bx+it[1]*bxy+it[2]*bxz,y=it[1]*by+it[2]*byz,z=it[2]*bz;
+        if(unit_voro.plane_intersects(x,y,z,x*x+y*y+z*z)) {
+            uv_cuts.push_back(*it);uv_cuts.push_back(it[1]);uv_cuts.push_back(it[2]);
+            unit_voro.plane(x,y,z);
+            unit_voro.plane(-x,-y,-z);
+        }
+    }
+    double dvol=bx*by*bz;
+    if(fabs(unit_voro.volume()-dvol)>unit_voro_update_tolerance*dvol) return false;
+    compute_max_uv();
+    return true;
+}
+
+/** Calculates a bound on the maximum y and z coordinates that could possibly
+ * cut the unit Voronoi cell. This is based upon a geometric result that
+ * particles with z>l can't cut a cell lying within the paraboloid
+ * z<=(l*l-x*x-y*y)/(2*l). It is always a tighter bound than the one based on
+ * computing the maximum radius of a Voronoi cell vertex. */
+void unitcell::compute_max_uv() {
+    max_uv_y=max_uv_z=0;
+    double y,z,q,*pts=unit_voro.pts,*pp=pts;
+    while(pp<pts+3*unit_voro.p) {
+        q=*(pp++);y=*(pp++);z=*(pp++);q=sqrt(q*q+y*y+z*z);
+        if(y+q>max_uv_y) max_uv_y=y+q;
+        if(z+q>max_uv_z) max_uv_z=z+q;
+    }
+    max_uv_z*=0.5;
+    max_uv_y*=0.5;
+}
+
+/** Looks for the unit Voronoi cell of the domain in the process-wide cache,
+ * and copies it into this class if it is found.
+ * \return True if the cell was found, false otherwise. */
+bool unitcell::cache_fetch() {
+    const double b[6]={bx,bxy,by,bxz,byz,bz};
+    bool found=false;
+#pragma omp critical(voro_unitcell_cache)
+    if(uc_cache.enable) {
+        for(int i=int(uc_cache.e.size())-1;i>=0;i--) {
+            unitcell_cache_entry &ce=*uc_cache.e[i];
+            if(ce.difference(b)<=unit_voro_cache_tolerance) {
+                unit_voro=ce.uv;
+                max_uv_y=ce.max_uv_y;
+                max_uv_z=ce.max_uv_z;
+                uv_cuts=ce.cuts;
+                if(ce.im_done) {
+                    im_vi=ce.vi;im_vd=ce.vd;im_done=true;
+                }
+                uc_cache.touch(i);
+                uc_cache.hits++;
+                found=true;
+                break;
+            }
+        }
+    }
+    return found;
+}
+
+/** Computes the unit Voronoi cell of the domain and adds it to the
+ * process-wide cache. If incremental updates are enabled, then the computation
+ * first tries the images that cut the cell of the most similar domain in the
+ * cache, and only carries out the full computation if this fails. */
+void unitcell::cache_store() {
+    const double b[6]={bx,bxy,by,bxz,byz,bz};
+    bool en,inc;
+    std::vector<int> cuts;
+#pragma omp critical(voro_unitcell_cache)
+    {
+        en=uc_cache.enable;inc=uc_cache.incremental;
+        if(en&&inc) {
+
+            // Find the most similar domain in the cache
+            double d,bd=unit_voro_update_range;
+            int bi=-1;
+            for(int i=0;i<int(uc_cache.e.size());i++) {
+                d=uc_cache.e[i]->difference(b);
+                if(d<=bd) {bd=d;bi=i;}
+            }
+            if(bi>=0) cuts=uc_cache.e[bi]->cuts;
+        }
+    }
+
+    // Compute the cell outside of the critical section, so that other
+    // threads can use the cache in the meantime
+    bool upd=!cuts.empty()&&update_unit_voro(cuts);
+    if(!upd) compute_unit_voro();
+    if(!en) return;
+
+    // Add the cell to the cache, removing the least recently used entry if
+    // the cache is full
+    unitcell_cache_entry *ce=new unitcell_cache_entry;
+    for(int i=0;i<6;i++) ce->b[i]=b[i];
+    ce->uv=unit_voro;
+    ce->max_uv_y=max_uv_y;
+    ce->max_uv_z=max_uv_z;
+    ce->cuts=uv_cuts;
+#pragma omp critical(voro_unitcell_cache)
+    {
+        if(upd) uc_cache.updates++;else uc_cache.misses++;
+        if(int(uc_cache.e.size())>=unit_voro_cache_size) {
+            delete uc_cache.e[0];
+            uc_cache.e.erase(uc_cache.e.begin());
+        }
+        uc_cache.e.push_back(ce);
+    }
+}
+
+/** Sets whether the process-wide cache of unit Voronoi cells is used when
+ * constructing unitcell classes. By default, the cache is enabled without
+ * incremental updates.
+ * \param[in] enable whether to use the cache.
+ * \param[in] incremental whether to compute the cells of new domain shapes
+ *                        starting from the cell of a similar domain in the
+ *                        cache. This is useful when the domain is gradually
+ *                        deformed, such as in constant-pressure or shearing
+ *                        simulations. */
+void unitcell::cache_settings(bool enable,bool incremental) {
+#pragma omp critical(voro_unitcell_cache)
+    {
+        uc_cache.enable=enable;
+        uc_cache.incremental=incremental;
+    }
+}
+
+/** Removes all of the entries from the process-wide cache of unit Voronoi
+ * cells, and resets the statistics. */
+void unitcell::clear_cache() {
+#pragma omp critical(voro_unitcell_cache)
+    {
+        uc_cache.clear();
+        uc_cache.hits=uc_cache.updates=uc_cache.misses=0;
+    }
+}
+
+/** Returns statistics about the use of the process-wide cache of unit Voronoi
+ * cells since it was last cleared.
+ * \param[out] hits the number of cells that were found in the cache.
+ * \param[out] updates the number of cells that were computed starting from
+ *                     the cell of a similar domain.
+ * \param[out] misses the number of cells that were computed from scratch. */
+void unitcell::cache_statistics(int &hits,int &updates,int &misses) {
+#pragma omp critical(voro_unitcell_cache)
+    {
+        hits=uc_cache.hits;
+        updates=uc_cache.updates;
+        misses=uc_cache.misses;
+    }
+}
+
 /** Applies a pair of opposing plane cuts from a periodic image point to the
  * unit Voronoi cell.
  * \param[in] (i,j,k) the index of the periodic image to consider. */
 inline void unitcell::unit_voro_apply(int i,int j,int k) {
-    double x=i*bx+j*bxy+k*bxz,y=j*by+k*byz,z=k*bz;
+    double x=i*bx+j*rxy+k*rxz,y=j*by+k*ryz,z=k*bz;
+
+    // Record the images that cut the cell, in terms of the domain vectors,
+    // for use in incremental updates
+    if(unit_voro.plane_intersects(x,y,z,x*x+y*y+z*z)) {
+        uv_cuts.push_back(i-j*sxy-k*sxz);
+        uv_cuts.push_back(j-k*syz);
+        uv_cuts.push_back(k);
+    }
     unit_voro.plane(x,y,z);
     unit_voro.plane(-x,-y,-z);
 }
@@ -109,13 +397,37 @@ bool unitcell::intersects_image(double dx,double dy,double dz,double &vol) {
     return true;
 }
 
-/** Computes a list of periodic domain images that intersect the unit Voronoi cell.
+/** Computes a list of periodic domain images that intersect the unit Voronoi
+ * cell. The list is computed the first time that it is requested, and is also
+ * stored in the process-wide cache.
  * \param[out] vi a vector containing triplets (i,j,k) corresponding to domain
  *                images that intersect the unit Voronoi cell, when it is
  *                centered in the middle of the primary domain.
  * \param[out] vd a vector containing the fraction of the Voronoi cell volume
  *                within each corresponding image listed in vi. */
 void unitcell::images(std::vector<int> &vi,std::vector<double> &vd) {
+    if(!im_done) {
+        compute_images();
+        im_done=true;
+
+        // Store the list in the cache entry for this domain, if there is one
+        const double b[6]={bx,bxy,by,bxz,byz,bz};
+#pragma omp critical(voro_unitcell_cache)
+        for(int i=int(uc_cache.e.size())-1;i>=0;i--) {
+            unitcell_cache_entry &ce=*uc_cache.e[i];
+            if(!ce.im_done&&ce.difference(b)<=unit_voro_cache_tolerance) {
+                ce.vi=im_vi;ce.vd=im_vd;ce.im_done=true;
+                break;
+            }
+        }
+    }
+    vi.insert(vi.end(),im_vi.begin(),im_vi.end());
+    vd.insert(vd.end(),im_vd.begin(),im_vd.end());
+}
+
+/** Computes the list of periodic domain images that intersect the unit
+ * Voronoi cell, storing it in im_vi and im_vd. */
+void unitcell::compute_images() {
     const int ms2=max_unit_voro_shells*2+1,mss=ms2*ms2*ms2;
     bool *a=new bool[mss],*ac=a+max_unit_voro_shells*(1+ms2*(1+ms2)),*ap=a;
     int i,j,k;
@@ -140,11 +452,11 @@ void unitcell::images(std::vector<int> &vi,std::vector<double> &vd) {
         // Check intersection of this image
         if(intersects_image(i,j,k,vol)) {
 
-            // Add this entry to the output vectors
-            vi.push_back(i);
-            vi.push_back(j);
-            vi.push_back(k);
-            vd.push_back(vol);
+            // Add this entry to the lists
+            im_vi.push_back(i);
+            im_vi.push_back(j);
+            im_vi.push_back(k);
+            im_vd.push_back(vol);
 
             // Add neighbors to the queue if they have not been tested
             ap=ac+i+ms2*(j+ms2*k);
@@ -188,7 +500,7 @@ bool unitcell::unit_voro_intersect(int l) {
  * \param[in] (i,j,k) the index of the periodic image to consider.
  * \return True if the image cuts the cell, false otherwise. */
 inline bool unitcell::unit_voro_test(int i,int j,int k) {
-    double x=i*bx+j*bxy+k*bxz,y=j*by+k*byz,z=k*bz;
+    double x=i*bx+j*rxy+k*rxz,y=j*by+k*ryz,z=k*bz;
     double rsq=x*x+y*y+z*z;
     return unit_voro.plane_intersects(x,y,z,rsq);
 }
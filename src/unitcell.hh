@@ -20,22 +20,22 @@ class unitcell {
     public:
         /** The x coordinate of the first vector defining the periodic
          * domain. */
-        const double bx;
+        double bx;
         /** The x coordinate of the second vector defining the periodic domain.
          */
-        const double bxy;
+        double bxy;
         /** The y coordinate of the second vector defining the periodic domain.
          */
-        const double by;
+        double by;
         /** The x coordinate of the third vector defining the periodic domain.
          */
-        const double bxz;
+        double bxz;
         /** The y coordinate of the third vector defining the periodic domain.
          */
-        const double byz;
+        double byz;
         /** The z coordinate of the third vector defining the periodic domain.
          */
-        const double bz;
+        double bz;
         /** The computed unit Voronoi cell corresponding the given 3D
          * non-rectangular periodic domain geometry. */
         voronoicell_3d unit_voro;
@@ -58,7 +58,11 @@ class unitcell {
         void draw_domain_pov(FILE *fp=stdout);
         bool intersects_image(double dx,double dy,double dz,double &vol);
         void images(std::vector<int> &vi,std::vector<double> &vd);
+        static void cache_settings(bool enable,bool incremental=false);
+        static void clear_cache();
+        static void cache_statistics(int &hits,int &updates,int &misses);
     protected:
+        void set_domain(double bx_,double bxy_,double by_,double bxz_,double byz_,double bz_);
         /** The maximum y-coordinate that could possibly cut the computed unit
          * Voronoi cell. */
         double max_uv_y;
@@ -66,6 +70,39 @@ class unitcell {
          * Voronoi cell. */
         double max_uv_z;
     private:
+        /** The x coordinate of the second vector of a reduced basis for the
+         * lattice of periodic images. */
+        double rxy;
+        /** The x coordinate of the third vector of a reduced basis for the
+         * lattice of periodic images. */
+        double rxz;
+        /** The y coordinate of the third vector of a reduced basis for the
+         * lattice of periodic images. */
+        double ryz;
+        /** The integer multiples of the first vector that are subtracted
+         * from the second and third vectors, and of the second vector that
+         * is subtracted from the third vector, to form the reduced basis. */
+        int sxy,sxz,syz;
+        /** A list of the periodic images whose planes cut the unit Voronoi
+         * cell during its construction, as triplets of indices with respect
+         * to the vectors defining the domain. */
+        std::vector<int> uv_cuts;
+        /** Whether the list of periodic domain images that intersect the unit
+         * Voronoi cell has been computed. */
+        bool im_done;
+        /** The periodic domain images that intersect the unit Voronoi cell,
+         * as computed by the images routine. */
+        std::vector<int> im_vi;
+        /** The fractions of the unit Voronoi cell volume within each of the
+         * periodic domain images in im_vi. */
+        std::vector<double> im_vd;
+        void setup();
+        void compute_unit_voro();
+        bool update_unit_voro(const std::vector<int> &cuts);
+        void compute_max_uv();
+        bool cache_fetch();
+        void cache_store();
+        void compute_images();
         inline void unit_voro_apply(int i,int j,int k);
         bool unit_voro_intersect(int l);
         inline bool unit_voro_test(int i,int j,int k);
@@ -6,28 +6,80 @@
 
 #include "v_base_3d.hh"
 #include "config.hh"
+#include "common.hh"
+#include "worklist_gen_3d.hh"
 
 namespace voro {
 
-/** This function is called during container construction. The routine scans
- * all of the worklists in the wl[] array. For a given worklist of blocks
- * labeled \f$w_1\f$ to \f$w_n\f$, it computes a sequence \f$r_0\f$ to
- * \f$r_n\f$ so that $r_i$ is the minimum distance to all the blocks
- * \f$w_{j}\f$ where \f$j>i\f$ and all blocks outside the worklist. The values
- * of \f$r_n\f$ is calculated first, as the minimum distance to any block in
- * the shell surrounding the worklist. The \f$r_i\f$ are then computed in
- * reverse order by considering the distance to \f$w_{i+1}\f$. */
-voro_base_3d::voro_base_3d(int nx_,int ny_,int nz_,double boxx_,double boxy_,double boxz_) :
+/** The class constructor sets up the dimensions of the computational grid,
+ * selects the block worklists to use, and computes the minimum distances
+ * associated with them.
+ * \param[in] (nx_,ny_,nz_) the number of blocks in each direction.
+ * \param[in] (boxx_,boxy_,boxz_) the dimensions of a block.
+ * \param[in] hgrid_ half the number of subregions that each block is divided
+ *                   into along each direction for the worklists. */
+voro_base_3d::voro_base_3d(int nx_,int ny_,int nz_,double boxx_,double boxy_,double boxz_,int hgrid_) :
     nx(nx_), ny(ny_), nz(nz_), nxy(nx_*ny_), nxyz(nxy*nz_), boxx(boxx_), boxy(boxy_), boxz(boxz_),
-    xsp(1/boxx_), ysp(1/boxy_), zsp(1/boxz_), mrad(new double[wl_hgridcu_3d*wl_seq_length_3d]) {
+    xsp(1/boxx_), ysp(1/boxy_), zsp(1/boxz_), wl_hgrid(hgrid_), wl_fgrid(2*hgrid_),
+    wl_hgridcu(hgrid_*hgrid_*hgrid_), mrad(NULL), wlist(wl) {
+    if(wl_hgrid<1||wl_hgrid>max_worklist_hgrid)
+        voro_fatal_error("Worklist subgrid resolution out of range",VOROPP_INTERNAL_ERROR);
+    mrad=new double[wl_hgridcu*wl_seq_length_3d];
+    select_worklists();
+    initialize_radii();
+}
+
+/** Changes the dimensions of the computational blocks, keeping the number of
+ * blocks fixed. The current worklists are kept if the new block shape is
+ * within the aspect ratio limit of the shape that they were selected for, and
+ * otherwise new worklists are selected. The minimum distances associated with
+ * the worklists are then recomputed.
+ * \param[in] (boxx_,boxy_,boxz_) the new dimensions of a block. */
+void voro_base_3d::set_block_size(double boxx_,double boxy_,double boxz_) {
+    boxx=boxx_;boxy=boxy_;boxz=boxz_;
+    xsp=1/boxx_;ysp=1/boxy_;zsp=1/boxz_;
+    double rx=boxx/wl_boxx,ry=boxy/wl_boxy,rz=boxz/wl_boxz,
+           rmin=rx<ry?rx:ry,rmax=rx>ry?rx:ry;
+    if(rz<rmin) rmin=rz;
+    if(rz>rmax) rmax=rz;
+    if(rmax>worklist_aspect_limit*rmin) select_worklists();
+    initialize_radii();
+}
+
+/** Selects the block worklists to use. If the blocks are close to cubic and
+ * the default subgrid resolution is used, then the pre-computed worklists in
+ * the wl[] array are used. Otherwise worklists are generated for the actual
+ * block shape, or taken from the cache of previously generated worklists. */
+void voro_base_3d::select_worklists() {
+    double bmin=boxx<boxy?boxx:boxy,bmax=boxx>boxy?boxx:boxy;
+    if(boxz<bmin) bmin=boxz;
+    if(boxz>bmax) bmax=boxz;
+    if(wl_hgrid!=wl_hgrid_3d||bmax>worklist_aspect_limit*bmin) {
+        wlist=worklist_gen_3d::worklists(wl_hgrid,boxx,boxy,boxz);
+        wl_boxx=boxx;wl_boxy=boxy;wl_boxz=boxz;
+    } else {
+        wlist=wl;
+        wl_boxx=wl_boxy=wl_boxz=1;
+    }
+}
+
+/** Scans all of the worklists. For a given worklist of blocks labeled
+ * \f$w_1\f$ to \f$w_n\f$, it computes a sequence \f$r_0\f$ to \f$r_n\f$ so
+ * that $r_i$ is the minimum distance to all the blocks \f$w_{j}\f$ where
+ * \f$j>i\f$ and all blocks outside the worklist. The values of \f$r_n\f$ is
+ * calculated first, as the minimum distance to any block in the shell
+ * surrounding the worklist. The \f$r_i\f$ are then computed in reverse order
+ * by considering the distance to \f$w_{i+1}\f$. */
+void voro_base_3d::initialize_radii() {
     const unsigned int b1=1<<21,b2=1<<22,b3=1<<24,b4=1<<25,b5=1<<27,b6=1<<28;
-    const double xstep=boxx/wl_fgrid_3d,ystep=boxy/wl_fgrid_3d,zstep=boxz/wl_fgrid_3d;
+    const double xstep=boxx/wl_fgrid,ystep=boxy/wl_fgrid,zstep=boxz/wl_fgrid;
     int i,j,k,lx,ly,lz,q;
-    unsigned int f,*e=const_cast<unsigned int*> (wl);
+    const unsigned int *e=wlist;
+    unsigned int f;
     double xlo,ylo,zlo,xhi,yhi,zhi,minr,*radp=mrad;
-    for(zlo=0,zhi=zstep,lz=0;lz<wl_hgrid_3d;zlo=zhi,zhi+=zstep,lz++) {
-        for(ylo=0,yhi=ystep,ly=0;ly<wl_hgrid_3d;ylo=yhi,yhi+=ystep,ly++) {
-            for(xlo=0,xhi=xstep,lx=0;lx<wl_hgrid_3d;xlo=xhi,xhi+=xstep,lx++) {
+    for(zlo=0,zhi=zstep,lz=0;lz<wl_hgrid;zlo=zhi,zhi+=zstep,lz++) {
+        for(ylo=0,yhi=ystep,ly=0;ly<wl_hgrid;ylo=yhi,yhi+=ystep,ly++) {
+            for(xlo=0,xhi=xstep,lx=0;lx<wl_hgrid;xlo=xhi,xhi+=xstep,lx++) {
                 minr=large_number;
                 for(q=e[0]+1;q<wl_seq_length_3d;q++) {
                     f=e[q];
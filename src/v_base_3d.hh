@@ -35,26 +35,39 @@ class voro_base_3d {
          * routines that step through blocks in sequence. */
         const int nxyz;
         /** The size of a computational block in the x direction. */
-        const double boxx;
+        double boxx;
         /** The size of a computational block in the y direction. */
-        const double boxy;
+        double boxy;
         /** The size of a computational block in the z direction. */
-        const double boxz;
+        double boxz;
         /** The inverse box length in the x direction. */
-        const double xsp;
+        double xsp;
         /** The inverse box length in the y direction. */
-        const double ysp;
+        double ysp;
         /** The inverse box length in the z direction. */
-        const double zsp;
+        double zsp;
+        /** Half the number of subregions that each block is divided into
+         * along each direction for the block worklists. */
+        const int wl_hgrid;
+        /** The number of subregions that each block is divided into along
+         * each direction for the block worklists. */
+        const int wl_fgrid;
+        /** The total number of block worklists. */
+        const int wl_hgridcu;
         /** An array to hold the minimum distances associated with the
          * worklists. This array is initialized during container construction,
          * by the initialize_radii() routine. */
         double *mrad;
         /** The pre-computed block worklists. */
         static const unsigned int wl[wl_seq_length_3d*wl_hgridcu_3d];
-        voro_base_3d(int nx_,int ny_,int nz_,double boxx_,double boxy_,double boxz_);
+        /** A pointer to the block worklists that are used for this
+         * container, which are either the pre-computed worklists, or
+         * worklists generated for the block shape. */
+        const unsigned int *wlist;
+        voro_base_3d(int nx_,int ny_,int nz_,double boxx_,double boxy_,double boxz_,int hgrid_=wl_hgrid_3d);
         ~voro_base_3d() {delete [] mrad;}
     protected:
+        void set_block_size(double boxx_,double boxy_,double boxz_);
         /** A custom int function that returns consistent stepping for negative
          * numbers, so that (-1.5, -0.5, 0.5, 1.5) maps to (-2,-1,0,1).
          * \param[in] a the number to consider.
@@ -73,6 +86,11 @@ class voro_base_3d {
          * \return The value of a div b, consistent for negative numbers. */
         inline int step_div(int a,int b) {return a>=0?a/b:-1+(a+1)/b;}
     private:
+        /** The block dimensions that the current worklists were selected
+         * for, which are all set to one for the pre-computed worklists. */
+        double wl_boxx,wl_boxy,wl_boxz;
+        void select_worklists();
+        void initialize_radii();
         void compute_minimum(double &minr,double &xlo,double &xhi,double &ylo,double &yhi,double &zlo,double &zhi,int ti,int tj,int tk);
 };
 
@@ -4,6 +4,8 @@
 /** \file v_compute_3d.cc
  * \brief Function implementantions for the voro_compute_3d template. */
 
+#include <algorithm>
+
 #include "worklist_3d.hh"
 #include "v_compute_3d.hh"
 #include "rad_option.hh"
@@ -35,10 +37,13 @@ voro_compute_3d<c_class>::voro_compute_3d(c_class &con_, int hx_, int hy_,
       id(con_.id),
       p(con_.p),
       co(con_.co),
+      nplane_calls(0),
       bxsq(boxx * boxx + boxy * boxy + boxz * boxz),
       mv(0),
       qu_size(3 * (3 + hxy + hz * (hx + hy))),
-      wl(con_.wl),
+      hgrid(con_.wl_hgrid),
+      fgrid(con_.wl_fgrid),
+      wl(con_.wlist),
       mrad(con_.mrad),
       mask(new uint32_t[hxyz]),
       qu(new int[qu_size]),
@@ -80,31 +85,160 @@ inline void voro_compute_3d<c_class>::scan_all(int ijk,double x,double y,double
  * \param[in] (ci,cj,ck) the coordinates of the block that the test particle is
  *                       in relative to the container data structure.
  * \param[in] ijk the index of the block that the test particle is in.
- * \param[out] w a reference to a particle record in which to store information
- *               about the particle whose Voronoi cell the vector is within.
- * \param[out] mrs the minimum computed distance. */
+ * \param[in,out] w a reference to a particle record in which to store
+ *                  information about the particle whose Voronoi cell the
+ *                  vector is within. If seeded is true, then on input this
+ *                  holds a candidate particle, found relative to the same
+ *                  block (ci,cj,ck).
+ * \param[out] mrs the minimum computed distance.
+ * \param[in] seeded whether to use the particle in w as the starting guess.
+ *                   Its distance to the vector then serves as the initial
+ *                   search radius, which allows the block search to terminate
+ *                   earlier when successive queries are close together. */
+template<class c_class>
+void voro_compute_3d<c_class>::find_voronoi_cell(double x,double y,double z,int ci,int cj,int ck,int ijk,particle_record_3d &w,double &mrs,bool seeded) {
+    double qx=0,qy=0,qz=0,fx,fy,fz,*pp;
+    int i,j,k,disp;
+    con.initialize_search(ci,cj,ck,ijk,i,j,k,disp);
+
+    // Init setup for parameters to return. If a seed particle is given, then
+    // compute its distance to the vector, taking into account the periodic
+    // displacement of the block that it was found in.
+    if(seeded&&w.ijk!=-1) {
+        con.region_index(ci,cj,ck,w.di+i,w.dj+j,w.dk+k,qx,qy,qz,disp);
+        pp=p[w.ijk]+ps*w.l;
+        fx=*pp+qx-x;fy=pp[1]+qy-y;fz=pp[2]+qz-z;
+        mrs=con.r_current_sub(fx*fx+fy*fy+fz*fz,w.ijk,w.l);
+    } else {w.ijk=-1;mrs=large_number;}
+
+    nearest_search ns(*this,w,mrs);
+    search_blocks(ns,x,y,z,ci,cj,ck,ijk,i,j,k,disp);
+}
+
+/** Finds the k particles that are closest to a given vector, using the
+ * Euclidean distance. For the radical tessellation containers, the particle
+ * radii are not taken into account. In periodic directions, the search
+ * extends over one periodic length either side of the vector, and hence the
+ * result may contain several periodic images of the same particle.
+ * \param[in] (x,y,z) the vector to consider.
+ * \param[in] (ci,cj,ck) the coordinates of the block that the vector is in
+ *                       relative to the container data structure.
+ * \param[in] ijk the index of the block that the vector is in.
+ * \param[in] kn the number of particles to find.
+ * \param[out] nr a vector in which to store the particles found, sorted in
+ *                order of increasing distance. Fewer than kn particles are
+ *                stored if the container does not have enough. */
+template<class c_class>
+void voro_compute_3d<c_class>::find_k_nearest(double x,double y,double z,int ci,int cj,int ck,int ijk,int kn,std::vector<neighbor_record_3d> &nr) {
+    int i,j,k,disp;
+    nr.clear();
+    if(kn<=0) return;
+    con.initialize_search(ci,cj,ck,ijk,i,j,k,disp);
+    k_nearest_search ns(*this,kn,nr);
+    search_blocks(ns,x,y,z,ci,cj,ck,ijk,i,j,k,disp);
+    std::sort_heap(nr.begin(),nr.end());
+}
+
+/** Finds all particles within a given distance of a vector. For the radical
+ * tessellation containers, the particle radii are not taken into account. In
+ * periodic directions, the search extends over one periodic length either
+ * side of the vector, so the result is complete for radii up to half of the
+ * periodic length.
+ * \param[in] (x,y,z) the vector to consider.
+ * \param[in] (ci,cj,ck) the coordinates of the block that the vector is in
+ *                       relative to the container data structure.
+ * \param[in] ijk the index of the block that the vector is in.
+ * \param[in] r the search radius.
+ * \param[out] nr a vector in which to store the particles found, in no
+ *                particular order. */
+template<class c_class>
+void voro_compute_3d<c_class>::find_within_radius(double x,double y,double z,int ci,int cj,int ck,int ijk,double r,std::vector<neighbor_record_3d> &nr) {
+    int i,j,k,disp;
+    nr.clear();
+    con.initialize_search(ci,cj,ck,ijk,i,j,k,disp);
+    radius_search ns(*this,r*r,nr);
+    search_blocks(ns,x,y,z,ci,cj,ck,ijk,i,j,k,disp);
+}
+
+/** Tests the particles within a block during a k-nearest neighbor search,
+ * adding those closer than the current kth nearest particle to the heap.
+ * \param[in] ijk the index of the block.
+ * \param[in] (x,y,z) the test vector to consider (which may have already had a
+ *                    periodic displacement applied to it).
+ * \param[in] (di,dj,dk) the coordinates of the current block, to store in the
+ *                       particle records. */
+template<class c_class>
+inline void voro_compute_3d<c_class>::k_nearest_search::scan(int ijk,double x,double y,double z,int di,int dj,int dk) {
+    double x1,y1,z1,rs,*pp=vc.p[ijk];
+    neighbor_record_3d r;
+    r.ijk=ijk;r.di=di;r.dj=dj;r.dk=dk;
+    for(int l=0;l<vc.co[ijk];l++,pp+=vc.ps) {
+        x1=*pp-x;y1=pp[1]-y;z1=pp[2]-z;
+        rs=x1*x1+y1*y1+z1*z1;
+        if(rs<rb) {
+            r.l=l;r.rs=rs;
+            if((int) nr.size()==kn) {
+                std::pop_heap(nr.begin(),nr.end());
+                nr.back()=r;
+            } else nr.push_back(r);
+            std::push_heap(nr.begin(),nr.end());
+            if((int) nr.size()==kn) rb=nr.front().rs;
+        }
+    }
+}
+
+/** Tests the particles within a block during a fixed-radius search, storing
+ * those that are within the search radius.
+ * \param[in] ijk the index of the block.
+ * \param[in] (x,y,z) the test vector to consider (which may have already had a
+ *                    periodic displacement applied to it).
+ * \param[in] (di,dj,dk) the coordinates of the current block, to store in the
+ *                       particle records. */
+template<class c_class>
+inline void voro_compute_3d<c_class>::radius_search::scan(int ijk,double x,double y,double z,int di,int dj,int dk) {
+    double x1,y1,z1,*pp=vc.p[ijk];
+    neighbor_record_3d r;
+    r.ijk=ijk;r.di=di;r.dj=dj;r.dk=dk;
+    for(int l=0;l<vc.co[ijk];l++,pp+=vc.ps) {
+        x1=*pp-x;y1=pp[1]-y;z1=pp[2]-z;
+        r.rs=x1*x1+y1*y1+z1*z1;
+        if(r.rs<=rs) {r.l=l;nr.push_back(r);}
+    }
+}
+
+/** Searches the blocks around a given vector in order of increasing distance,
+ * using the worklists to test the nearby blocks, and then the mask and queue
+ * to work outwards block by block. The search terminates once all remaining
+ * blocks are further away than the search radius. This routine forms the
+ * common core of the find_voronoi_cell(), find_k_nearest(), and
+ * find_within_radius() routines.
+ * \param[in] ns the search state, which tests the particles in each block and
+ *               supplies the current squared search radius.
+ * \param[in] (x,y,z) the vector to consider.
+ * \param[in] (ci,cj,ck) the coordinates of the block that the vector is in
+ *                       relative to the container data structure.
+ * \param[in] ijk the index of the block that the vector is in.
+ * \param[in] (i,j,k) the coordinates of the block relative to the mask, as
+ *                    computed by the container's initialize_search() routine.
+ * \param[in] disp a block displacement used internally by the container. */
 template<class c_class>
-void voro_compute_3d<c_class>::find_voronoi_cell(double x,double y,double z,int ci,int cj,int ck,int ijk,particle_record_3d &w,double &mrs) {
+template<class n_search>
+void voro_compute_3d<c_class>::search_blocks(n_search &ns,double x,double y,double z,int ci,int cj,int ck,int ijk,int i,int j,int k,int disp) {
     double qx=0,qy=0,qz=0,rs;
-    int i,j,k,di,dj,dk,ei,ej,ek,f,g,disp;
+    int di,dj,dk,ei,ej,ek,f,g;
     double fx,fy,fz,mxs,mys,mzs,*radp;
     unsigned int q,*e;
     uint32_t *mijk;
 
-    // Init setup for parameters to return
-    w.ijk=-1;mrs=large_number;
-
-    con.initialize_search(ci,cj,ck,ijk,i,j,k,disp);
-
     // Test all particles in the particle's local region first
-    scan_all(ijk,x,y,z,0,0,0,w,mrs);
+    ns.scan(ijk,x,y,z,0,0,0);
 
     // Now compute the fractional position of the particle within its region
     // and store it in (fx,fy,fz). We use this to compute an index (di,dj,dk)
     // of which subregion the particle is within.
     unsigned int m1,m2;
     con.frac_pos(x,y,z,ci,cj,ck,fx,fy,fz);
-    di=int(fx*xsp*wl_fgrid_3d);dj=int(fy*ysp*wl_fgrid_3d);dk=int(fz*zsp*wl_fgrid_3d);
+    di=int(fx*xsp*fgrid);dj=int(fy*ysp*fgrid);dk=int(fz*zsp*fgrid);
 
     // The indices (di,dj,dk) tell us which worklist to use, to test the blocks
     // in the optimal order. But we only store worklists for the eighth of the
@@ -113,38 +247,39 @@ void voro_compute_3d<c_class>::find_voronoi_cell(double x,double y,double z,int
     // for these cases, by reflecting high values of di, dj, and dk. For these
     // cases, a mask is constructed in m1 and m2 which is used to flip the
     // worklist information when it is loaded.
-    if(di>=wl_hgrid_3d) {
+    if(di>=hgrid) {
         mxs=boxx-fx;
-        m1=127+(3<<21);m2=1+(1<<21);di=wl_fgrid_3d-1-di;if(di<0) di=0;
+        m1=127+(3<<21);m2=1+(1<<21);di=fgrid-1-di;if(di<0) di=0;
     } else {m1=m2=0;mxs=fx;}
-    if(dj>=wl_hgrid_3d) {
+    if(dj>=hgrid) {
         mys=boxy-fy;
-        m1|=(127<<7)+(3<<24);m2|=(1<<7)+(1<<24);dj=wl_fgrid_3d-1-dj;if(dj<0) dj=0;
+        m1|=(127<<7)+(3<<24);m2|=(1<<7)+(1<<24);dj=fgrid-1-dj;if(dj<0) dj=0;
     } else mys=fy;
-    if(dk>=wl_hgrid_3d) {
+    if(dk>=hgrid) {
         mzs=boxz-fz;
-        m1|=(127<<14)+(3<<27);m2|=(1<<14)+(1<<27);dk=wl_fgrid_3d-1-dk;if(dk<0) dk=0;
+        m1|=(127<<14)+(3<<27);m2|=(1<<14)+(1<<27);dk=fgrid-1-dk;if(dk<0) dk=0;
     } else mzs=fz;
 
-    // Do a quick test to account for the case when the minimum radius is small
-    // enought that no other blocks need to be considered
-    rs=con.r_max_add(mrs);
+    // Do a quick test to account for the case when the search radius is small
+    // enough that no other blocks need to be considered
+    rs=ns.bound();
     if(mxs*mxs>rs&&mys*mys>rs&&mzs*mzs>rs) return;
 
     // Now compute which worklist we are going to use, and set radp and e to
     // point at the right offsets
-    ijk=di+wl_hgrid_3d*(dj+wl_hgrid_3d*dk);
+    ijk=di+hgrid*(dj+hgrid*dk);
     radp=mrad+ijk*wl_seq_length_3d;
     e=(const_cast<unsigned int*> (wl))+ijk*wl_seq_length_3d;
 
     // Read in how many items in the worklist can be tested without having to
-    // worry about writing to the mask
+    // worry about writing to the mask. For worklists generated for very flat
+    // blocks, there may be no such items.
     f=e[0];g=0;
-    do {
+    while(g<f) {
 
-        // If mrs is less than the minimum distance to any untested block, then
-        // we are done
-        if(con.r_max_add(mrs)<radp[g]) return;
+        // If the search radius is less than the minimum distance to any
+        // untested block, then we are done
+        if(ns.bound()<radp[g]) return;
         g++;
 
         // Load in a block off the worklist, permute it with the symmetry mask,
@@ -160,22 +295,17 @@ void voro_compute_3d<c_class>::find_voronoi_cell(double x,double y,double z,int
         ej=dj+j;if(ej<0||ej>=hy) continue;
         ek=dk+k;if(ek<0||ek>=hz) continue;
 
-        // Call the compute_min_max_radius() function. This returns true if the
-        // minimum distance to the block is bigger than the current mrs, in
-        // which case we skip this block and move on. Otherwise, it computes
-        // the maximum distance to the block and returns it in crs.
-        if(compute_min_radius(di,dj,dk,fx,fy,fz,mrs)) continue;
+        // Call the compute_min_radius() function. This returns true if the
+        // minimum distance to the block is bigger than the search radius, in
+        // which case we skip this block and move on.
+        if(compute_min_radius(di,dj,dk,fx,fy,fz,ns.bound())) continue;
 
         // Now compute which region we are going to loop over, adding a
         // displacement for the periodic cases
         ijk=con.region_index(ci,cj,ck,ei,ej,ek,qx,qy,qz,disp);
 
-        // If mrs is bigger than the maximum distance to the block, then we
-        // have to test all particles in the block for intersections.
-        // Otherwise, we do additional checks and skip those particles which
-        // can't possibly intersect the block.
-        scan_all(ijk,x-qx,y-qy,z-qz,di,dj,dk,w,mrs);
-    } while(g<f);
+        ns.scan(ijk,x-qx,y-qy,z-qz,di,dj,dk);
+    }
 
     // Update mask value and initialize queue
     mv++;
@@ -184,9 +314,9 @@ void voro_compute_3d<c_class>::find_voronoi_cell(double x,double y,double z,int
 
     while(g<wl_seq_length_3d-1) {
 
-        // If mrs is less than the minimum distance to any untested block, then
-        // we are done
-        if(con.r_max_add(mrs)<radp[g]) return;
+        // If the search radius is less than the minimum distance to any
+        // untested block, then we are done
+        if(ns.bound()<radp[g]) return;
         g++;
 
         // Load in a block off the worklist, permute it with the symmetry mask,
@@ -205,21 +335,21 @@ void voro_compute_3d<c_class>::find_voronoi_cell(double x,double y,double z,int
         mijk=mask+ei+hx*(ej+hy*ek);
         *mijk=mv;
 
-        // Skip this block if it is further away than the current minimum
+        // Skip this block if it is further away than the current search
         // radius
-        if(compute_min_radius(di,dj,dk,fx,fy,fz,mrs)) continue;
+        if(compute_min_radius(di,dj,dk,fx,fy,fz,ns.bound())) continue;
 
         // Now compute which region we are going to loop over, adding a
         // displacement for the periodic cases
         ijk=con.region_index(ci,cj,ck,ei,ej,ek,qx,qy,qz,disp);
-        scan_all(ijk,x-qx,y-qy,z-qz,di,dj,dk,w,mrs);
+        ns.scan(ijk,x-qx,y-qy,z-qz,di,dj,dk);
 
         if(qu_e>qu_l-18) add_list_memory(qu_s,qu_e);
         scan_bits_mask_add(q,mijk,ei,ej,ek,qu_e);
     }
 
     // Do a check to see if we've reached the radius cutoff
-    if(con.r_max_add(mrs)<radp[g]) return;
+    if(ns.bound()<radp[g]) return;
 
     // We were unable to completely compute the cell based on the blocks in the
     // worklist, so now we have to go block by block, reading in items off the
@@ -230,10 +360,10 @@ void voro_compute_3d<c_class>::find_voronoi_cell(double x,double y,double z,int
         if(qu_s==qu_l) qu_s=qu;
         ei=*(qu_s++);ej=*(qu_s++);ek=*(qu_s++);
         di=ei-i;dj=ej-j;dk=ek-k;
-        if(compute_min_radius(di,dj,dk,fx,fy,fz,mrs)) continue;
+        if(compute_min_radius(di,dj,dk,fx,fy,fz,ns.bound())) continue;
 
         ijk=con.region_index(ci,cj,ck,ei,ej,ek,qx,qy,qz,disp);
-        scan_all(ijk,x-qx,y-qy,z-qz,di,dj,dk,w,mrs);
+        ns.scan(ijk,x-qx,y-qy,z-qz,di,dj,dk);
 
         // Test the neighbors of the current block, and add them to the block
         // list if they haven't already been tested
@@ -304,17 +434,116 @@ inline void voro_compute_3d<c_class>::scan_bits_mask_add(unsigned int q,uint32_t
 template<class c_class>
 template<class v_cell>
 bool voro_compute_3d<c_class>::compute_cell(v_cell &c,int ijk,int s,int ci,int cj,int ck) {
+    double x,y,z,r_rad=0,r_mul=0;
+    int i,j,k,disp;
+    if(!con.initialize_voronoicell(c,ijk,s,ci,cj,ck,i,j,k,x,y,z,disp)) return false;
+    con.r_init(ijk,s,r_rad,r_mul);
+    return compute_cell_planes(c,ijk,s,ci,cj,ck,i,j,k,x,y,z,disp,r_rad,r_mul)
+        &&con.finalize_voronoicell(c,ijk,x,y,z);
+}
+
+/** Computes the Voronoi cell for a particle in the container, starting from
+ * the neighbors of the particle at a previous time step. The cell is first cut
+ * by the planes of the previous neighbors, using their current positions, so
+ * that it shrinks to nearly its final size. The usual search over the
+ * worklist is then carried out, which verifies that the cell is complete,
+ * skipping the planes that were already applied.
+ * The result is identical to compute_cell() regardless of how accurate the
+ * previous neighbors are. In periodic directions, the nearest periodic image
+ * of each previous neighbor is used.
+ * \param[in,out] c a reference to a voronoicell object.
+ * \param[in] ijk the index of the block that the test particle is in.
+ * \param[in] s the index of the particle within the test block.
+ * \param[in] (ci,cj,ck) the coordinates of the block that the test particle is
+ *                       in relative to the container data structure.
+ * \param[in] nb the IDs of the previous neighbors. Negative IDs, which
+ *               correspond to walls, and IDs that are not in the container
+ *               are skipped.
+ * \param[in] nn the number of previous neighbors.
+ * \param[in] pi an index for finding the particles in the container from
+ *               their IDs.
+ * \return False if the Voronoi cell was completely removed during the
+ *         computation and has zero volume, true otherwise. */
+template<class c_class>
+template<class v_cell>
+bool voro_compute_3d<c_class>::compute_cell_warm(v_cell &c,int ijk,int s,int ci,int cj,int ck,const int *nb,int nn,particle_index_3d &pi) {
+    double x,y,z,x1,y1,z1,*pp,r_rad=0,r_mul=0;
+    int i,j,k,disp;
+    bool alive=true;
+    c_info w;
+    if(!con.initialize_voronoicell(c,ijk,s,ci,cj,ck,i,j,k,x,y,z,disp)) return false;
+    con.r_init(ijk,s,r_rad,r_mul);
+
+    // Cut the cell by the planes of the previous neighbors, recording them
+    // so that they are not applied again during the worklist search
+    for(int n=0;n<nn;n++) if(nb[n]>=0&&pi.find(nb[n],w)&&(w.ijk!=ijk||w.q!=s)) {
+        pp=p[w.ijk]+ps*w.q;
+        x1=*pp-x;y1=pp[1]-y;z1=pp[2]-z;
+        con.nearest_image(x1,y1,z1);
+        if(!cut(c,x1,y1,z1,con.r_scale(x1*x1+y1*y1+z1*z1,w.ijk,w.q,r_rad),id[w.ijk][w.q])) {alive=false;break;}
+        wid.push_back(id[w.ijk][w.q]);
+        wdisp.push_back(x1);wdisp.push_back(y1);wdisp.push_back(z1);
+    }
+    if(alive) alive=compute_cell_planes(c,ijk,s,ci,cj,ck,i,j,k,x,y,z,disp,r_rad,r_mul)
+        &&con.finalize_voronoicell(c,ijk,x,y,z);
+    wid.clear();wdisp.clear();
+    return alive;
+}
+
+/** Computes the Voronoi cell for a ghost particle at a given position, which
+ * is not stored in the container. Unlike inserting the ghost particle into
+ * the container and calling compute_cell(), this routine does not modify the
+ * container, so several threads can compute ghost cells concurrently, as long
+ * as each uses its own voro_compute_3d object.
+ * \param[in,out] c a reference to a voronoicell object.
+ * \param[in] ijk the index of the block that the ghost particle is in.
+ * \param[in] (ci,cj,ck) the coordinates of the block that the ghost particle
+ *                       is in relative to the container data structure.
+ * \param[in] (x,y,z) the position of the ghost particle, which must be within
+ *                    the primary domain.
+ * \param[in] r the radius of the ghost particle, which is only used by
+ *              containers for radical Voronoi tessellations.
+ * \return False if the Voronoi cell was completely removed during the
+ *         computation and has zero volume, true otherwise. */
+template<class c_class>
+template<class v_cell>
+bool voro_compute_3d<c_class>::compute_ghost_cell(v_cell &c,int ijk,int ci,int cj,int ck,double x,double y,double z,double r) {
+    double r_rad=0,r_mul=0;
+    int i,j,k,disp;
+    if(!con.initialize_ghost_voronoicell(c,ijk,ci,cj,ck,i,j,k,x,y,z,disp)) return false;
+    con.r_init_ghost(r,r_rad,r_mul);
+    return compute_cell_planes(c,ijk,co[ijk],ci,cj,ck,i,j,k,x,y,z,disp,r_rad,r_mul)
+        &&con.finalize_voronoicell(c,ijk,x,y,z);
+}
+
+/** Carries out the plane cuts for the compute_cell() and compute_ghost_cell()
+ * routines, once the Voronoi cell has been initialized.
+ * \param[in,out] c a reference to a voronoicell object.
+ * \param[in] ijk the index of the block that the test particle is in.
+ * \param[in] s the index of the particle within the test block, which is
+ *              skipped. For a ghost particle, this is set to the number of
+ *              particles in the block so that all of them are tested.
+ * \param[in] (ci,cj,ck) the coordinates of the block that the test particle is
+ *                       in relative to the container data structure.
+ * \param[in] (i,j,k) the coordinates of the test block relative to the
+ *                    voro_compute coordinate system.
+ * \param[in] (x,y,z) the position of the test particle.
+ * \param[in] disp a block displacement used to compute block indices.
+ * \param[in] (r_rad,r_mul) constants for the radical tessellation.
+ * \return False if the Voronoi cell was completely removed during the
+ *         computation and has zero volume, true otherwise. */
+template<class c_class>
+template<class v_cell>
+bool voro_compute_3d<c_class>::compute_cell_planes(v_cell &c,int ijk,int s,int ci,int cj,int ck,int i,int j,int k,
+        double x,double y,double z,int disp,double r_rad,double r_mul) {
     static const int count_list[8]={7,11,15,19,26,35,45,59},*count_e=count_list+8;
-    double x,y,z,x1,y1,z1,qx=0,qy=0,qz=0;
+    double x1,y1,z1,qx=0,qy=0,qz=0;
     double xlo,ylo,zlo,xhi,yhi,zhi,x2,y2,z2,rs;
-    int i,j,k,di,dj,dk,ei,ej,ek,f,g,l,disp;
+    int di,dj,dk,ei,ej,ek,f,g,l;
     double fx,fy,fz,gxs,gys,gzs,*radp;
     unsigned int q,*e;
     uint32_t *mijk;
-    double r_rad,r_mul,r_val;
-
-    if(!con.initialize_voronoicell(c,ijk,s,ci,cj,ck,i,j,k,x,y,z,disp)) return false;
-    con.r_init(ijk,s,r_rad,r_mul);
+    double r_val;
 
     // Initialize the Voronoi cell to fill the entire container
     double crs,mrs;
@@ -327,7 +556,7 @@ bool voro_compute_3d<c_class>::compute_cell(v_cell &c,int ijk,int s,int ci,int c
         y1=p[ijk][ps*l+1]-y;
         z1=p[ijk][ps*l+2]-z;
         rs=con.r_scale(x1*x1+y1*y1+z1*z1,ijk,l,r_rad);
-        if(!c.nplane(x1,y1,z1,rs,id[ijk][l])) return false;
+        if(!cut(c,x1,y1,z1,rs,id[ijk][l])) return false;
     }
     l++;
     while(l<co[ijk]) {
@@ -335,7 +564,7 @@ bool voro_compute_3d<c_class>::compute_cell(v_cell &c,int ijk,int s,int ci,int c
         y1=p[ijk][ps*l+1]-y;
         z1=p[ijk][ps*l+2]-z;
         rs=con.r_scale(x1*x1+y1*y1+z1*z1,ijk,l,r_rad);
-        if(!c.nplane(x1,y1,z1,rs,id[ijk][l])) return false;
+        if(!cut(c,x1,y1,z1,rs,id[ijk][l])) return false;
         l++;
     }
 
@@ -349,7 +578,7 @@ bool voro_compute_3d<c_class>::compute_cell(v_cell &c,int ijk,int s,int ci,int c
     // of which subregion the particle is within.
     unsigned int m1,m2;
     con.frac_pos(x,y,z,ci,cj,ck,fx,fy,fz);
-    di=int(fx*xsp*wl_fgrid_3d);dj=int(fy*ysp*wl_fgrid_3d);dk=int(fz*zsp*wl_fgrid_3d);
+    di=int(fx*xsp*fgrid);dj=int(fy*ysp*fgrid);dk=int(fz*zsp*fgrid);
 
     // The indices (di,dj,dk) tell us which worklist to use, to test the blocks
     // in the optimal order. But we only store worklists for the eighth of the
@@ -358,30 +587,31 @@ bool voro_compute_3d<c_class>::compute_cell(v_cell &c,int ijk,int s,int ci,int c
     // for these cases, by reflecting high values of di, dj, and dk. For these
     // cases, a mask is constructed in m1 and m2 which is used to flip the
     // worklist information when it is loaded.
-    if(di>=wl_hgrid_3d) {
+    if(di>=hgrid) {
         gxs=fx;
-        m1=127+(3<<21);m2=1+(1<<21);di=wl_fgrid_3d-1-di;if(di<0) di=0;
+        m1=127+(3<<21);m2=1+(1<<21);di=fgrid-1-di;if(di<0) di=0;
     } else {m1=m2=0;gxs=boxx-fx;}
-    if(dj>=wl_hgrid_3d) {
+    if(dj>=hgrid) {
         gys=fy;
-        m1|=(127<<7)+(3<<24);m2|=(1<<7)+(1<<24);dj=wl_fgrid_3d-1-dj;if(dj<0) dj=0;
+        m1|=(127<<7)+(3<<24);m2|=(1<<7)+(1<<24);dj=fgrid-1-dj;if(dj<0) dj=0;
     } else gys=boxy-fy;
-    if(dk>=wl_hgrid_3d) {
+    if(dk>=hgrid) {
         gzs=fz;
-        m1|=(127<<14)+(3<<27);m2|=(1<<14)+(1<<27);dk=wl_fgrid_3d-1-dk;if(dk<0) dk=0;
+        m1|=(127<<14)+(3<<27);m2|=(1<<14)+(1<<27);dk=fgrid-1-dk;if(dk<0) dk=0;
     } else gzs=boxz-fz;
     gxs*=gxs;gys*=gys;gzs*=gzs;
 
     // Now compute which worklist we are going to use, and set radp and e to
     // point at the right offsets
-    ijk=di+wl_hgrid_3d*(dj+wl_hgrid_3d*dk);
+    ijk=di+hgrid*(dj+hgrid*dk);
     radp=mrad+ijk*wl_seq_length_3d;
     e=(const_cast<unsigned int*> (wl))+ijk*wl_seq_length_3d;
 
     // Read in how many items in the worklist can be tested without having to
-    // worry about writing to the mask
+    // worry about writing to the mask. For worklists generated for very flat
+    // blocks, there may be no such items.
     f=e[0];g=0;
-    do {
+    while(g<f) {
 
         // At the intervals specified by count_list, we recompute the maximum
         // radius squared
@@ -430,7 +660,7 @@ bool voro_compute_3d<c_class>::compute_cell(v_cell &c,int ijk,int s,int ci,int c
                     y1=p[ijk][ps*l+1]-y2;
                     z1=p[ijk][ps*l+2]-z2;
                     rs=con.r_scale(x1*x1+y1*y1+z1*z1,ijk,l,r_rad);
-                    if(!c.nplane(x1,y1,z1,rs,id[ijk][l])) return false;
+                    if(!cut(c,x1,y1,z1,rs,id[ijk][l])) return false;
                     l++;
                 } while (l<co[ijk]);
             } else {
@@ -439,12 +669,12 @@ bool voro_compute_3d<c_class>::compute_cell(v_cell &c,int ijk,int s,int ci,int c
                     y1=p[ijk][ps*l+1]-y2;
                     z1=p[ijk][ps*l+2]-z2;
                     rs=x1*x1+y1*y1+z1*z1;
-                    if(con.r_scale_check(rs,mrs,ijk,l,r_rad)&&!c.nplane(x1,y1,z1,rs,id[ijk][l])) return false;
+                    if(con.r_scale_check(rs,mrs,ijk,l,r_rad)&&!cut(c,x1,y1,z1,rs,id[ijk][l])) return false;
                     l++;
                 } while (l<co[ijk]);
             }
         }
-    } while(g<f);
+    }
 
     // If we reach here, we were unable to compute the entire cell using the
     // first part of the worklist. This section of the algorithm continues the
@@ -512,7 +742,7 @@ bool voro_compute_3d<c_class>::compute_cell(v_cell &c,int ijk,int s,int ci,int c
                     y1=p[ijk][ps*l+1]-y2;
                     z1=p[ijk][ps*l+2]-z2;
                     rs=con.r_scale(x1*x1+y1*y1+z1*z1,ijk,l,r_rad);
-                    if(!c.nplane(x1,y1,z1,rs,id[ijk][l])) return false;
+                    if(!cut(c,x1,y1,z1,rs,id[ijk][l])) return false;
                     l++;
                 } while (l<co[ijk]);
             } else {
@@ -521,7 +751,7 @@ bool voro_compute_3d<c_class>::compute_cell(v_cell &c,int ijk,int s,int ci,int c
                     y1=p[ijk][ps*l+1]-y2;
                     z1=p[ijk][ps*l+2]-z2;
                     rs=x1*x1+y1*y1+z1*z1;
-                    if(con.r_scale_check(rs,mrs,ijk,l,r_rad)&&!c.nplane(x1,y1,z1,rs,id[ijk][l])) return false;
+                    if(con.r_scale_check(rs,mrs,ijk,l,r_rad)&&!cut(c,x1,y1,z1,rs,id[ijk][l])) return false;
                     l++;
                 } while (l<co[ijk]);
             }
@@ -615,7 +845,7 @@ bool voro_compute_3d<c_class>::compute_cell(v_cell &c,int ijk,int s,int ci,int c
                 y1=p[ijk][ps*l+1]-y2;
                 z1=p[ijk][ps*l+2]-z2;
                 rs=con.r_scale(x1*x1+y1*y1+z1*z1,ijk,l,r_rad);
-                if(!c.nplane(x1,y1,z1,rs,id[ijk][l])) return false;
+                if(!cut(c,x1,y1,z1,rs,id[ijk][l])) return false;
                 l++;
             } while (l<co[ijk]);
         }
@@ -949,7 +1179,7 @@ bool voro_compute_3d<c_class>::compute_min_max_radius(int di,int dj,int dk,doubl
 }
 
 template<class c_class>
-bool voro_compute_3d<c_class>::compute_min_radius(int di,int dj,int dk,double fx,double fy,double fz,double mrs) {
+bool voro_compute_3d<c_class>::compute_min_radius(int di,int dj,int dk,double fx,double fy,double fz,double rb) {
     double t,crs;
 
     if(di>0) {t=di*boxx-fx;crs=t*t;}
@@ -962,7 +1192,7 @@ bool voro_compute_3d<c_class>::compute_min_radius(int di,int dj,int dk,double fx
     if(dk>0) {t=dk*boxz-fz;crs+=t*t;}
     else if(dk<0) {t=(dk+1)*boxz-fz;crs+=t*t;}
 
-    return crs>con.r_max_add(mrs);
+    return crs>rb;
 }
 
 /** Adds memory to the queue.
@@ -993,19 +1223,35 @@ template voro_compute_3d<container_3d>::voro_compute_3d(container_3d&,int,int,in
 template voro_compute_3d<container_poly_3d>::voro_compute_3d(container_poly_3d&,int,int,int);
 template bool voro_compute_3d<container_3d>::compute_cell(voronoicell_3d&,int,int,int,int,int);
 template bool voro_compute_3d<container_3d>::compute_cell(voronoicell_neighbor_3d&,int,int,int,int,int);
-template void voro_compute_3d<container_3d>::find_voronoi_cell(double,double,double,int,int,int,int,particle_record_3d&,double&);
+template bool voro_compute_3d<container_3d>::compute_cell_warm(voronoicell_3d&,int,int,int,int,int,const int*,int,particle_index_3d&);
+template bool voro_compute_3d<container_3d>::compute_cell_warm(voronoicell_neighbor_3d&,int,int,int,int,int,const int*,int,particle_index_3d&);
+template void voro_compute_3d<container_3d>::find_voronoi_cell(double,double,double,int,int,int,int,particle_record_3d&,double&,bool);
+template void voro_compute_3d<container_3d>::find_k_nearest(double,double,double,int,int,int,int,int,std::vector<neighbor_record_3d>&);
+template void voro_compute_3d<container_3d>::find_within_radius(double,double,double,int,int,int,int,double,std::vector<neighbor_record_3d>&);
+template bool voro_compute_3d<container_3d>::compute_ghost_cell(voronoicell_3d&,int,int,int,int,double,double,double,double);
+template bool voro_compute_3d<container_3d>::compute_ghost_cell(voronoicell_neighbor_3d&,int,int,int,int,double,double,double,double);
 template bool voro_compute_3d<container_poly_3d>::compute_cell(voronoicell_3d&,int,int,int,int,int);
 template bool voro_compute_3d<container_poly_3d>::compute_cell(voronoicell_neighbor_3d&,int,int,int,int,int);
-template void voro_compute_3d<container_poly_3d>::find_voronoi_cell(double,double,double,int,int,int,int,particle_record_3d&,double&);
+template bool voro_compute_3d<container_poly_3d>::compute_cell_warm(voronoicell_3d&,int,int,int,int,int,const int*,int,particle_index_3d&);
+template bool voro_compute_3d<container_poly_3d>::compute_cell_warm(voronoicell_neighbor_3d&,int,int,int,int,int,const int*,int,particle_index_3d&);
+template void voro_compute_3d<container_poly_3d>::find_voronoi_cell(double,double,double,int,int,int,int,particle_record_3d&,double&,bool);
+template void voro_compute_3d<container_poly_3d>::find_k_nearest(double,double,double,int,int,int,int,int,std::vector<neighbor_record_3d>&);
+template void voro_compute_3d<container_poly_3d>::find_within_radius(double,double,double,int,int,int,int,double,std::vector<neighbor_record_3d>&);
+template bool voro_compute_3d<container_poly_3d>::compute_ghost_cell(voronoicell_3d&,int,int,int,int,double,double,double,double);
+template bool voro_compute_3d<container_poly_3d>::compute_ghost_cell(voronoicell_neighbor_3d&,int,int,int,int,double,double,double,double);
 
 // Explicit template instantiation
 template voro_compute_3d<container_triclinic>::voro_compute_3d(container_triclinic&,int,int,int);
 template voro_compute_3d<container_triclinic_poly>::voro_compute_3d(container_triclinic_poly&,int,int,int);
 template bool voro_compute_3d<container_triclinic>::compute_cell(voronoicell_3d&,int,int,int,int,int);
 template bool voro_compute_3d<container_triclinic>::compute_cell(voronoicell_neighbor_3d&,int,int,int,int,int);
-template void voro_compute_3d<container_triclinic>::find_voronoi_cell(double,double,double,int,int,int,int,particle_record_3d&,double&);
+template void voro_compute_3d<container_triclinic>::find_voronoi_cell(double,double,double,int,int,int,int,particle_record_3d&,double&,bool);
+template void voro_compute_3d<container_triclinic>::find_k_nearest(double,double,double,int,int,int,int,int,std::vector<neighbor_record_3d>&);
+template void voro_compute_3d<container_triclinic>::find_within_radius(double,double,double,int,int,int,int,double,std::vector<neighbor_record_3d>&);
 template bool voro_compute_3d<container_triclinic_poly>::compute_cell(voronoicell_3d&,int,int,int,int,int);
 template bool voro_compute_3d<container_triclinic_poly>::compute_cell(voronoicell_neighbor_3d&,int,int,int,int,int);
-template void voro_compute_3d<container_triclinic_poly>::find_voronoi_cell(double,double,double,int,int,int,int,particle_record_3d&,double&);
+template void voro_compute_3d<container_triclinic_poly>::find_voronoi_cell(double,double,double,int,int,int,int,particle_record_3d&,double&,bool);
+template void voro_compute_3d<container_triclinic_poly>::find_k_nearest(double,double,double,int,int,int,int,int,std::vector<neighbor_record_3d>&);
+template void voro_compute_3d<container_triclinic_poly>::find_within_radius(double,double,double,int,int,int,int,double,std::vector<neighbor_record_3d>&);
 
 }
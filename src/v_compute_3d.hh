@@ -10,8 +10,11 @@
 #include "config.hh"
 #include "worklist_3d.hh"
 #include "cell_3d.hh"
+#include "particle_index_3d.hh"
 #include <inttypes.h>
 
+#include <vector>
+
 namespace voro {
 
 /** \brief Structure for holding information about a particle.
@@ -32,6 +35,19 @@ struct particle_record_3d {
     int dk;
 };
 
+/** \brief Structure for holding a particle found by a neighbor search.
+ *
+ * This structure extends the particle record with the squared distance from
+ * the particle to the search vector. It is used by the k-nearest neighbor and
+ * fixed-radius searches in the voro_compute_3d template. */
+struct neighbor_record_3d : public particle_record_3d {
+    /** The squared distance from the particle to the search vector. */
+    double rs;
+    /** Orders the records by distance, for use in the heap of the k-nearest
+     * neighbor search. */
+    inline bool operator<(const neighbor_record_3d &nr) const {return rs<nr.rs;}
+};
+
 /** \brief Template for carrying out Voronoi cell computations. */
 template <class c_class>
 class voro_compute_3d {
@@ -74,6 +90,9 @@ class voro_compute_3d {
         /** An array holding the number of particles within each computational
          * box of the container. */
         int *co;
+        /** The number of plane cuts that have been applied by this object,
+         * which can be used to measure the cost of the cell computations. */
+        uint64_t nplane_calls;
         voro_compute_3d(c_class &con_,int hx_,int hy_,int hz_);
         /** The class destructor frees the dynamically allocated memory for the
          * mask and queue. */
@@ -83,8 +102,68 @@ class voro_compute_3d {
         }
         template<class v_cell>
         bool compute_cell(v_cell &c,int ijk,int s,int ci,int cj,int ck);
-        void find_voronoi_cell(double x,double y,double z,int ci,int cj,int ck,int ijk,particle_record_3d &w,double &mrs);
+        template<class v_cell>
+        bool compute_cell_warm(v_cell &c,int ijk,int s,int ci,int cj,int ck,const int *nb,int nn,particle_index_3d &pi);
+        template<class v_cell>
+        bool compute_ghost_cell(v_cell &c,int ijk,int ci,int cj,int ck,double x,double y,double z,double r);
+        void find_voronoi_cell(double x,double y,double z,int ci,int cj,int ck,int ijk,particle_record_3d &w,double &mrs,bool seeded=false);
+        void find_k_nearest(double x,double y,double z,int ci,int cj,int ck,int ijk,int kn,std::vector<neighbor_record_3d> &nr);
+        void find_within_radius(double x,double y,double z,int ci,int cj,int ck,int ijk,double r,std::vector<neighbor_record_3d> &nr);
     private:
+        /** \brief Search state for finding the Voronoi cell that contains a
+         * vector.
+         *
+         * The searches over the blocks are carried out by the search_blocks()
+         * template, which uses the search state classes to test the particles
+         * in each block, and to supply the squared distance beyond which
+         * blocks no longer need to be considered. */
+        class nearest_search {
+            public:
+                nearest_search(voro_compute_3d &vc_,particle_record_3d &w_,double &mrs_) : vc(vc_), w(w_), mrs(mrs_) {}
+                /** Returns the squared search radius. */
+                inline double bound() {return vc.con.r_max_add(mrs);}
+                /** Tests the particles in a block. */
+                inline void scan(int ijk,double x,double y,double z,int di,int dj,int dk) {
+                    vc.scan_all(ijk,x,y,z,di,dj,dk,w,mrs);
+                }
+            private:
+                voro_compute_3d &vc;
+                particle_record_3d &w;
+                double &mrs;
+        };
+        /** \brief Search state for finding the k nearest particles to a
+         * vector.
+         *
+         * The particles found so far are held in a max-heap ordered by
+         * distance, so that the search radius is the distance to the kth
+         * nearest particle once k particles have been found. */
+        class k_nearest_search {
+            public:
+                k_nearest_search(voro_compute_3d &vc_,int kn_,std::vector<neighbor_record_3d> &nr_) : vc(vc_), kn(kn_), rb(large_number), nr(nr_) {}
+                /** Returns the squared search radius. */
+                inline double bound() {return rb;}
+                inline void scan(int ijk,double x,double y,double z,int di,int dj,int dk);
+            private:
+                voro_compute_3d &vc;
+                const int kn;
+                double rb;
+                std::vector<neighbor_record_3d> &nr;
+        };
+        /** \brief Search state for finding all particles within a fixed
+         * distance of a vector. */
+        class radius_search {
+            public:
+                radius_search(voro_compute_3d &vc_,double rs_,std::vector<neighbor_record_3d> &nr_) : vc(vc_), rs(rs_), nr(nr_) {}
+                /** Returns the squared search radius. */
+                inline double bound() {return rs;}
+                inline void scan(int ijk,double x,double y,double z,int di,int dj,int dk);
+            private:
+                voro_compute_3d &vc;
+                const double rs;
+                std::vector<neighbor_record_3d> &nr;
+        };
+        template<class n_search>
+        void search_blocks(n_search &ns,double x,double y,double z,int ci,int cj,int ck,int ijk,int i,int j,int k,int disp);
         /** A constant set to boxx*boxx+boxy*boxy+boxz*boxz, which is
          * frequently used in the computation. */
         const double bxsq;
@@ -93,6 +172,12 @@ class voro_compute_3d {
         unsigned int mv;
         /** The current size of the search list. */
         int qu_size;
+        /** Half the number of subregions that each block is divided into
+         * for the worklists. */
+        const int hgrid;
+        /** The number of subregions that each block is divided into for the
+         * worklists. */
+        const int fgrid;
         /** A pointer to the array of worklists. */
         const unsigned int *wl;
         /** An pointer to the array holding the minimum distances associated
@@ -107,6 +192,43 @@ class voro_compute_3d {
         /** A pointer to the end of the queue array, used to determine when the
          * queue is full. */
         int *qu_l;
+        /** The IDs of the particles whose planes were applied at the start
+         * of a warm-started computation, which is empty otherwise. */
+        std::vector<int> wid;
+        /** The displacement vectors of the particles whose planes were
+         * applied at the start of a warm-started computation. */
+        std::vector<double> wdisp;
+        /** Applies a plane cut to a Voronoi cell, and records it in the count
+         * of plane cuts. During a warm-started computation, planes that were
+         * already applied are skipped.
+         * \param[in,out] c a reference to a voronoicell object.
+         * \param[in] (x,y,z) the normal vector to the plane.
+         * \param[in] rs the distance along this vector of the plane.
+         * \param[in] p_id the ID of the particle that generates the plane.
+         * \return False if the plane cut deleted the cell entirely, true
+         * otherwise. */
+        template<class v_cell>
+        inline bool cut(v_cell &c,double x,double y,double z,double rs,int p_id) {
+            if(!wid.empty()&&warm_applied(x,y,z,p_id)) return true;
+            nplane_calls++;
+            return c.nplane(x,y,z,rs,p_id);
+        }
+        /** Checks whether a plane was applied at the start of a warm-started
+         * computation. Periodic images of the same particle have the same ID,
+         * so the displacement vectors are compared too.
+         * \param[in] (x,y,z) the displacement vector of the particle.
+         * \param[in] p_id the ID of the particle.
+         * \return True if the plane was applied, false otherwise. */
+        inline bool warm_applied(double x,double y,double z,int p_id) {
+            for(int n=0;n<(int) wid.size();n++) if(wid[n]==p_id) {
+                double *wp=wdisp.data()+3*n,dx=x-*wp,dy=y-wp[1],dz=z-wp[2];
+                if(dx*dx+dy*dy+dz*dz<tolerance*(x*x+y*y+z*z)) return true;
+            }
+            return false;
+        }
+        template<class v_cell>
+        bool compute_cell_planes(v_cell &c,int ijk,int s,int ci,int cj,int ck,int i,int j,int k,
+                double x,double y,double z,int disp,double r_rad,double r_mul);
         template<class v_cell>
         bool corner_test(v_cell &c,double xl,double yl,double zl,double xh,double yh,double zh,double &r_mul,double &r_val);
         template<class v_cell>
@@ -122,7 +244,7 @@ class voro_compute_3d {
         template<class v_cell>
         inline bool face_z_test(v_cell &c,double x0,double y0,double zl,double x1,double y1,double &r_mul,double &r_val);
         bool compute_min_max_radius(int di,int dj,int dk,double fx,double fy,double fz,double gx,double gy,double gz,double& crs,double mrs,double &r_mul);
-        bool compute_min_radius(int di,int dj,int dk,double fx,double fy,double fz,double mrs);
+        bool compute_min_radius(int di,int dj,int dk,double fx,double fy,double fz,double rb);
         inline void add_to_mask(int ei,int ej,int ek,int *&qu_e);
         inline void scan_bits_mask_add(unsigned int q,uint32_t *mijk,int ei,int ej,int ek,int *&qu_e);
         inline void scan_all(int ijk,double x,double y,double z,int di,int dj,int dk,particle_record_3d &w,double &mrs);
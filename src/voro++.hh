@@ -234,12 +234,13 @@
  * add_wall() command, and these are called each time a compute_cell() command
  * is carried out. At present, wall types for planes, spheres, cylinders, and
  * cones are provided, although custom walls can be added by creating new
- * classes derived from the pure virtual class. Currently all wall types
+ * classes derived from the pure virtual class. The curved wall types
  * approximate the wall surface with a single plane, which produces some small
  * errors, but generally gives good results for dense particle packings in
- * direct contact with a wall surface. It would be possible to create more
- * accurate walls by making cut_cell() routines that approximate the curved
- * surface with multiple plane cuts.
+ * direct contact with a wall surface. The wall_mesh class represents a wall
+ * by a closed triangle mesh, and cuts each cell by the planes of the nearby
+ * triangles, which are found using a bounding volume hierarchy. This allows
+ * complicated geometries to be represented by a single wall object.
  *
  * The wall objects can used for periodic calculations, although to obtain
  * valid results, the walls should also be periodic as well. For example, in a
@@ -318,10 +319,16 @@
 #include "common.hh"
 #include "cell_2d.hh"
 #include "cell_3d.hh"
+#include "cell_estimate_3d.hh"
+#include "cell_reduction_3d.hh"
 #include "config.hh"
 #include "container_2d.hh"
 #include "container_3d.hh"
+#include "container_quad_2d.hh"
 #include "container_tri.hh"
+#include "delaunay_3d.hh"
+#include "neighbor_graph_3d.hh"
+#include "particle_index_3d.hh"
 #include "particle_list.hh"
 #include "rad_option.hh"
 #include "unitcell.hh"
@@ -329,11 +336,15 @@
 #include "v_base_3d.hh"
 #include "v_compute_2d.hh"
 #include "v_compute_3d.hh"
+#include "voronoi_mesh_3d.hh"
+#include "vtu_writer_3d.hh"
 #include "wall.hh"
 #include "wall_2d.hh"
 #include "wall_3d.hh"
+#include "wall_mesh_3d.hh"
 #include "worklist_2d.hh"
 #include "worklist_3d.hh"
+#include "worklist_gen_3d.hh"
 #include "iter_2d.hh"
 #include "iter_3d.hh"
 
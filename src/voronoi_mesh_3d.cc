@@ -0,0 +1,294 @@
+// Voro++, a cell-based Voronoi library
+// By Chris H. Rycroft and the Rycroft Group
+
+/** \file voronoi_mesh_3d.cc
+ * \brief Function implementations for the voronoi_mesh_3d class. */
+
+#include <algorithm>
+#include <utility>
+
+#include "voronoi_mesh_3d.hh"
+#include "cell_3d.hh"
+#include "container_3d.hh"
+#include "container_tri.hh"
+#include "iter_3d.hh"
+
+namespace voro {
+
+/** Computes all of the Voronoi cells in a container in parallel, and merges
+ * them into a global mesh. The computation has four stages:
+ *
+ * 1. The cells are computed with one contiguous range of rows per thread, and
+ *    the vertices and faces of every cell are stored.
+ * 2. Each face is paired with the faces of the neighboring cell that point
+ *    back to it, and the vertices of the two faces that lie within the
+ *    tolerance are recorded as matches.
+ * 3. The matches are propagated by repeatedly taking the minimum label over
+ *    each vertex and its matches, until the labels settle. Each group of
+ *    vertices with the same label forms one vertex of the mesh.
+ * 4. Each face is paired with the face of the neighboring cell that has the
+ *    same vertices, and one of the two is kept.
+ *
+ * \param[in] con the container class to use.
+ * \param[in] tol_ the distance below which two vertices are merged. If this
+ *                 is negative, then a default based on the size of the
+ *                 container is used. */
+template<class c_class>
+void voronoi_mesh_3d::compute(c_class &con,double tol_) {
+    std::vector<int> ijk,q;
+    const int nt=con.number_thread();
+    int i,n;
+
+    // Set up the tolerance and the lattice vectors
+    tol=tol_>0?tol_:sqrt(tolerance*con.max_len_sq);
+    setup_lattice(con);
+
+    // Collect the particles in the container, and sort them into rows
+    cell_id.clear();
+    for(typename c_class::iterator cli=con.begin();cli<con.end();cli++) {
+        ijk.push_back(cli->ijk);q.push_back(cli->q);
+        cell_id.push_back(con.id[cli->ijk][cli->q]);
+    }
+    n=cell_id.size();
+    direct=voro_sort_rows(cell_id,ijk,q);
+
+    // Compute the cells, storing the vertex positions, the neighbor of each
+    // face, and the face vertex lists for each range of rows
+    std::vector<uint64_t> voff(n+1);
+    cell_off.resize(n+1);
+    std::vector<double> *tpos=new std::vector<double>[nt];
+    std::vector<int> *tnbr=new std::vector<int>[nt],*tfv=new std::vector<int>[nt];
+#pragma omp parallel num_threads(nt)
+    {
+        voronoicell_neighbor_3d c(con);
+        std::vector<int> v,fv;
+        std::vector<double> pv;
+#pragma omp for schedule(static,1)
+        for(int t=0;t<nt;t++) {
+            for(int i=int((int64_t) n*t/nt);i<int((int64_t) n*(t+1)/nt);i++) {
+                if(con.compute_cell(c,ijk[i],q[i])) {
+                    double *pp=con.p[ijk[i]]+con.ps*q[i];
+                    c.vertices(*pp,pp[1],pp[2],pv);
+                    c.neighbors(v);
+                    c.face_vertices(fv);
+                    tpos[t].insert(tpos[t].end(),pv.begin(),pv.end());
+                    tnbr[t].insert(tnbr[t].end(),v.begin(),v.end());
+                    tfv[t].insert(tfv[t].end(),fv.begin(),fv.end());
+                    voff[i+1]=pv.size()/3;
+                    cell_off[i+1]=v.size();
+                } else voff[i+1]=cell_off[i+1]=0;
+            }
+        }
+    }
+
+    // Compute the offsets, and copy the cell data into global arrays, with
+    // the face vertices converted into global vertex indices
+    voff[0]=cell_off[0]=0;
+    for(i=0;i<n;i++) {voff[i+1]+=voff[i];cell_off[i+1]+=cell_off[i];}
+    const int nv=voff[n],nf=cell_off[n];
+    std::vector<uint64_t> tfo(nt+1);
+    tfo[0]=0;
+    for(int t=0;t<nt;t++) tfo[t+1]=tfo[t]+tfv[t].size()-tnbr[t].size();
+    std::vector<double> pos(3*nv);
+    std::vector<int> fnbr(nf),fv(tfo[nt]);
+    std::vector<uint64_t> fo(nf+1);
+    fo[nf]=tfo[nt];
+#pragma omp parallel for num_threads(nt)
+    for(int t=0;t<nt;t++) {
+        int i0=int((int64_t) n*t/nt),i1=int((int64_t) n*(t+1)/nt);
+        std::copy(tpos[t].begin(),tpos[t].end(),pos.begin()+3*voff[i0]);
+        std::copy(tnbr[t].begin(),tnbr[t].end(),fnbr.begin()+cell_off[i0]);
+        std::vector<int>::iterator fp=tfv[t].begin();
+        uint64_t o=tfo[t];
+        for(int i=i0;i<i1;i++) for(uint64_t f=cell_off[i];f<cell_off[i+1];f++) {
+            int k=*(fp++);
+            fo[f]=o;
+            for(int l=0;l<k;l++) fv[o++]=*(fp++)+voff[i];
+        }
+    }
+    delete [] tfv;
+    delete [] tnbr;
+    delete [] tpos;
+
+    // Find the coincident vertices on each pair of matching faces. Each pair
+    // is considered once, and the matches are recorded in both directions.
+    std::vector<std::pair<int,int> > *tm=new std::vector<std::pair<int,int> >[nt];
+#pragma omp parallel num_threads(nt)
+    {
+        std::vector<std::pair<int,int> > &m=tm[t_num()];
+#pragma omp for schedule(dynamic,256)
+        for(int i=0;i<n;i++) {
+            const int pi=int(cell_id[i]);
+            for(uint64_t f=cell_off[i];f<cell_off[i+1];f++) {
+                int j=row(fnbr[f]);
+                if(j<i) continue;
+                for(uint64_t g=cell_off[j];g<cell_off[j+1];g++) {
+                    if(fnbr[g]!=pi||(j==i&&g<=f)) continue;
+                    for(uint64_t a=fo[f];a<fo[f+1];a++) for(uint64_t b=fo[g];b<fo[g+1];b++)
+                        if(close(pos.data()+3*fv[a],pos.data()+3*fv[b])) {
+                            m.push_back(std::make_pair(fv[a],fv[b]));
+                            m.push_back(std::make_pair(fv[b],fv[a]));
+                        }
+                }
+            }
+        }
+    }
+
+    // Assemble the matches into a CSR structure
+    std::vector<uint64_t> mo(nv+1,0);
+    for(int t=0;t<nt;t++) for(std::vector<std::pair<int,int> >::iterator mp=tm[t].begin();mp!=tm[t].end();mp++) mo[mp->first+1]++;
+    for(i=0;i<nv;i++) mo[i+1]+=mo[i];
+    std::vector<int> mv(mo[nv]);
+    {
+        std::vector<uint64_t> mc(mo.begin(),mo.end()-1);
+        for(int t=0;t<nt;t++) for(std::vector<std::pair<int,int> >::iterator mp=tm[t].begin();mp!=tm[t].end();mp++) mv[mc[mp->first]++]=mp->second;
+    }
+    delete [] tm;
+
+    // Propagate the minimum label across the matches until it settles,
+    // jumping to the label of the current label to speed up convergence
+    std::vector<int> lab(nv),nlab(nv);
+    for(i=0;i<nv;i++) lab[i]=i;
+    bool changed=true;
+    while(changed) {
+        changed=false;
+#pragma omp parallel for num_threads(nt) schedule(static,4096) reduction(||:changed)
+        for(int a=0;a<nv;a++) {
+            int l=lab[lab[a]];
+            for(uint64_t e=mo[a];e<mo[a+1];e++) if(lab[mv[e]]<l) l=lab[mv[e]];
+            nlab[a]=l;
+            if(l!=lab[a]) changed=true;
+        }
+        lab.swap(nlab);
+    }
+
+    // Number the groups and store the mesh vertices, mapping them into the
+    // primary domain in the periodic directions
+    std::vector<int> gi(nv);
+    int ng=0;
+    for(i=0;i<nv;i++) if(lab[i]==i) gi[i]=ng++;
+    vert.resize(3*ng);
+#pragma omp parallel for num_threads(nt)
+    for(int a=0;a<nv;a++) if(lab[a]==a) wrap(pos.data()+3*a,vert.data()+3*gi[a]);
+
+    // Convert the face vertices into mesh vertices, removing any repeats
+    // that arise when a short edge has been merged
+    std::vector<int> fk(nf);
+#pragma omp parallel for num_threads(nt) schedule(dynamic,1024)
+    for(int f=0;f<nf;f++) {
+        int k=0,*fp=fv.data()+fo[f];
+        for(uint64_t a=fo[f];a<fo[f+1];a++) {
+            int g=gi[lab[fv[a]]];
+            if(k==0||fp[k-1]!=g) fp[k++]=g;
+        }
+        if(k>1&&fp[k-1]==*fp) k--;
+        fk[f]=k;
+    }
+
+    // Pair each face with the face of the neighboring cell that has the same
+    // vertices. The face in the lower row is kept, and faces that cannot be
+    // paired are kept on both sides.
+    std::vector<int> pr(nf,-1);
+    unmatched=0;
+#pragma omp parallel num_threads(nt) reduction(+:unmatched)
+    {
+        std::vector<int> s,sg;
+#pragma omp for schedule(dynamic,256)
+        for(int i=0;i<n;i++) {
+            const int pi=int(cell_id[i]);
+            for(uint64_t f=cell_off[i];f<cell_off[i+1];f++) {
+                if(fnbr[f]<0) continue;
+                int j=row(fnbr[f]);
+                if(j>=0) {
+                    s.assign(fv.begin()+fo[f],fv.begin()+fo[f]+fk[f]);
+                    std::sort(s.begin(),s.end());
+                    for(uint64_t g=cell_off[j];g<cell_off[j+1];g++) {
+                        if(fnbr[g]!=pi||g==f||fk[g]!=fk[f]) continue;
+                        sg.assign(fv.begin()+fo[g],fv.begin()+fo[g]+fk[g]);
+                        std::sort(sg.begin(),sg.end());
+                        if(s==sg) {pr[f]=g;break;}
+                    }
+                }
+                if(pr[f]==-1) unmatched++;
+            }
+        }
+    }
+
+    // Number the faces that are kept, and assemble the face arrays
+    std::vector<int> fi(nf);
+    int nm=0;
+    face_off.resize(1);face_off[0]=0;
+    for(i=0;i<n;i++) for(int f=cell_off[i];f<int(cell_off[i+1]);f++) {
+        int j=pr[f]<0||pr[pr[f]]!=f?-1:row(fnbr[f]);
+        if(j<0||j>i||(j==i&&pr[f]>f)) {
+            fi[f]=nm++;
+            face_off.push_back(face_off.back()+fk[f]);
+        } else fi[f]=-1;
+    }
+    face_vert.resize(face_off[nm]);
+    face_cell.resize(2*nm);
+#pragma omp parallel for num_threads(nt) schedule(dynamic,256)
+    for(int i=0;i<n;i++) for(uint64_t f=cell_off[i];f<cell_off[i+1];f++) if(fi[f]>=0) {
+        std::copy(fv.begin()+fo[f],fv.begin()+fo[f]+fk[f],face_vert.begin()+face_off[fi[f]]);
+        face_cell[2*fi[f]]=int(cell_id[i]);
+        face_cell[2*fi[f]+1]=fnbr[f];
+    }
+
+    // Store the faces of each cell
+    cell_face.resize(nf);
+#pragma omp parallel for num_threads(nt)
+    for(int f=0;f<nf;f++) cell_face[f]=fi[f]>=0?fi[f]:fi[pr[f]];
+}
+
+/** Sets up the lattice vectors for a rectangular container, using the
+ * container dimensions in the periodic directions.
+ * \param[in] con the container. */
+void voronoi_mesh_3d::setup_lattice(container_base_3d &con) {
+    for(int l=0;l<9;l++) lat[l]=0;
+    if(con.x_prd) *lat=con.bx-con.ax;
+    if(con.y_prd) lat[4]=con.by-con.ay;
+    if(con.z_prd) lat[8]=con.bz-con.az;
+    *org=con.ax;org[1]=con.ay;org[2]=con.az;
+}
+
+/** Sets up the lattice vectors for a triclinic container, which is periodic
+ * in all three directions, with its primary domain starting at the origin.
+ * \param[in] con the container. */
+void voronoi_mesh_3d::setup_lattice(container_triclinic_base &con) {
+    *lat=con.bx;lat[1]=lat[2]=0;
+    lat[3]=con.bxy;lat[4]=con.by;lat[5]=0;
+    lat[6]=con.bxz;lat[7]=con.byz;lat[8]=con.bz;
+    *org=org[1]=org[2]=0;
+}
+
+/** Outputs the mesh in a plain text format. The vertices are listed first,
+ * followed by the faces, each given as the number of vertices, the vertex
+ * indices, and the two cells on either side. The cells are listed last, each
+ * given as the particle ID, the number of faces, and the face indices.
+ * \param[in] fp a file handle to write to. */
+void voronoi_mesh_3d::output(FILE *fp) {
+    int i,nm=faces(),nc=cells();
+    uint64_t e;
+    fprintf(fp,"vertices %d\n",vertices());
+    for(i=0;i<vertices();i++) fprintf(fp,"%g %g %g\n",vert[3*i],vert[3*i+1],vert[3*i+2]);
+    fprintf(fp,"faces %d\n",nm);
+    for(i=0;i<nm;i++) {
+        fprintf(fp,"%d",int(face_off[i+1]-face_off[i]));
+        for(e=face_off[i];e<face_off[i+1];e++) fprintf(fp," %d",face_vert[e]);
+        fprintf(fp," %d %d\n",face_cell[2*i],face_cell[2*i+1]);
+    }
+    fprintf(fp,"cells %d\n",nc);
+    for(i=0;i<nc;i++) {
+        fprintf(fp,"%d %d",int(cell_id[i]),int(cell_off[i+1]-cell_off[i]));
+        for(e=cell_off[i];e<cell_off[i+1];e++) fprintf(fp," %d",cell_face[e]);
+        fputc('\n',fp);
+    }
+}
+
+// Explicit template instantiation
+template void voronoi_mesh_3d::compute(container_3d&,double);
+template void voronoi_mesh_3d::compute(container_poly_3d&,double);
+template void voronoi_mesh_3d::compute(container_triclinic&,double);
+template void voronoi_mesh_3d::compute(container_triclinic_poly&,double);
+
+}
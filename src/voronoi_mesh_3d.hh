@@ -0,0 +1,141 @@
+// Voro++, a cell-based Voronoi library
+// By Chris H. Rycroft and the Rycroft Group
+
+/** \file voronoi_mesh_3d.hh
+ * \brief Header file for the voronoi_mesh_3d class. */
+
+#ifndef VOROPP_VORONOI_MESH_3D_HH
+#define VOROPP_VORONOI_MESH_3D_HH
+
+#include <cstdio>
+#include <cmath>
+#include <inttypes.h>
+
+#include <vector>
+
+#include "config.hh"
+#include "common.hh"
+
+namespace voro {
+
+class container_base_3d;
+class container_triclinic_base;
+
+/** \brief A class for assembling a Voronoi tessellation into a single mesh
+ * with shared vertices and faces.
+ *
+ * When the Voronoi cells are output individually, each Voronoi vertex appears
+ * once for every cell that it belongs to, and each interior face appears
+ * twice. The voronoi_mesh_3d class computes all of the cells in a container
+ * in parallel and merges them into a global mesh. It stores the unique
+ * vertices, the unique faces tagged with the two cells on either side, and
+ * the list of faces of each cell.
+ *
+ * Vertices are merged using the neighbor information in the cells. A vertex
+ * on the face between two cells is compared only against the vertices of the
+ * matching face in the neighboring cell, and is merged with those that lie
+ * within a tolerance. The merges are then propagated to find the connected
+ * groups of vertices, which handles degenerate vertices where more than four
+ * cells meet. In periodic directions, vertices are identified with their
+ * periodic images and are stored within the primary domain. For triclinic
+ * containers, the periodic images are given by the three lattice vectors. */
+class voronoi_mesh_3d {
+    public:
+        /** The positions of the unique vertices, with three entries per
+         * vertex. */
+        std::vector<double> vert;
+        /** The offsets of each face into the face_vert array. */
+        std::vector<uint64_t> face_off;
+        /** The vertex indices of each face, ordered as in the cell given by
+         * the first entry of face_cell. */
+        std::vector<int> face_vert;
+        /** The two cells on either side of each face, with two entries per
+         * face. The first is the cell that the vertex ordering refers to. The
+         * second is the neighboring cell, or the negative wall ID for faces
+         * formed by walls or by the container boundary. */
+        std::vector<int> face_cell;
+        /** The particle ID of each cell, in ascending order. */
+        std::vector<uint64_t> cell_id;
+        /** The offsets of each cell into the cell_face array. */
+        std::vector<uint64_t> cell_off;
+        /** The face indices of each cell. */
+        std::vector<int> cell_face;
+        /** The number of interior faces that could not be matched with a face
+         * in the neighboring cell, which are stored separately for each of the
+         * two cells. This happens for tiny faces that are only found on one
+         * side, and for faces cut by curved walls, since each cell
+         * approximates the wall by its own tangent plane. */
+        int unmatched;
+        voronoi_mesh_3d() : unmatched(0), direct(true), tol(0) {}
+        template<class c_class>
+        void compute(c_class &con,double tol_=-1);
+        /** Returns the number of unique vertices.
+         * \return The number of vertices. */
+        inline int vertices() {return vert.size()/3;}
+        /** Returns the number of unique faces.
+         * \return The number of faces. */
+        inline int faces() {return face_off.empty()?0:int(face_off.size())-1;}
+        /** Returns the number of cells.
+         * \return The number of cells. */
+        inline int cells() {return cell_id.size();}
+        void output(FILE *fp=stdout);
+        /** Saves the mesh to a file.
+         * \param[in] filename the name of the file to write to. */
+        inline void output(const char *filename) {
+            FILE *fp=safe_fopen(filename,"w");
+            output(fp);
+            fclose(fp);
+        }
+    private:
+        /** Whether the particle IDs are exactly 0 to n-1, in which case the
+         * row of a particle is equal to its ID. */
+        bool direct;
+        /** The tolerance used to merge vertices, specified as a length. */
+        double tol;
+        /** The three lattice vectors, which are zero in non-periodic
+         * directions. */
+        double lat[9];
+        /** The lower corner of the container. */
+        double org[3];
+        void setup_lattice(container_base_3d &con);
+        void setup_lattice(container_triclinic_base &con);
+        /** Finds the row corresponding to a particle ID.
+         * \param[in] pid the particle ID to find.
+         * \return The row, or -1 if the particle is not in the mesh. */
+        inline int row(int pid) {return voro_find_row(direct,cell_id,pid);}
+        /** Tests whether two vertices coincide, taking into account the
+         * periodicity of the container.
+         * \param[in] (a,b) pointers to the coordinates of the vertices.
+         * \return True if the vertices are within the tolerance, false
+         * otherwise. */
+        inline bool close(const double *a,const double *b) {
+            double d[3]={a[0]-b[0],a[1]-b[1],a[2]-b[2]};
+            for(int l=2;l>=0;l--) {
+                const double *lp=lat+3*l;
+                if(lp[l]>0) {
+                    double k=nearbyint(d[l]/lp[l]);
+                    *d-=k*(*lp);d[1]-=k*lp[1];d[2]-=k*lp[2];
+                }
+            }
+            return d[0]*d[0]+d[1]*d[1]+d[2]*d[2]<tol*tol;
+        }
+        /** Maps a vertex into the primary domain, by subtracting lattice
+         * vectors in the periodic directions.
+         * \param[in] a a pointer to the coordinates of the vertex.
+         * \param[out] v a pointer to the array in which to store the mapped
+         *               coordinates. */
+        inline void wrap(const double *a,double *v) {
+            *v=*a;v[1]=a[1];v[2]=a[2];
+            for(int l=2;l>=0;l--) {
+                const double *lp=lat+3*l;
+                if(lp[l]>0) {
+                    double k=floor((v[l]-org[l])/lp[l]);
+                    *v-=k*(*lp);v[1]-=k*lp[1];v[2]-=k*lp[2];
+                }
+            }
+        }
+};
+
+}
+
+#endif
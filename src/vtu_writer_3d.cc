@@ -0,0 +1,319 @@
+// Voro++, a cell-based Voronoi library
+// By Chris H. Rycroft and the Rycroft Group
+
+/** \file vtu_writer_3d.cc
+ * \brief Function implementations for the vtu_writer_3d class. */
+
+#include <cstring>
+#include <algorithm>
+
+#if VOROPP_ZLIB
+#include <zlib.h>
+#endif
+
+#include "vtu_writer_3d.hh"
+#include "common.hh"
+#include "cell_3d.hh"
+#include "container_3d.hh"
+#include "container_tri.hh"
+#include "iter_3d.hh"
+
+namespace voro {
+
+/** The number of particles in each block, which is saved as a separate piece
+ * of the grid. */
+const int vtu_block_size=32768;
+
+/** The VTK cell type for a polyhedron. */
+const unsigned char vtk_polyhedron=42;
+
+/** The names of the data arrays, in the order that they are written. */
+static const char *vtu_name[10]={"","connectivity","offsets","types","faces",
+    "faceoffsets","id","volume","number_of_faces","radius"};
+
+/** The VTK data types of the data arrays. */
+static const char *vtu_type[10]={"Float64","Int64","Int64","UInt8","Int64",
+    "Int64","Int64","Float64","Int32","Float64"};
+
+/** Initializes the class, checking that compression is available if it is
+ * requested.
+ * \param[in] compress_ whether to compress the data arrays with zlib.
+ * \param[in] block_size_ the size in bytes of the blocks that the data arrays
+ *                        are split into for compression. */
+vtu_writer_3d::vtu_writer_3d(bool compress_,int block_size_)
+    : compress(compress_), block_size(block_size_) {
+#if !VOROPP_ZLIB
+    if(compress) voro_fatal_error("VTK output compression requires voro++ to be compiled with VOROPP_ZLIB=1",VOROPP_INTERNAL_ERROR);
+#endif
+}
+
+/** Computes all of the Voronoi cells in a container in parallel, and saves
+ * them to a VTK unstructured grid file. The file must be seekable, since the
+ * sizes of the pieces, the array offsets, and the compressed block sizes are
+ * filled in once the data has been written.
+ * \param[in] con the container class to use.
+ * \param[in] filename the name of the file to write to. */
+template<class c_class>
+void vtu_writer_3d::write(c_class &con,const char *filename) {
+    nt=con.number_thread();
+    radius=con.ps==4;
+    const int na=radius?10:9;
+
+    // Collect the particles in the container, and split them into blocks
+    for(typename c_class::iterator cli=con.begin();cli<con.end();cli++) {
+        ijk.push_back(cli->ijk);q.push_back(cli->q);
+    }
+    int m=ijk.size(),np=m==0?1:(m+vtu_block_size-1)/vtu_block_size;
+    std::vector<long> opos;
+    std::vector<uint64_t> pval((na+2)*np);
+
+    // Write the XML header, followed by the data arrays of each piece
+    fp=safe_fopen(filename,"wb");
+    header(np,opos);
+    long app=ftell(fp);
+    for(int l=0;l<np;l++) {
+        uint64_t *pv=pval.data()+(na+2)*l;
+        compute(con,l*vtu_block_size,std::min(m,(l+1)*vtu_block_size));
+        *pv=voff[n];pv[1]=n;
+        for(int a=0;a<na;a++) {
+            pv[a+2]=ftell(fp)-app;
+            write_array(a);
+        }
+    }
+    fputs("\n  </AppendedData>\n</VTKFile>\n",fp);
+
+    // Fill in the sizes of the pieces and the offsets of the data arrays
+    for(int k=0;k<(na+2)*np;k++) {
+        fseek(fp,opos[k],SEEK_SET);
+        fprintf(fp,"%020llu",(unsigned long long) pval[k]);
+    }
+    fclose(fp);
+
+    // Free the particle list and the cell data
+    std::vector<int>().swap(ijk);std::vector<int>().swap(q);
+    std::vector<double>().swap(pts);std::vector<int>().swap(fv);
+    std::vector<char>().swap(pend);
+}
+
+/** Computes a block of Voronoi cells, and stores their vertices, faces, and
+ * statistics. The block is split into one contiguous range of particles per
+ * thread, and each thread gathers the data for its range before it is copied
+ * into the arrays for the block.
+ * \param[in] con the container class to use.
+ * \param[in] (c0,c1) the range of particles in the block. */
+template<class c_class>
+void vtu_writer_3d::compute(c_class &con,int c0,int c1) {
+    int i,m=c1-c0;
+
+    // Compute the cells and gather the data for each range of particles.
+    // Cells that are removed entirely by walls are skipped.
+    std::vector<double> *tpts=new std::vector<double>[nt];
+    std::vector<int> *tfv=new std::vector<int>[nt],*tnv=new std::vector<int>[nt];
+    std::vector<int64_t> *tid=new std::vector<int64_t>[nt];
+    std::vector<double> *tvol=new std::vector<double>[nt],*trad=new std::vector<double>[nt];
+    std::vector<int> *tnf=new std::vector<int>[nt],*tnfv=new std::vector<int>[nt];
+#pragma omp parallel num_threads(nt)
+    {
+        voronoicell_3d c(con);
+        std::vector<int> v;
+        std::vector<double> pv;
+#pragma omp for schedule(static,1)
+        for(int t=0;t<nt;t++) {
+            for(int i=c0+m*t/nt;i<c0+m*(t+1)/nt;i++) {
+                if(!con.compute_cell(c,ijk[i],q[i])) continue;
+                double *pp=con.p[ijk[i]]+con.ps*q[i];
+                c.vertices(*pp,pp[1],pp[2],pv);
+                c.face_vertices(v);
+                tpts[t].insert(tpts[t].end(),pv.begin(),pv.end());
+                tfv[t].insert(tfv[t].end(),v.begin(),v.end());
+                tnv[t].push_back(pv.size()/3);
+                tnfv[t].push_back(v.size());
+                tnf[t].push_back(c.number_of_faces());
+                tvol[t].push_back(c.volume());
+                tid[t].push_back(con.id[ijk[i]][q[i]]);
+                if(radius) trad[t].push_back(pp[3]);
+            }
+        }
+    }
+
+    // Compute the offsets, and copy the data into the arrays for the block
+    std::vector<int> tc(nt+1);
+    tc[0]=0;
+    for(int t=0;t<nt;t++) tc[t+1]=tc[t]+tnv[t].size();
+    n=tc[nt];
+    voff.resize(n+1);foff.resize(n+1);
+    voff[0]=foff[0]=0;
+    for(int t=0;t<nt;t++) for(i=0;i<(int) tnv[t].size();i++) {
+        voff[tc[t]+i+1]=voff[tc[t]+i]+tnv[t][i];
+        foff[tc[t]+i+1]=foff[tc[t]+i]+tnfv[t][i];
+    }
+    pts.resize(3*voff[n]);fv.resize(foff[n]);
+    cid.resize(n);cnf.resize(n);cvol.resize(n);crad.resize(radius?n:0);
+#pragma omp parallel for num_threads(nt)
+    for(int t=0;t<nt;t++) {
+        std::copy(tpts[t].begin(),tpts[t].end(),pts.begin()+3*voff[tc[t]]);
+        std::copy(tfv[t].begin(),tfv[t].end(),fv.begin()+foff[tc[t]]);
+        std::copy(tid[t].begin(),tid[t].end(),cid.begin()+tc[t]);
+        std::copy(tnf[t].begin(),tnf[t].end(),cnf.begin()+tc[t]);
+        std::copy(tvol[t].begin(),tvol[t].end(),cvol.begin()+tc[t]);
+        std::copy(trad[t].begin(),trad[t].end(),crad.begin()+(radius?tc[t]:0));
+    }
+    delete [] tnfv;delete [] tnf;
+    delete [] trad;delete [] tvol;
+    delete [] tid;
+    delete [] tnv;delete [] tfv;
+    delete [] tpts;
+}
+
+/** Writes the XML header of the file. The sizes of the pieces and the offsets
+ * of the data arrays are written as placeholders, and their positions in the
+ * file are recorded so that they can be filled in later.
+ * \param[in] np the number of pieces.
+ * \param[out] opos a vector in which to store the positions of the
+ *                  placeholders. */
+void vtu_writer_3d::header(int np,std::vector<long> &opos) {
+    const int one=1,na=radius?10:9;
+    fprintf(fp,"<?xml version=\"1.0\"?>\n"
+               "<VTKFile type=\"UnstructuredGrid\" version=\"1.0\" byte_order=\"%s\" header_type=\"UInt64\"%s>\n"
+               "  <UnstructuredGrid>\n",
+            *reinterpret_cast<const char*>(&one)==1?"LittleEndian":"BigEndian",
+            compress?" compressor=\"vtkZLibDataCompressor\"":"");
+    for(int l=0;l<np;l++) {
+        fputs("    <Piece NumberOfPoints=\"",fp);
+        opos.push_back(ftell(fp));
+        fputs("00000000000000000000\" NumberOfCells=\"",fp);
+        opos.push_back(ftell(fp));
+        fputs("00000000000000000000\">\n",fp);
+        for(int a=0;a<na;a++) {
+            if(a==0) fputs("      <Points>\n",fp);
+            else if(a==1) fputs("      <Cells>\n",fp);
+            else if(a==6) fputs("      <CellData Scalars=\"volume\">\n",fp);
+            fprintf(fp,"        <DataArray type=\"%s\"",vtu_type[a]);
+            if(a==0) fputs(" NumberOfComponents=\"3\"",fp);
+            else fprintf(fp," Name=\"%s\"",vtu_name[a]);
+            fputs(" format=\"appended\" offset=\"",fp);
+            opos.push_back(ftell(fp));
+            fputs("00000000000000000000\"/>\n",fp);
+            if(a==0) fputs("      </Points>\n",fp);
+            else if(a==5) fputs("      </Cells>\n",fp);
+        }
+        fputs("      </CellData>\n"
+              "    </Piece>\n",fp);
+    }
+    fputs("  </UnstructuredGrid>\n"
+          "  <AppendedData encoding=\"raw\">\n"
+          "_",fp);
+}
+
+/** Returns the position in bytes of the data for a cell within a data array.
+ * \param[in] a the index of the data array.
+ * \param[in] i the index of the cell, which may be n to obtain the size of
+ *              the array.
+ * \return The position. */
+uint64_t vtu_writer_3d::array_pos(int a,int i) {
+    switch(a) {
+        case 0: return 24*voff[i];
+        case 1: return 8*voff[i];
+        case 3: return i;
+        case 4: return 8*(i+foff[i]);
+        case 8: return 4*uint64_t(i);
+        default: return 8*uint64_t(i);
+    }
+}
+
+/** Fills in the data for a cell within a data array.
+ * \param[in] a the index of the data array.
+ * \param[in] i the index of the cell.
+ * \param[in] b a pointer to the position in the output buffer to write to. */
+void vtu_writer_3d::fill(int a,int i,char *b) {
+    int64_t l,e;
+    switch(a) {
+        case 0:
+            memcpy(b,pts.data()+3*voff[i],24*(voff[i+1]-voff[i]));
+            break;
+        case 1:
+            for(l=voff[i];l<int64_t(voff[i+1]);l++,b+=8) memcpy(b,&l,8);
+            break;
+        case 2:
+            l=voff[i+1];memcpy(b,&l,8);
+            break;
+        case 3:
+            *b=vtk_polyhedron;
+            break;
+        case 4:
+
+            // Write the number of faces, followed by the number of vertices
+            // and the vertex indices of each face. The vertices are reversed,
+            // since VTK expects them to be ordered counterclockwise when
+            // viewed from outside the cell.
+            l=cnf[i];memcpy(b,&l,8);b+=8;
+            for(uint64_t p=foff[i];p<foff[i+1];p+=fv[p]+1) {
+                int k=fv[p];
+                l=k;memcpy(b,&l,8);b+=8;
+                for(;k>0;k--,b+=8) {
+                    e=fv[p+k]+voff[i];memcpy(b,&e,8);
+                }
+            }
+            break;
+        case 5:
+            l=i+1+foff[i+1];memcpy(b,&l,8);
+            break;
+        case 6: memcpy(b,&cid[i],8);break;
+        case 7: memcpy(b,&cvol[i],8);break;
+        case 8: memcpy(b,&cnf[i],4);break;
+        case 9: memcpy(b,&crad[i],8);
+    }
+}
+
+/** Writes a data array of the current block to the file, preceded by its
+ * header. The array is generated using multiple threads.
+ * \param[in] a the index of the data array. */
+void vtu_writer_3d::write_array(int a) {
+    uint64_t tot=array_pos(a,n);
+    pend.resize(tot);
+    char *bp=pend.data();
+#pragma omp parallel for num_threads(nt) schedule(dynamic,256)
+    for(int i=0;i<n;i++) fill(a,i,bp+array_pos(a,i));
+    if(compress) write_blocks();
+    else {
+        fwrite(&tot,sizeof(uint64_t),1,fp);
+        fwrite(bp,1,tot,fp);
+    }
+}
+
+/** Splits the buffered data array into blocks, compresses them in parallel,
+ * and writes them to the file, preceded by the header that gives the number
+ * of blocks and their sizes. */
+void vtu_writer_3d::write_blocks() {
+#if VOROPP_ZLIB
+    size_t ps=pend.size();
+    int k=(ps+block_size-1)/block_size;
+    std::vector<std::vector<unsigned char> > cb(k);
+#pragma omp parallel for num_threads(nt) schedule(dynamic,1)
+    for(int l=0;l<k;l++) {
+        uLong s=std::min(size_t(block_size),ps-size_t(l)*block_size);
+        uLongf cs=compressBound(s);
+        cb[l].resize(cs);
+        if(compress2(cb[l].data(),&cs,reinterpret_cast<const Bytef*>(pend.data())+size_t(l)*block_size,s,Z_DEFAULT_COMPRESSION)!=Z_OK)
+            voro_fatal_error("zlib compression failed",VOROPP_INTERNAL_ERROR);
+        cb[l].resize(cs);
+    }
+
+    // Write the header, which contains the number of blocks, the block size,
+    // the size of the last block, and the compressed size of each block
+    std::vector<uint64_t> hd(k+3);
+    hd[0]=k;hd[1]=block_size;
+    hd[2]=ps%block_size==0&&ps>0?block_size:ps%block_size;
+    for(int l=0;l<k;l++) hd[l+3]=cb[l].size();
+    fwrite(hd.data(),sizeof(uint64_t),k+3,fp);
+    for(int l=0;l<k;l++) fwrite(cb[l].data(),1,cb[l].size(),fp);
+#endif
+}
+
+// Explicit template instantiation
+template void vtu_writer_3d::write(container_3d&,const char*);
+template void vtu_writer_3d::write(container_poly_3d&,const char*);
+template void vtu_writer_3d::write(container_triclinic&,const char*);
+template void vtu_writer_3d::write(container_triclinic_poly&,const char*);
+
+}
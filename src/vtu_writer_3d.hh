@@ -0,0 +1,92 @@
+// Voro++, a cell-based Voronoi library
+// By Chris H. Rycroft and the Rycroft Group
+
+/** \file vtu_writer_3d.hh
+ * \brief Header file for the vtu_writer_3d class. */
+
+#ifndef VOROPP_VTU_WRITER_3D_HH
+#define VOROPP_VTU_WRITER_3D_HH
+
+#include <cstdio>
+#include <inttypes.h>
+
+#include <vector>
+
+#include "config.hh"
+
+namespace voro {
+
+/** \brief A class for saving a Voronoi tessellation in the VTK unstructured
+ * grid format.
+ *
+ * The vtu_writer_3d class computes all of the Voronoi cells in a container in
+ * parallel, and saves them to a VTK XML unstructured grid (.vtu) file that
+ * can be opened directly in ParaView or VisIt. Each Voronoi cell is stored as
+ * a polyhedron cell with its own copy of its vertices, along with cell data
+ * arrays for the particle ID, the volume, the number of faces, and the
+ * particle radius for the radical tessellation containers.
+ *
+ * The particles are split into blocks, and each block is saved as a separate
+ * piece of the grid. The cells in a block are computed using multiple threads,
+ * and their data arrays are written in binary after the XML header, using the
+ * appended raw encoding. Only one block is stored at a time, so the memory
+ * overhead does not grow with the size of the tessellation. If voro++ is
+ * compiled with VOROPP_ZLIB set to 1, then the data can optionally be
+ * compressed with zlib, in which case the blocks of each array are compressed
+ * in parallel. */
+class vtu_writer_3d {
+    public:
+        /** Whether to compress the data arrays with zlib. */
+        const bool compress;
+        /** The size in bytes of the blocks that the data arrays are split
+         * into for compression. */
+        const int block_size;
+        vtu_writer_3d(bool compress_=false,int block_size_=65536);
+        template<class c_class>
+        void write(c_class &con,const char *filename);
+    private:
+        /** The number of threads to use. */
+        int nt;
+        /** The number of cells in the current block. */
+        int n;
+        /** Whether to write the particle radii. */
+        bool radius;
+        /** The block and particle indices of the particles in the
+         * container. */
+        std::vector<int> ijk,q;
+        /** The vertex positions of the cells in the current block, in global
+         * coordinates. */
+        std::vector<double> pts;
+        /** The face vertex lists of the cells in the current block, in the format given by the
+         * voronoicell_base_3d::face_vertices() routine, using the vertex
+         * indices within each cell. */
+        std::vector<int> fv;
+        /** The offsets of each cell into the vertex list, of length n+1. */
+        std::vector<uint64_t> voff;
+        /** The offsets of each cell into the face vertex lists, of length
+         * n+1. */
+        std::vector<uint64_t> foff;
+        /** The particle ID of each cell. */
+        std::vector<int64_t> cid;
+        /** The number of faces of each cell. */
+        std::vector<int> cnf;
+        /** The volume of each cell. */
+        std::vector<double> cvol;
+        /** The radius of each particle, if required. */
+        std::vector<double> crad;
+        /** The file handle to write to. */
+        FILE *fp;
+        /** A buffer for the uncompressed data of an array. */
+        std::vector<char> pend;
+        template<class c_class>
+        void compute(c_class &con,int c0,int c1);
+        void header(int np,std::vector<long> &opos);
+        void write_array(int a);
+        void write_blocks();
+        uint64_t array_pos(int a,int i);
+        void fill(int a,int i,char *b);
+};
+
+}
+
+#endif
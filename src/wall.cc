@@ -42,7 +42,7 @@ void wall_list_2d::increase_wall_memory() {
 }
 
 /** The wall_list constructor sets up an array of pointers to wall classes. */
-wall_list_3d::wall_list_3d() : walls(new wall_3d*[init_wall_size]), wep(walls), wel(walls+init_wall_size),
+wall_list_3d::wall_list_3d() : walls(new wall_3d*[init_wall_size]), wep(walls), nlast(0), wel(walls+init_wall_size),
     current_wall_size(init_wall_size) {}
 
 /** The wall_list destructor frees the array of pointers to the wall classes.
@@ -57,6 +57,48 @@ void wall_list_3d::add_wall(wall_list_3d &wl) {
     for(wall_3d **wp=wl.walls;wp<wl.wep;wp++) add_wall(*wp);
 }
 
+/** Tests whether all eight corners of an axis-aligned box are inside the wall
+ * object. For walls whose inside region is convex, and whose plane cuts are
+ * tangent to that region, this implies that the wall cannot cut any Voronoi
+ * cell that is contained within the box.
+ * \param[in] (xlo,xhi) the x range of the box.
+ * \param[in] (ylo,yhi) the y range of the box.
+ * \param[in] (zlo,zhi) the z range of the box.
+ * \return True if all of the corners are inside, false otherwise. */
+bool wall_3d::corners_inside(double xlo,double xhi,double ylo,double yhi,double zlo,double zhi) {
+    return point_inside(xlo,ylo,zlo)&&point_inside(xhi,ylo,zlo)
+         &&point_inside(xlo,yhi,zlo)&&point_inside(xhi,yhi,zlo)
+         &&point_inside(xlo,ylo,zhi)&&point_inside(xhi,ylo,zhi)
+         &&point_inside(xlo,yhi,zhi)&&point_inside(xhi,yhi,zhi);
+}
+
+/** Tests whether each of a batch of points is inside the wall object. The
+ * default implementation calls point_inside for each point that is still
+ * marked as inside, and wall classes can override this with a routine that
+ * processes the whole batch at once.
+ * \param[in] n the number of points.
+ * \param[in] pos the point positions, as consecutive (x,y,z) triplets.
+ * \param[in,out] in an array of flags for the points, where a flag is
+ *                    cleared if the point is outside the wall. Flags that are
+ *                    already false are left unchanged. */
+void wall_3d::points_inside(int n,const double *pos,bool *in) {
+    for(int i=0;i<n;i++,pos+=3)
+        if(in[i]&&!point_inside(*pos,pos[1],pos[2])) in[i]=false;
+}
+
+/** Determines whether each of a batch of points is inside all of the walls on
+ * the list. Each wall processes the whole batch before the next one is
+ * considered, which allows walls that hold many components to evaluate them
+ * without any per-point virtual function calls.
+ * \param[in] n the number of points.
+ * \param[in] pos the point positions, as consecutive (x,y,z) triplets.
+ * \param[out] in an array of n flags, which are set to true for the points
+ *                 that are inside all of the walls, and false otherwise. */
+void wall_list_3d::points_inside_walls(int n,const double *pos,bool *in) {
+    for(int i=0;i<n;i++) in[i]=true;
+    for(wall_3d **wp=walls;wp<wep;wp++) (*wp)->points_inside(n,pos,in);
+}
+
 /** Deallocates all of the wall classes pointed to by the wall_list. */
 void wall_list_3d::deallocate() {
     for(wall_3d **wp=walls;wp<wep;wp++) delete *wp;
@@ -99,6 +99,26 @@ class wall_3d {
         /** A pure virtual function for cutting a cell with
          * neighbor-tracking enabled with a wall. */
         virtual bool cut_cell(voronoicell_neighbor_3d &c,double x,double y,double z) = 0;
+        /** Tests whether an axis-aligned box lies entirely inside the wall
+         * object, in which case the wall cannot cut any Voronoi cell that is
+         * contained within the box. This is used to skip walls that are far
+         * from a computational block. The default implementation returns
+         * false, so that the wall is always applied.
+         * \param[in] (xlo,xhi) the x range of the box.
+         * \param[in] (ylo,yhi) the y range of the box.
+         * \param[in] (zlo,zhi) the z range of the box.
+         * \return True if the box is inside, false otherwise. */
+        virtual bool box_inside(double xlo,double xhi,double ylo,double yhi,double zlo,double zhi) {return false;}
+        /** Returns whether the wall should be applied to a Voronoi cell after
+         * the cell has been cut by the nearby particles, rather than before.
+         * This is useful for walls whose plane cuts depend on the size of
+         * the cell. The default implementation returns false.
+         * \return True if the wall should be applied last, false otherwise.
+         */
+        virtual bool apply_last() {return false;}
+        virtual void points_inside(int n,const double *pos,bool *in);
+    protected:
+        bool corners_inside(double xlo,double xhi,double ylo,double yhi,double zlo,double zhi);
 };
 
 /** \brief A class for storing a list of pointers to walls.
@@ -115,6 +135,8 @@ class wall_list_3d {
         /** A pointer to the next free position to add a wall pointer.
          */
         wall_3d **wep;
+        /** The number of walls on the list that are applied last. */
+        int nlast;
         wall_list_3d();
         ~wall_list_3d();
         /** Adds a wall to the list.
@@ -122,6 +144,7 @@ class wall_list_3d {
         inline void add_wall(wall_3d *w) {
             if(wep==wel) increase_wall_memory();
             *(wep++)=w;
+            if(w->apply_last()) nlast++;
         }
         /** Adds a wall to the list.
          * \param[in] w a reference to the wall to add. */
@@ -135,6 +158,7 @@ class wall_list_3d {
             for(wall_3d **wp=walls;wp<wep;wp++) if(!((*wp)->point_inside(x,y,z))) return false;
             return true;
         }
+        void points_inside_walls(int n,const double *pos,bool *in);
         /** Cuts a Voronoi cell by all of the walls currently on the list.
          * \param[in] c a reference to the Voronoi cell class.
          * \param[in] (x,y,z) the position of the cell.
@@ -145,6 +169,32 @@ class wall_list_3d {
             for(wall_3d **wp=walls;wp<wep;wp++) if(!((*wp)->cut_cell(c,x,y,z))) return false;
             return true;
         }
+        /** Cuts a Voronoi cell by all of the walls on the list that are not
+         * applied last.
+         * \param[in] c a reference to the Voronoi cell class.
+         * \param[in] (x,y,z) the position of the cell.
+         * \return True if the cell still exists, false if the cell is deleted.
+         */
+        template<class c_class>
+        bool apply_walls_first(c_class &c,double x,double y,double z) {
+            if(nlast==0) return apply_walls(c,x,y,z);
+            for(wall_3d **wp=walls;wp<wep;wp++)
+                if(!(*wp)->apply_last()&&!((*wp)->cut_cell(c,x,y,z))) return false;
+            return true;
+        }
+        /** Cuts a Voronoi cell by all of the walls on the list that are
+         * applied last.
+         * \param[in] c a reference to the Voronoi cell class.
+         * \param[in] (x,y,z) the position of the cell.
+         * \return True if the cell still exists, false if the cell is deleted.
+         */
+        template<class c_class>
+        bool apply_walls_last(c_class &c,double x,double y,double z) {
+            if(nlast==0) return true;
+            for(wall_3d **wp=walls;wp<wep;wp++)
+                if((*wp)->apply_last()&&!((*wp)->cut_cell(c,x,y,z))) return false;
+            return true;
+        }
         void deallocate();
     protected:
         void increase_wall_memory();
@@ -117,6 +117,187 @@ bool wall_cone::cut_cell_base(v_cell &c,double x,double y,double z) {
     return true;
 }
 
+/** Adds a plane to the group.
+ * \param[in] (xc_,yc_,zc_) a normal vector to the plane.
+ * \param[in] ac_ a displacement along the normal vector.
+ * \param[in] w_id_ an ID number to associate with the plane for neighbor
+ *                  tracking. */
+void wall_plane_group::add(double xc_,double yc_,double zc_,double ac_,int w_id_) {
+    w_id.push_back(w_id_);
+    xc.push_back(xc_);yc.push_back(yc_);zc.push_back(zc_);ac.push_back(ac_);
+    nl.push_back(sqrt(xc_*xc_+yc_*yc_+zc_*zc_));
+}
+
+/** Tests to see whether a point is inside all of the planes in the group.
+ * \param[in] (x,y,z) the vector to test.
+ * \return True if the point is inside, false if the point is outside. */
+bool wall_plane_group::point_inside(double x,double y,double z) {
+    for(int j=0;j<size();j++) if(x*xc[j]+y*yc[j]+z*zc[j]>=ac[j]) return false;
+    return true;
+}
+
+/** Tests whether each of a batch of points is inside all of the planes in the
+ * group.
+ * \param[in] n the number of points.
+ * \param[in] pos the point positions, as consecutive (x,y,z) triplets.
+ * \param[in,out] in an array of flags for the points, where a flag is cleared
+ *                    if the point is outside any of the planes. */
+void wall_plane_group::points_inside(int n,const double *pos,bool *in) {
+    for(int j=0;j<size();j++) {
+        double nx=xc[j],ny=yc[j],nz=zc[j],a=ac[j];
+#pragma omp simd
+        for(int i=0;i<n;i++)
+            in[i]&=pos[3*i]*nx+pos[3*i+1]*ny+pos[3*i+2]*nz<a;
+    }
+}
+
+/** Cuts a cell by all of the planes in the group. A plane is skipped if it is
+ * further from the particle than the furthest vertex of the cell, in which
+ * case it cannot cut the cell. The furthest vertex is only computed once,
+ * which is conservative since the cell can only shrink as planes are applied.
+ * \param[in,out] c the Voronoi cell to be cut.
+ * \param[in] (x,y,z) the location of the Voronoi cell.
+ * \return True if the cell still exists, false if the cell is deleted. */
+template<class v_cell>
+bool wall_plane_group::cut_cell_base(v_cell &c,double x,double y,double z) {
+    double mr=sqrt(c.max_radius_squared()),dq;
+    for(int j=0;j<size();j++) {
+        dq=2*(ac[j]-x*xc[j]-y*yc[j]-z*zc[j]);
+        if(dq>mr*nl[j]+c.big_tol) continue;
+        if(!c.nplane(xc[j],yc[j],zc[j],dq,w_id[j])) return false;
+    }
+    return true;
+}
+
+/** Adds a sphere to the group.
+ * \param[in] (xc_,yc_,zc_) a position vector for the sphere's center.
+ * \param[in] rc_ the radius of the sphere.
+ * \param[in] w_id_ an ID number to associate with the sphere for neighbor
+ *                  tracking. */
+void wall_sphere_group::add(double xc_,double yc_,double zc_,double rc_,int w_id_) {
+    w_id.push_back(w_id_);
+    xc.push_back(xc_);yc.push_back(yc_);zc.push_back(zc_);rc.push_back(rc_);
+}
+
+/** Tests to see whether a point is inside all of the spheres in the group.
+ * \param[in] (x,y,z) the vector to test.
+ * \return True if the point is inside, false if the point is outside. */
+bool wall_sphere_group::point_inside(double x,double y,double z) {
+    for(int j=0;j<size();j++)
+        if((x-xc[j])*(x-xc[j])+(y-yc[j])*(y-yc[j])+(z-zc[j])*(z-zc[j])>=rc[j]*rc[j]) return false;
+    return true;
+}
+
+/** Tests whether each of a batch of points is inside all of the spheres in
+ * the group.
+ * \param[in] n the number of points.
+ * \param[in] pos the point positions, as consecutive (x,y,z) triplets.
+ * \param[in,out] in an array of flags for the points, where a flag is cleared
+ *                    if the point is outside any of the spheres. */
+void wall_sphere_group::points_inside(int n,const double *pos,bool *in) {
+    for(int j=0;j<size();j++) {
+        double cx=xc[j],cy=yc[j],cz=zc[j],rsq=rc[j]*rc[j];
+#pragma omp simd
+        for(int i=0;i<n;i++) {
+            double xd=pos[3*i]-cx,yd=pos[3*i+1]-cy,zd=pos[3*i+2]-cz;
+            in[i]&=xd*xd+yd*yd+zd*zd<rsq;
+        }
+    }
+}
+
+/** Cuts a cell by all of the spheres in the group, using the same planar
+ * approximation as the wall_sphere class. Spheres whose cutting planes are
+ * beyond the furthest vertex of the cell are skipped.
+ * \param[in,out] c the Voronoi cell to be cut.
+ * \param[in] (x,y,z) the location of the Voronoi cell.
+ * \return True if the cell still exists, false if the cell is deleted. */
+template<class v_cell>
+bool wall_sphere_group::cut_cell_base(v_cell &c,double x,double y,double z) {
+    double mr=sqrt(c.max_radius_squared()),xd,yd,zd,dq,dl;
+    for(int j=0;j<size();j++) {
+        xd=x-xc[j];yd=y-yc[j];zd=z-zc[j];dq=xd*xd+yd*yd+zd*zd;
+        if(dq>1e-5) {
+            dl=sqrt(dq);
+            dq=2*(dl*rc[j]-dq);
+            if(dq>mr*dl+c.big_tol) continue;
+            if(!c.nplane(xd,yd,zd,dq,w_id[j])) return false;
+        }
+    }
+    return true;
+}
+
+/** Adds a cylinder to the group.
+ * \param[in] (xc_,yc_,zc_) a point on the axis of the cylinder.
+ * \param[in] (xa_,ya_,za_) a vector pointing along the direction of the
+ *                          cylinder.
+ * \param[in] rc_ the radius of the cylinder.
+ * \param[in] w_id_ an ID number to associate with the cylinder for neighbor
+ *                  tracking. */
+void wall_cylinder_group::add(double xc_,double yc_,double zc_,double xa_,double ya_,double za_,double rc_,int w_id_) {
+    w_id.push_back(w_id_);
+    xc.push_back(xc_);yc.push_back(yc_);zc.push_back(zc_);
+    xa.push_back(xa_);ya.push_back(ya_);za.push_back(za_);
+    asi.push_back(1/(xa_*xa_+ya_*ya_+za_*za_));rc.push_back(rc_);
+}
+
+/** Tests to see whether a point is inside all of the cylinders in the group.
+ * \param[in] (x,y,z) the vector to test.
+ * \return True if the point is inside, false if the point is outside. */
+bool wall_cylinder_group::point_inside(double x,double y,double z) {
+    double xd,yd,zd,pa;
+    for(int j=0;j<size();j++) {
+        xd=x-xc[j];yd=y-yc[j];zd=z-zc[j];
+        pa=(xd*xa[j]+yd*ya[j]+zd*za[j])*asi[j];
+        xd-=xa[j]*pa;yd-=ya[j]*pa;zd-=za[j]*pa;
+        if(xd*xd+yd*yd+zd*zd>=rc[j]*rc[j]) return false;
+    }
+    return true;
+}
+
+/** Tests whether each of a batch of points is inside all of the cylinders in
+ * the group.
+ * \param[in] n the number of points.
+ * \param[in] pos the point positions, as consecutive (x,y,z) triplets.
+ * \param[in,out] in an array of flags for the points, where a flag is cleared
+ *                    if the point is outside any of the cylinders. */
+void wall_cylinder_group::points_inside(int n,const double *pos,bool *in) {
+    for(int j=0;j<size();j++) {
+        double cx=xc[j],cy=yc[j],cz=zc[j],ax=xa[j],ay=ya[j],az=za[j],
+               as=asi[j],rsq=rc[j]*rc[j];
+#pragma omp simd
+        for(int i=0;i<n;i++) {
+            double xd=pos[3*i]-cx,yd=pos[3*i+1]-cy,zd=pos[3*i+2]-cz,
+                   pa=(xd*ax+yd*ay+zd*az)*as;
+            xd-=ax*pa;yd-=ay*pa;zd-=az*pa;
+            in[i]&=xd*xd+yd*yd+zd*zd<rsq;
+        }
+    }
+}
+
+/** Cuts a cell by all of the cylinders in the group, using the same planar
+ * approximation as the wall_cylinder class. Cylinders whose cutting planes are
+ * beyond the furthest vertex of the cell are skipped.
+ * \param[in,out] c the Voronoi cell to be cut.
+ * \param[in] (x,y,z) the location of the Voronoi cell.
+ * \return True if the cell still exists, false if the cell is deleted. */
+template<class v_cell>
+bool wall_cylinder_group::cut_cell_base(v_cell &c,double x,double y,double z) {
+    double mr=sqrt(c.max_radius_squared()),xd,yd,zd,pa,dl;
+    for(int j=0;j<size();j++) {
+        xd=x-xc[j];yd=y-yc[j];zd=z-zc[j];
+        pa=(xd*xa[j]+yd*ya[j]+zd*za[j])*asi[j];
+        xd-=xa[j]*pa;yd-=ya[j]*pa;zd-=za[j]*pa;
+        pa=xd*xd+yd*yd+zd*zd;
+        if(pa>1e-5) {
+            dl=sqrt(pa);
+            pa=2*(dl*rc[j]-pa);
+            if(pa>mr*dl+c.big_tol) continue;
+            if(!c.nplane(xd,yd,zd,pa,w_id[j])) return false;
+        }
+    }
+    return true;
+}
+
 // Explicit instantiation
 template bool wall_sphere::cut_cell_base(voronoicell_3d&,double,double,double);
 template bool wall_sphere::cut_cell_base(voronoicell_neighbor_3d&,double,double,double);
@@ -126,5 +307,11 @@ template bool wall_cylinder::cut_cell_base(voronoicell_3d&,double,double,double)
 template bool wall_cylinder::cut_cell_base(voronoicell_neighbor_3d&,double,double,double);
 template bool wall_cone::cut_cell_base(voronoicell_3d&,double,double,double);
 template bool wall_cone::cut_cell_base(voronoicell_neighbor_3d&,double,double,double);
+template bool wall_plane_group::cut_cell_base(voronoicell_3d&,double,double,double);
+template bool wall_plane_group::cut_cell_base(voronoicell_neighbor_3d&,double,double,double);
+template bool wall_sphere_group::cut_cell_base(voronoicell_3d&,double,double,double);
+template bool wall_sphere_group::cut_cell_base(voronoicell_neighbor_3d&,double,double,double);
+template bool wall_cylinder_group::cut_cell_base(voronoicell_3d&,double,double,double);
+template bool wall_cylinder_group::cut_cell_base(voronoicell_neighbor_3d&,double,double,double);
 
 }
@@ -7,6 +7,8 @@
 #ifndef VOROPP_WALL_3D_HH
 #define VOROPP_WALL_3D_HH
 
+#include <vector>
+
 #include "cell_3d.hh"
 #include "container_3d.hh"
 
@@ -29,6 +31,9 @@ struct wall_sphere : public wall_3d {
         bool cut_cell_base(v_cell &c,double x,double y,double z);
         bool cut_cell(voronoicell_3d &c,double x,double y,double z) {return cut_cell_base(c,x,y,z);}
         bool cut_cell(voronoicell_neighbor_3d &c,double x,double y,double z) {return cut_cell_base(c,x,y,z);}
+        bool box_inside(double xlo,double xhi,double ylo,double yhi,double zlo,double zhi) {
+            return corners_inside(xlo,xhi,ylo,yhi,zlo,zhi);
+        }
     private:
         const int w_id;
         const double xc,yc,zc,rc;
@@ -51,6 +56,9 @@ struct wall_plane : public wall_3d {
         bool cut_cell_base(v_cell &c,double x,double y,double z);
         bool cut_cell(voronoicell_3d &c,double x,double y,double z) {return cut_cell_base(c,x,y,z);}
         bool cut_cell(voronoicell_neighbor_3d &c,double x,double y,double z) {return cut_cell_base(c,x,y,z);}
+        bool box_inside(double xlo,double xhi,double ylo,double yhi,double zlo,double zhi) {
+            return corners_inside(xlo,xhi,ylo,yhi,zlo,zhi);
+        }
     private:
         const int w_id;
         const double xc,yc,zc,ac;
@@ -76,6 +84,9 @@ struct wall_cylinder : public wall_3d {
         bool cut_cell_base(v_cell &c,double x,double y,double z);
         bool cut_cell(voronoicell_3d &c,double x,double y,double z) {return cut_cell_base(c,x,y,z);}
         bool cut_cell(voronoicell_neighbor_3d &c,double x,double y,double z) {return cut_cell_base(c,x,y,z);}
+        bool box_inside(double xlo,double xhi,double ylo,double yhi,double zlo,double zhi) {
+            return corners_inside(xlo,xhi,ylo,yhi,zlo,zhi);
+        }
     private:
         const int w_id;
         const double xc,yc,zc,xa,ya,za,asi,rc;
@@ -103,11 +114,104 @@ struct wall_cone : public wall_3d {
         bool cut_cell_base(v_cell &c,double x,double y,double z);
         bool cut_cell(voronoicell_3d &c,double x,double y,double z) {return cut_cell_base(c,x,y,z);}
         bool cut_cell(voronoicell_neighbor_3d &c,double x,double y,double z) {return cut_cell_base(c,x,y,z);}
+        bool box_inside(double xlo,double xhi,double ylo,double yhi,double zlo,double zhi) {
+            return gra>0&&corners_inside(xlo,xhi,ylo,yhi,zlo,zhi);
+        }
     private:
         const int w_id;
         const double xc,yc,zc,xa,ya,za,asi,gra,sang,cang;
 };
 
+/** \brief A class representing a collection of plane wall objects.
+ *
+ * This class represents a collection of plane walls, whose inside is the
+ * region that is inside all of them. It gives the same results as adding each
+ * plane as a separate wall_plane, but the parameters are held in separate
+ * arrays, so that the planes are evaluated in tight loops without a virtual
+ * function call for each one. When testing a batch of points with
+ * points_inside, each plane is tested against all of the points in a loop
+ * that the compiler can vectorize. When cutting a cell, the planes that are
+ * too far away to intersect it are skipped without calling the plane cutting
+ * routine. */
+class wall_plane_group : public wall_3d {
+    public:
+        void add(double xc_,double yc_,double zc_,double ac_,int w_id_=-99);
+        /** Returns the number of planes in the group.
+         * \return The number of planes. */
+        inline int size() {return static_cast<int>(xc.size());}
+        bool point_inside(double x,double y,double z);
+        void points_inside(int n,const double *pos,bool *in);
+        template<class v_cell>
+        bool cut_cell_base(v_cell &c,double x,double y,double z);
+        bool cut_cell(voronoicell_3d &c,double x,double y,double z) {return cut_cell_base(c,x,y,z);}
+        bool cut_cell(voronoicell_neighbor_3d &c,double x,double y,double z) {return cut_cell_base(c,x,y,z);}
+        bool box_inside(double xlo,double xhi,double ylo,double yhi,double zlo,double zhi) {
+            return corners_inside(xlo,xhi,ylo,yhi,zlo,zhi);
+        }
+    private:
+        /** The ID numbers associated with the planes. */
+        std::vector<int> w_id;
+        /** The components of the plane normals, the displacements along the
+         * normals, and the lengths of the normals. */
+        std::vector<double> xc,yc,zc,ac,nl;
+};
+
+/** \brief A class representing a collection of spherical wall objects.
+ *
+ * This class represents a collection of spherical walls, whose inside is the
+ * region that is inside all of them. It is the spherical counterpart of the
+ * wall_plane_group class. */
+class wall_sphere_group : public wall_3d {
+    public:
+        void add(double xc_,double yc_,double zc_,double rc_,int w_id_=-99);
+        /** Returns the number of spheres in the group.
+         * \return The number of spheres. */
+        inline int size() {return static_cast<int>(xc.size());}
+        bool point_inside(double x,double y,double z);
+        void points_inside(int n,const double *pos,bool *in);
+        template<class v_cell>
+        bool cut_cell_base(v_cell &c,double x,double y,double z);
+        bool cut_cell(voronoicell_3d &c,double x,double y,double z) {return cut_cell_base(c,x,y,z);}
+        bool cut_cell(voronoicell_neighbor_3d &c,double x,double y,double z) {return cut_cell_base(c,x,y,z);}
+        bool box_inside(double xlo,double xhi,double ylo,double yhi,double zlo,double zhi) {
+            return corners_inside(xlo,xhi,ylo,yhi,zlo,zhi);
+        }
+    private:
+        /** The ID numbers associated with the spheres. */
+        std::vector<int> w_id;
+        /** The components of the sphere centers, and the radii. */
+        std::vector<double> xc,yc,zc,rc;
+};
+
+/** \brief A class representing a collection of cylindrical wall objects.
+ *
+ * This class represents a collection of open cylinder walls, whose inside is
+ * the region that is inside all of them. It is the cylindrical counterpart of
+ * the wall_plane_group class. */
+class wall_cylinder_group : public wall_3d {
+    public:
+        void add(double xc_,double yc_,double zc_,double xa_,double ya_,double za_,double rc_,int w_id_=-99);
+        /** Returns the number of cylinders in the group.
+         * \return The number of cylinders. */
+        inline int size() {return static_cast<int>(xc.size());}
+        bool point_inside(double x,double y,double z);
+        void points_inside(int n,const double *pos,bool *in);
+        template<class v_cell>
+        bool cut_cell_base(v_cell &c,double x,double y,double z);
+        bool cut_cell(voronoicell_3d &c,double x,double y,double z) {return cut_cell_base(c,x,y,z);}
+        bool cut_cell(voronoicell_neighbor_3d &c,double x,double y,double z) {return cut_cell_base(c,x,y,z);}
+        bool box_inside(double xlo,double xhi,double ylo,double yhi,double zlo,double zhi) {
+            return corners_inside(xlo,xhi,ylo,yhi,zlo,zhi);
+        }
+    private:
+        /** The ID numbers associated with the cylinders. */
+        std::vector<int> w_id;
+        /** The components of points on the cylinder axes, the components of
+         * the axis directions, the reciprocals of the squared lengths of the
+         * axis directions, and the radii. */
+        std::vector<double> xc,yc,zc,xa,ya,za,asi,rc;
+};
+
 }
 
 #endif
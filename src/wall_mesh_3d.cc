@@ -0,0 +1,338 @@
+// Voro++, a cell-based Voronoi library
+// By Chris H. Rycroft and the Rycroft Group
+
+/** \file wall_mesh_3d.cc
+ * \brief Function implementations for the wall_mesh class. */
+
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+#include "wall_mesh_3d.hh"
+#include "config.hh"
+#include "common.hh"
+
+namespace voro {
+
+/** The maximum number of triangles in a leaf of the bounding volume
+ * hierarchy. */
+static const int wall_mesh_leaf_size=4;
+
+/** The maximum depth of the stacks used to traverse the bounding volume
+ * hierarchy. Since the nodes are split at the median, this is only reached
+ * for meshes with an astronomical number of triangles. */
+static const int wall_mesh_stack_size=128;
+
+/** Constructs a mesh wall from arrays of vertices and triangles.
+ * \param[in] v the vertex coordinates, with three entries per vertex.
+ * \param[in] t the triangles, with three vertex indices per triangle.
+ * \param[in] w_id_ an ID number to associate with the wall for neighbor
+ *                  tracking. */
+wall_mesh::wall_mesh(const std::vector<double> &v,const std::vector<int> &t,int w_id_)
+    : w_id(w_id_), nt(0) {
+    setup(v,t);
+}
+
+/** Constructs a mesh wall by reading a triangle mesh in the Object File Format
+ * (OFF). Faces with more than three vertices are divided into triangles.
+ * \param[in] filename the name of the file to read.
+ * \param[in] w_id_ an ID number to associate with the wall for neighbor
+ *                  tracking. */
+wall_mesh::wall_mesh(const char *filename,int w_id_) : w_id(w_id_), nt(0) {
+    FILE *fp=safe_fopen(filename,"r");
+    char buf[8];
+    int nv,nf,ne,k,i,i0,i1,i2;
+    if(fscanf(fp,"%7s",buf)!=1||strcmp(buf,"OFF")!=0||fscanf(fp,"%d %d %d",&nv,&nf,&ne)!=3||nv<0||nf<0)
+        voro_fatal_error("Mesh file is not in OFF format",VOROPP_FILE_ERROR);
+
+    // Read the vertices and faces, dividing each face into a fan of
+    // triangles
+    std::vector<double> v(3*nv);
+    std::vector<int> t;
+    for(i=0;i<3*nv;i++) if(fscanf(fp,"%lg",&v[i])!=1)
+        voro_fatal_error("Error reading vertices from mesh file",VOROPP_FILE_ERROR);
+    while(nf-->0) {
+        if(fscanf(fp,"%d %d %d",&k,&i0,&i1)!=3||k<3)
+            voro_fatal_error("Error reading faces from mesh file",VOROPP_FILE_ERROR);
+        for(i=2;i<k;i++,i1=i2) {
+            if(fscanf(fp,"%d",&i2)!=1)
+                voro_fatal_error("Error reading faces from mesh file",VOROPP_FILE_ERROR);
+            t.push_back(i0);t.push_back(i1);t.push_back(i2);
+        }
+
+        // Skip any color information at the end of the line
+        while((k=fgetc(fp))!='\n'&&k!=EOF);
+    }
+    fclose(fp);
+    setup(v,t);
+}
+
+/** Sets up the triangle data and the bounding volume hierarchy. Degenerate
+ * triangles are discarded, and the triangles are oriented so that their
+ * normals point outwards.
+ * \param[in] v the vertex coordinates, with three entries per vertex.
+ * \param[in] t the triangles, with three vertex indices per triangle. */
+void wall_mesh::setup(const std::vector<double> &v,const std::vector<int> &t) {
+    int nv=v.size()/3,i,j;
+    if(t.size()%3!=0)
+        voro_fatal_error("Mesh triangle list has an invalid length",VOROPP_INTERNAL_ERROR);
+    for(i=0;i<(int) t.size();i++) if(t[i]<0||t[i]>=nv)
+        voro_fatal_error("Mesh triangle refers to a non-existent vertex",VOROPP_INTERNAL_ERROR);
+
+    // Compute the length scale of the mesh, used to detect degenerate
+    // triangles
+    double l=0,*tp,ux,uy,uz,wx,wy,wz,nx,ny,nz,a,vol=0;
+    for(i=0;i<3*nv;i++) if(fabs(v[i])>l) l=fabs(v[i]);
+
+    // Store the vertices and normals of the triangles
+    std::vector<double> tt;
+    for(i=0;i<(int) t.size();i+=3) {
+        const double *p0=v.data()+3*t[i],*p1=v.data()+3*t[i+1],*p2=v.data()+3*t[i+2];
+        ux=p1[0]-*p0;uy=p1[1]-p0[1];uz=p1[2]-p0[2];
+        wx=p2[0]-*p0;wy=p2[1]-p0[1];wz=p2[2]-p0[2];
+        nx=uy*wz-uz*wy;ny=uz*wx-ux*wz;nz=ux*wy-uy*wx;
+        a=sqrt(nx*nx+ny*ny+nz*nz);
+        if(a<=tolerance*l*l) continue;
+        vol+=*p0*nx+p0[1]*ny+p0[2]*nz;
+        a=1/a;nx*=a;ny*=a;nz*=a;
+        tt.insert(tt.end(),p0,p0+3);
+        tt.insert(tt.end(),p1,p1+3);
+        tt.insert(tt.end(),p2,p2+3);
+        tt.push_back(nx);tt.push_back(ny);tt.push_back(nz);
+        tt.push_back(*p0*nx+p0[1]*ny+p0[2]*nz);
+    }
+    nt=tt.size()/13;
+    if(nt==0) voro_fatal_error("Mesh has no triangles",VOROPP_INTERNAL_ERROR);
+
+    // If the mesh has a negative signed volume then its triangles are
+    // oriented inwards, so reverse them
+    if(vol<0) for(tp=tt.data();tp<tt.data()+13*nt;tp+=13) {
+        for(j=3;j<6;j++) std::swap(tp[j],tp[j+3]);
+        for(j=9;j<13;j++) tp[j]=-tp[j];
+    }
+
+    // Build the hierarchy, and then store the triangles in the order of its
+    // leaves
+    std::vector<int> perm(nt);
+    std::vector<double> cen(3*nt);
+    for(i=0;i<nt;i++) {
+        perm[i]=i;
+        tp=tt.data()+13*i;
+        for(j=0;j<3;j++) cen[3*i+j]=(tp[j]+tp[j+3]+tp[j+6])*(1/3.0);
+    }
+    tr.swap(tt);
+    nd.resize(1);
+    build(0,0,nt,perm,cen);
+    tt.resize(13*nt);
+    for(i=0;i<nt;i++) std::copy(tr.begin()+13*perm[i],tr.begin()+13*perm[i]+13,tt.begin()+13*i);
+    tr.swap(tt);
+}
+
+/** Comparison object that orders triangles by the coordinate of their
+ * centroids in one direction. */
+struct wall_mesh_compare {
+    /** The centroids of the triangles. */
+    const double *cen;
+    /** The direction to compare. */
+    int d;
+    bool operator()(int a,int b) const {return cen[3*a+d]<cen[3*b+d];}
+};
+
+/** Recursively builds a node of the bounding volume hierarchy, dividing the
+ * triangles at the median of their centroids along the direction in which the
+ * centroids are most spread out. The triangles are read from the tr array in
+ * their original order.
+ * \param[in] k the index of the node.
+ * \param[in] lo the position of the node's first triangle in the permutation.
+ * \param[in] n the number of triangles in the node.
+ * \param[in,out] perm the permutation of the triangles.
+ * \param[in] cen the centroids of the triangles. */
+void wall_mesh::build(int k,int lo,int n,std::vector<int> &perm,std::vector<double> &cen) {
+    double bb[6]={large_number,-large_number,large_number,-large_number,large_number,-large_number},
+           cb[6]={large_number,-large_number,large_number,-large_number,large_number,-large_number};
+    int i,j,q;
+
+    // Compute the bounding box of the triangles and of their centroids
+    for(i=lo;i<lo+n;i++) {
+        q=perm[i];
+        const double *tp=tr.data()+13*q,*cp=cen.data()+3*q;
+        for(j=0;j<3;j++) {
+            if(cp[j]<cb[2*j]) cb[2*j]=cp[j];
+            if(cp[j]>cb[2*j+1]) cb[2*j+1]=cp[j];
+        }
+        for(j=0;j<9;j++) {
+            if(tp[j]<bb[2*(j%3)]) bb[2*(j%3)]=tp[j];
+            if(tp[j]>bb[2*(j%3)+1]) bb[2*(j%3)+1]=tp[j];
+        }
+    }
+    std::copy(bb,bb+6,nd[k].bb);
+
+    // Store small nodes as leaves
+    if(n<=wall_mesh_leaf_size) {nd[k].l=lo;nd[k].n=n;return;}
+
+    // Divide the triangles at the median along the longest direction
+    wall_mesh_compare cmp;
+    cmp.cen=cen.data();cmp.d=0;
+    if(cb[3]-cb[2]>cb[1]-cb[0]) cmp.d=1;
+    if(cb[5]-cb[4]>cb[2*cmp.d+1]-cb[2*cmp.d]) cmp.d=2;
+    int m=n>>1,c=nd.size();
+    std::nth_element(perm.begin()+lo,perm.begin()+lo+m,perm.begin()+lo+n,cmp);
+    nd[k].l=c;nd[k].n=0;
+    nd.resize(c+2);
+    build(c,lo,m,perm,cen);
+    build(c+1,lo+m,n-m,perm,cen);
+}
+
+/** Tests to see whether a point is inside the mesh, by counting the number of
+ * triangles that a ray from the point crosses. The ray direction is chosen to
+ * make it unlikely that the ray passes exactly through an edge or a vertex.
+ * \param[in] (x,y,z) the vector to test.
+ * \return True if the point is inside, false if the point is outside. */
+bool wall_mesh::point_inside(double x,double y,double z) {
+    const double dx=0.5773502691896258,dy=0.5773672692896258,dz=0.5773332690896258,
+                 ix=1/dx,iy=1/dy,iz=1/dz;
+    int st[wall_mesh_stack_size],*sp=st;
+    bool in=false;
+    *(sp++)=0;
+    while(sp>st) {
+        const wall_mesh_node &w=nd[*(--sp)];
+
+        // Check whether the ray intersects the node's bounding box. Since the
+        // ray direction is positive in each coordinate, only the upper
+        // faces of the box need to be considered for the exit point.
+        double tlo=0,thi=large_number,t;
+        t=(w.bb[1]-x)*ix;if(t<thi) thi=t;
+        t=(w.bb[3]-y)*iy;if(t<thi) thi=t;
+        t=(w.bb[5]-z)*iz;if(t<thi) thi=t;
+        t=(w.bb[0]-x)*ix;if(t>tlo) tlo=t;
+        t=(w.bb[2]-y)*iy;if(t>tlo) tlo=t;
+        t=(w.bb[4]-z)*iz;if(t>tlo) tlo=t;
+        if(tlo>thi) continue;
+
+        if(w.n==0) {*(sp++)=w.l;*(sp++)=w.l+1;continue;}
+
+        // Test the ray against each triangle in the leaf using the
+        // Moller-Trumbore algorithm
+        for(const double *tp=tr.data()+13*w.l,*te=tp+13*w.n;tp<te;tp+=13) {
+            double ux=tp[3]-*tp,uy=tp[4]-tp[1],uz=tp[5]-tp[2],
+                   wx=tp[6]-*tp,wy=tp[7]-tp[1],wz=tp[8]-tp[2],
+                   px=dy*wz-dz*wy,py=dz*wx-dx*wz,pz=dx*wy-dy*wx,
+                   det=ux*px+uy*py+uz*pz;
+            if(det==0) continue;
+            double idet=1/det,sx=x-*tp,sy=y-tp[1],sz=z-tp[2],
+                   u=(sx*px+sy*py+sz*pz)*idet;
+            if(u<0||u>1) continue;
+            double qx=sy*uz-sz*uy,qy=sz*ux-sx*uz,qz=sx*uy-sy*ux,
+                   v=(dx*qx+dy*qy+dz*qz)*idet;
+            if(v<0||u+v>1) continue;
+            if((wx*qx+wy*qy+wz*qz)*idet>0) in=!in;
+        }
+    }
+    return in;
+}
+
+/** Cuts a cell by the mesh wall object. The cell is cut by the plane of each
+ * triangle that is within reach of the cell, starting with the nearest
+ * triangles, and the reach is updated after every cut.
+ * \param[in,out] c the Voronoi cell to be cut.
+ * \param[in] (x,y,z) the location of the Voronoi cell.
+ * \return True if the cell still exists, false if the cell is deleted. */
+template<class v_cell>
+bool wall_mesh::cut_cell_base(v_cell &c,double x,double y,double z) {
+    double rs=0.25*c.max_radius_squared(),dq,d0,d1;
+    int st[wall_mesh_stack_size],*sp=st;
+    *(sp++)=0;
+    while(sp>st) {
+        const wall_mesh_node &w=nd[*(--sp)];
+        if(box_dist_sq(w,x,y,z)>=rs) continue;
+
+        // For an internal node, push the children so that the nearer one is
+        // considered first
+        if(w.n==0) {
+            d0=box_dist_sq(nd[w.l],x,y,z);
+            d1=box_dist_sq(nd[w.l+1],x,y,z);
+            if(d0<d1) {*(sp++)=w.l+1;*(sp++)=w.l;}
+            else {*(sp++)=w.l;*(sp++)=w.l+1;}
+            continue;
+        }
+
+        // Cut the cell by the planes of the triangles in the leaf that are
+        // within reach, skipping those that have the particle on their outer
+        // side
+        for(const double *tp=tr.data()+13*w.l,*te=tp+13*w.n;tp<te;tp+=13) {
+            dq=tp[12]-tp[9]*x-tp[10]*y-tp[11]*z;
+            if(dq<=0||dq*dq>=rs||tri_dist_sq(tp,x,y,z)>=rs) continue;
+            if(!c.nplane(tp[9],tp[10],tp[11],2*dq,w_id)) return false;
+            rs=0.25*c.max_radius_squared();
+        }
+    }
+    return true;
+}
+
+/** Computes the squared distance from a point to a triangle.
+ * \param[in] tp a pointer to the triangle data.
+ * \param[in] (x,y,z) the position of the point.
+ * \return The squared distance. */
+double wall_mesh::tri_dist_sq(const double *tp,double x,double y,double z) {
+    const double *a=tp,*b=tp+3,*c=tp+6;
+    double abx=b[0]-a[0],aby=b[1]-a[1],abz=b[2]-a[2],
+           acx=c[0]-a[0],acy=c[1]-a[1],acz=c[2]-a[2],
+           apx=x-a[0],apy=y-a[1],apz=z-a[2],
+           d1=abx*apx+aby*apy+abz*apz,d2=acx*apx+acy*apy+acz*apz,cx,cy,cz,v,w;
+
+    // Find the closest point by considering the Voronoi regions of the
+    // vertices, edges, and face of the triangle
+    if(d1<=0&&d2<=0) {cx=a[0];cy=a[1];cz=a[2];}
+    else {
+        double bpx=x-b[0],bpy=y-b[1],bpz=z-b[2],
+               d3=abx*bpx+aby*bpy+abz*bpz,d4=acx*bpx+acy*bpy+acz*bpz;
+        if(d3>=0&&d4<=d3) {cx=b[0];cy=b[1];cz=b[2];}
+        else {
+            double vc=d1*d4-d3*d2;
+            if(vc<=0&&d1>=0&&d3<=0) {
+                v=d1/(d1-d3);
+                cx=a[0]+v*abx;cy=a[1]+v*aby;cz=a[2]+v*abz;
+            } else {
+                double cpx=x-c[0],cpy=y-c[1],cpz=z-c[2],
+                       d5=abx*cpx+aby*cpy+abz*cpz,d6=acx*cpx+acy*cpy+acz*cpz;
+                if(d6>=0&&d5<=d6) {cx=c[0];cy=c[1];cz=c[2];}
+                else {
+                    double vb=d5*d2-d1*d6;
+                    if(vb<=0&&d2>=0&&d6<=0) {
+                        w=d2/(d2-d6);
+                        cx=a[0]+w*acx;cy=a[1]+w*acy;cz=a[2]+w*acz;
+                    } else {
+                        double va=d3*d6-d5*d4;
+                        if(va<=0&&(d4-d3)>=0&&(d5-d6)>=0) {
+                            w=(d4-d3)/((d4-d3)+(d5-d6));
+                            cx=b[0]+w*(c[0]-b[0]);cy=b[1]+w*(c[1]-b[1]);cz=b[2]+w*(c[2]-b[2]);
+                        } else {
+                            double den=1/(va+vb+vc);
+                            v=vb*den;w=vc*den;
+                            cx=a[0]+abx*v+acx*w;cy=a[1]+aby*v+acy*w;cz=a[2]+abz*v+acz*w;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    cx-=x;cy-=y;cz-=z;
+    return cx*cx+cy*cy+cz*cz;
+}
+
+/** Computes the volume enclosed by the mesh.
+ * \return The volume. */
+double wall_mesh::volume() {
+    double vol=0;
+    for(const double *tp=tr.data(),*te=tp+13*nt;tp<te;tp+=13)
+        vol+=*tp*(tp[4]*tp[8]-tp[5]*tp[7])+tp[1]*(tp[5]*tp[6]-tp[3]*tp[8])
+            +tp[2]*(tp[3]*tp[7]-tp[4]*tp[6]);
+    return vol*(1/6.0);
+}
+
+// Explicit instantiation
+template bool wall_mesh::cut_cell_base(voronoicell_3d&,double,double,double);
+template bool wall_mesh::cut_cell_base(voronoicell_neighbor_3d&,double,double,double);
+
+}
@@ -0,0 +1,103 @@
+// Voro++, a cell-based Voronoi library
+// By Chris H. Rycroft and the Rycroft Group
+
+/** \file wall_mesh_3d.hh
+ * \brief Header file for the wall_mesh class. */
+
+#ifndef VOROPP_WALL_MESH_3D_HH
+#define VOROPP_WALL_MESH_3D_HH
+
+#include <vector>
+
+#include "cell_3d.hh"
+#include "wall.hh"
+
+namespace voro {
+
+/** \brief A node in the bounding volume hierarchy of a wall_mesh. */
+struct wall_mesh_node {
+    /** The bounding box of the node, as the minimum and maximum coordinates
+     * in each direction. */
+    double bb[6];
+    /** For a leaf, the index of the first triangle. Otherwise, the index of
+     * the first child node, with the second child immediately after it. */
+    int l;
+    /** For a leaf, the number of triangles. Otherwise zero. */
+    int n;
+};
+
+/** \brief A class representing a wall given by a closed triangle mesh.
+ *
+ * This class represents a wall whose inside is the region enclosed by a
+ * closed triangle mesh, which makes it possible to model complicated
+ * geometries such as scanned parts or porous media with a single wall object.
+ * The triangles are stored in a bounding volume hierarchy, so that the
+ * triangles near a given point can be found quickly.
+ *
+ * A Voronoi cell is cut by the planes of the triangles that are within reach
+ * of it, meaning that their distance from the particle is less than the
+ * maximum distance from the particle to a vertex of the cell. The reach is
+ * updated after every cut, and the nearest triangles are considered first.
+ * The mesh is applied after the cell has been cut by the nearby particles, so
+ * that only the triangles close to the cell are used.
+ * Triangles whose planes have the particle on their outer side are skipped.
+ * For convex meshes this gives the exact intersection of the cell with the
+ * mesh interior. For non-convex meshes it is an approximation, in the same
+ * way as for the curved walls, that is accurate when the particles are
+ * densely packed against the wall.
+ *
+ * The point_inside routine counts the crossings of a ray with the mesh. The
+ * triangles are oriented automatically so that their normals point outwards,
+ * assuming that the mesh is closed and consistently oriented. */
+class wall_mesh : public wall_3d {
+    public:
+        wall_mesh(const std::vector<double> &v,const std::vector<int> &t,int w_id_=-99);
+        wall_mesh(const char *filename,int w_id_=-99);
+        bool point_inside(double x,double y,double z);
+        template<class v_cell>
+        bool cut_cell_base(v_cell &c,double x,double y,double z);
+        bool cut_cell(voronoicell_3d &c,double x,double y,double z) {return cut_cell_base(c,x,y,z);}
+        bool cut_cell(voronoicell_neighbor_3d &c,double x,double y,double z) {return cut_cell_base(c,x,y,z);}
+        /** Since the triangles that are considered depend on the size of the
+         * cell, the mesh is applied after the nearby particles.
+         * \return True. */
+        bool apply_last() {return true;}
+        /** Returns the number of triangles in the mesh, excluding any
+         * degenerate triangles that were discarded.
+         * \return The number of triangles. */
+        inline int number_of_triangles() {return nt;}
+        double volume();
+    private:
+        /** The ID number associated with the wall. */
+        const int w_id;
+        /** The number of triangles. */
+        int nt;
+        /** The triangle data, with thirteen entries for each triangle: the
+         * coordinates of the three vertices, the unit outward normal, and the
+         * displacement of the triangle's plane along the normal. The
+         * triangles are ordered so that each leaf of the hierarchy refers to
+         * a consecutive range. */
+        std::vector<double> tr;
+        /** The nodes of the bounding volume hierarchy, with the root first. */
+        std::vector<wall_mesh_node> nd;
+        void setup(const std::vector<double> &v,const std::vector<int> &t);
+        void build(int k,int lo,int n,std::vector<int> &perm,std::vector<double> &cen);
+        double tri_dist_sq(const double *tp,double x,double y,double z);
+        /** Computes the squared distance from a point to the bounding box of
+         * a node.
+         * \param[in] w a reference to the node.
+         * \param[in] (x,y,z) the position of the point.
+         * \return The squared distance, which is zero if the point is inside
+         *         the box. */
+        inline double box_dist_sq(const wall_mesh_node &w,double x,double y,double z) {
+            double d=0,e;
+            if(x<w.bb[0]) {e=w.bb[0]-x;d+=e*e;} else if(x>w.bb[1]) {e=x-w.bb[1];d+=e*e;}
+            if(y<w.bb[2]) {e=w.bb[2]-y;d+=e*e;} else if(y>w.bb[3]) {e=y-w.bb[3];d+=e*e;}
+            if(z<w.bb[4]) {e=w.bb[4]-z;d+=e*e;} else if(z>w.bb[5]) {e=z-w.bb[5];d+=e*e;}
+            return d;
+        }
+};
+
+}
+
+#endif
@@ -0,0 +1,232 @@
+// Voro++, a cell-based Voronoi library
+// By Chris H. Rycroft and the Rycroft Group
+
+/** \file worklist_gen_3d.cc
+ * \brief Function implementations for the worklist_gen_3d class. */
+
+#include <cstdlib>
+#include <cmath>
+
+#include "worklist_gen_3d.hh"
+#include "config.hh"
+#include "common.hh"
+
+namespace voro {
+
+/** \brief A class holding the worklists that have been generated.
+ *
+ * The generated worklists are stored for the lifetime of the program, and
+ * freed when it exits. */
+class worklist_cache_3d {
+    public:
+        /** The worklist generators for each block shape. */
+        std::vector<worklist_gen_3d*> g;
+        ~worklist_cache_3d() {
+            for(int i=0;i<(int) g.size();i++) delete g[i];
+        }
+};
+
+/** The cache of generated worklists. */
+static worklist_cache_3d wl_cache_3d;
+
+/** Generates the block worklists for a given block shape and subgrid
+ * resolution. The construction follows the worklist_gen_3d.pl script: for
+ * each subregion, the blocks are added to the worklist one at a time, picking
+ * the block adjacent to the worklist with the smallest distance to the
+ * subregion, plus a small penalty for the distance from the previous block.
+ * The distances are measured using the actual block dimensions.
+ * \param[in] hgrid_ half the number of subregions that each block is divided
+ *                   into along each direction.
+ * \param[in] (sx_,sy_,sz_) the block dimensions, scaled so that the smallest
+ *                          is one. */
+worklist_gen_3d::worklist_gen_3d(int hgrid_,double sx_,double sy_,double sz_)
+    : hgrid(hgrid_), fgrid(2*hgrid_), sx(sx_), sy(sy_), sz(sz_),
+    wl(new unsigned int[wl_seq_length_3d*hgrid_*hgrid_*hgrid_]), v(0) {
+
+    // Set up the mask, which is made larger for elongated blocks since the
+    // worklists can then extend further along the short directions
+    double smax=sx>sy?sx:sy;
+    if(sz>smax) smax=sz;
+    dis=8*int(ceil(smax));
+    if(dis>64) dis=64;
+    d=2*dis+1;dd=d*d;d0=(1+d+dd)*dis;
+    m.assign(dd*d,0);
+    la.resize(dd*d);
+
+    // Create a worklist for each subregion
+    unsigned int *e=wl;
+    for(int kk=0;kk<hgrid;kk++) for(int jj=0;jj<hgrid;jj++)
+        for(int ii=0;ii<hgrid;ii++,e+=wl_seq_length_3d)
+            if(!worklist(ii,jj,kk,e,false)&&!worklist(ii,jj,kk,e,true))
+                voro_fatal_error("Failure in worklist construction",VOROPP_INTERNAL_ERROR);
+
+    // Free the memory used during the construction
+    std::vector<unsigned int>().swap(m);
+    std::vector<int>().swap(la);
+}
+
+/** Returns the block worklists for a given block shape and subgrid
+ * resolution, generating them if they are not already in the cache. This
+ * routine can be called from multiple threads.
+ * \param[in] hgrid half the number of subregions that each block is divided
+ *                  into along each direction.
+ * \param[in] (boxx,boxy,boxz) the dimensions of a block.
+ * \return A pointer to the worklists. */
+const unsigned int* worklist_gen_3d::worklists(int hgrid,double boxx,double boxy,double boxz) {
+
+    // Scale the block dimensions so that the smallest is one. Very elongated
+    // blocks are treated as having an aspect ratio of 64, which keeps the
+    // worklists within the range that can be encoded.
+    double bmin=boxx<boxy?boxx:boxy;
+    if(boxz<bmin) bmin=boxz;
+    double sx=boxx/bmin,sy=boxy/bmin,sz=boxz/bmin;
+    if(sx>64) sx=64;
+    if(sy>64) sy=64;
+    if(sz>64) sz=64;
+
+    const unsigned int *e=NULL;
+#pragma omp critical(voro_worklist_cache_3d)
+    {
+        std::vector<worklist_gen_3d*> &g=wl_cache_3d.g;
+        for(int i=0;i<(int) g.size();i++)
+            if(g[i]->hgrid==hgrid&&fabs(g[i]->sx-sx)<tolerance*sx
+               &&fabs(g[i]->sy-sy)<tolerance*sy&&fabs(g[i]->sz-sz)<tolerance*sz) {
+                e=g[i]->wl;break;
+            }
+        if(e==NULL) {
+            g.push_back(new worklist_gen_3d(hgrid,sx,sy,sz));
+            e=g.back()->wl;
+        }
+    }
+    return e;
+}
+
+/** Constructs the worklist for a single subregion. The first entry is the
+ * number of blocks that can be tested without considering blocks outside the
+ * worklist, and the following entries encode the block displacements and the
+ * neighboring blocks outside the worklist that need to be considered when
+ * each block is tested. The construction of the outside blocks requires that
+ * the neighbors of each worklist block in the direction of the central block
+ * are also in the worklist. For very anisotropic blocks this may not hold,
+ * in which case the worklist can be constructed again in strict mode, where
+ * a block is only added once these neighbors are in the worklist.
+ * \param[in] (ii,jj,kk) the index of the subregion.
+ * \param[out] e a pointer to the worklist to fill in.
+ * \param[in] strict whether to use strict mode.
+ * \return True if the worklist was constructed, false otherwise. */
+bool worklist_gen_3d::worklist(int ii,int jj,int kk,unsigned int *e,bool strict) {
+    int j,k,n,nx=0,xt,yt,zt,xp=0,yp=0,zp=0;
+    double x=(ii+0.5)/fgrid,y=(jj+0.5)/fgrid,z=(kk+0.5)/fgrid,wei,minwei;
+    unsigned int o;
+
+    // Add the blocks to the worklist in order of increasing distance. The
+    // candidate blocks are marked with v and the blocks in the worklist are
+    // marked with v+1. The six neighbors of the central block must be in the
+    // worklist, so the last slots are reserved for them if needed, which
+    // only happens for very elongated blocks.
+    int rem=6;
+    v+=2;
+    a.clear();b.clear();
+    m[d0]=v+1;
+    add(1,0,0);add(0,1,0);add(0,0,1);
+    add(-1,0,0);add(0,-1,0);add(0,0,-1);
+    for(int l=0;l<ls;l++) {
+        minwei=1e9;
+        for(n=0;n<(int) a.size();n+=3) {
+            xt=a[n];yt=a[n+1];zt=a[n+2];
+            if(ls-l<=rem&&abs(xt)+abs(yt)+abs(zt)!=1) continue;
+            k=d0+xt+d*yt+dd*zt;
+            if(strict&&((xt>0&&m[k-1]!=v+1)||(xt<0&&m[k+1]!=v+1)
+             ||(yt>0&&m[k-d]!=v+1)||(yt<0&&m[k+d]!=v+1)
+             ||(zt>0&&m[k-dd]!=v+1)||(zt<0&&m[k+dd]!=v+1))) continue;
+            wei=adis(x,y,z,xt,yt,zt)+0.02*sqrt((xt-xp)*sx*(xt-xp)*sx
+                +(yt-yp)*sy*(yt-yp)*sy+(zt-zp)*sz*(zt-zp)*sz);
+            if(wei<minwei) {nx=n;minwei=wei;}
+        }
+        xp=a[nx];yp=a[nx+1];zp=a[nx+2];
+        m[d0+xp+d*yp+dd*zp]=v+1;
+        if(abs(xp)+abs(yp)+abs(zp)==1) rem--;
+        add(xp+1,yp,zp);add(xp,yp+1,zp);add(xp,yp,zp+1);
+        add(xp-1,yp,zp);add(xp,yp-1,zp);add(xp,yp,zp-1);
+        b.push_back(xp);b.push_back(yp);b.push_back(zp);
+        a.erase(a.begin()+nx,a.begin()+nx+3);
+    }
+
+    // Mark all blocks that are on the worklist
+    m[d0]=++v;
+    for(n=0;n<3*ls;n+=3) m[d0+b[n]+d*b[n+1]+dd*b[n+2]]=v;
+
+    // Find which neighboring outside blocks need to be marked when
+    // considering each block, using the last possible entry that can reach
+    // a block
+    for(n=j=0;n<3*ls;n+=3,j++) {
+        xt=b[n];yt=b[n+1];zt=b[n+2];
+        k=d0+xt+d*yt+dd*zt;
+        if(xt>=0&&m[k+1]!=v) {la[k+1]=j;m[k+1]=v+1;}
+        if(yt>=0&&m[k+d]!=v) {la[k+d]=j;m[k+d]=v+1;}
+        if(zt>=0&&m[k+dd]!=v) {la[k+dd]=j;m[k+dd]=v+1;}
+        if(xt<=0&&m[k-1]!=v) {la[k-1]=j;m[k-1]=v+1;}
+        if(yt<=0&&m[k-d]!=v) {la[k-d]=j;m[k-d]=v+1;}
+        if(zt<=0&&m[k-dd]!=v) {la[k-dd]=j;m[k-dd]=v+1;}
+    }
+    for(n=0;n<3*ls;n+=3) {
+        k=d0+b[n]+d*b[n+1]+dd*b[n+2];
+        if(m[k+1]<v||m[k-1]<v||m[k+d]<v||m[k-d]<v||m[k+dd]<v||m[k-dd]<v) return false;
+    }
+
+    // Compute the number of entries where outside blocks do not need to be
+    // considered
+    for(n=j=0;n<3*ls;n+=3,j++) {
+        k=d0+b[n]+d*b[n+1]+dd*b[n+2];
+        if(m[k+1]!=v||m[k+d]!=v||m[k+dd]!=v||m[k-1]!=v||m[k-d]!=v||m[k-dd]!=v) break;
+    }
+    *e=j;
+
+    // Encode the worklist entries
+    for(n=j=0;n<3*ls;n+=3,j++) {
+        xt=b[n];yt=b[n+1];zt=b[n+2];
+        k=d0+xt+d*yt+dd*zt;
+        o=0;
+        if(m[k+1]!=v&&la[k+1]==j) o|=1;
+        if(m[k-1]!=v&&la[k-1]==j) o^=3;
+        if(m[k+d]!=v&&la[k+d]==j) o|=8;
+        if(m[k-d]!=v&&la[k-d]==j) o^=24;
+        if(m[k+dd]!=v&&la[k+dd]==j) o|=64;
+        if(m[k-dd]!=v&&la[k-dd]==j) o^=192;
+        e[j+1]=(xt+64)|(yt+64)<<7|(zt+64)<<14|o<<21;
+    }
+    return true;
+}
+
+/** Adds a block to the list of candidates, if it has not already been
+ * considered.
+ * \param[in] (xt,yt,zt) the displacement of the block. */
+void worklist_gen_3d::add(int xt,int yt,int zt) {
+    if(xt<=-dis||xt>=dis||yt<=-dis||yt>=dis||zt<=-dis||zt>=dis)
+        voro_fatal_error("Worklist construction exceeded the mask size",VOROPP_INTERNAL_ERROR);
+    unsigned int &mk=m[d0+xt+d*yt+dd*zt];
+    if(mk<v) {
+        a.push_back(xt);a.push_back(yt);a.push_back(zt);
+        mk=v;
+    }
+}
+
+/** Computes the distance from a point in the central block to the nearest
+ * point of another block, using the scaled block dimensions.
+ * \param[in] (x,y,z) the position of the point, as a fraction of the block
+ *                    dimensions.
+ * \param[in] (xt,yt,zt) the displacement of the other block.
+ * \return The distance. */
+double worklist_gen_3d::adis(double x,double y,double z,int xt,int yt,int zt) {
+    double xco=0,yco=0,zco=0;
+    if(xt>0) xco=x-xt;
+    else if(xt<0) xco=x-xt-1;
+    if(yt>0) yco=y-yt;
+    else if(yt<0) yco=y-yt-1;
+    if(zt>0) zco=z-zt;
+    else if(zt<0) zco=z-zt-1;
+    xco*=sx;yco*=sy;zco*=sz;
+    return sqrt(xco*xco+yco*yco+zco*zco);
+}
+
+}
@@ -0,0 +1,74 @@
+// Voro++, a cell-based Voronoi library
+// By Chris H. Rycroft and the Rycroft Group
+
+/** \file worklist_gen_3d.hh
+ * \brief Header file for the worklist_gen_3d class. */
+
+#ifndef VOROPP_WORKLIST_GEN_3D_HH
+#define VOROPP_WORKLIST_GEN_3D_HH
+
+#include <vector>
+
+#include "worklist_3d.hh"
+
+namespace voro {
+
+/** \brief A class for generating block worklists at run time.
+ *
+ * The precomputed block worklists in v_base_wl_3d.cc are created by the
+ * worklist_gen_3d.pl script, assuming that the computational blocks are cubes
+ * and that each block is divided into a fixed subgrid. When the blocks are
+ * strongly anisotropic, such as for thin slabs or elongated domains, the
+ * blocks are then visited in a poor order. This class carries out the same
+ * construction as the script for a given block shape and subgrid resolution.
+ * For cubic blocks and the default resolution, it reproduces the precomputed
+ * worklists exactly.
+ *
+ * Since the worklists only depend on the shape of the blocks, the generated
+ * worklists are cached for the lifetime of the program, so that containers
+ * of the same shape share them. */
+class worklist_gen_3d {
+    public:
+        /** Half the number of subregions that each block is divided into
+         * along each direction. */
+        const int hgrid;
+        /** The number of subregions that each block is divided into along
+         * each direction. */
+        const int fgrid;
+        /** The block dimensions, scaled so that the smallest is one. */
+        const double sx,sy,sz;
+        /** The generated worklists, with wl_seq_length_3d entries for each of
+         * the hgrid^3 subregions. */
+        unsigned int *wl;
+        worklist_gen_3d(int hgrid_,double sx_,double sy_,double sz_);
+        ~worklist_gen_3d() {delete [] wl;}
+        static const unsigned int* worklists(int hgrid,double boxx,double boxy,double boxz);
+    private:
+        /** The number of blocks in each worklist. */
+        static const int ls=wl_seq_length_3d-1;
+        /** The largest block displacement that can be stored in the mask. */
+        int dis;
+        /** The size of the mask in each direction. */
+        int d;
+        /** The size of a layer of the mask. */
+        int dd;
+        /** The index of the zero displacement in the mask. */
+        int d0;
+        /** The current value used to mark the mask. */
+        unsigned int v;
+        /** The mask of blocks that have been considered. */
+        std::vector<unsigned int> m;
+        /** The worklist entry that last reached each block in the mask. */
+        std::vector<int> la;
+        /** The candidate blocks that are adjacent to the worklist. */
+        std::vector<int> a;
+        /** The blocks in the current worklist. */
+        std::vector<int> b;
+        bool worklist(int ii,int jj,int kk,unsigned int *e,bool strict);
+        void add(int xt,int yt,int zt);
+        double adis(double x,double y,double z,int xt,int yt,int zt);
+};
+
+}
+
+#endif